@@ -8,7 +8,7 @@
   Description: Logfile class code module 
  
 \****************************************************************/
-#include "IMR_Log.hpp"
+#include "imr_log.hpp"
 
 // Globals:
 bool IMR_LogEnabled;
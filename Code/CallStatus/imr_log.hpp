@@ -11,15 +11,15 @@
 #ifndef IMR_LOG_HPP_INCLUDED
 #define IMR_LOG_HPP_INCLUDED
 
-#include <sys\types.h>
-#include <sys\stat.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
-#include <io.h>
 #include <malloc.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
-#include "..\CallStatus\IMR_RetVals.hpp"
+#include "../Foundation/imr_compat.hpp"
+#include "../CallStatus/imr_retvals.hpp"
 
 // Prototypes:
 int IMR_StartLogging(char *LogFile);
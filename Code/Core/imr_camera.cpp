@@ -8,7 +8,7 @@
  Description: Camera class code module
  
 \****************************************************************/
-#include "IMR_Camera.hpp"
+#include "imr_camera.hpp"
 
 /***************************************************************************\
   Sets the name of the camera.
@@ -18,8 +18,11 @@ void IMR_Camera::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
+
+// The list it's in has to index the names again:
+Name_Changed();
  }
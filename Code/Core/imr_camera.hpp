@@ -18,13 +18,14 @@
 #include <malloc.h>
 #include <math.h>
 #include <stdlib.h>
-#include "IMR_Geometry.hpp"
-#include "IMR_Table.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
-#include "..\CallStatus\IMR_RetVals.hpp"
+#include "imr_geometry.hpp"
+#include "imr_table.hpp"
+#include "../Foundation/imr_list.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
 
 // Camera interface class:
-class IMR_Camera
+class IMR_Camera : public IMR_NamedItem
     {
     protected:
       // Miscellaneous
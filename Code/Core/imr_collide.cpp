@@ -8,47 +8,584 @@
  Description: Simple ellipsoid-space based collision detection library
  
 \****************************************************************/
-#include "IMR_Collide.hpp"
+#include "imr_collide.hpp"
 
 IMR_3DPoint DbgInfo[4];
 
 /***************************************************************************\
   Returns true if the specified sphere intersects with the bounding sphere
-  of the specified poly.
+  of the specified poly.  The sphere and the poly must be in the same space.
 \***************************************************************************/
 int IMR_Collide_InRange(IMR_3DPoint &Pnt1, float RadiusSquared, IMR_Polygon &Poly)
 {
-float dX, dY, dZ, DistSquared;
-IMR_3DPoint Hit, Delta;
+float dX, dY, dZ, DistSquared, Reach;
 
-Delta = Poly.Centroid - Hit;
-dX = Delta.X;
-dY = Delta.Y; 
-dZ = Delta.Z;
+dX = Poly.Centroid.X - Pnt1.X;
+dY = Poly.Centroid.Y - Pnt1.Y; 
+dZ = Poly.Centroid.Z - Pnt1.Z;
 DistSquared = (dX * dX) + (dY * dY) + (dZ * dZ);
-if (DistSquared < RadiusSquared)
+Reach = sqrt(RadiusSquared) + Poly.Radius;
+if (DistSquared < Reach * Reach)
     return 1;
 
 return 0;
  }
 
+/***************************************************************************\
+  Finds the box (in world coords) swept by the ellipsoid as it moves along
+  the velocity in the collision info.  If something's already been hit, 
+  the box only goes as far as the hit, since nothing past it matters.
+\***************************************************************************/
+void IMR_Collide_FindSweptBox(IMR_CollideInfo &Info, float *Min, float *Max)
+{
+IMR_3DPoint Dest = Info.SourcePoint + Info.Velocity;
+float Scale[3], *Src = &Info.SourcePoint.X, *Dst = &Dest.X, *Vel = &Info.Velocity.X, Length;
+int c;
+
+// Stop at the nearest hit so far:
+if (Info.foundCollision)
+    {
+    Length = Info.Velocity.Mag();
+    if (Info.nearestDistance < Length)
+        for (c = 0; c < 3; c ++)
+            Dst[c] = Src[c] + (Vel[c] * (Info.nearestDistance / Length));
+     }
+
+Scale[0] = Info.Rh; Scale[1] = Info.Rv; Scale[2] = Info.Rh;
+for (c = 0; c < 3; c ++)
+    {
+    Min[c] = Src[c] < Dst[c] ? Src[c] : Dst[c];
+    Max[c] = Src[c] > Dst[c] ? Src[c] : Dst[c];
+    Min[c] = (Min[c] - 1.0f - IMR_COLLIDE_EPSILON) * Scale[c];
+    Max[c] = (Max[c] + 1.0f + IMR_COLLIDE_EPSILON) * Scale[c];
+     }
+ }
+
+/***************************************************************************\
+  Returns true if the two boxes overlap.
+\***************************************************************************/
+int IMR_Collide_BoxesOverlap(float *MinA, float *MaxA, float *MinB, float *MaxB)
+{
+return !(MinA[0] > MaxB[0] || MaxA[0] < MinB[0] ||
+         MinA[1] > MaxB[1] || MaxA[1] < MinB[1] ||
+         MinA[2] > MaxB[2] || MaxA[2] < MinB[2]);
+ }
+
+/***************************************************************************\
+  Returns true if the ray passes through the specified box (global coords)
+  before it's current nearest hit, false if not.
+\***************************************************************************/
+int IMR_Collide_RayHitsBox(IMR_CollideRay &Ray, float *Min, float *Max)
+{
+float Near, Far, Inv, t1, t2, Temp;
+int c;
+
+Near = 0;
+Far = Ray.Distance;
+for (c = 0; c < 3; c ++)
+    {
+    if (!(&Ray.Dir.X)[c])
+        {
+        // Parallel to the slab, so it has to start inside it:
+        if ((&Ray.Origin.X)[c] < Min[c] || (&Ray.Origin.X)[c] > Max[c]) return 0;
+        continue;
+         }
+    Inv = 1.0f / (&Ray.Dir.X)[c];
+    t1 = (Min[c] - (&Ray.Origin.X)[c]) * Inv;
+    t2 = (Max[c] - (&Ray.Origin.X)[c]) * Inv;
+    if (t1 > t2) { Temp = t1; t1 = t2; t2 = Temp; }
+    if (t1 > Near) Near = t1;
+    if (t2 < Far) Far = t2;
+    if (Near > Far) return 0;
+     }
+return 1;
+ }
+
+// Data passed from IMR_Collide_RayModel() to the tree query:
+struct IMR_CollideRayQuery
+    {
+    IMR_CollideMesh *Mesh;
+    float Origin[3], Dir[3];                // Ray (model coords)
+    int AnyHit;                             // Flags to stop at the first hit found
+    int Tri;                                // Nearest triangle hit (-1 if none)
+    float T;                                // Distance to it
+     };
+
+/***************************************************************************\
+  Intersects the ray with a triangle of the mesh (Moller-Trumbore, using
+  the mesh's edges) and shortens the ray if it's hit.  Both sides of the
+  triangle count.  Called by IMR_CollideBVH::Query_Ray().
+  Returns nonzero to stop the query.
+\***************************************************************************/
+static int IMR_Collide_RayTriangle(void *Data, int Tri, float *MaxT)
+{
+IMR_CollideRayQuery &Q = *(IMR_CollideRayQuery *)Data;
+IMR_CollideMesh &M = *Q.Mesh;
+float pX, pY, pZ, tX, tY, tZ, qX, qY, qZ, Det, Inv, u, v, t;
+
+// Find the determinant (zero if the ray is in the plane):
+pX = (Q.Dir[1] * M.E2z[Tri]) - (Q.Dir[2] * M.E2y[Tri]);
+pY = (Q.Dir[2] * M.E2x[Tri]) - (Q.Dir[0] * M.E2z[Tri]);
+pZ = (Q.Dir[0] * M.E2y[Tri]) - (Q.Dir[1] * M.E2x[Tri]);
+Det = (M.E1x[Tri] * pX) + (M.E1y[Tri] * pY) + (M.E1z[Tri] * pZ);
+if (Det > -1e-12f && Det < 1e-12f) return 0;
+Inv = 1.0f / Det;
+
+// Find the first barycentric coord:
+tX = Q.Origin[0] - M.Ax[Tri];
+tY = Q.Origin[1] - M.Ay[Tri];
+tZ = Q.Origin[2] - M.Az[Tri];
+u = ((tX * pX) + (tY * pY) + (tZ * pZ)) * Inv;
+if (u < 0.0f || u > 1.0f) return 0;
+
+// And the second:
+qX = (tY * M.E1z[Tri]) - (tZ * M.E1y[Tri]);
+qY = (tZ * M.E1x[Tri]) - (tX * M.E1z[Tri]);
+qZ = (tX * M.E1y[Tri]) - (tY * M.E1x[Tri]);
+v = ((Q.Dir[0] * qX) + (Q.Dir[1] * qY) + (Q.Dir[2] * qZ)) * Inv;
+if (v < 0.0f || u + v > 1.0f) return 0;
+
+// Find the distance along the ray:
+t = ((M.E2x[Tri] * qX) + (M.E2y[Tri] * qY) + (M.E2z[Tri] * qZ)) * Inv;
+if (t < 0.0f || t > *MaxT) return 0;
+
+// Save the hit:
+*MaxT = Q.T = t;
+Q.Tri = Tri;
+return Q.AnyHit;
+ }
+
+/***************************************************************************\
+  Casts the ray at the specified model (at the specified position, turned
+  by the specified rotation matrix).  Only hits nearer than the ray's 
+  current nearest hit count.  If AnyHit is set the first hit found is 
+  taken instead of the nearest one (good enough for line of sight).
+  Only reads the model's collision tree and mesh, so it's safe to call 
+  from several threads once the tree is built.
+  Returns true if the model was hit, false if not.
+\***************************************************************************/
+int IMR_Collide_RayModel(IMR_Model *Mdl, IMR_3DPoint &Pos, IMR_Matrix &Rot, IMR_CollideRay &Ray, int AnyHit)
+{
+IMR_CollideRayQuery Q;
+IMR_CollideBVH *BVH;
+IMR_CollideMesh *M;
+float X, Y, Z;
+int c;
+
+// Get the model's collision tree and mesh:
+if (!Mdl || !(BVH = Mdl->Get_CollideBVH())) return 0;
+M = Q.Mesh = Mdl->Get_CollideMesh();
+
+// Move the ray into model space (the inverse of a rotation is it's 
+// transpose, and the distances don't change):
+X = Ray.Origin.X - Pos.X;
+Y = Ray.Origin.Y - Pos.Y;
+Z = Ray.Origin.Z - Pos.Z;
+for (c = 0; c < 3; c ++)
+    {
+    Q.Origin[c] = (X * Rot.Mtrx[c][0]) + (Y * Rot.Mtrx[c][1]) + (Z * Rot.Mtrx[c][2]);
+    Q.Dir[c] = (Ray.Dir.X * Rot.Mtrx[c][0]) + (Ray.Dir.Y * Rot.Mtrx[c][1]) + (Ray.Dir.Z * Rot.Mtrx[c][2]);
+     }
+Q.AnyHit = AnyHit;
+Q.Tri = -1;
+
+// Walk the tree:
+BVH->Query_Ray(Q.Origin, Q.Dir, Ray.Distance, IMR_Collide_RayTriangle, &Q);
+if (Q.Tri < 0) return 0;
+
+// Save the hit:
+Ray.Hit = 1;
+Ray.Distance = Q.T;
+Ray.Point.X = Ray.Origin.X + (Ray.Dir.X * Q.T);
+Ray.Point.Y = Ray.Origin.Y + (Ray.Dir.Y * Q.T);
+Ray.Point.Z = Ray.Origin.Z + (Ray.Dir.Z * Q.T);
+Ray.Normal.X = (M->Nx[Q.Tri] * Rot.Mtrx[0][0]) + (M->Ny[Q.Tri] * Rot.Mtrx[1][0]) + (M->Nz[Q.Tri] * Rot.Mtrx[2][0]);
+Ray.Normal.Y = (M->Nx[Q.Tri] * Rot.Mtrx[0][1]) + (M->Ny[Q.Tri] * Rot.Mtrx[1][1]) + (M->Nz[Q.Tri] * Rot.Mtrx[2][1]);
+Ray.Normal.Z = (M->Nx[Q.Tri] * Rot.Mtrx[0][2]) + (M->Ny[Q.Tri] * Rot.Mtrx[1][2]) + (M->Nz[Q.Tri] * Rot.Mtrx[2][2]);
+return 1;
+ }
+
+// Data passed from IMR_Collide_CheckModCollision() to the tree query:
+struct IMR_CollideQuery
+    {
+    IMR_Model *Mdl;
+    IMR_CollideMesh *Mesh;
+    IMR_CollideBVH *BVH;
+    IMR_CollideInfo *Info;
+    void *Obj;                              // Object the model is in (for the contact cache)
+    int SkipTris[IMR_COLLIDE_MAXCONTACTS];  // Cached triangles already tested
+    int Num_Skip;
+    IMR_Matrix Transform;                   // Model rotation
+    IMR_3DPoint WorldPos;                   // Model position
+    IMR_3DPoint eRadius;                    // World to ellipsoid space scale
+    IMR_3DPoint Offset;                     // Model position (ellipsoid space)
+    float *WorldVerts;                      // Cached world coords of the model (or NULL)
+    int ModelSpace;                         // Flags if the ellipsoid was moved into model space
+    IMR_CollideScaled *Scaled;              // Ellipsoid space copy of the mesh to use (or NULL)
+    IMR_3DPoint SegStart, SegDelta;         // Path of the ellipsoid center (model coords)
+    float SegLengthSquared, Reach;          // Squared length of path, reach of the ellipsoid
+    int LastPoly, LastInRange;              // Last poly checked against the path
+    IMR_CollidePacket Packet;               // Triangles waiting to be swept
+    IMR_3DPoint Source;                     // Source point (ellipsoid space)
+    IMR_3DPoint normalizedVelocity;         // Direction of motion (ellipsoid space)
+    float distanceToTravel;                 // Length of motion (ellipsoid space)
+     };
+
+/***************************************************************************\
+  Gets the specified corner of a mesh triangle in the space the query is 
+  done in: world coords from the object's cache, model coords if the 
+  ellipsoid was moved into model space, or otherwise transformed to world
+  coords on the fly.
+\***************************************************************************/
+static inline void IMR_Collide_GetCorner(IMR_CollideQuery &Q, int Tri, int Corner, IMR_3DPoint &P)
+{
+IMR_CollideMesh &M = *Q.Mesh;
+float *World, X, Y, Z;
+
+// Use the cache if we have it:
+if (Q.WorldVerts)
+    {
+    World = &Q.WorldVerts[M.Verts[Tri * 3 + Corner] * 3];
+    P.X = World[0];
+    P.Y = World[1];
+    P.Z = World[2];
+    return;
+     }
+
+// Otherwise get the corner from the mesh:
+X = M.Ax[Tri]; Y = M.Ay[Tri]; Z = M.Az[Tri];
+if (Corner == 1) { X += M.E1x[Tri]; Y += M.E1y[Tri]; Z += M.E1z[Tri]; }
+if (Corner == 2) { X += M.E2x[Tri]; Y += M.E2y[Tri]; Z += M.E2z[Tri]; }
+if (Q.ModelSpace)
+    {
+    P.X = X;
+    P.Y = Y;
+    P.Z = Z;
+     }
+else
+    {
+    P.X = (X * Q.Transform.Mtrx[0][0]) + (Y * Q.Transform.Mtrx[1][0]) + (Z * Q.Transform.Mtrx[2][0]) + Q.WorldPos.X;
+    P.Y = (X * Q.Transform.Mtrx[0][1]) + (Y * Q.Transform.Mtrx[1][1]) + (Z * Q.Transform.Mtrx[2][1]) + Q.WorldPos.Y;
+    P.Z = (X * Q.Transform.Mtrx[0][2]) + (Y * Q.Transform.Mtrx[1][2]) + (Z * Q.Transform.Mtrx[2][2]) + Q.WorldPos.Z;
+     }
+ }
+
+/***************************************************************************\
+  Moves a point in model ellipsoid space back to world ellipsoid space, or
+  just turns it if the offset isn't wanted (for normals).
+\***************************************************************************/
+static inline void IMR_Collide_ModelToWorld(IMR_CollideQuery &Q, IMR_3DPoint &P, int Offset)
+{
+float X = P.X, Y = P.Y, Z = P.Z;
+
+P.X = (X * Q.Transform.Mtrx[0][0]) + (Y * Q.Transform.Mtrx[1][0]) + (Z * Q.Transform.Mtrx[2][0]);
+P.Y = (X * Q.Transform.Mtrx[0][1]) + (Y * Q.Transform.Mtrx[1][1]) + (Z * Q.Transform.Mtrx[2][1]);
+P.Z = (X * Q.Transform.Mtrx[0][2]) + (Y * Q.Transform.Mtrx[1][2]) + (Z * Q.Transform.Mtrx[2][2]);
+if (Offset) P += Q.Offset;
+ }
+
+/***************************************************************************\
+  Moves a vector in world ellipsoid space into model ellipsoid space (the
+  inverse of a rotation is it's transpose).
+\***************************************************************************/
+static inline void IMR_Collide_WorldToModel(IMR_CollideQuery &Q, IMR_3DPoint &P)
+{
+float X = P.X, Y = P.Y, Z = P.Z;
+
+P.X = (X * Q.Transform.Mtrx[0][0]) + (Y * Q.Transform.Mtrx[0][1]) + (Z * Q.Transform.Mtrx[0][2]);
+P.Y = (X * Q.Transform.Mtrx[1][0]) + (Y * Q.Transform.Mtrx[1][1]) + (Z * Q.Transform.Mtrx[1][2]);
+P.Z = (X * Q.Transform.Mtrx[2][0]) + (Y * Q.Transform.Mtrx[2][1]) + (Z * Q.Transform.Mtrx[2][2]);
+ }
+
+/***************************************************************************\
+  Adds a triangle to the contacts found by this move.  If the list is full
+  it replaces the farthest one (if that's farther).
+\***************************************************************************/
+static void IMR_Collide_AddContact(IMR_CollideQuery &Q, int Tri, float Distance)
+{
+IMR_CollideInfo &Info = *Q.Info;
+IMR_CollideContact *Contact;
+int index, Far;
+
+// If it's already there, just keep the closer distance:
+Far = 0;
+for (index = 0; index < Info.numNewContacts; index ++)
+    {
+    Contact = &Info.newContacts[index];
+    if (Contact->Tri == Tri && Contact->Obj == Q.Obj && Contact->Mdl == Q.Mdl)
+        {
+        if (Distance < Contact->Distance) Contact->Distance = Distance;
+        return;
+         }
+    if (Contact->Distance > Info.newContacts[Far].Distance) Far = index;
+     }
+
+// Find a spot for it:
+if (Info.numNewContacts < IMR_COLLIDE_MAXCONTACTS)
+    Contact = &Info.newContacts[Info.numNewContacts ++];
+else if (Distance < Info.newContacts[Far].Distance)
+    Contact = &Info.newContacts[Far];
+else
+    return;
+
+// And fill it in:
+Contact->Obj = Q.Obj;
+Contact->Mdl = Q.Mdl;
+Contact->Revision = Q.Mdl->Get_Revision();
+Contact->Tri = Tri;
+Contact->Distance = Distance;
+ }
+
+/***************************************************************************\
+  Sweeps the ellipsoid against the triangles gathered in the query's packet
+  and updates the collision info with the closest hit so far.
+\***************************************************************************/
+static void IMR_Collide_FlushPacket(IMR_CollideQuery &Q)
+{
+IMR_CollidePacket &Pkt = Q.Packet;
+IMR_CollideHit Hits[IMR_COLLIDE_PACKETSIZE];
+int tri;
+
+// Make sure there's something to do:
+if (!Pkt.Num) return;
+
+// Fill the unused slots with copies of the first triangle:
+for (tri = Pkt.Num; tri < IMR_COLLIDE_PACKETSIZE; tri ++)
+    {
+    Pkt.Ax[tri] = Pkt.Ax[0]; Pkt.Ay[tri] = Pkt.Ay[0]; Pkt.Az[tri] = Pkt.Az[0];
+    Pkt.Bx[tri] = Pkt.Bx[0]; Pkt.By[tri] = Pkt.By[0]; Pkt.Bz[tri] = Pkt.Bz[0];
+    Pkt.Cx[tri] = Pkt.Cx[0]; Pkt.Cy[tri] = Pkt.Cy[0]; Pkt.Cz[tri] = Pkt.Cz[0];
+    Pkt.Nx[tri] = Pkt.Nx[0]; Pkt.Ny[tri] = Pkt.Ny[0]; Pkt.Nz[tri] = Pkt.Nz[0];
+     }
+
+// Sweep the whole packet:
+IMR_Collide_SweepPacket(Pkt, Q.Source, Q.normalizedVelocity, Hits);
+
+// Handle the results:
+for (tri = 0; tri < Pkt.Num; tri ++)
+    {
+    // Put the hit points back in world space:
+    if (Q.ModelSpace)
+        {
+        IMR_Collide_ModelToWorld(Q, Hits[tri].SpherePoint, 1);
+        IMR_Collide_ModelToWorld(Q, Hits[tri].PolyPoint, 1);
+         }
+
+    if (!Q.Info->Shared) DbgInfo[0] = Hits[tri].PolyPoint;
+    
+    // Here we do the error checking to see if we got ourself stuck last frame:
+    if (IMR_Collide_CheckPointInSphere(Hits[tri].PolyPoint, Q.Info->SourcePoint, 1.0f))
+        Q.Info->stuck = 1;
+
+    // Remember it for next time if it was hit or nearly hit:
+    if ((Hits[tri].Distance > 0) && (Hits[tri].Distance <= Q.distanceToTravel + IMR_COLLIDE_CONTACTREACH))
+        IMR_Collide_AddContact(Q, Pkt.Tri[tri], Hits[tri].Distance);
+
+    // Ok, now we might update the collision data if we hit something:
+    if ((Hits[tri].Distance > 0) && (Hits[tri].Distance <= Q.distanceToTravel))
+        { 
+        if (!Q.Info->foundCollision || (Hits[tri].Distance < Q.Info->nearestDistance))
+            {
+            // If this is the first hit or the closest so far, save the information:
+            Q.Info->nearestDistance = Hits[tri].Distance;
+            Q.Info->nearestIntersectionPoint = Hits[tri].SpherePoint;
+            Q.Info->nearestPolygonIntersectionPoint = Hits[tri].PolyPoint;
+            Q.Info->foundCollision = 1;
+             }
+         } 
+     }
+
+// Empty the packet:
+Pkt.Num = 0;
+ }
+
+/***************************************************************************\
+  Adds a triangle from the tree to the query's packet if it's near the path
+  of the ellipsoid and faces it, and sweeps the packet once it's full.  
+  Called by IMR_CollideBVH::Query() for each triangle near the motion.
+  Only reads the collision mesh (and the object's cache).
+\***************************************************************************/
+static void IMR_Collide_CheckTriangle(void *Data, int Tri)
+{
+IMR_CollideQuery &Q = *(IMR_CollideQuery *)Data;
+IMR_CollideMesh &M = *Q.Mesh;
+IMR_CollidePacket &Pkt = Q.Packet;
+IMR_3DPoint p1, p2, p3;
+IMR_3DPoint pNormal;
+float *Sphere, t, dX, dY, dZ, Reach;
+int Slot;
+
+// Skip it if it was already tested from the contact cache:
+for (Slot = 0; Slot < Q.Num_Skip; Slot ++)
+    if (Q.SkipTris[Slot] == Tri) return;
+
+// Count it:
+++ Q.Info->trianglesTested;
+
+// Skip the poly if it's bounding sphere is too far from the path (quads are 
+// split in two, so remember the last answer):
+if (M.Group[Tri] != Q.LastPoly)
+    {
+    Q.LastPoly = M.Group[Tri];
+    Sphere = &M.Spheres[Q.LastPoly * 4];
+    t = 0;
+    if (Q.SegLengthSquared > 0)
+        {
+        t = (((Sphere[0] - Q.SegStart.X) * Q.SegDelta.X) + 
+             ((Sphere[1] - Q.SegStart.Y) * Q.SegDelta.Y) + 
+             ((Sphere[2] - Q.SegStart.Z) * Q.SegDelta.Z)) / Q.SegLengthSquared;
+        if (t < 0) t = 0; else if (t > 1) t = 1;
+         }
+    dX = Sphere[0] - (Q.SegStart.X + (Q.SegDelta.X * t));
+    dY = Sphere[1] - (Q.SegStart.Y + (Q.SegDelta.Y * t));
+    dZ = Sphere[2] - (Q.SegStart.Z + (Q.SegDelta.Z * t));
+    Reach = Q.Reach + Sphere[3];
+    Q.LastInRange = ((dX * dX) + (dY * dY) + (dZ * dZ)) < Reach * Reach;
+     }
+if (!Q.LastInRange) return;
+
+// Get the corners in ellipsoid space and the normal:
+pNormal.X = M.Nx[Tri]; pNormal.Y = M.Ny[Tri]; pNormal.Z = M.Nz[Tri];
+if (Q.Scaled)
+    {
+    p1.X = Q.Scaled->Ax[Tri]; p1.Y = Q.Scaled->Ay[Tri]; p1.Z = Q.Scaled->Az[Tri];
+    p2.X = Q.Scaled->Bx[Tri]; p2.Y = Q.Scaled->By[Tri]; p2.Z = Q.Scaled->Bz[Tri];
+    p3.X = Q.Scaled->Cx[Tri]; p3.Y = Q.Scaled->Cy[Tri]; p3.Z = Q.Scaled->Cz[Tri];
+     }
+else
+    {
+    IMR_Collide_GetCorner(Q, Tri, 0, p1);
+    IMR_Collide_GetCorner(Q, Tri, 1, p2);
+    IMR_Collide_GetCorner(Q, Tri, 2, p3);
+    p1 = p1 * Q.eRadius;
+    p2 = p2 * Q.eRadius;
+    p3 = p3 * Q.eRadius;
+    if (!Q.ModelSpace) IMR_Collide_ModelToWorld(Q, pNormal, 0);
+     }
+
+// Ignore backfaces:
+if (pNormal.Dot_Product(Q.normalizedVelocity) >= 1.0f) return;
+
+// Add it to the packet:
+Slot = Pkt.Num ++;
+Pkt.Ax[Slot] = p1.X; Pkt.Ay[Slot] = p1.Y; Pkt.Az[Slot] = p1.Z;
+Pkt.Bx[Slot] = p2.X; Pkt.By[Slot] = p2.Y; Pkt.Bz[Slot] = p2.Z;
+Pkt.Cx[Slot] = p3.X; Pkt.Cy[Slot] = p3.Y; Pkt.Cz[Slot] = p3.Z;
+Pkt.Nx[Slot] = pNormal.X; Pkt.Ny[Slot] = pNormal.Y; Pkt.Nz[Slot] = pNormal.Z;
+Pkt.Tri[Slot] = Tri;
+
+// And sweep it if it's full:
+if (Pkt.Num == IMR_COLLIDE_PACKETSIZE) IMR_Collide_FlushPacket(Q);
+ }
+
+/***************************************************************************\
+  Sets up a query of the specified model for the collision checks below:
+  picks the space to work in and finds the path of the ellipsoid.  If the
+  cached triangles were already tested, the ones in this model are skipped.
+  Returns false if the model has no collision tree.
+\***************************************************************************/
+static int IMR_Collide_SetupQuery(IMR_CollideQuery &Q, IMR_Model *Mdl, IMR_3DPoint &WorldPos, IMR_Matrix &WorldRot, IMR_CollideInfo &Info, float *WorldVerts, void *Obj)
+{
+IMR_CollideContact *Contact;
+int index;
+
+// Get the model's collision tree and mesh:
+if (!(Q.BVH = Mdl->Get_CollideBVH()))
+    return 0;
+Q.Mesh = Mdl->Get_CollideMesh();
+
+// From info:
+Q.Mdl = Mdl;
+Q.Obj = Obj;
+Q.Info = &Info;
+Q.WorldPos = WorldPos;
+Q.Source = Info.SourcePoint;
+Q.eRadius.X = Q.eRadius.Z = Info.invRh; Q.eRadius.Y = Info.invRv;
+
+// Make a normalized velocity vector and find it's length:
+Q.normalizedVelocity = Info.Velocity;
+Q.normalizedVelocity.Make_Unit();
+Q.distanceToTravel = Info.Velocity.Mag();
+
+// Get the model's rotation:
+Q.Transform = WorldRot;
+
+// Pick the space to work in:
+Q.WorldVerts = WorldVerts;
+Q.ModelSpace = 0;
+Q.Scaled = NULL;
+if (!WorldVerts && Q.Transform.Mtrx[1][1] == 1.0f && 
+    Q.Transform.Mtrx[0][1] == 0.0f && Q.Transform.Mtrx[1][0] == 0.0f &&
+    Q.Transform.Mtrx[1][2] == 0.0f && Q.Transform.Mtrx[2][1] == 0.0f)
+    {
+    // Move the ellipsoid instead of the model:
+    Q.ModelSpace = 1;
+    Q.Offset = WorldPos * Q.eRadius;
+    Q.Source -= Q.Offset;
+    IMR_Collide_WorldToModel(Q, Q.Source);
+    IMR_Collide_WorldToModel(Q, Q.normalizedVelocity);
+
+    // Use the mesh's ellipsoid space copy if we can (but don't make one if
+    // other threads are reading the mesh):
+    if (Info.Shared)
+        Q.Scaled = Q.Mesh->Get_Prepared(Info.invRh, Info.invRv);
+    else
+        Q.Scaled = Q.Mesh->Prepare(Info.invRh, Info.invRv);
+     }
+
+// Find the path of the ellipsoid's center in model coords for rejecting 
+// polys by their bounding spheres:
+Q.SegStart.X = (Info.SourcePoint.X * Info.Rh) - WorldPos.X;
+Q.SegStart.Y = (Info.SourcePoint.Y * Info.Rv) - WorldPos.Y;
+Q.SegStart.Z = (Info.SourcePoint.Z * Info.Rh) - WorldPos.Z;
+Q.SegDelta.X = Info.Velocity.X * Info.Rh;
+Q.SegDelta.Y = Info.Velocity.Y * Info.Rv;
+Q.SegDelta.Z = Info.Velocity.Z * Info.Rh;
+IMR_Collide_WorldToModel(Q, Q.SegStart);
+IMR_Collide_WorldToModel(Q, Q.SegDelta);
+Q.SegLengthSquared = Q.SegDelta.Dot_Product(Q.SegDelta);
+Q.Reach = (Info.Rh > Info.Rv ? Info.Rh : Info.Rv) * (1.0f + IMR_COLLIDE_EPSILON);
+Q.LastPoly = -1;
+Q.LastInRange = 0;
+Q.Packet.Num = 0;
+
+// Skip the cached triangles in this model if they've been done:
+Q.Num_Skip = 0;
+if (Info.checkedContacts)
+    for (index = 0; index < Info.numContacts; index ++)
+        {
+        Contact = &Info.contacts[index];
+        if (Contact->Obj == Obj && Contact->Mdl == Mdl && Contact->Revision == Mdl->Get_Revision())
+            Q.SkipTris[Q.Num_Skip ++] = Contact->Tri;
+         }
+
+// And return ok:
+return 1;
+ }
+
 /***************************************************************************\
   Checks for collisions on the specified model.  Passed position should be
   in world ellipsoid space, will be converted to model and ellipsoid space 
   internally.
-  Quadrilaterals will be split into triangles and tested seperately.
-  Updates collision info structure according to collision status.
+  Only the triangles in the model's collision tree that are near the 
+  swept ellipsoid are tested, and the model itself isn't modified.  If the
+  object caches it's world coords they're used, otherwise if the model is
+  only turned about Y the ellipsoid is moved into model space instead 
+  (the horizontal radius is the same in X and Z, so this is exact).
+  If Info.Shared is set nothing is built or cached, so several threads 
+  can check the same model as long as it's collision tree is up to date.
+  Obj is the object the model is in, and is only used to tell the 
+  triangles in the contact cache apart.
   
   Code originally by Telemachos of Peroxide and adapted by DH
   Returns flag stating actions taken.
 \***************************************************************************/
-int IMR_Collide_CheckModCollision(IMR_Model *Mdl, IMR_3DPoint WorldPos, IMR_Attitude WorldAtd, IMR_CollideInfo &Info)
+int IMR_Collide_CheckModCollision(IMR_Model *Mdl, IMR_3DPoint WorldPos, IMR_Matrix &WorldRot, IMR_CollideInfo &Info, float *WorldVerts, void *Obj)
 {
-int A, B, C;
-IMR_3DPoint p1,p2,p3;
-IMR_3DPoint pNormal;
-IMR_3DPoint pOrigin;
-IMR_3DPoint v1, v2;
+IMR_CollideQuery Q;
+IMR_3DPoint Center;
+float Min[3], Max[3], Extent[3], BoxMin[3], BoxMax[3];
+int c;
 
 // Make sure we have a model:
 if (!Mdl)
@@ -57,171 +594,154 @@ if (!Mdl)
     return IMR_COLLIDE_NOCOLLISION;
      }
 
-// From info:
-IMR_3DPoint source = Info.SourcePoint;
-IMR_3DPoint velocity = Info.Velocity;
-IMR_3DPoint eRadius; eRadius.X = eRadius.Z = Info.invRh; eRadius.Y = Info.invRv;
-
-// Setup intersection data:
-IMR_3DPoint sIPoint;    // sphere intersection point
-IMR_3DPoint pIPoint;    // plane intersection point  
-IMR_3DPoint polyIPoint; // polygon intersection point
-
-// Make a normalized velocity vector and transform our other vectors:
-IMR_3DPoint normalizedVelocity = velocity;
-normalizedVelocity.Make_Unit();
-
-// Calculate length of velocity vector:
-float distanceToTravel = velocity.Mag();
-float distToPlaneIntersection;
-float distToEllipsoidIntersection;
-  
-// Loop through all faces in the model:
-int isQuad = 0;
-int index;
+// Set up the query:
+if (!IMR_Collide_SetupQuery(Q, Mdl, WorldPos, WorldRot, Info, WorldVerts, Obj))
+    return IMR_COLLIDE_NOCOLLISION;
 
-// Get transformed coords. for the model:
-IMR_Matrix Transform;
-Transform.Rotate(WorldAtd.X, WorldAtd.Y, WorldAtd.Z);
-for (index = 0; index < Mdl->Num_Vertices; index ++)
+// Find the box swept by the ellipsoid (relative to the model's position):
+IMR_Collide_FindSweptBox(Info, Min, Max);
+for (c = 0; c < 3; c ++)
     {
-    Mdl->Vertices[index].LocalToActive();
-    Mdl->Vertices[index].Transform(Transform);
-    Mdl->Vertices[index] += WorldPos;           // Leave in active buffer...
+    Extent[c] = (Max[c] - Min[c]) * 0.5f;
+    (&Center.X)[c] = ((Min[c] + Max[c]) * 0.5f) - (&WorldPos.X)[c];
      }
 
-// Now check for collisions on each poly:
-for (int i = 0; i < Mdl->Num_Polygons; i ++)
+// Rotate the box into model space (the inverse of a rotation is it's 
+// transpose) and query the tree with it:
+for (c = 0; c < 3; c ++)
     {
-    index = i;
+    Max[c] = (Center.X * Q.Transform.Mtrx[c][0]) + (Center.Y * Q.Transform.Mtrx[c][1]) + (Center.Z * Q.Transform.Mtrx[c][2]);
+    Min[c] = (Extent[0] * fabs(Q.Transform.Mtrx[c][0])) + (Extent[1] * fabs(Q.Transform.Mtrx[c][1])) + (Extent[2] * fabs(Q.Transform.Mtrx[c][2]));
+    BoxMin[c] = Max[c] - Min[c];
+    BoxMax[c] = Max[c] + Min[c];
+     }
+Q.BVH->Query(BoxMin, BoxMax, IMR_Collide_CheckTriangle, &Q);
+IMR_Collide_FlushPacket(Q);
 
-    // Handle quads:
-    if (Mdl->Polygons[i].Num_Verts == 4 && isQuad == 0) // First loop through this quad, do first half
-        {
-        isQuad = 1;
-        A = Mdl->Polygons[i].Vtx_Index[0];
-        B = Mdl->Polygons[i].Vtx_Index[1];
-        C = Mdl->Polygons[i].Vtx_Index[3];
-        i --;   // Do this poly again on the next iteration
-         }
-    else if (Mdl->Polygons[i].Num_Verts == 4 && isQuad == 1) // Second loop through this quad, do second half
-        {
-        isQuad = 0;
-        A = Mdl->Polygons[i].Vtx_Index[1];
-        B = Mdl->Polygons[i].Vtx_Index[2];
-        C = Mdl->Polygons[i].Vtx_Index[3];
-         }
-    else                                        // Just a triangle... no problem        
-        {
-        A = Mdl->Polygons[i].Vtx_Index[0];
-        B = Mdl->Polygons[i].Vtx_Index[1];
-        C = Mdl->Polygons[i].Vtx_Index[2];
-         }
+// And return our action flag:
+if (Info.foundCollision) return IMR_COLLIDE_COLLIDING;
+return IMR_COLLIDE_NOCOLLISION;
+ }
 
-    //////
-    // Hack alert!
-    //    Normal vertices in model shouldn't be used as regular vertices for polygons,
-    //    assuming the models are properly constructed.
-    //////
+/***************************************************************************\
+  Checks for collisions on just the triangles of the specified model that
+  are in the contact cache (see IMR_Collide_CheckModCollision()).  Done 
+  before the full check so there's a close hit early, which shrinks the 
+  box the full check searches.
+  Returns flag stating actions taken.
+\***************************************************************************/
+int IMR_Collide_CheckModContacts(IMR_Model *Mdl, IMR_3DPoint WorldPos, IMR_Matrix &WorldRot, IMR_CollideInfo &Info, float *WorldVerts, void *Obj)
+{
+IMR_CollideQuery Q;
+IMR_CollideContact *Contact;
+int index;
 
-    // Get the data for the triangle:
-    p1 = Mdl->Vertices[A] * eRadius;
-    p2 = Mdl->Vertices[B] * eRadius;
-    p3 = Mdl->Vertices[C] * eRadius;
-    
-    // Get normal to plane containing polygon:
-    pNormal = *Mdl->Polygons[index].Normal - *Mdl->Polygons[index].Vtx_List[0];
-    pNormal.Make_Unit();
-    //pNormal = (pNormal * eRadius) - *Mdl->Polygons[index].Vtx_List[0];
+// Make sure we have a model with cached triangles:
+if (!Mdl) return IMR_COLLIDE_NOCOLLISION;
+for (index = 0; index < Info.numContacts; index ++)
+    if (Info.contacts[index].Obj == Obj && Info.contacts[index].Mdl == Mdl) break;
+if (index == Info.numContacts) return IMR_COLLIDE_NOCOLLISION;
 
-    pOrigin = p1;
-    v1 = p2 - p1;
-    v2 = p3 - p1;
+// Set up the query:
+if (!IMR_Collide_SetupQuery(Q, Mdl, WorldPos, WorldRot, Info, WorldVerts, Obj))
+    return IMR_COLLIDE_NOCOLLISION;
 
-    // You might not need this if you KNOW all your triangles are valid
-    if (!(v1.IsZero() || v2.IsZero()))
-        {
-        // Ignore backfaces:
-        if (pNormal.Dot_Product(normalizedVelocity) < 1.0f)
-            { 
-            // Calculate sphere intersection point:
-            sIPoint = source - pNormal;
-
-            // Classify point to determine if ellipsoid spans the plane:
-            int pClass = IMR_Collide_ClassifyPoint(sIPoint, pOrigin, pNormal);
-
-            // Find the plane intersection point:
-            if (pClass == IMR_COLLIDE_PLANE_BACKSIDE) // Plane is embedded in ellipsoid
-                {
-                // Find plane intersection point by shooting a ray from the
-                // sphere intersection point along the planes normal:
-                distToPlaneIntersection = IMR_Collide_IntersectRayPlane(sIPoint, pNormal, pOrigin, pNormal);
-
-                // Calculate plane intersection point:
-                pIPoint.X = sIPoint.X + distToPlaneIntersection * pNormal.X;
-                pIPoint.Y = sIPoint.Y + distToPlaneIntersection * pNormal.Y;
-                pIPoint.Z = sIPoint.Z + distToPlaneIntersection * pNormal.Z;
-                 }
-            else
-                {
-                // Shoot ray along the velocity vector:
-                distToPlaneIntersection = IMR_Collide_IntersectRayPlane(sIPoint, normalizedVelocity, pOrigin, pNormal);
-
-                // Calculate plane intersection point:
-                pIPoint.X = sIPoint.X + distToPlaneIntersection * normalizedVelocity.X;
-                pIPoint.Y = sIPoint.Y + distToPlaneIntersection * normalizedVelocity.Y;
-                pIPoint.Z = sIPoint.Z + distToPlaneIntersection * normalizedVelocity.Z;
-                 }
-
-            // Find polygon intersection point. By default we assume its equal to the 
-            // plane intersection point:
-            polyIPoint = pIPoint;
-            distToEllipsoidIntersection = distToPlaneIntersection;
-            if (!IMR_Collide_CheckPointInTriangle(pIPoint, p1, p2, p3))   // If not in triangle...
-                {
-                polyIPoint = IMR_Collide_ClosestPointOnTriangle(p1, p2, p3, pIPoint);
-                IMR_3DPoint Negated = normalizedVelocity;
-                Negated.X = -Negated.X;
-                Negated.Y = -Negated.Y;
-                Negated.Z = -Negated.Z;
-                distToEllipsoidIntersection = IMR_Collide_IntersectRaySphere(polyIPoint, Negated, source, 1.0f);
-
-                // Calculate true sphere intersection point:
-                if (distToEllipsoidIntersection > 0)
-                    {
-                    sIPoint.X = polyIPoint.X + (distToEllipsoidIntersection * Negated.X);
-                    sIPoint.Y = polyIPoint.Y + (distToEllipsoidIntersection * Negated.Y);
-                    sIPoint.Z = polyIPoint.Z + (distToEllipsoidIntersection * Negated.Z);
-                     }
-                 }
-
-            DbgInfo[0] = polyIPoint;
-            
-            // Here we do the error checking to see if we got ourself stuck last frame:
-            if (IMR_Collide_CheckPointInSphere(polyIPoint, source, 1.0f))
-                Info.stuck = 1;
-
-            // Ok, now we might update the collision data if we hit something:
-            if ((distToEllipsoidIntersection > 0) && (distToEllipsoidIntersection <= distanceToTravel))
-                { 
-                if (!Info.foundCollision || (distToEllipsoidIntersection < Info.nearestDistance))
-                    {
-                    // If this is the first hit or the closest so far, save the information:
-                    Info.nearestDistance = distToEllipsoidIntersection;
-                    Info.nearestIntersectionPoint = sIPoint;
-                    Info.nearestPolygonIntersectionPoint = polyIPoint;
-                    Info.foundCollision = 1;
-                     }
-                 } 
-             } // If not backface
-         } // If a valid plane        
-     } // For all faces     
+// Check each cached triangle from this model (as long as the model hasn't
+// changed since):
+for (; index < Info.numContacts; index ++)
+    {
+    Contact = &Info.contacts[index];
+    if (Contact->Obj != Obj || Contact->Mdl != Mdl || Contact->Revision != Mdl->Get_Revision()) continue;
+    if (Contact->Tri >= Q.Mesh->Get_Num_Tris()) continue;
+    ++ Info.cacheTests;
+    IMR_Collide_CheckTriangle(&Q, Contact->Tri);
+     }
+IMR_Collide_FlushPacket(Q);
 
 // And return our action flag:
 if (Info.foundCollision) return IMR_COLLIDE_COLLIDING;
 return IMR_COLLIDE_NOCOLLISION;
  }
 
+/***************************************************************************\
+  Starts a new move: the contacts found by the last move become the cache
+  to test first.
+\***************************************************************************/
+void IMR_Collide_BeginContacts(IMR_CollideInfo &Info)
+{
+int index;
+
+for (index = 0; index < Info.numNewContacts; index ++)
+    Info.contacts[index] = Info.newContacts[index];
+Info.numContacts = Info.numNewContacts;
+Info.numNewContacts = 0;
+Info.checkedContacts = 0;
+ }
+
+/***************************************************************************\
+  Frees the cached vertices.
+\***************************************************************************/
+void IMR_CollideCache::Reset(void)
+{
+if (Verts) free(Verts);
+Verts = NULL;
+Max_Verts = 0;
+Mdl = NULL;
+Revision = -1;
+Valid = Queries = 0;
+ }
+
+/***************************************************************************\
+  Returns the world coords of the specified model for use with
+  IMR_Collide_CheckModCollision().  The cache is only (re)built once the
+  object has been queried a few times without moving, so objects that move
+  every frame never pay for transforming their whole model.
+  Returns NULL if the object is moving or there isn't enough memory.
+\***************************************************************************/
+float *IMR_CollideCache::Fetch(IMR_Model *Model, IMR_Matrix &Rot, IMR_3DPoint &Pos)
+{
+IMR_3DPoint *V;
+float *W;
+int vtx;
+
+// Use the cache if it's still good:
+if (Valid && Model == Mdl && Model->Get_Revision() == Revision) return Verts;
+
+// Don't bother if the object is still moving:
+if (++ Queries < IMR_COLLIDECACHE_MINQUERIES) return NULL;
+
+// Make room for the vertices:
+if (Model->Num_Vertices > Max_Verts)
+    {
+    if (Verts) free(Verts);
+    Max_Verts = 0;
+    if (!(Verts = (float *)malloc(sizeof(float) * 3 * Model->Num_Vertices)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideCache::Fetch(): Out of memory! (%d)", Model->Num_Vertices);
+        return NULL;
+         }
+    Max_Verts = Model->Num_Vertices;
+     }
+
+// Transform the model to world coords (without touching it):
+for (vtx = 0; vtx < Model->Num_Vertices; vtx ++)
+    {
+    V = &Model->Vertices[vtx];
+    W = &Verts[vtx * 3];
+    W[0] = (V->lX * Rot.Mtrx[0][0]) + (V->lY * Rot.Mtrx[1][0]) + (V->lZ * Rot.Mtrx[2][0]) + Pos.X;
+    W[1] = (V->lX * Rot.Mtrx[0][1]) + (V->lY * Rot.Mtrx[1][1]) + (V->lZ * Rot.Mtrx[2][1]) + Pos.Y;
+    W[2] = (V->lX * Rot.Mtrx[0][2]) + (V->lY * Rot.Mtrx[1][2]) + (V->lZ * Rot.Mtrx[2][2]) + Pos.Z;
+     }
+
+// Remember what we cached:
+Mdl = Model;
+Revision = Model->Get_Revision();
+Valid = 1;
+
+// And return the vertices:
+return Verts;
+ }
+
 /***************************************************************************\
   Returns the distance to plane in world units, -1 if no intersection.
   Expects normalized directinoal vectors.
@@ -244,9 +764,9 @@ float IMR_Collide_IntersectRaySphere(IMR_3DPoint rO, IMR_3DPoint rV, IMR_3DPoint
 {
 IMR_3DPoint Q = sO - rO;
    
-float c = Q.Mag();
+float c2 = Q.Dot_Product(Q);
 float v = Q.Dot_Product(rV);
-float d = (sR * sR) - (c * c) - (v * v);
+float d = (sR * sR) - (c2 - (v * v));
 
 // If there was no intersection, return -1:
 if (d < 0.0) return (-1.0f);
@@ -256,27 +776,34 @@ return (v - sqrt(d));
 }
 
 /***************************************************************************\
-  Returns true if the point is in the triangle, false otherwise.
-  Expects clockwise vertex ordering.
+  Returns true if the point is in the triangle, false otherwise.  The point
+  should be on the plane of the triangle.  Uses the barycentric coords of 
+  the point, so there are no square roots and no divides.
 \***************************************************************************/
 bool IMR_Collide_CheckPointInTriangle(IMR_3DPoint point, IMR_3DPoint a, IMR_3DPoint b, IMR_3DPoint c)
 {
-double total_angles = 0.0f;
+float v0X, v0Y, v0Z, v1X, v1Y, v1Z, v2X, v2Y, v2Z;
+float dot00, dot01, dot02, dot11, dot12, Denom, u, v, Tol;
 
-// Make the 3 vectors:
-IMR_3DPoint v1 = point - a;
-IMR_3DPoint v2 = point - b;
-IMR_3DPoint v3 = point - c;
-  
-v1.Make_Unit();
-v2.Make_Unit();
-v3.Make_Unit();
+// Make the edge vectors and the vector to the point:
+v0X = c.X - a.X; v0Y = c.Y - a.Y; v0Z = c.Z - a.Z;
+v1X = b.X - a.X; v1Y = b.Y - a.Y; v1Z = b.Z - a.Z;
+v2X = point.X - a.X; v2Y = point.Y - a.Y; v2Z = point.Z - a.Z;
 
-total_angles += acos(v1.Dot_Product(v2));   
-total_angles += acos(v2.Dot_Product(v3));
-total_angles += acos(v3.Dot_Product(v1)); 
+// Find the barycentric coords (scaled by Denom, which is never negative):
+dot00 = (v0X * v0X) + (v0Y * v0Y) + (v0Z * v0Z);
+dot01 = (v0X * v1X) + (v0Y * v1Y) + (v0Z * v1Z);
+dot02 = (v0X * v2X) + (v0Y * v2Y) + (v0Z * v2Z);
+dot11 = (v1X * v1X) + (v1Y * v1Y) + (v1Z * v1Z);
+dot12 = (v1X * v2X) + (v1Y * v2Y) + (v1Z * v2Z);
+Denom = (dot00 * dot11) - (dot01 * dot01);
+if (Denom <= 0.0f) return 0;
+u = (dot11 * dot02) - (dot01 * dot12);
+v = (dot00 * dot12) - (dot01 * dot02);
 
-if (fabs((6.2848f) - total_angles) <= 0.005) return 1;
+// The point is inside if both are positive and they add up to less than one:
+Tol = Denom * IMR_COLLIDE_TRIEPSILON;
+if (u >= -Tol && v >= -Tol && (u + v) <= Denom + Tol) return 1;
 return 0;
  }
 
@@ -285,47 +812,247 @@ return 0;
 \***************************************************************************/
 IMR_3DPoint IMR_Collide_ClosestPointOnLine(IMR_3DPoint &a, IMR_3DPoint &b, IMR_3DPoint &p)
 {
-// Determine t (the length of the vector from a to p):
-IMR_3DPoint c = p - a;
-IMR_3DPoint V = b - a; 
-float d = V.Mag();
-V.Make_Unit();  
-float t = V.Dot_Product(c);
-
-// Check to see if t is beyond the extents of the line segment
-if (t < 0.0f) return (a);
-if (t > d) return (b);
-  
-// Return the point between a and b
-// Set length of V to t. V is normalized so this is easy:
-V.X = V.X * t;
-V.Y = V.Y * t;
-V.Z = V.Z * t;
-           
-return (a + V);        
-}
+IMR_3DPoint Result;
+float VX = b.X - a.X, VY = b.Y - a.Y, VZ = b.Z - a.Z;
+float t, Length;
+
+// Find how far along the segment the point is (0 at a, 1 at b):
+Length = (VX * VX) + (VY * VY) + (VZ * VZ);
+t = ((p.X - a.X) * VX) + ((p.Y - a.Y) * VY) + ((p.Z - a.Z) * VZ);
+
+// Check to see if it's beyond the extents of the line segment:
+if (t <= 0.0f || Length <= 0.0f) return (a);
+if (t >= Length) return (b);
+
+// Return the point between a and b:
+t /= Length;
+Result.X = a.X + (VX * t);
+Result.Y = a.Y + (VY * t);
+Result.Z = a.Z + (VZ * t);
+return Result;
+ }
 
 /***************************************************************************\
-  Returns the closest point on the triangle to the input point.
+  Returns the closest point on the triangle to the input point.  Finds which
+  vertex, edge, or face region the point is in from the dot products 
+  (no square roots).
 \***************************************************************************/
 IMR_3DPoint IMR_Collide_ClosestPointOnTriangle(IMR_3DPoint a, IMR_3DPoint b, IMR_3DPoint c, IMR_3DPoint p)
 {
-IMR_3DPoint Rab = IMR_Collide_ClosestPointOnLine(a, b, p);
-IMR_3DPoint Rbc = IMR_Collide_ClosestPointOnLine(b, c, p);
-IMR_3DPoint Rca = IMR_Collide_ClosestPointOnLine(c, a, p);
-    
-float dAB = (p - Rab).Mag();
-float dBC = (p - Rbc).Mag();
-float dCA = (p - Rca).Mag();
-  
-float min = dAB;
-IMR_3DPoint result = Rab;
+IMR_3DPoint Result;
+float abX = b.X - a.X, abY = b.Y - a.Y, abZ = b.Z - a.Z;
+float acX = c.X - a.X, acY = c.Y - a.Y, acZ = c.Z - a.Z;
+float pX, pY, pZ, d1, d2, d3, d4, d5, d6, va, vb, vc, v, w, Denom;
 
-if (dBC < min) { min = dBC; result = Rbc; }
-if (dCA < min) result = Rca;
-  
-return result;      
-}
+// In the region of a?
+pX = p.X - a.X; pY = p.Y - a.Y; pZ = p.Z - a.Z;
+d1 = (abX * pX) + (abY * pY) + (abZ * pZ);
+d2 = (acX * pX) + (acY * pY) + (acZ * pZ);
+if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+// In the region of b?
+pX = p.X - b.X; pY = p.Y - b.Y; pZ = p.Z - b.Z;
+d3 = (abX * pX) + (abY * pY) + (abZ * pZ);
+d4 = (acX * pX) + (acY * pY) + (acZ * pZ);
+if (d3 >= 0.0f && d4 <= d3) return b;
+
+// On edge ab?
+vc = (d1 * d4) - (d3 * d2);
+if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+    v = d1 / (d1 - d3);
+    Result.X = a.X + (abX * v); Result.Y = a.Y + (abY * v); Result.Z = a.Z + (abZ * v);
+    return Result;
+     }
+
+// In the region of c?
+pX = p.X - c.X; pY = p.Y - c.Y; pZ = p.Z - c.Z;
+d5 = (abX * pX) + (abY * pY) + (abZ * pZ);
+d6 = (acX * pX) + (acY * pY) + (acZ * pZ);
+if (d6 >= 0.0f && d5 <= d6) return c;
+
+// On edge ac?
+vb = (d5 * d2) - (d1 * d6);
+if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+    w = d2 / (d2 - d6);
+    Result.X = a.X + (acX * w); Result.Y = a.Y + (acY * w); Result.Z = a.Z + (acZ * w);
+    return Result;
+     }
+
+// On edge bc?
+va = (d3 * d6) - (d5 * d4);
+if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+    w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    Result.X = b.X + ((c.X - b.X) * w); Result.Y = b.Y + ((c.Y - b.Y) * w); Result.Z = b.Z + ((c.Z - b.Z) * w);
+    return Result;
+     }
+
+// Must be inside the face:
+Denom = 1.0f / (va + vb + vc);
+v = vb * Denom;
+w = vc * Denom;
+Result.X = a.X + (abX * v) + (acX * w);
+Result.Y = a.Y + (abY * v) + (acY * w);
+Result.Z = a.Z + (abZ * v) + (acZ * w);
+return Result;
+ }
+
+/***************************************************************************\
+  Sweeps the unit sphere at the source along the direction against each 
+  triangle in the packet (ellipsoid space) and fills in a hit for each.  
+  The plane intersections and point in triangle tests are done on the 
+  whole packet at once (with SSE if IMR_SSE is defined); only triangles 
+  that are missed by the plane point need the closest point on the edges.
+\***************************************************************************/
+void IMR_Collide_SweepPacket(IMR_CollidePacket &Pkt, IMR_3DPoint &Source, IMR_3DPoint &Dir, IMR_CollideHit *Hits)
+{
+float pX[IMR_COLLIDE_PACKETSIZE], pY[IMR_COLLIDE_PACKETSIZE], pZ[IMR_COLLIDE_PACKETSIZE];
+float sX[IMR_COLLIDE_PACKETSIZE], sY[IMR_COLLIDE_PACKETSIZE], sZ[IMR_COLLIDE_PACKETSIZE];
+float Dist[IMR_COLLIDE_PACKETSIZE];
+int Inside[IMR_COLLIDE_PACKETSIZE];
+IMR_3DPoint a, b, c, Point, Negated;
+int tri;
+
+#ifdef IMR_SSE
+// Splat the sphere and the direction:
+__m128 SrcX = _mm_set1_ps(Source.X), SrcY = _mm_set1_ps(Source.Y), SrcZ = _mm_set1_ps(Source.Z);
+__m128 DirX = _mm_set1_ps(Dir.X), DirY = _mm_set1_ps(Dir.Y), DirZ = _mm_set1_ps(Dir.Z);
+__m128 Zero = _mm_setzero_ps(), Tol = _mm_set1_ps(IMR_COLLIDE_TRIEPSILON);
+__m128 Ax = _mm_loadu_ps(Pkt.Ax), Ay = _mm_loadu_ps(Pkt.Ay), Az = _mm_loadu_ps(Pkt.Az);
+__m128 Nx = _mm_loadu_ps(Pkt.Nx), Ny = _mm_loadu_ps(Pkt.Ny), Nz = _mm_loadu_ps(Pkt.Nz);
+__m128 SIx, SIy, SIz, Class, Back, RayX, RayY, RayZ, Numer, Denom, T, Bad;
+__m128 v0x, v0y, v0z, v1x, v1y, v1z, v2x, v2y, v2z;
+__m128 d00, d01, d02, d11, d12, BDenom, U, V, BTol, In;
+
+// Point on the sphere nearest each plane:
+SIx = _mm_sub_ps(SrcX, Nx); SIy = _mm_sub_ps(SrcY, Ny); SIz = _mm_sub_ps(SrcZ, Nz);
+
+// Is the plane embedded in the sphere (if so shoot along the normal)?
+Class = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(Ax, SIx), Nx), _mm_mul_ps(_mm_sub_ps(Ay, SIy), Ny)), _mm_mul_ps(_mm_sub_ps(Az, SIz), Nz));
+Back = _mm_cmpgt_ps(Class, _mm_set1_ps(0.001f));
+RayX = _mm_or_ps(_mm_and_ps(Back, Nx), _mm_andnot_ps(Back, DirX));
+RayY = _mm_or_ps(_mm_and_ps(Back, Ny), _mm_andnot_ps(Back, DirY));
+RayZ = _mm_or_ps(_mm_and_ps(Back, Nz), _mm_andnot_ps(Back, DirZ));
+
+// Distance to the plane along the ray (-1 if parallel):
+Numer = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(SIx, Ax), Nx), _mm_mul_ps(_mm_sub_ps(SIy, Ay), Ny)), _mm_mul_ps(_mm_sub_ps(SIz, Az), Nz));
+Denom = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Nx, RayX), _mm_mul_ps(Ny, RayY)), _mm_mul_ps(Nz, RayZ));
+Bad = _mm_cmpeq_ps(Denom, Zero);
+T = _mm_sub_ps(Zero, _mm_div_ps(Numer, _mm_or_ps(_mm_and_ps(Bad, _mm_set1_ps(1.0f)), _mm_andnot_ps(Bad, Denom))));
+T = _mm_or_ps(_mm_and_ps(Bad, _mm_set1_ps(-1.0f)), _mm_andnot_ps(Bad, T));
+_mm_storeu_ps(Dist, T);
+
+// The plane intersection point:
+SIx = _mm_add_ps(SIx, _mm_mul_ps(T, RayX)); _mm_storeu_ps(pX, SIx);
+SIy = _mm_add_ps(SIy, _mm_mul_ps(T, RayY)); _mm_storeu_ps(pY, SIy);
+SIz = _mm_add_ps(SIz, _mm_mul_ps(T, RayZ)); _mm_storeu_ps(pZ, SIz);
+
+// Is it in the triangle (barycentric)?
+v0x = _mm_sub_ps(_mm_loadu_ps(Pkt.Cx), Ax); v0y = _mm_sub_ps(_mm_loadu_ps(Pkt.Cy), Ay); v0z = _mm_sub_ps(_mm_loadu_ps(Pkt.Cz), Az);
+v1x = _mm_sub_ps(_mm_loadu_ps(Pkt.Bx), Ax); v1y = _mm_sub_ps(_mm_loadu_ps(Pkt.By), Ay); v1z = _mm_sub_ps(_mm_loadu_ps(Pkt.Bz), Az);
+v2x = _mm_sub_ps(SIx, Ax); v2y = _mm_sub_ps(SIy, Ay); v2z = _mm_sub_ps(SIz, Az);
+d00 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v0x, v0x), _mm_mul_ps(v0y, v0y)), _mm_mul_ps(v0z, v0z));
+d01 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v0x, v1x), _mm_mul_ps(v0y, v1y)), _mm_mul_ps(v0z, v1z));
+d02 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v0x, v2x), _mm_mul_ps(v0y, v2y)), _mm_mul_ps(v0z, v2z));
+d11 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v1x, v1x), _mm_mul_ps(v1y, v1y)), _mm_mul_ps(v1z, v1z));
+d12 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v1x, v2x), _mm_mul_ps(v1y, v2y)), _mm_mul_ps(v1z, v2z));
+BDenom = _mm_sub_ps(_mm_mul_ps(d00, d11), _mm_mul_ps(d01, d01));
+U = _mm_sub_ps(_mm_mul_ps(d11, d02), _mm_mul_ps(d01, d12));
+V = _mm_sub_ps(_mm_mul_ps(d00, d12), _mm_mul_ps(d01, d02));
+BTol = _mm_mul_ps(BDenom, Tol);
+In = _mm_and_ps(_mm_cmpgt_ps(BDenom, Zero), _mm_cmpge_ps(U, _mm_sub_ps(Zero, BTol)));
+In = _mm_and_ps(In, _mm_cmpge_ps(V, _mm_sub_ps(Zero, BTol)));
+In = _mm_and_ps(In, _mm_cmple_ps(_mm_add_ps(U, V), _mm_add_ps(BDenom, BTol)));
+tri = _mm_movemask_ps(In);
+for (int lane = 0; lane < IMR_COLLIDE_PACKETSIZE; lane ++)
+    {
+    Inside[lane] = (tri >> lane) & 1;
+    sX[lane] = Source.X - Pkt.Nx[lane];
+    sY[lane] = Source.Y - Pkt.Ny[lane];
+    sZ[lane] = Source.Z - Pkt.Nz[lane];
+     }
+#else
+float RayX, RayY, RayZ, Numer, Denom, v0X, v0Y, v0Z, v1X, v1Y, v1Z, v2X, v2Y, v2Z;
+float dot00, dot01, dot02, dot11, dot12, BDenom, u, v, BTol;
+
+// Each step is straight line code over the packet:
+for (tri = 0; tri < IMR_COLLIDE_PACKETSIZE; tri ++)
+    {
+    // Point on the sphere nearest the plane:
+    sX[tri] = Source.X - Pkt.Nx[tri];
+    sY[tri] = Source.Y - Pkt.Ny[tri];
+    sZ[tri] = Source.Z - Pkt.Nz[tri];
+
+    // If the plane is embedded in the sphere shoot along the normal,
+    // otherwise along the velocity:
+    if (((Pkt.Ax[tri] - sX[tri]) * Pkt.Nx[tri]) + ((Pkt.Ay[tri] - sY[tri]) * Pkt.Ny[tri]) + ((Pkt.Az[tri] - sZ[tri]) * Pkt.Nz[tri]) > 0.001f)
+        { RayX = Pkt.Nx[tri]; RayY = Pkt.Ny[tri]; RayZ = Pkt.Nz[tri]; }
+    else
+        { RayX = Dir.X; RayY = Dir.Y; RayZ = Dir.Z; }
+
+    // Find the plane intersection point:
+    Numer = ((sX[tri] - Pkt.Ax[tri]) * Pkt.Nx[tri]) + ((sY[tri] - Pkt.Ay[tri]) * Pkt.Ny[tri]) + ((sZ[tri] - Pkt.Az[tri]) * Pkt.Nz[tri]);
+    Denom = (Pkt.Nx[tri] * RayX) + (Pkt.Ny[tri] * RayY) + (Pkt.Nz[tri] * RayZ);
+    Dist[tri] = (Denom == 0.0f) ? -1.0f : -(Numer / Denom);
+    pX[tri] = sX[tri] + (Dist[tri] * RayX);
+    pY[tri] = sY[tri] + (Dist[tri] * RayY);
+    pZ[tri] = sZ[tri] + (Dist[tri] * RayZ);
+
+    // Is it in the triangle (barycentric)?
+    v0X = Pkt.Cx[tri] - Pkt.Ax[tri]; v0Y = Pkt.Cy[tri] - Pkt.Ay[tri]; v0Z = Pkt.Cz[tri] - Pkt.Az[tri];
+    v1X = Pkt.Bx[tri] - Pkt.Ax[tri]; v1Y = Pkt.By[tri] - Pkt.Ay[tri]; v1Z = Pkt.Bz[tri] - Pkt.Az[tri];
+    v2X = pX[tri] - Pkt.Ax[tri]; v2Y = pY[tri] - Pkt.Ay[tri]; v2Z = pZ[tri] - Pkt.Az[tri];
+    dot00 = (v0X * v0X) + (v0Y * v0Y) + (v0Z * v0Z);
+    dot01 = (v0X * v1X) + (v0Y * v1Y) + (v0Z * v1Z);
+    dot02 = (v0X * v2X) + (v0Y * v2Y) + (v0Z * v2Z);
+    dot11 = (v1X * v1X) + (v1Y * v1Y) + (v1Z * v1Z);
+    dot12 = (v1X * v2X) + (v1Y * v2Y) + (v1Z * v2Z);
+    BDenom = (dot00 * dot11) - (dot01 * dot01);
+    u = (dot11 * dot02) - (dot01 * dot12);
+    v = (dot00 * dot12) - (dot01 * dot02);
+    BTol = BDenom * IMR_COLLIDE_TRIEPSILON;
+    Inside[tri] = (BDenom > 0.0f && u >= -BTol && v >= -BTol && (u + v) <= BDenom + BTol);
+     }
+#endif
+
+// Now finish each triangle:
+Negated.X = -Dir.X;
+Negated.Y = -Dir.Y;
+Negated.Z = -Dir.Z;
+for (tri = 0; tri < Pkt.Num; tri ++)
+    {
+    Point.X = pX[tri]; Point.Y = pY[tri]; Point.Z = pZ[tri];
+    Hits[tri].SpherePoint.X = sX[tri];
+    Hits[tri].SpherePoint.Y = sY[tri];
+    Hits[tri].SpherePoint.Z = sZ[tri];
+
+    // If the plane point is in the triangle that's where we hit:
+    if (Inside[tri])
+        {
+        Hits[tri].PolyPoint = Point;
+        Hits[tri].Distance = Dist[tri];
+        continue;
+         }
+
+    // Otherwise find the closest point on the edges and shoot a ray back at
+    // the sphere from it:
+    a.X = Pkt.Ax[tri]; a.Y = Pkt.Ay[tri]; a.Z = Pkt.Az[tri];
+    b.X = Pkt.Bx[tri]; b.Y = Pkt.By[tri]; b.Z = Pkt.Bz[tri];
+    c.X = Pkt.Cx[tri]; c.Y = Pkt.Cy[tri]; c.Z = Pkt.Cz[tri];
+    Hits[tri].PolyPoint = IMR_Collide_ClosestPointOnTriangle(a, b, c, Point);
+    Hits[tri].Distance = IMR_Collide_IntersectRaySphere(Hits[tri].PolyPoint, Negated, Source, 1.0f);
+
+    // Calculate true sphere intersection point:
+    if (Hits[tri].Distance > 0)
+        {
+        Hits[tri].SpherePoint.X = Hits[tri].PolyPoint.X + (Hits[tri].Distance * Negated.X);
+        Hits[tri].SpherePoint.Y = Hits[tri].PolyPoint.Y + (Hits[tri].Distance * Negated.Y);
+        Hits[tri].SpherePoint.Z = Hits[tri].PolyPoint.Z + (Hits[tri].Distance * Negated.Z);
+         }
+     }
+ }
 
 /***************************************************************************\
   Returns true if the point is contained in the specified sphere, false if 
@@ -333,8 +1060,8 @@ return result;
 \***************************************************************************/
 bool IMR_Collide_CheckPointInSphere(IMR_3DPoint point, IMR_3DPoint sO, float sR)
 {
-float d = (point - sO).Mag();
-if ( d <= sR) return 1;
+IMR_3DPoint D = point - sO;
+if (D.Dot_Product(D) <= sR * sR) return 1;
 return 0;  
  }
 
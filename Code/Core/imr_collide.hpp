@@ -13,9 +13,13 @@
 
 // Include headers:
 #include <math.h>
-#include "IMR_Geom_Prim.hpp"
-#include "IMR_Geom_Model.hpp"
-#include "IMR_Matrix.hpp"
+#include "imr_geom_prim.hpp"
+#include "imr_geom_model.hpp"
+#include "imr_matrix.hpp"
+#include "imr_collidebvh.hpp"
+#ifdef IMR_SSE
+    #include <xmmintrin.h>
+#endif
 
 extern IMR_3DPoint DbgInfo[4];
 
@@ -26,6 +30,59 @@ extern IMR_3DPoint DbgInfo[4];
 #define IMR_COLLIDE_PLANE_BACKSIDE 0x000001
 #define IMR_COLLIDE_PLANE_FRONT    0x000002
 #define IMR_COLLIDE_ON_PLANE       0x000004
+#define IMR_COLLIDECACHE_MINQUERIES 4      // Queries on a still object before it's mesh is cached
+#define IMR_COLLIDE_TRIEPSILON     0.0001f  // Tolerance of the point in triangle test (barycentric)
+#define IMR_COLLIDE_PACKETSIZE     4        // Triangles swept at once
+#define IMR_COLLIDE_MAXITERATIONS  5        // Default max slide iterations per move
+#define IMR_COLLIDE_MAXCONTACTS    8        // Triangles remembered by each mover's contact cache
+#define IMR_COLLIDE_CONTACTREACH   1.0f     // How far past the motion a triangle can be and still be remembered (ellipsoid space)
+#define IMR_COLLIDE_CONTACTMINMOVE 1.0f     // Shortest motion the contact cache is tried first for (ellipsoid space)
+
+// Packet of triangles in ellipsoid space (stored as arrays so each step
+// can be done on the whole packet at once):
+struct IMR_CollidePacket
+    {
+    float Ax[IMR_COLLIDE_PACKETSIZE], Ay[IMR_COLLIDE_PACKETSIZE], Az[IMR_COLLIDE_PACKETSIZE];
+    float Bx[IMR_COLLIDE_PACKETSIZE], By[IMR_COLLIDE_PACKETSIZE], Bz[IMR_COLLIDE_PACKETSIZE];
+    float Cx[IMR_COLLIDE_PACKETSIZE], Cy[IMR_COLLIDE_PACKETSIZE], Cz[IMR_COLLIDE_PACKETSIZE];
+    float Nx[IMR_COLLIDE_PACKETSIZE], Ny[IMR_COLLIDE_PACKETSIZE], Nz[IMR_COLLIDE_PACKETSIZE];  // Unit normal
+    int Tri[IMR_COLLIDE_PACKETSIZE];    // Mesh triangle in each slot
+    int Num;
+     };
+
+// Result of sweeping the unit sphere against one triangle:
+struct IMR_CollideHit
+    {
+    float Distance;                 // Distance along the velocity to the hit (<= 0 if none)
+    IMR_3DPoint SpherePoint;        // Hit point on the sphere
+    IMR_3DPoint PolyPoint;          // Hit point on the triangle
+     };
+
+// Ray for ray casts (global coords):
+struct IMR_CollideRay
+    {
+    IMR_3DPoint Origin;             // Start of the ray
+    IMR_3DPoint Dir;                // Direction (distances are in units of it's length)
+    float MaxDist;                  // Length of the ray
+    void *Ignore;                   // Object to skip (or NULL)
+
+    // Results:
+    int Hit;                        // Flags if anything was hit
+    float Distance;                 // Distance to the nearest hit so far (MaxDist if none)
+    IMR_3DPoint Point;              // Hitpoint
+    IMR_3DPoint Normal;             // Unit normal of the triangle hit
+    void *HitObj;                   // Object hit
+     };
+
+// Triangle in a mover's contact cache:
+struct IMR_CollideContact
+    {
+    void *Obj;                      // Object the triangle is in (only compared, never used)
+    IMR_Model *Mdl;                 // Model and revision the triangle is from
+    int Revision;
+    int Tri;                        // Triangle in the model's collision mesh
+    float Distance;                 // Distance along the motion to the hit (ellipsoid space)
+     };
 
 // CollideInfo class:
 class IMR_CollideInfo
@@ -46,11 +103,49 @@ class IMR_CollideInfo
       IMR_3DPoint nearestIntersectionPoint;         // Hitpoint on sphere
       IMR_3DPoint nearestPolygonIntersectionPoint;  // Hitpoint on polygon
       
+      // Contacts over the whole move (see Reset_Contacts()):
+      int hitCount;                                 // Collisions while sliding
+      IMR_3DPoint lastHitPoint;                     // Last hitpoint on polygon (ellipsoid space)
+      
       // Error handling:
       IMR_3DPoint lastSafePosition;
       bool stuck; 
+      
+      // Broad phase:
+      void *Ignore;                                 // Object to skip (the one moving)
+      int Shared;                                   // Flags that other threads are using the environment
+
+      // Solver limits and counters:
+      int maxIterations;                            // Max slide iterations per move
+      int iterations;                               // Slide iterations used by the last move
+      int trianglesTested;                          // Triangles tested by the last move
+
+      // Contact cache (triangles hit or nearly hit by the last move, which
+      // are tested first to get a close hit early):
+      IMR_CollideContact contacts[IMR_COLLIDE_MAXCONTACTS];
+      int numContacts;
+      IMR_CollideContact newContacts[IMR_COLLIDE_MAXCONTACTS];   // Found by this move
+      int numNewContacts;
+      int checkedContacts;                          // Flags that the cached triangles were already tested
+      int cacheHits, cacheMisses;                   // Collisions whose nearest triangle was / wasn't cached (running totals)
+      int cacheTests;                               // Cached triangles tested (running total)
 
       // Functions:
+      IMR_CollideInfo() 
+          { 
+          Ignore = NULL; Shared = 0; hitCount = 0; 
+          maxIterations = IMR_COLLIDE_MAXITERATIONS; iterations = trianglesTested = 0;
+          Clear_ContactCache();
+          Reset_CacheStats();
+           };
+      inline void Reset_Contacts(void) { hitCount = 0; };
+      inline void Clear_ContactCache(void) { numContacts = numNewContacts = checkedContacts = 0; };
+      inline void Reset_CacheStats(void) { cacheHits = cacheMisses = cacheTests = 0; };
+      inline float Get_CacheHitRate(void) 
+          { 
+          if (cacheHits + cacheMisses) return (float)cacheHits / (float)(cacheHits + cacheMisses);
+          return 0;
+           };
       inline void Setup_Ellipsoid(float rv, float rh)
           {
           Rv = rv;  RvSqrd = rv * rv;
@@ -60,14 +155,49 @@ class IMR_CollideInfo
            };
      };
 
+// World space collision mesh cache (one per object):
+class IMR_CollideCache
+    {
+    protected:
+      float *Verts;                 // World coords of each model vertex (X, Y, Z)
+      int Max_Verts;
+      IMR_Model *Mdl;               // Model and revision the cache was built from
+      int Revision;
+      int Valid;
+      int Queries;                  // Queries since the object last moved
+      
+    public:
+      IMR_CollideCache() { Verts = NULL; Max_Verts = 0; Mdl = NULL; Revision = -1; Valid = Queries = 0; };
+      ~IMR_CollideCache() { Reset(); };
+      
+      // Init and de-init methods:
+      void Reset(void);
+      inline void Invalidate(void) { Valid = 0; Queries = 0; };
+      
+      // Cache access methods:
+      float *Fetch(IMR_Model *Model, IMR_Matrix &Rot, IMR_3DPoint &Pos);
+      inline float *Peek(IMR_Model *Model)
+          {
+          if (Valid && Model == Mdl && Model->Get_Revision() == Revision) return Verts;
+          return NULL;
+           };
+     };
+
 // Prototypes:
-int IMR_Collide_CheckModCollision(IMR_Model *Mdl, IMR_3DPoint ModPos, IMR_Attitude ModAtd, IMR_CollideInfo &Info);
+int IMR_Collide_CheckModCollision(IMR_Model *Mdl, IMR_3DPoint ModPos, IMR_Matrix &ModRot, IMR_CollideInfo &Info, float *WorldVerts, void *Obj);
+int IMR_Collide_CheckModContacts(IMR_Model *Mdl, IMR_3DPoint ModPos, IMR_Matrix &ModRot, IMR_CollideInfo &Info, float *WorldVerts, void *Obj);
+void IMR_Collide_BeginContacts(IMR_CollideInfo &Info);
 int IMR_Collide_InRange(IMR_3DPoint &Pnt1, float RadiusSquared, IMR_Polygon &Poly);
+void IMR_Collide_FindSweptBox(IMR_CollideInfo &Info, float *Min, float *Max);
+int IMR_Collide_BoxesOverlap(float *MinA, float *MaxA, float *MinB, float *MaxB);
+int IMR_Collide_RayHitsBox(IMR_CollideRay &Ray, float *Min, float *Max);
+int IMR_Collide_RayModel(IMR_Model *Mdl, IMR_3DPoint &Pos, IMR_Matrix &Rot, IMR_CollideRay &Ray, int AnyHit);
 float IMR_Collide_IntersectRayPlane(IMR_3DPoint rOrigin, IMR_3DPoint rVector, IMR_3DPoint pOrigin, IMR_3DPoint pNormal); 
 float IMR_Collide_IntersectRaySphere(IMR_3DPoint rO, IMR_3DPoint rV, IMR_3DPoint sO, float sR);
 IMR_3DPoint IMR_Collide_ClosestPointOnLine(IMR_3DPoint &a, IMR_3DPoint &b, IMR_3DPoint &p);
 IMR_3DPoint IMR_Collide_ClosestPointOnTriangle(IMR_3DPoint a, IMR_3DPoint b, IMR_3DPoint c, IMR_3DPoint p);
 bool IMR_Collide_CheckPointInTriangle(IMR_3DPoint point, IMR_3DPoint a, IMR_3DPoint b, IMR_3DPoint c);
+void IMR_Collide_SweepPacket(IMR_CollidePacket &Pkt, IMR_3DPoint &Source, IMR_3DPoint &Dir, IMR_CollideHit *Hits);
 bool IMR_Collide_CheckPointInSphere(IMR_3DPoint point, IMR_3DPoint sO, float sR);
 IMR_3DPoint IMR_Collide_TangentPlaneNormalOfEllipsoid(IMR_3DPoint point, IMR_3DPoint eO, IMR_3DPoint eR);
 int IMR_Collide_ClassifyPoint(IMR_3DPoint point, IMR_3DPoint pO, IMR_3DPoint pN);
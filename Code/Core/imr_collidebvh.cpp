@@ -0,0 +1,299 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_CollideBVH.cpp
+ Description: Axis aligned bounding box tree over the triangles
+              of a collision mesh.  Lets collision queries skip
+              everything that isn't near the moving ellipsoid.
+
+\****************************************************************/
+#include "imr_collidebvh.hpp"
+
+/***************************************************************************\
+  Frees all memory used by the tree.
+\***************************************************************************/
+void IMR_CollideBVH::Reset(void)
+{
+if (Nodes) free(Nodes);
+if (Centers) free(Centers);
+Nodes = NULL;
+Centers = NULL;
+Num_Tris = Num_Nodes = Max_Nodes = 0;
+Revision = -1;
+ }
+
+/***************************************************************************\
+  Builds the tree over the triangles of the specified collision mesh.  The
+  triangles in the mesh are sorted so each leaf covers a run of them.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_CollideBVH::Build(IMR_CollideMesh &Mesh)
+{
+int tri;
+
+// Get rid of the old tree:
+Reset();
+
+// Make sure there's something to build:
+Num_Tris = Mesh.Get_Num_Tris();
+if (!Num_Tris)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideBVH::Build(): Mesh has no triangles!");
+    return IMRERR_NODATA;
+     }
+
+// Allocate space (a binary tree never needs more than 2n - 1 nodes):
+Max_Nodes = (Num_Tris * 2) - 1;
+Nodes = (IMR_CollideNode *)malloc(sizeof(IMR_CollideNode) * Max_Nodes);
+Centers = (float *)malloc(sizeof(float) * 3 * Num_Tris);
+if (!Nodes || !Centers)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideBVH::Build(): Out of memory! (%d)", Num_Tris);
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+
+// Find the center of each triangle:
+for (tri = 0; tri < Num_Tris; tri ++)
+    {
+    Centers[tri * 3 + 0] = Mesh.Ax[tri] + ((Mesh.E1x[tri] + Mesh.E2x[tri]) * (1.0f / 3.0f));
+    Centers[tri * 3 + 1] = Mesh.Ay[tri] + ((Mesh.E1y[tri] + Mesh.E2y[tri]) * (1.0f / 3.0f));
+    Centers[tri * 3 + 2] = Mesh.Az[tri] + ((Mesh.E1z[tri] + Mesh.E2z[tri]) * (1.0f / 3.0f));
+     }
+
+// Build the tree:
+Build_Node(Mesh, 0, Num_Tris, 0);
+
+// Don't need the centers anymore:
+free(Centers);
+Centers = NULL;
+
+// Remember what we were built from:
+Revision = Mesh.Get_Revision();
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Builds a node for the specified range of triangles and it's children.
+  The triangles are split at the middle of their centers along the longest
+  axis.
+  Notes: Protected member function.
+  Returns the index of the node.
+\***************************************************************************/
+int IMR_CollideBVH::Build_Node(IMR_CollideMesh &Mesh, int First, int Num, int Depth)
+{
+IMR_CollideNode *Node;
+float CMin[3], CMax[3], Corner[3][3], Split, TmpCenter;
+int NodeIndex, tri, c, vtx, Axis, Mid, Left;
+
+// Make a new node:
+NodeIndex = Num_Nodes ++;
+Node = &Nodes[NodeIndex];
+Node->Left = Node->Right = -1;
+Node->FirstTri = First;
+Node->Num_Tris = Num;
+
+// Find the bounds of the triangles and their centers:
+for (c = 0; c < 3; c ++)
+    {
+    Node->Min[c] = CMin[c] = 1e30f;
+    Node->Max[c] = CMax[c] = -1e30f;
+     }
+for (tri = First; tri < First + Num; tri ++)
+    {
+    Corner[0][0] = Mesh.Ax[tri];
+    Corner[0][1] = Mesh.Ay[tri];
+    Corner[0][2] = Mesh.Az[tri];
+    Corner[1][0] = Mesh.Ax[tri] + Mesh.E1x[tri];
+    Corner[1][1] = Mesh.Ay[tri] + Mesh.E1y[tri];
+    Corner[1][2] = Mesh.Az[tri] + Mesh.E1z[tri];
+    Corner[2][0] = Mesh.Ax[tri] + Mesh.E2x[tri];
+    Corner[2][1] = Mesh.Ay[tri] + Mesh.E2y[tri];
+    Corner[2][2] = Mesh.Az[tri] + Mesh.E2z[tri];
+    for (c = 0; c < 3; c ++)
+        {
+        for (vtx = 0; vtx < 3; vtx ++)
+            {
+            if (Corner[vtx][c] < Node->Min[c]) Node->Min[c] = Corner[vtx][c];
+            if (Corner[vtx][c] > Node->Max[c]) Node->Max[c] = Corner[vtx][c];
+             }
+        if (Centers[tri * 3 + c] < CMin[c]) CMin[c] = Centers[tri * 3 + c];
+        if (Centers[tri * 3 + c] > CMax[c]) CMax[c] = Centers[tri * 3 + c];
+         }
+     }
+
+// Make a leaf if there are few enough triangles:
+if (Num <= IMR_COLLIDEBVH_LEAFTRIS || Depth >= IMR_COLLIDEBVH_MAXDEPTH - 1) return NodeIndex;
+
+// Find the longest axis:
+Axis = 0;
+if (CMax[1] - CMin[1] > CMax[Axis] - CMin[Axis]) Axis = 1;
+if (CMax[2] - CMin[2] > CMax[Axis] - CMin[Axis]) Axis = 2;
+Split = (CMin[Axis] + CMax[Axis]) * 0.5f;
+
+// Move the triangles before the split to the front:
+Mid = First;
+for (tri = First; tri < First + Num; tri ++)
+    {
+    if (Centers[tri * 3 + Axis] >= Split) continue;
+    Mesh.Swap_Tris(tri, Mid);
+    for (c = 0; c < 3; c ++)
+        {
+        TmpCenter = Centers[tri * 3 + c];
+        Centers[tri * 3 + c] = Centers[Mid * 3 + c];
+        Centers[Mid * 3 + c] = TmpCenter;
+         }
+    ++ Mid;
+     }
+
+// If everything landed on one side, just split them in half:
+if (Mid == First || Mid == First + Num) Mid = First + (Num / 2);
+
+// Build the children:
+Left = Build_Node(Mesh, First, Mid - First, Depth + 1);
+Nodes[NodeIndex].Right = Build_Node(Mesh, Mid, First + Num - Mid, Depth + 1);
+Nodes[NodeIndex].Left = Left;
+Nodes[NodeIndex].Num_Tris = 0;
+
+// Return the node:
+return NodeIndex;
+ }
+
+/***************************************************************************\
+  Calls the specified function for each triangle in a leaf that overlaps
+  the specified box (model coords).
+  Returns the number of triangles found.
+\***************************************************************************/
+int IMR_CollideBVH::Query(float *Min, float *Max, IMR_CollideBVH_Callback Func, void *Data)
+{
+int Stack[IMR_COLLIDEBVH_MAXDEPTH + 1], Top, Found, tri;
+IMR_CollideNode *Node;
+
+// Make sure we have a tree:
+if (!Num_Nodes || !Func) return 0;
+
+// Walk the tree:
+Found = 0;
+Top = 0;
+Stack[Top ++] = 0;
+while (Top)
+    {
+    Node = &Nodes[Stack[-- Top]];
+
+    // Skip the node if it's not in the box:
+    if (Node->Min[0] > Max[0] || Node->Max[0] < Min[0] ||
+        Node->Min[1] > Max[1] || Node->Max[1] < Min[1] ||
+        Node->Min[2] > Max[2] || Node->Max[2] < Min[2]) continue;
+
+    // Report the triangles in leaves:
+    if (Node->Left < 0)
+        {
+        for (tri = Node->FirstTri; tri < Node->FirstTri + Node->Num_Tris; tri ++)
+            Func(Data, tri);
+        Found += Node->Num_Tris;
+        continue;
+         }
+
+    // Otherwise check the children:
+    Stack[Top ++] = Node->Left;
+    Stack[Top ++] = Node->Right;
+     }
+
+// Return the number found:
+return Found;
+ }
+
+/***************************************************************************\
+  Finds where the ray enters the specified box.  Inv is 1 / the direction 
+  of the ray (0 for a zero direction, which only has to be inside the
+  slab).
+  Returns true if the ray hits the box before MaxT, false if not.
+\***************************************************************************/
+static inline int IMR_CollideBVH_RayBox(float *Origin, float *Inv, float *Min, float *Max, float MaxT, float &Entry)
+{
+float Near, Far, t1, t2;
+int c;
+
+Near = 0;
+Far = MaxT;
+for (c = 0; c < 3; c ++)
+    {
+    if (!Inv[c])
+        {
+        if (Origin[c] < Min[c] || Origin[c] > Max[c]) return 0;
+        continue;
+         }
+    t1 = (Min[c] - Origin[c]) * Inv[c];
+    t2 = (Max[c] - Origin[c]) * Inv[c];
+    if (t1 > t2) { Near = Near > t2 ? Near : t2; Far = Far < t1 ? Far : t1; }
+    else         { Near = Near > t1 ? Near : t1; Far = Far < t2 ? Far : t2; }
+    if (Near > Far) return 0;
+     }
+Entry = Near;
+return 1;
+ }
+
+/***************************************************************************\
+  Calls the specified function for each triangle in a leaf that the ray
+  from Origin along Dir (model coords) passes through before MaxT (in 
+  units of Dir).  Nearer nodes are visited first, and the function can 
+  shorten the ray as it finds hits so farther nodes get skipped.
+  Returns the number of triangles found.
+\***************************************************************************/
+int IMR_CollideBVH::Query_Ray(float *Origin, float *Dir, float MaxT, IMR_CollideBVH_RayCallback Func, void *Data)
+{
+int Stack[IMR_COLLIDEBVH_MAXDEPTH + 1], Top, Found, tri, HitL, HitR;
+float Entries[IMR_COLLIDEBVH_MAXDEPTH + 1], Inv[3], EntryL, EntryR;
+IMR_CollideNode *Node;
+int c;
+
+// Make sure we have a tree:
+if (!Num_Nodes || !Func) return 0;
+
+// Get the inverse of the direction for the box tests:
+for (c = 0; c < 3; c ++)
+    Inv[c] = Dir[c] ? 1.0f / Dir[c] : 0;
+
+// Make sure the ray hits the tree at all:
+if (!IMR_CollideBVH_RayBox(Origin, Inv, Nodes[0].Min, Nodes[0].Max, MaxT, EntryL)) return 0;
+
+// Walk the tree:
+Found = 0;
+Top = 0;
+Entries[Top] = EntryL;
+Stack[Top ++] = 0;
+while (Top)
+    {
+    // Skip the node if a hit found since it was pushed is nearer:
+    -- Top;
+    if (Entries[Top] > MaxT) continue;
+    Node = &Nodes[Stack[Top]];
+
+    // Report the triangles in leaves:
+    if (Node->Left < 0)
+        {
+        for (tri = Node->FirstTri; tri < Node->FirstTri + Node->Num_Tris; tri ++)
+            {
+            ++ Found;
+            if (Func(Data, tri, &MaxT)) return Found;
+             }
+        continue;
+         }
+
+    // Otherwise check the children the ray passes through (nearest last, 
+    // so it comes off the stack first):
+    HitL = IMR_CollideBVH_RayBox(Origin, Inv, Nodes[Node->Left].Min, Nodes[Node->Left].Max, MaxT, EntryL);
+    HitR = IMR_CollideBVH_RayBox(Origin, Inv, Nodes[Node->Right].Min, Nodes[Node->Right].Max, MaxT, EntryR);
+    if (HitR && (!HitL || EntryL <= EntryR)) { Entries[Top] = EntryR; Stack[Top ++] = Node->Right; }
+    if (HitL) { Entries[Top] = EntryL; Stack[Top ++] = Node->Left; }
+    if (HitR && HitL && EntryL > EntryR) { Entries[Top] = EntryR; Stack[Top ++] = Node->Right; }
+     }
+
+// Return the number found:
+return Found;
+ }
@@ -0,0 +1,75 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_CollideBVH.hpp
+ Description: Header
+
+\****************************************************************/
+#ifndef __IMR_COLLIDEBVH__HPP
+#define __IMR_COLLIDEBVH__HPP
+
+// Include headers:
+#include <stdlib.h>
+#include "imr_collidemesh.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
+
+// Constants:
+#define IMR_COLLIDEBVH_LEAFTRIS     4       // Max triangles in a leaf
+#define IMR_COLLIDEBVH_MAXDEPTH     64      // Max depth of the tree (size of the query stack)
+
+// Called for each triangle found by a query:
+typedef void (*IMR_CollideBVH_Callback)(void *Data, int Tri);
+
+// Called for each triangle found by a ray query.  Can shorten the ray by
+// lowering MaxT, and returns nonzero to stop the query:
+typedef int (*IMR_CollideBVH_RayCallback)(void *Data, int Tri, float *MaxT);
+
+// Tree node (model coords):
+struct IMR_CollideNode
+    {
+    float Min[3], Max[3];       // Bounding box
+    int Left, Right;            // Children (-1 if this is a leaf)
+    int FirstTri, Num_Tris;     // Triangles (only used in leaves)
+     };
+
+// Bounding volume hierarchy class:
+class IMR_CollideBVH
+    {
+    protected:
+      int Num_Tris;
+      IMR_CollideNode *Nodes;
+      int Num_Nodes, Max_Nodes;
+      float *Centers;           // Triangle centers (only used while building)
+      int Revision;             // Model revision of the mesh the tree was built from
+
+      // Protected member functions:
+      int Build_Node(IMR_CollideMesh &Mesh, int First, int Num, int Depth);
+
+    public:
+      IMR_CollideBVH()
+          {
+          Nodes = NULL; Centers = NULL;
+          Num_Tris = Num_Nodes = Max_Nodes = 0;
+          Revision = -1;
+           };
+      ~IMR_CollideBVH() { Reset(); };
+
+      // Init and de-init methods:
+      int Build(IMR_CollideMesh &Mesh);
+      void Reset(void);
+
+      // Query methods:
+      int Query(float *Min, float *Max, IMR_CollideBVH_Callback Func, void *Data);
+      int Query_Ray(float *Origin, float *Dir, float MaxT, IMR_CollideBVH_RayCallback Func, void *Data);
+
+      // Info methods:
+      inline int Get_Num_Tris(void) { return Num_Tris; };
+      inline int Get_Num_Nodes(void) { return Num_Nodes; };
+      inline int Get_Revision(void) { return Revision; };
+     };
+
+#endif
@@ -0,0 +1,368 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_CollideHash.cpp
+ Description: Spatial hash of moving object bounds.  Objects are
+              linked into each grid cell their box covers, and
+              only relinked when that set of cells changes, so
+              keeping the hash up to date and finding pairs both
+              cost about the same per object no matter how many
+              there are.
+
+\****************************************************************/
+#include "imr_collidehash.hpp"
+
+/***************************************************************************\
+  Allocates space for the specified number of objects, using cells of the
+  specified size.  Cells should be about as big as a typical object.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_CollideHash::Setup(float NewCellSize, int MaxObjects)
+{
+int index;
+
+// Get rid of the old hash:
+Reset();
+
+// Check the params:
+if (NewCellSize <= 0 || MaxObjects <= 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideHash::Setup(): Invalid size! (%f, %d)", NewCellSize, MaxObjects);
+    return IMRERR_GENERIC;
+     }
+CellSize = NewCellSize;
+Inv_CellSize = 1.0f / NewCellSize;
+
+// Use a power of two number of buckets, at least twice the objects:
+for (Num_Buckets = 16; Num_Buckets < MaxObjects * 2; Num_Buckets <<= 1);
+
+// Allocate space (an object in the grid never covers more than
+// IMR_COLLIDEHASH_MAXCELLS cells, so the links can't run out):
+Max_Entries = MaxObjects;
+Max_Links = MaxObjects * IMR_COLLIDEHASH_MAXCELLS;
+Buckets = (int *)malloc(sizeof(int) * Num_Buckets);
+Entries = (IMR_CollideHashEntry *)malloc(sizeof(IMR_CollideHashEntry) * Max_Entries);
+Links = (IMR_CollideHashLink *)malloc(sizeof(IMR_CollideHashLink) * Max_Links);
+if (!Buckets || !Entries || !Links)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideHash::Setup(): Out of memory! (%d)", MaxObjects);
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+
+// Everything starts out empty:
+for (index = 0; index < Num_Buckets; index ++)
+    Buckets[index] = -1;
+for (index = 0; index < Max_Entries; index ++)
+    {
+    Entries[index].Obj = NULL;
+    Entries[index].State = IMR_COLLIDEHASH_FREE;
+    Entries[index].FirstLink = -1;
+    Entries[index].Next = index + 1 < Max_Entries ? index + 1 : -1;
+     }
+for (index = 0; index < Max_Links; index ++)
+    Links[index].Next_InEntry = index + 1 < Max_Links ? index + 1 : -1;
+Free_Entry = 0;
+Free_Link = 0;
+Big_Entry = -1;
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Frees all memory used by the hash.
+\***************************************************************************/
+void IMR_CollideHash::Reset(void)
+{
+if (Buckets) free(Buckets);
+if (Entries) free(Entries);
+if (Links) free(Links);
+Buckets = NULL;
+Entries = NULL;
+Links = NULL;
+Num_Buckets = Max_Entries = Max_Links = 0;
+Free_Entry = Big_Entry = Free_Link = -1;
+ }
+
+/***************************************************************************\
+  Returns the bucket of the specified cell.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_CollideHash::Hash_Cell(int X, int Y, int Z)
+{
+return (int)(((unsigned long)X * 73856093UL) ^ ((unsigned long)Y * 19349663UL) ^ ((unsigned long)Z * 83492791UL)) & (Num_Buckets - 1);
+ }
+
+/***************************************************************************\
+  Adds the specified object to the hash, with the specified bounding box
+  (global coords, or NULL if it has none).
+  Returns the entry of the object, or -1 if the hash is full.
+\***************************************************************************/
+int IMR_CollideHash::Add(IMR_Object *Obj, float *Min, float *Max)
+{
+int Entry;
+
+// Get a free entry:
+if (Free_Entry < 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideHash::Add(): Hash is full! (%d)", Max_Entries);
+    return -1;
+     }
+Entry = Free_Entry;
+Free_Entry = Entries[Entry].Next;
+
+// Fill it in and put it in it's cells:
+Entries[Entry].Obj = Obj;
+Entries[Entry].State = IMR_COLLIDEHASH_NOBOUNDS;
+Entries[Entry].FirstLink = -1;
+Entries[Entry].Next = -1;
+Move(Entry, Min, Max);
+
+// Return the entry:
+return Entry;
+ }
+
+/***************************************************************************\
+  Gives the specified entry a new bounding box (global coords, or NULL if
+  it has none).  The entry is only relinked if it covers different cells.
+\***************************************************************************/
+void IMR_CollideHash::Move(int Entry, float *Min, float *Max)
+{
+IMR_CollideHashEntry *E;
+int CMin[3], CMax[3], Span, c;
+
+// Make sure the entry is in use:
+if (Entry < 0 || Entry >= Max_Entries) return;
+E = &Entries[Entry];
+if (E->State == IMR_COLLIDEHASH_FREE) return;
+
+// If there's no box, take it out of the grid:
+if (!Min || !Max)
+    {
+    if (E->State == IMR_COLLIDEHASH_CELLS) Unlink_Cells(Entry);
+    if (E->State == IMR_COLLIDEHASH_BIG) Unlink_Big(Entry);
+    E->State = IMR_COLLIDEHASH_NOBOUNDS;
+    return;
+     }
+
+// Save the box and find the cells it covers:
+for (c = 0; c < 3; c ++)
+    {
+    E->Min[c] = Min[c];
+    E->Max[c] = Max[c];
+    CMin[c] = (int)floor(Min[c] * Inv_CellSize);
+    CMax[c] = (int)floor(Max[c] * Inv_CellSize);
+     }
+
+// Nothing else to do if they're the same cells as before:
+if (E->State == IMR_COLLIDEHASH_CELLS &&
+    CMin[0] == E->CMin[0] && CMin[1] == E->CMin[1] && CMin[2] == E->CMin[2] &&
+    CMax[0] == E->CMax[0] && CMax[1] == E->CMax[1] && CMax[2] == E->CMax[2]) return;
+
+// Otherwise take it out of the old cells:
+if (E->State == IMR_COLLIDEHASH_CELLS) Unlink_Cells(Entry);
+if (E->State == IMR_COLLIDEHASH_BIG) Unlink_Big(Entry);
+for (c = 0; c < 3; c ++)
+    {
+    E->CMin[c] = CMin[c];
+    E->CMax[c] = CMax[c];
+     }
+
+// Count the cells it covers (a bit at a time so it can't overflow):
+Span = 1;
+for (c = 0; c < 3 && Span <= IMR_COLLIDEHASH_MAXCELLS; c ++)
+    {
+    if (CMax[c] - CMin[c] >= IMR_COLLIDEHASH_MAXCELLS) Span = IMR_COLLIDEHASH_MAXCELLS + 1;
+    else Span *= CMax[c] - CMin[c] + 1;
+     }
+
+// Keep big objects apart, and put the rest in the new cells:
+if (Span > IMR_COLLIDEHASH_MAXCELLS)
+    {
+    E->State = IMR_COLLIDEHASH_BIG;
+    E->Next = Big_Entry;
+    Big_Entry = Entry;
+     }
+else
+    {
+    E->State = IMR_COLLIDEHASH_CELLS;
+    Link_Cells(Entry);
+     }
+ }
+
+/***************************************************************************\
+  Removes the specified entry from the hash.
+\***************************************************************************/
+void IMR_CollideHash::Remove(int Entry)
+{
+// Make sure the entry is in use:
+if (Entry < 0 || Entry >= Max_Entries || Entries[Entry].State == IMR_COLLIDEHASH_FREE) return;
+
+// Take it out of the grid:
+Move(Entry, NULL, NULL);
+
+// And free the entry:
+Entries[Entry].Obj = NULL;
+Entries[Entry].State = IMR_COLLIDEHASH_FREE;
+Entries[Entry].Next = Free_Entry;
+Free_Entry = Entry;
+ }
+
+/***************************************************************************\
+  Links the specified entry into each cell it covers.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_CollideHash::Link_Cells(int Entry)
+{
+IMR_CollideHashEntry *E = &Entries[Entry];
+IMR_CollideHashLink *L;
+int X, Y, Z, Link;
+
+E->FirstLink = -1;
+for (X = E->CMin[0]; X <= E->CMax[0]; X ++)
+    for (Y = E->CMin[1]; Y <= E->CMax[1]; Y ++)
+        for (Z = E->CMin[2]; Z <= E->CMax[2]; Z ++)
+            {
+            // Get a free link:
+            Link = Free_Link;
+            L = &Links[Link];
+            Free_Link = L->Next_InEntry;
+
+            // Fill it in:
+            L->Entry = Entry;
+            L->Cell[0] = X;
+            L->Cell[1] = Y;
+            L->Cell[2] = Z;
+            L->Next_InEntry = E->FirstLink;
+            E->FirstLink = Link;
+
+            // And put it at the front of the bucket:
+            L->Bucket = Hash_Cell(X, Y, Z);
+            L->Prev = -1;
+            L->Next = Buckets[L->Bucket];
+            if (L->Next >= 0) Links[L->Next].Prev = Link;
+            Buckets[L->Bucket] = Link;
+             }
+ }
+
+/***************************************************************************\
+  Unlinks the specified entry from the cells it's in.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_CollideHash::Unlink_Cells(int Entry)
+{
+IMR_CollideHashEntry *E = &Entries[Entry];
+IMR_CollideHashLink *L;
+int Link, Next;
+
+for (Link = E->FirstLink; Link >= 0; Link = Next)
+    {
+    L = &Links[Link];
+    Next = L->Next_InEntry;
+
+    // Take it out of the bucket:
+    if (L->Prev >= 0) Links[L->Prev].Next = L->Next;
+    else Buckets[L->Bucket] = L->Next;
+    if (L->Next >= 0) Links[L->Next].Prev = L->Prev;
+
+    // And free it:
+    L->Next_InEntry = Free_Link;
+    Free_Link = Link;
+     }
+E->FirstLink = -1;
+ }
+
+/***************************************************************************\
+  Takes the specified entry off the list of big objects.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_CollideHash::Unlink_Big(int Entry)
+{
+int *Prev;
+
+for (Prev = &Big_Entry; *Prev >= 0; Prev = &Entries[*Prev].Next)
+    if (*Prev == Entry)
+        {
+        *Prev = Entries[Entry].Next;
+        break;
+         }
+Entries[Entry].Next = -1;
+ }
+
+/***************************************************************************\
+  Finds each pair of objects whose bounding boxes touch, and stores up to
+  MaxPairs of them.  Each pair is only found once: objects in the grid are
+  paired in the first cell they share, and big objects are tested against
+  everything.  The pairs only say the boxes touch; checking the models is
+  up to the caller (CheckCollide() on one with the other's ellipsoid).
+  The boxes are from the last time the objects' coords were found, so
+  call ResolveCoords() on the world first.
+  Returns the number of pairs found (which can be more than MaxPairs).
+\***************************************************************************/
+int IMR_CollideHash::Find_Pairs(IMR_CollidePair *Pairs, int MaxPairs)
+{
+IMR_CollideHashLink *LA, *LB;
+IMR_CollideHashEntry *A, *B;
+int Bucket, LinkA, LinkB, Big, Entry, Found, c;
+
+Found = 0;
+
+// Check the objects sharing each bucket:
+for (Bucket = 0; Bucket < Num_Buckets; Bucket ++)
+    for (LinkA = Buckets[Bucket]; LinkA >= 0; LinkA = LA->Next)
+        {
+        LA = &Links[LinkA];
+        A = &Entries[LA->Entry];
+        for (LinkB = LA->Next; LinkB >= 0; LinkB = LB->Next)
+            {
+            LB = &Links[LinkB];
+            B = &Entries[LB->Entry];
+
+            // Skip different cells that landed in the same bucket:
+            if (LA->Cell[0] != LB->Cell[0] || LA->Cell[1] != LB->Cell[1] || LA->Cell[2] != LB->Cell[2]) continue;
+
+            // Only pair them in the first cell they share:
+            for (c = 0; c < 3; c ++)
+                if (LA->Cell[c] != (A->CMin[c] > B->CMin[c] ? A->CMin[c] : B->CMin[c])) break;
+            if (c < 3 || !Boxes_Touch(*A, *B)) continue;
+
+            // Found one:
+            if (Found < MaxPairs)
+                {
+                Pairs[Found].A = A->Obj;
+                Pairs[Found].B = B->Obj;
+                 }
+            ++ Found;
+             }
+         }
+
+// Check the big objects against everything else:
+for (Big = Big_Entry; Big >= 0; Big = A->Next)
+    {
+    A = &Entries[Big];
+    for (Entry = 0; Entry < Max_Entries; Entry ++)
+        {
+        B = &Entries[Entry];
+
+        // Skip anything not in the grid (and big pairs after the first time):
+        if (B->State != IMR_COLLIDEHASH_CELLS &&
+           (B->State != IMR_COLLIDEHASH_BIG || Entry <= Big)) continue;
+        if (!Boxes_Touch(*A, *B)) continue;
+
+        // Found one:
+        if (Found < MaxPairs)
+            {
+            Pairs[Found].A = A->Obj;
+            Pairs[Found].B = B->Obj;
+             }
+        ++ Found;
+         }
+     }
+
+// Return the number found:
+return Found;
+ }
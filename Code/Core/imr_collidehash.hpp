@@ -0,0 +1,110 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_CollideHash.hpp
+ Description: Header
+
+\****************************************************************/
+#ifndef __IMR_COLLIDEHASH__HPP
+#define __IMR_COLLIDEHASH__HPP
+
+// Include headers:
+#include <stdlib.h>
+#include <math.h>
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
+
+// Constants:
+#define IMR_COLLIDEHASH_MAXCELLS    8       // Max cells an object can cover before it's kept apart as a big object
+
+// Entry states:
+#define IMR_COLLIDEHASH_FREE        0       // Not in use
+#define IMR_COLLIDEHASH_NOBOUNDS    1       // In use, but has no bounds (so never pairs)
+#define IMR_COLLIDEHASH_CELLS       2       // Linked into the cells it covers
+#define IMR_COLLIDEHASH_BIG         3       // Covers too many cells, tested against everything
+
+// Defined elsewhere:
+class IMR_Object;
+
+// Possibly touching pair of objects:
+struct IMR_CollidePair
+    {
+    IMR_Object *A, *B;
+     };
+
+// Object in the hash (global coords):
+struct IMR_CollideHashEntry
+    {
+    IMR_Object *Obj;
+    float Min[3], Max[3];       // Bounding box
+    int CMin[3], CMax[3];       // Cells the box covers
+    int State;
+    int FirstLink;              // Links of the cells it's in (-1 if none)
+    int Next;                   // Next free or big entry
+     };
+
+// Entry in a cell (each bucket is a doubly linked list of these):
+struct IMR_CollideHashLink
+    {
+    int Entry;
+    int Cell[3];
+    int Bucket, Prev, Next;
+    int Next_InEntry;           // Next link of the same entry (or next free link)
+     };
+
+// Spatial hash class.  Keeps the bounds of moving objects in a uniform grid
+// of cells (hashed into a fixed table), so pairs of objects that might touch
+// can be found without testing every object against every other:
+class IMR_CollideHash
+    {
+    protected:
+      float CellSize, Inv_CellSize;
+      int *Buckets;                 // First link in each bucket (-1 if empty)
+      int Num_Buckets;
+      IMR_CollideHashEntry *Entries;
+      int Max_Entries, Free_Entry, Big_Entry;
+      IMR_CollideHashLink *Links;
+      int Max_Links, Free_Link;
+
+      // Protected member functions:
+      int Hash_Cell(int X, int Y, int Z);
+      void Link_Cells(int Entry);
+      void Unlink_Cells(int Entry);
+      void Unlink_Big(int Entry);
+      inline int Boxes_Touch(IMR_CollideHashEntry &A, IMR_CollideHashEntry &B)
+          {
+          return A.Min[0] <= B.Max[0] && A.Max[0] >= B.Min[0] &&
+                 A.Min[1] <= B.Max[1] && A.Max[1] >= B.Min[1] &&
+                 A.Min[2] <= B.Max[2] && A.Max[2] >= B.Min[2];
+           };
+
+    public:
+      IMR_CollideHash()
+          {
+          Buckets = NULL; Entries = NULL; Links = NULL;
+          Num_Buckets = Max_Entries = Max_Links = 0;
+          Free_Entry = Big_Entry = Free_Link = -1;
+          CellSize = Inv_CellSize = 0;
+           };
+      ~IMR_CollideHash() { Reset(); };
+
+      // Init and de-init methods:
+      int Setup(float NewCellSize, int MaxObjects);
+      void Reset(void);
+
+      // Object methods:
+      int Add(IMR_Object *Obj, float *Min, float *Max);
+      void Move(int Entry, float *Min, float *Max);
+      void Remove(int Entry);
+
+      // Query methods:
+      int Find_Pairs(IMR_CollidePair *Pairs, int MaxPairs);
+
+      // Info methods:
+      inline float Get_CellSize(void) { return CellSize; };
+     };
+
+#endif
@@ -0,0 +1,517 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_CollideMesh.cpp
+ Description: Collision mesh module.  Splits the polys of a model
+              into triangles and precomputes everything the
+              collision code needs (edges, unit normals, plane
+              distances), so queries never touch the render data.
+
+ RDF layout (after the usual type and resource name):
+   int   Number of triangles
+   int   Number of polys
+   int   Vertex indices (3 per triangle)
+   int   Poly of each triangle
+   float Each triangle array in turn (Ax, Ay, Az, E1x ... Nz, D)
+   float Bounding sphere of each poly (X, Y, Z, Radius)
+
+\****************************************************************/
+#include "imr_collidemesh.hpp"
+
+/***************************************************************************\
+  Returns the first 16 byte boundary at or after the specified pointer.
+  Notes: Protected member function.
+\***************************************************************************/
+float *IMR_CollideMesh::Align(float *Ptr)
+{
+return (float *)(((size_t)Ptr + 15) & ~(size_t)15);
+ }
+
+/***************************************************************************\
+  Allocates memory for the specified number of triangles and polys and
+  sets up the array pointers.
+  Notes: Protected member function.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_CollideMesh::Alloc(int NumTris, int NumGroups)
+{
+float *Stream[IMR_COLLIDEMESH_STREAMS];
+float *Ptr;
+int stream;
+
+// Get rid of the old mesh:
+Reset();
+
+// Allocate space (each array is padded to a multiple of 4 floats, so they
+// all stay aligned):
+Num_Padded = (NumTris + 3) & ~3;
+Block = (float *)malloc(sizeof(float) * ((Num_Padded * IMR_COLLIDEMESH_STREAMS) + 4));
+Verts = (int *)malloc(sizeof(int) * 3 * NumTris);
+Group = (int *)malloc(sizeof(int) * NumTris);
+Spheres = (float *)malloc(sizeof(float) * 4 * NumGroups);
+if (!Block || !Verts || !Group || !Spheres)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideMesh::Alloc(): Out of memory! (%d)", NumTris);
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+memset(Block, 0, sizeof(float) * ((Num_Padded * IMR_COLLIDEMESH_STREAMS) + 4));
+
+// Point the arrays into the block:
+Ptr = Align(Block);
+for (stream = 0; stream < IMR_COLLIDEMESH_STREAMS; stream ++, Ptr += Num_Padded)
+    Stream[stream] = Ptr;
+Ax = Stream[0];  Ay = Stream[1];  Az = Stream[2];
+E1x = Stream[3]; E1y = Stream[4]; E1z = Stream[5];
+E2x = Stream[6]; E2y = Stream[7]; E2z = Stream[8];
+Nx = Stream[9];  Ny = Stream[10]; Nz = Stream[11];
+D = Stream[12];
+
+// Save the sizes:
+Num_Tris = NumTris;
+Num_Groups = NumGroups;
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Frees the ellipsoid space copies.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_CollideMesh::Drop_Scaled(void)
+{
+for (int slot = 0; slot < IMR_COLLIDEMESH_SCALES; slot ++)
+    {
+    if (Scaled[slot].Block) free(Scaled[slot].Block);
+    Scaled[slot].Block = NULL;
+     }
+Scaled_Clock = 0;
+ }
+
+/***************************************************************************\
+  Frees all memory used by the mesh.
+\***************************************************************************/
+void IMR_CollideMesh::Reset(void)
+{
+if (Block) free(Block);
+if (Verts) free(Verts);
+if (Group) free(Group);
+if (Spheres) free(Spheres);
+Drop_Scaled();
+Block = NULL;
+Verts = Group = NULL;
+Spheres = NULL;
+Num_Tris = Num_Padded = Num_Groups = 0;
+Revision = -1;
+ }
+
+/***************************************************************************\
+  Builds the mesh from the polys of the specified model (local coords).
+  Quads are split along the 1-3 diagonal and the rest are fanned.
+  Triangles with a zero length edge are left out.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_CollideMesh::Build(IMR_Model &Mdl)
+{
+int Split[IMR_MAXPOLYVERTS * 3];
+IMR_Polygon *Poly;
+IMR_3DPoint *A, *B, *C, Normal;
+int poly, tri, Num, Count, split, err;
+
+// Count the triangles:
+Count = 0;
+for (poly = 0; poly < Mdl.Num_Polygons; poly ++)
+    if (Mdl.Polygons[poly].Num_Verts >= 3)
+        Count += Mdl.Polygons[poly].Num_Verts - 2;
+if (!Count)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideMesh::Build(): Model %s has no polys!", Mdl.Get_Name());
+    return IMRERR_NODATA;
+     }
+
+// Allocate space:
+err = Alloc(Count, Mdl.Num_Polygons);
+if (IMR_ISNOTOK(err)) return err;
+
+// Split the polys into triangles:
+Num = 0;
+for (poly = 0; poly < Mdl.Num_Polygons; poly ++)
+    {
+    Poly = &Mdl.Polygons[poly];
+
+    // Save the bounding sphere:
+    Spheres[poly * 4 + 0] = Poly->Centroid.X;
+    Spheres[poly * 4 + 1] = Poly->Centroid.Y;
+    Spheres[poly * 4 + 2] = Poly->Centroid.Z;
+    Spheres[poly * 4 + 3] = Poly->Radius;
+    if (Poly->Num_Verts < 3) continue;
+
+    // Find the corners of each triangle:
+    Count = 0;
+    if (Poly->Num_Verts == 4)
+        {
+        Split[0] = Poly->Vtx_Index[0]; Split[1] = Poly->Vtx_Index[1]; Split[2] = Poly->Vtx_Index[3];
+        Split[3] = Poly->Vtx_Index[1]; Split[4] = Poly->Vtx_Index[2]; Split[5] = Poly->Vtx_Index[3];
+        Count = 2;
+         }
+    else
+        for (tri = 1; tri < Poly->Num_Verts - 1; tri ++, Count ++)
+            {
+            Split[Count * 3 + 0] = Poly->Vtx_Index[0];
+            Split[Count * 3 + 1] = Poly->Vtx_Index[tri];
+            Split[Count * 3 + 2] = Poly->Vtx_Index[tri + 1];
+             }
+
+    // Get the unit normal of the poly:
+    Normal.X = Mdl.Vertices[Poly->Normal_Index].lX - Mdl.Vertices[Poly->Vtx_Index[0]].lX;
+    Normal.Y = Mdl.Vertices[Poly->Normal_Index].lY - Mdl.Vertices[Poly->Vtx_Index[0]].lY;
+    Normal.Z = Mdl.Vertices[Poly->Normal_Index].lZ - Mdl.Vertices[Poly->Vtx_Index[0]].lZ;
+    Normal.Make_Unit();
+
+    // And save each triangle:
+    for (split = 0; split < Count; split ++)
+        {
+        A = &Mdl.Vertices[Split[split * 3 + 0]];
+        B = &Mdl.Vertices[Split[split * 3 + 1]];
+        C = &Mdl.Vertices[Split[split * 3 + 2]];
+        if ((B->lX == A->lX && B->lY == A->lY && B->lZ == A->lZ) ||
+            (C->lX == A->lX && C->lY == A->lY && C->lZ == A->lZ)) continue;
+        Ax[Num] = A->lX; Ay[Num] = A->lY; Az[Num] = A->lZ;
+        E1x[Num] = B->lX - A->lX; E1y[Num] = B->lY - A->lY; E1z[Num] = B->lZ - A->lZ;
+        E2x[Num] = C->lX - A->lX; E2y[Num] = C->lY - A->lY; E2z[Num] = C->lZ - A->lZ;
+        Nx[Num] = Normal.X; Ny[Num] = Normal.Y; Nz[Num] = Normal.Z;
+        D[Num] = -((Normal.X * A->lX) + (Normal.Y * A->lY) + (Normal.Z * A->lZ));
+        Verts[Num * 3 + 0] = Split[split * 3 + 0];
+        Verts[Num * 3 + 1] = Split[split * 3 + 1];
+        Verts[Num * 3 + 2] = Split[split * 3 + 2];
+        Group[Num] = poly;
+        ++ Num;
+         }
+     }
+
+// Make sure something was left:
+Num_Tris = Num;
+if (!Num_Tris)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideMesh::Build(): Model %s has no usable polys!", Mdl.Get_Name());
+    Reset();
+    return IMRERR_NODATA;
+     }
+
+// Remember what we were built from:
+Revision = Mdl.Get_Revision();
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Builds the mesh from the specified list of triangles (9 floats each, the
+  three corners in turn).  Each triangle is it's own group, and it's
+  vertex indices point at it's corners in the list.  Triangles with no
+  area are left out.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_CollideMesh::Build(float *Corners, int NumTris)
+{
+float *A, *B, *C, *P, *Sphere, Normal[3], Len;
+int tri, Num, c, err;
+
+// Allocate space:
+if (NumTris <= 0 || !Corners)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideMesh::Build(): No triangles!");
+    return IMRERR_NODATA;
+     }
+err = Alloc(NumTris, NumTris);
+if (IMR_ISNOTOK(err)) return err;
+
+// Save each triangle:
+Num = 0;
+for (tri = 0; tri < NumTris; tri ++)
+    {
+    A = &Corners[tri * 9];
+    B = A + 3;
+    C = A + 6;
+
+    // Save the bounding sphere (around the center):
+    Sphere = &Spheres[tri * 4];
+    for (c = 0; c < 3; c ++) Sphere[c] = (A[c] + B[c] + C[c]) * (1.0f / 3.0f);
+    Sphere[3] = 0;
+    for (P = A; P <= C; P += 3)
+        {
+        Len = sqrt(((P[0] - Sphere[0]) * (P[0] - Sphere[0])) +
+                   ((P[1] - Sphere[1]) * (P[1] - Sphere[1])) +
+                   ((P[2] - Sphere[2]) * (P[2] - Sphere[2])));
+        if (Len > Sphere[3]) Sphere[3] = Len;
+         }
+
+    // Find the unit normal (skip it if there's no area):
+    Normal[0] = ((B[1] - A[1]) * (C[2] - A[2])) - ((B[2] - A[2]) * (C[1] - A[1]));
+    Normal[1] = ((B[2] - A[2]) * (C[0] - A[0])) - ((B[0] - A[0]) * (C[2] - A[2]));
+    Normal[2] = ((B[0] - A[0]) * (C[1] - A[1])) - ((B[1] - A[1]) * (C[0] - A[0]));
+    Len = sqrt((Normal[0] * Normal[0]) + (Normal[1] * Normal[1]) + (Normal[2] * Normal[2]));
+    if (Len <= 0.0f) continue;
+    Normal[0] /= Len; Normal[1] /= Len; Normal[2] /= Len;
+
+    // And save it:
+    Ax[Num] = A[0]; Ay[Num] = A[1]; Az[Num] = A[2];
+    E1x[Num] = B[0] - A[0]; E1y[Num] = B[1] - A[1]; E1z[Num] = B[2] - A[2];
+    E2x[Num] = C[0] - A[0]; E2y[Num] = C[1] - A[1]; E2z[Num] = C[2] - A[2];
+    Nx[Num] = Normal[0]; Ny[Num] = Normal[1]; Nz[Num] = Normal[2];
+    D[Num] = -((Normal[0] * A[0]) + (Normal[1] * A[1]) + (Normal[2] * A[2]));
+    Verts[Num * 3 + 0] = tri * 3 + 0;
+    Verts[Num * 3 + 1] = tri * 3 + 1;
+    Verts[Num * 3 + 2] = tri * 3 + 2;
+    Group[Num] = tri;
+    ++ Num;
+     }
+
+// Make sure something was left:
+Num_Tris = Num;
+if (!Num_Tris)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideMesh::Build(): No usable triangles!");
+    Reset();
+    return IMRERR_NODATA;
+     }
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Makes a copy of the triangle corners scaled into ellipsoid space by the
+  specified horizontal and vertical scales (1 / radius), so queries with
+  the same ellipsoid don't have to scale them each time.  A copy is kept
+  for each of the last few ellipsoid sizes, so movers of different sizes
+  don't keep rescaling the whole mesh.  Only good for queries done in
+  model space with a model turned about Y.
+  Returns a pointer to the copy if successful, otherwise NULL.
+\***************************************************************************/
+IMR_CollideScaled *IMR_CollideMesh::Prepare(float NewScaleH, float NewScaleV)
+{
+IMR_CollideScaled *Copy;
+float *Ptr;
+int slot, tri;
+
+// Don't bother if we already have it:
+if (!Num_Tris) return NULL;
+Copy = Get_Prepared(NewScaleH, NewScaleV);
+if (Copy)
+    {
+    Copy->Last_Used = ++ Scaled_Clock;
+    return Copy;
+     }
+
+// Use a free slot, or the one used longest ago:
+Copy = &Scaled[0];
+for (slot = 0; slot < IMR_COLLIDEMESH_SCALES; slot ++)
+    {
+    if (!Scaled[slot].Block) { Copy = &Scaled[slot]; break; }
+    if (Scaled[slot].Last_Used < Copy->Last_Used) Copy = &Scaled[slot];
+     }
+
+// Allocate space:
+if (!Copy->Block)
+    {
+    Copy->Block = (float *)malloc(sizeof(float) * ((Num_Padded * IMR_COLLIDEMESH_CORNERS) + 4));
+    if (!Copy->Block)
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideMesh::Prepare(): Out of memory! (%d)", Num_Tris);
+        return NULL;
+         }
+    memset(Copy->Block, 0, sizeof(float) * ((Num_Padded * IMR_COLLIDEMESH_CORNERS) + 4));
+    Ptr = Align(Copy->Block);
+    Copy->Ax = Ptr; Ptr += Num_Padded; Copy->Ay = Ptr; Ptr += Num_Padded; Copy->Az = Ptr; Ptr += Num_Padded;
+    Copy->Bx = Ptr; Ptr += Num_Padded; Copy->By = Ptr; Ptr += Num_Padded; Copy->Bz = Ptr; Ptr += Num_Padded;
+    Copy->Cx = Ptr; Ptr += Num_Padded; Copy->Cy = Ptr; Ptr += Num_Padded; Copy->Cz = Ptr;
+     }
+
+// Scale the corners:
+for (tri = 0; tri < Num_Tris; tri ++)
+    {
+    Copy->Ax[tri] = Ax[tri] * NewScaleH;
+    Copy->Ay[tri] = Ay[tri] * NewScaleV;
+    Copy->Az[tri] = Az[tri] * NewScaleH;
+    Copy->Bx[tri] = (Ax[tri] + E1x[tri]) * NewScaleH;
+    Copy->By[tri] = (Ay[tri] + E1y[tri]) * NewScaleV;
+    Copy->Bz[tri] = (Az[tri] + E1z[tri]) * NewScaleH;
+    Copy->Cx[tri] = (Ax[tri] + E2x[tri]) * NewScaleH;
+    Copy->Cy[tri] = (Ay[tri] + E2y[tri]) * NewScaleV;
+    Copy->Cz[tri] = (Az[tri] + E2z[tri]) * NewScaleH;
+     }
+Copy->ScaleH = NewScaleH;
+Copy->ScaleV = NewScaleV;
+Copy->Last_Used = ++ Scaled_Clock;
+
+// And return the copy:
+return Copy;
+ }
+
+/***************************************************************************\
+  Swaps two triangles (used to sort them while building a tree).  Drops
+  the ellipsoid space copies.
+\***************************************************************************/
+void IMR_CollideMesh::Swap_Tris(int TriA, int TriB)
+{
+float *Ptr, Temp;
+int stream, vtx, TempIndex;
+
+if (TriA == TriB) return;
+
+// Swap the float arrays:
+Ptr = Ax;
+for (stream = 0; stream < IMR_COLLIDEMESH_STREAMS; stream ++, Ptr += Num_Padded)
+    {
+    Temp = Ptr[TriA]; Ptr[TriA] = Ptr[TriB]; Ptr[TriB] = Temp;
+     }
+
+// And the indices:
+for (vtx = 0; vtx < 3; vtx ++)
+    {
+    TempIndex = Verts[TriA * 3 + vtx];
+    Verts[TriA * 3 + vtx] = Verts[TriB * 3 + vtx];
+    Verts[TriB * 3 + vtx] = TempIndex;
+     }
+TempIndex = Group[TriA]; Group[TriA] = Group[TriB]; Group[TriB] = TempIndex;
+
+// The scaled copies are out of order now:
+if (Scaled_Clock) Drop_Scaled();
+ }
+
+/***************************************************************************\
+  Saves the mesh to the specified file as an RDF with the specified
+  resource name.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_CollideMesh::Save(char *FileName, char *ResName)
+{
+char Buffer[33];
+float *Ptr;
+int fd, stream;
+
+// Make sure we have something to save:
+if (!Num_Tris)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_CollideMesh::Save(): Nothing to save!");
+    return IMRERR_NODATA;
+     }
+
+// Open the file:
+fd = open(FileName, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, S_IREAD | S_IWRITE);
+if (fd == -1)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Can not create file %s!", FileName);
+    return IMRERR_BADFILE;
+     }
+
+// Write the type and resource name:
+write(fd, IMR_COLLIDEMESH_RDFTYPE, 3);
+memset(Buffer, 0, 33);
+strncpy(Buffer, ResName, 32);
+write(fd, Buffer, 32);
+
+// Write the sizes and indices:
+write(fd, &Num_Tris, 4);
+write(fd, &Num_Groups, 4);
+write(fd, Verts, sizeof(int) * 3 * Num_Tris);
+write(fd, Group, sizeof(int) * Num_Tris);
+
+// Write the triangle arrays:
+Ptr = Ax;
+for (stream = 0; stream < IMR_COLLIDEMESH_STREAMS; stream ++, Ptr += Num_Padded)
+    write(fd, Ptr, sizeof(float) * Num_Tris);
+
+// Write the bounding spheres:
+write(fd, Spheres, sizeof(float) * 4 * Num_Groups);
+
+// Close the file:
+close(fd);
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Loads the mesh with the specified resource name for the specified model.
+  The mesh is checked against the model so it's indices are safe to use.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_CollideMesh::Load(char *ResName, IMR_Model &Mdl)
+{
+IMR_RDFResourceDesc ResourceDesc;
+unsigned char Buffer[35];
+float *Ptr;
+int fd, err, NumTris, NumGroups, stream, index, Bad;
+
+// Look for the file in our resources:
+ResourceDesc = IMR_Resources.Get_RDFManager()->FindRDF(IMR_COLLIDEMESH_RDFTYPE, NULL, ResName);
+if (ResourceDesc == -1)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Collision mesh %s not found in resource directory!", ResName);
+    return IMRERR_BADFILE;
+     }
+
+// Open the file:
+err = IMR_Resources.Get_RDFManager()->OpenRDF(ResourceDesc, fd);
+if (IMR_ISNOTOK(err))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Can't load collision mesh %s!", ResName);
+    return IMRERR_BADFILE;
+     }
+
+// Eat ID and name:
+read(fd, Buffer, 35);
+
+// Read the sizes and make room:
+NumTris = NumGroups = 0;
+read(fd, &NumTris, 4);
+read(fd, &NumGroups, 4);
+if (NumTris <= 0 || NumGroups != Mdl.Num_Polygons)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Collision mesh %s doesn't match model %s!", ResName, Mdl.Get_Name());
+    IMR_Resources.Get_RDFManager()->CloseRDF(fd);
+    return IMRERR_BADFILE;
+     }
+err = Alloc(NumTris, NumGroups);
+if (IMR_ISNOTOK(err))
+    {
+    IMR_Resources.Get_RDFManager()->CloseRDF(fd);
+    return err;
+     }
+
+// Read the indices, triangle arrays and spheres:
+read(fd, Verts, sizeof(int) * 3 * Num_Tris);
+read(fd, Group, sizeof(int) * Num_Tris);
+Ptr = Ax;
+for (stream = 0; stream < IMR_COLLIDEMESH_STREAMS; stream ++, Ptr += Num_Padded)
+    read(fd, Ptr, sizeof(float) * Num_Tris);
+read(fd, Spheres, sizeof(float) * 4 * Num_Groups);
+
+// Close the file:
+IMR_Resources.Get_RDFManager()->CloseRDF(fd);
+
+// Make sure the indices are in the model:
+Bad = 0;
+for (index = 0; index < Num_Tris * 3; index ++)
+    if (Verts[index] < 0 || Verts[index] >= Mdl.Num_Vertices) Bad = 1;
+for (index = 0; index < Num_Tris; index ++)
+    if (Group[index] < 0 || Group[index] >= Num_Groups) Bad = 1;
+if (Bad)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Bad collision mesh %s for model %s!", ResName, Mdl.Get_Name());
+    Reset();
+    return IMRERR_BADFILE;
+     }
+
+// Remember what we were loaded for:
+Revision = Mdl.Get_Revision();
+
+// And return ok:
+return IMR_OK;
+ }
@@ -0,0 +1,106 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_CollideMesh.hpp
+ Description: Header
+
+\****************************************************************/
+#ifndef __IMR_COLLIDEMESH__HPP
+#define __IMR_COLLIDEMESH__HPP
+
+// Include headers:
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "imr_geom_model.hpp"
+#include "imr_rdfmngr.hpp"
+#include "imr_resource.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
+
+// Constants:
+#define IMR_COLLIDEMESH_RDFTYPE     "Clm"
+#define IMR_COLLIDEMESH_STREAMS     13      // Float arrays per triangle (A, edges, normal, plane distance)
+#define IMR_COLLIDEMESH_CORNERS     9       // Float arrays per triangle in the ellipsoid space copy
+#define IMR_COLLIDEMESH_SCALES      4       // Ellipsoid space copies kept (one per ellipsoid size)
+
+// Copy of the triangle corners scaled into ellipsoid space (see
+// IMR_CollideMesh::Prepare()):
+struct IMR_CollideScaled
+    {
+    float ScaleH, ScaleV;       // Scale the copy was made with
+    float *Block;               // Memory for the float arrays (unaligned, NULL if the slot is free)
+    int Last_Used;              // When the copy was last prepared (for picking one to replace)
+    float *Ax, *Ay, *Az, *Bx, *By, *Bz, *Cx, *Cy, *Cz;
+     };
+
+// Collision mesh class (model coords).  Each value is kept in it's own
+// array, padded to a multiple of 4 and aligned to 16 bytes, so a query only
+// pulls in what it reads:
+class IMR_CollideMesh
+    {
+    protected:
+      int Num_Tris, Num_Padded, Num_Groups;
+      float *Block;                 // Memory for the float arrays (unaligned)
+      IMR_CollideScaled Scaled[IMR_COLLIDEMESH_SCALES];   // Ellipsoid space copies
+      int Scaled_Clock;             // Counts calls to Prepare() (for Last_Used)
+      int Revision;                 // Model revision the mesh was built from
+
+      // Protected member functions:
+      int Alloc(int NumTris, int NumGroups);
+      void Drop_Scaled(void);
+      float *Align(float *Ptr);
+
+    public:
+      // Triangle data (Num_Tris of each):
+      float *Ax, *Ay, *Az;          // First corner
+      float *E1x, *E1y, *E1z;       // Edge from the first corner to the second
+      float *E2x, *E2y, *E2z;       // Edge from the first corner to the third
+      float *Nx, *Ny, *Nz;          // Unit plane normal
+      float *D;                     // Plane distance (N.P + D = 0 on the plane)
+      int *Verts;                   // Model vertex index of each corner (3 per triangle)
+      int *Group;                   // Poly each triangle came from
+
+      // Bounding sphere of each poly (X, Y, Z, Radius):
+      float *Spheres;
+
+      IMR_CollideMesh()
+          {
+          Block = NULL;
+          Verts = Group = NULL;
+          Spheres = NULL;
+          Num_Tris = Num_Padded = Num_Groups = 0;
+          for (int slot = 0; slot < IMR_COLLIDEMESH_SCALES; slot ++) Scaled[slot].Block = NULL;
+          Scaled_Clock = 0;
+          Revision = -1;
+           };
+      ~IMR_CollideMesh() { Reset(); };
+
+      // Init and de-init methods:
+      int Build(IMR_Model &Mdl);
+      int Build(float *Corners, int NumTris);
+      void Reset(void);
+      IMR_CollideScaled *Prepare(float NewScaleH, float NewScaleV);
+      void Swap_Tris(int TriA, int TriB);
+
+      // File methods:
+      int Save(char *FileName, char *ResName);
+      int Load(char *ResName, IMR_Model &Mdl);
+
+      // Info methods:
+      inline int Get_Num_Tris(void) { return Num_Tris; };
+      inline int Get_Num_Groups(void) { return Num_Groups; };
+      inline int Get_Revision(void) { return Revision; };
+      inline IMR_CollideScaled *Get_Prepared(float CmpScaleH, float CmpScaleV)
+          {
+          for (int slot = 0; slot < IMR_COLLIDEMESH_SCALES; slot ++)
+              if (Scaled[slot].Block && Scaled[slot].ScaleH == CmpScaleH && Scaled[slot].ScaleV == CmpScaleV)
+                  return &Scaled[slot];
+          return NULL;
+           };
+     };
+
+#endif
@@ -8,7 +8,7 @@
  Description: Light geometry module.  Contains all lighting code.
  
 \****************************************************************/
-#include "IMR_Geom_Light.hpp"
+#include "imr_geom_light.hpp"
 
 /***************************************************************************\
   Sets the direction of the light given the specified angle. 
@@ -43,19 +43,155 @@ Direction = Target - Position;
 Direction.Make_Unit();
  }
 
+/***************************************************************************\
+  Finds the cosines used by spotlights from the umbra and penumbra.  Called
+  whenever either angle changes so the lighting code never has to touch 
+  the tables.
+  Note: A penumbra smaller than the umbra is treated as a hard edge.
+\***************************************************************************/
+void IMR_Light::Find_Cone(void)
+{
+int Outer;
+
+// The penumbra is never inside the umbra:
+Outer = (Penumbra > Umbra) ? Penumbra : Umbra;
+
+// Look up the cosines:
+CosUmbra = CosTable[Umbra];
+CosPenumbra = CosTable[Outer];
+SinPenumbra = SinTable[Outer];
+
+// Find the scale for the falloff between the two:
+if (CosUmbra > CosPenumbra)
+    ConeScale = 1.0 / (CosUmbra - CosPenumbra);
+else
+    ConeScale = 0.0;
+ }
+
+/***************************************************************************\
+  Adds everything about the light that affects the lighting result to the
+  specified key.  Used to tell when cached static lighting is stale.
+\***************************************************************************/
+void IMR_Light::Hash_State(IMR_LightCacheKey &Key)
+{
+IMR_Light *This = this;
+
+// Add the light, it's type and color:
+Key.Add(&This, sizeof(IMR_Light *));
+Key.Add(&ID, sizeof(int));
+Key.Add(&Type, sizeof(int));
+Key.Add(&ColorR, sizeof(float));
+Key.Add(&ColorG, sizeof(float));
+Key.Add(&ColorB, sizeof(float));
+
+// Add only what matters for this type of light:
+if (Type == IMR_LIGHT_POINT || Type == IMR_LIGHT_SPOT)
+    {
+    Key.Add(&WorldPos.X, sizeof(float));
+    Key.Add(&WorldPos.Y, sizeof(float));
+    Key.Add(&WorldPos.Z, sizeof(float));
+    Key.Add(&Range, sizeof(float));
+     }
+if (Type == IMR_LIGHT_CELESTIAL)
+    {
+    Key.Add(&Direction.X, sizeof(float));
+    Key.Add(&Direction.Y, sizeof(float));
+    Key.Add(&Direction.Z, sizeof(float));
+     }
+if (Type == IMR_LIGHT_SPOT)
+    {
+    Key.Add(&WorldDirection.X, sizeof(float));
+    Key.Add(&WorldDirection.Y, sizeof(float));
+    Key.Add(&WorldDirection.Z, sizeof(float));
+    Key.Add(&Umbra, sizeof(int));
+    Key.Add(&Penumbra, sizeof(int));
+     }
+ }
+
+/***************************************************************************\
+  Checks if the specified sphere (world coords) is within reach of the 
+  light.  Point and spot lights check their range, and spots also check 
+  their cone, widened by the angle the sphere covers as seen from the 
+  light.  Ambient and celestial lights reach everything.
+  Returns true if anything in the sphere might be lit.
+\***************************************************************************/
+int IMR_Light::Hits_Sphere(float *Center, float Radius)
+{
+float dX, dY, dZ, DistSquared, Distance, ViewDot, SinS, CosS;
+
+// Only point and spot lights have bounds:
+if (Type != IMR_LIGHT_POINT && Type != IMR_LIGHT_SPOT) return 1;
+
+// Check the range:
+dX = Center[0] - WorldPos.X;
+dY = Center[1] - WorldPos.Y;
+dZ = Center[2] - WorldPos.Z;
+DistSquared = (dX * dX) + (dY * dY) + (dZ * dZ);
+if (DistSquared >= (Range + Radius) * (Range + Radius)) return 0;
+if (Type == IMR_LIGHT_POINT) return 1;
+
+// Check the cone (unless the light is inside the sphere):
+if (DistSquared <= Radius * Radius) return 1;
+Distance = sqrt(DistSquared);
+ViewDot = ((dX * WorldDirection.X) + (dY * WorldDirection.Y) + (dZ * WorldDirection.Z)) / Distance;
+SinS = Radius / Distance;
+CosS = sqrt(1.0 - (SinS * SinS));
+if ((SinPenumbra * CosS) + (CosPenumbra * SinS) >= 0.0 &&
+    ViewDot < (CosPenumbra * CosS) - (SinPenumbra * SinS)) return 0;
+return 1;
+ }
+
+/***************************************************************************\
+  Finds how much the light could contribute to the specified sphere (world
+  coords).  Used to rank the lights for an object when it has too many.
+  Ambient lights always rank first.  Point and spot lights are ranked by 
+  their brightness at the closest point of the sphere.
+  Returns true if the light reaches the sphere, false otherwise.
+\***************************************************************************/
+int IMR_Light::Find_Influence(float *Center, float Radius, float &Rank)
+{
+float dX, dY, dZ, Distance;
+
+// Make sure the light reaches the sphere:
+Rank = 0.0;
+if (!Hits_Sphere(Center, Radius)) return 0;
+
+// Ambient lights light everything equally:
+if (Type == IMR_LIGHT_AMBIENT)
+    {
+    Rank = IMR_LIGHT_FARDISTANCE;
+    return 1;
+     }
+
+// Start with the brightness of the light:
+Rank = ColorR + ColorG + ColorB;
+if (Type == IMR_LIGHT_CELESTIAL) return 1;
+
+// And falloff with the distance to the sphere:
+dX = Center[0] - WorldPos.X;
+dY = Center[1] - WorldPos.Y;
+dZ = Center[2] - WorldPos.Z;
+Distance = sqrt((dX * dX) + (dY * dY) + (dZ * dZ)) - Radius;
+if (Distance > 0.0 && Range > 0.0) Rank *= (Range - Distance) / Range;
+return 1;
+ }
+
 /***************************************************************************\
   Illuminate each polygon in the list.
+  Note: The centroids of the polys must be found (in world coords) first.
 \***************************************************************************/
 void IMR_Light::IlluminatePolyList(IMR_Polygon *PList, int Num_Polys)
 {
-int poly, vtx, PolyVisible, p,
-    PolyVisable, InRange[4];
-float DeltaX, DeltaY, DeltaZ, Delta[4],
-      LightDot, DotMag, ViewDot,
+int poly, vtx, PolyVisible,
+    InRange[IMR_MAXPOLYVERTS], Num_Verts;
+float DeltaX, DeltaY, DeltaZ, Delta[IMR_MAXPOLYVERTS],
+      vX[IMR_MAXPOLYVERTS], vY[IMR_MAXPOLYVERTS], vZ[IMR_MAXPOLYVERTS],
+      Cone[IMR_MAXPOLYVERTS], Facing[IMR_MAXPOLYVERTS],
+      Sphere[3], InvRangeSquared,
+      LightDot, DotMag,
       Intensity, Attenuation, ConeIntensity,
       nX, nY, nZ,
       dX, dY, dZ,
-      Distance,
       Cr, Cg, Cb;
 IMR_3DPoint LDelta, Normal;
 
@@ -66,9 +202,19 @@ if (!PList)
     return;
      }
 
+// Used to find the attenuation from squared distances:
+InvRangeSquared = (RangeSquared > 0.0) ? 1.0 / RangeSquared : 0.0;
+
 // Loop through each polygon in the list:
 for (poly = 0; poly < Num_Polys; poly ++)
     {
+    // If static lighting has been baked into this poly, only dynamic 
+    // lights need to touch it:
+    if (PList[poly].Flags.Baked && !Dynamic) continue;
+    
+    // Polys lit from shared vertices are handled by IlluminateVertexList():
+    if (PList[poly].Flags.VertexLit) continue;
+    
     // If this poly is a lightsource (or we are not doing any lighting), 
     // set at max intensity and move on:
     if (PList[poly].Flags.LightSource)
@@ -209,15 +355,11 @@ for (poly = 0; poly < Num_Polys; poly ++)
             // If the vertex isn't in range, go to the next:
             if (!InRange[vtx]) continue;
             
-            // Calculate the square root of the delta:
-            Distance = sqrt(Delta[vtx]);
+            // Skip the vertex if the light is right on it:
+            if (Delta[vtx] <= 0.0) continue;
 
-            // Calculate intensity:
-            if (Range)
-                Intensity = (Range - Distance) / Range;
-            else 
-                Intensity = 0.0;
-            if (Intensity < 0.0) Intensity = -Intensity;
+            // Calculate intensity (straight from the squared distance):
+            Intensity = IMR_Attenuate(Delta[vtx] * InvRangeSquared);
             
             // Calculate the dot product for this vertex:
             if (vtx != 0)       // We already have the dot product if this is vertex 0
@@ -226,10 +368,10 @@ for (poly = 0; poly < Num_Polys; poly ++)
                 dY = WorldPos.Y - PList[poly].Vtx_List[vtx]->wY;
                 dZ = WorldPos.Z - PList[poly].Vtx_List[vtx]->wZ;
                 LightDot = (nX * dX) + (nY * dY) + (nZ * dZ);
-                LightDot /= sqrt((dX * dX) + (dY * dY) + (dZ * dZ));
                  }
-            else                // Otherwise just normalize the one we have
-                LightDot /= sqrt((dX * dX) + (dY * dY) + (dZ * dZ));
+            
+            // And normalize it (the squared length is the delta):
+            LightDot *= IMR_RSqrt(Delta[vtx]);
             
             // Now calculate color components:
             Attenuation = Intensity * LightDot;
@@ -257,145 +399,335 @@ for (poly = 0; poly < Num_Polys; poly ++)
         // Next poly: 
         continue;
          }
-     }
- }
 
-/*
     // Is this a spot light?
     if (Type == IMR_LIGHT_SPOT)
         {
+        Num_Verts = PList[poly].Num_Verts;
+        
         // Find normal to poly:
-        Normal = *PList[poly].Normal - *PList[poly].Vtx_List[0];
-
+        nX = PList[poly].Normal->wX - PList[poly].Vtx_List[0]->wX;
+        nY = PList[poly].Normal->wY - PList[poly].Vtx_List[0]->wY;
+        nZ = PList[poly].Normal->wZ - PList[poly].Vtx_List[0]->wZ;
+        
         // Backface cull the poly:
-        LDelta = WorldPos - *PList[poly].Vtx_List[0];
-        LightDot = LDelta.Dot_Product(Normal);
-        if (LightDot <= 0) continue;
-
-        // Now loop through each vertex in the poly and see if it is within the
-        // range of the light:
-        PolyVisible = 0;
-        for (vtx = 0; vtx < PList[poly].Num_Verts; vtx ++)
+        dX = WorldPos.X - PList[poly].Vtx_List[0]->wX;
+        dY = WorldPos.Y - PList[poly].Vtx_List[0]->wY;
+        dZ = WorldPos.Z - PList[poly].Vtx_List[0]->wZ;
+        LightDot = (nX * dX) + (nY * dY) + (nZ * dZ);
+        if (LightDot <= 0.0) continue;
+        
+        // Reject the poly if it's bounding sphere is out of range or outside
+        // the cone:
+        Sphere[0] = PList[poly].Centroid.X;
+        Sphere[1] = PList[poly].Centroid.Y;
+        Sphere[2] = PList[poly].Centroid.Z;
+        if (!Hits_Sphere(Sphere, PList[poly].Radius)) continue;
+        
+        // The poly might be lit, so find the vector from each vertex to the
+        // light and it's squared length:
+        for (vtx = 0; vtx < Num_Verts; vtx ++)
             {
-            // Calculate squared distance from the light to this vertex:
-            DeltaX = FixedToInt(WorldPos.X - PList[poly].Vtx_List[vtx]->X);
-            DeltaY = FixedToInt(WorldPos.Y - PList[poly].Vtx_List[vtx]->Y);
-            DeltaZ = FixedToInt(WorldPos.Z - PList[poly].Vtx_List[vtx]->Z);
-            Delta[vtx] = (DeltaX * DeltaX) + 
-                         (DeltaY * DeltaY) + 
-                         (DeltaZ * DeltaZ);
-                                              
-            // If the vertex is within range of the light, set the flag to visible:
-            if (Delta[vtx] < RangeSquared)
-                {
-                PolyVisible = 1;
-                InRange[vtx] = 1;
-                 }
-            else 
-                InRange[vtx] = 0;
+            vX[vtx] = WorldPos.X - PList[poly].Vtx_List[vtx]->wX;
+            vY[vtx] = WorldPos.Y - PList[poly].Vtx_List[vtx]->wY;
+            vZ[vtx] = WorldPos.Z - PList[poly].Vtx_List[vtx]->wZ;
+            Delta[vtx] = (vX[vtx] * vX[vtx]) + (vY[vtx] * vY[vtx]) + (vZ[vtx] * vZ[vtx]);
              }
         
-        // If the poly isn't within the range of the light, go to the next poly:
-        if (!PolyVisible) continue;
-
-        // Loop through each vertex in the poly:
-        for (vtx = 0; vtx < PList[poly].Num_Verts; vtx ++)
+        // Find the distance, facing, and cone angle at each vertex:
+        for (vtx = 0; vtx < Num_Verts; vtx ++)
             {
-            // If the vertex isn't in range, go to the next:
-            if (!InRange[vtx]) continue;
-
-            // Create a vector pointing from the vertex to the light:
-            LDelta = *PList[poly].Vtx_List[vtx] - WorldPos;
-            LDelta.Make_Unit();
-         
-            // Calculate the dot product between the light direction and the delta:
-            ViewDot = LDelta.Dot_Product(WorldDirection);
+            DotMag = (Delta[vtx] > 0.0) ? IMR_RSqrt(Delta[vtx]) : 0.0;
+            Facing[vtx] = ((nX * vX[vtx]) + (nY * vY[vtx]) + (nZ * vZ[vtx])) * DotMag;
+            Cone[vtx] = -((vX[vtx] * WorldDirection.X) + 
+                          (vY[vtx] * WorldDirection.Y) + 
+                          (vZ[vtx] * WorldDirection.Z)) * DotMag;
+             }
+        
+        // Find the intensity at each vertex:
+        for (vtx = 0; vtx < Num_Verts; vtx ++)
+            {
+            Intensity = IMR_Attenuate(Delta[vtx] * InvRangeSquared);
+            if (Facing[vtx] < 0.0) Facing[vtx] = 0.0;
+            ConeIntensity = Find_ConeIntensity(Cone[vtx]);
+            Delta[vtx] = Intensity * Facing[vtx] * ConeIntensity;
+             }
+        
+        // And light each vertex:
+        for (vtx = 0; vtx < Num_Verts; vtx ++)
+            {
+            PList[poly].UVI_Info[vtx].R += Delta[vtx] * ColorR;
+            PList[poly].UVI_Info[vtx].G += Delta[vtx] * ColorG;
+            PList[poly].UVI_Info[vtx].B += Delta[vtx] * ColorB;
             
-            // Skip this vertex if no light is hitting it:
-            if (ViewDot <= CosTable[Penumbra]) continue;
+            // Keep in range of 0-1:
+            if (PList[poly].UVI_Info[vtx].R > 1.0) PList[poly].UVI_Info[vtx].R = 1.0;
+            if (PList[poly].UVI_Info[vtx].G > 1.0) PList[poly].UVI_Info[vtx].G = 1.0;
+            if (PList[poly].UVI_Info[vtx].B > 1.0) PList[poly].UVI_Info[vtx].B = 1.0;
+             }
+        
+        // Next poly:
+        continue;
+         }
+     }
+ }
 
-            // Calculate the distance:
-            Distance = sqrt((float)Delta[vtx]);
+/***************************************************************************\
+  Illuminates each active vertex in the list using the vertex normals (unit
+  vectors, 3 floats per vertex).  The light is added to RGB (3 floats per 
+  vertex) without clamping, so the caller should clamp when the results 
+  are gathered into the polys.  Uses the same lighting model as 
+  IlluminatePolyList(), but each shared vertex is only lit once.
+  Note: Uses world coords.
+\***************************************************************************/
+void IMR_Light::IlluminateVertexList(IMR_3DPoint *VList, float *NList, float *RGB, char *Active, int Num_Verts)
+{
+int vtx;
+float dX, dY, dZ, DistSquared, InvDistance, LightDot, Intensity, InvRangeSquared;
 
-            // Check if the vertex is inside the umbra:
-            if (ViewDot > CosTable[Umbra])
-                {
-                // Calculate attenuation:
-                Attenuation = FloatToFixed((fRange - Distance) / fRange);
-                
-                // Calculate the dot product for this vertex:
-                dX = WorldPos.X - PList[poly].Vtx_List[vtx]->X;
-                dY = WorldPos.Y - PList[poly].Vtx_List[vtx]->Y;
-                dZ = WorldPos.Z - PList[poly].Vtx_List[vtx]->Z;
-                LightDot = FixedMult(nX, dX) + FixedMult(nY, dY) + FixedMult(nZ, dZ);
-                LightDot /= (int)sqrt(FixedToInt(LightDot));
-                LightDot = (LightDot + 65536) >> 1;
-                
-                // Calculate color components:
-                Intensity = FixedMult(Attenuation, LightDot);
-                //if (Intensity < 0) Intensity = -Intensity;
-                Cr = FixedToInt(Intensity * ColorR);
-                Cg = FixedToInt(Intensity * ColorG);
-                Cb = FixedToInt(Intensity * ColorB);
-                
-                // Add to the vertex:
-                PList[poly].UVI_Info[vtx].R += Cr;
-                PList[poly].UVI_Info[vtx].G += Cg;
-                PList[poly].UVI_Info[vtx].B += Cb;
-                if (Intensity < 0)
-                    {
-                    PList[poly].UVI_Info[vtx].R = 255;
-                    PList[poly].UVI_Info[vtx].G = 0;
-                    PList[poly].UVI_Info[vtx].B = 0;
-                     }           
-                
-                // And keep in range of 0-255:
-                if (PList[poly].UVI_Info[vtx].R > 255) PList[poly].UVI_Info[vtx].R = 255;
-                if (PList[poly].UVI_Info[vtx].G > 255) PList[poly].UVI_Info[vtx].G = 255;
-                if (PList[poly].UVI_Info[vtx].B > 255) PList[poly].UVI_Info[vtx].B = 255;
-                
-                // Next vertex:
-                continue;
-                 }
+// Make sure we have lists:
+if (!VList || !NList || !RGB || !Active)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "NULL list passed!");
+    return;
+     }
 
-            // Calculate intensity:
-            Intensity = FloatToFixed((fRange - Distance) / fRange);
-            
-            // Calculate the dot product for this vertex:
-            dX = WorldPos.X - PList[poly].Vtx_List[vtx]->X;
-            dY = WorldPos.Y - PList[poly].Vtx_List[vtx]->Y;
-            dZ = WorldPos.Z - PList[poly].Vtx_List[vtx]->Z;
-            LightDot = FixedMult(nX, dX) + FixedMult(nY, dY) + FixedMult(nZ, dZ);
-            LightDot /= (int)sqrt(FixedToInt(LightDot));
-            LightDot = (LightDot + 65536) >> 1;
-
-            // Calculate the cone intensity:
-            ConeIntensity = FixedDev(ViewDot - CosTable[Penumbra], CosTable[Umbra] - CosTable[Penumbra]);
-            if (ConeIntensity < 0) ConeIntensity = -ConeIntensity;
-            
-            // Calculate attenuation:
-            Attenuation = FixedMult(FixedMult(Intensity, LightDot), ConeIntensity);
-            
-            // Calculate color components:
-            Cr = FixedToInt(Attenuation * ColorR);
-            Cg = FixedToInt(Attenuation * ColorG);
-            Cb = FixedToInt(Attenuation * ColorB);
-                
-            // Add to the vertex:
-            PList[poly].UVI_Info[vtx].R += Cr;
-            PList[poly].UVI_Info[vtx].G += Cg;
-            PList[poly].UVI_Info[vtx].B += Cb;
-            if (Attenuation < 0)
-                {
-                PList[poly].UVI_Info[vtx].R = 255;
-                PList[poly].UVI_Info[vtx].G = 0;
-                PList[poly].UVI_Info[vtx].B = 0;
-                 }           
-                
-            // And keep in range of 0-255:
-            if (PList[poly].UVI_Info[vtx].R > 255) PList[poly].UVI_Info[vtx].R = 255;
-            if (PList[poly].UVI_Info[vtx].G > 255) PList[poly].UVI_Info[vtx].G = 255;
-            if (PList[poly].UVI_Info[vtx].B > 255) PList[poly].UVI_Info[vtx].B = 255;
-             }
+// Is this an ambient light?
+if (Type == IMR_LIGHT_AMBIENT)
+    {
+    for (vtx = 0; vtx < Num_Verts; vtx ++, RGB += 3)
+        {
+        if (!Active[vtx]) continue;
+        RGB[0] += ColorR;
+        RGB[1] += ColorG;
+        RGB[2] += ColorB;
+         }
+    return;
+     }
+
+// Is this a celestial light?
+if (Type == IMR_LIGHT_CELESTIAL)
+    {
+    for (vtx = 0; vtx < Num_Verts; vtx ++, NList += 3, RGB += 3)
+        {
+        if (!Active[vtx]) continue;
+        LightDot = (NList[0] * Direction.X) + (NList[1] * Direction.Y) + (NList[2] * Direction.Z);
+        if (LightDot <= 0.0) continue;
+        RGB[0] += LightDot * ColorR;
+        RGB[1] += LightDot * ColorG;
+        RGB[2] += LightDot * ColorB;
+         }
+    return;
+     }
+
+// Is this a point or spot light?
+if (Type == IMR_LIGHT_POINT || Type == IMR_LIGHT_SPOT)
+    {
+    InvRangeSquared = (RangeSquared > 0.0) ? 1.0 / RangeSquared : 0.0;
+    for (vtx = 0; vtx < Num_Verts; vtx ++, NList += 3, RGB += 3)
+        {
+        if (!Active[vtx]) continue;
+        
+        // Make sure the vertex is in range:
+        dX = WorldPos.X - VList[vtx].wX;
+        dY = WorldPos.Y - VList[vtx].wY;
+        dZ = WorldPos.Z - VList[vtx].wZ;
+        DistSquared = (dX * dX) + (dY * dY) + (dZ * dZ);
+        if (DistSquared >= RangeSquared || DistSquared <= 0.0) continue;
+        
+        // Make sure the vertex faces the light:
+        LightDot = (NList[0] * dX) + (NList[1] * dY) + (NList[2] * dZ);
+        if (LightDot <= 0.0) continue;
+        
+        // Attenuate:
+        InvDistance = IMR_RSqrt(DistSquared);
+        Intensity = IMR_Attenuate(DistSquared * InvRangeSquared) * (LightDot * InvDistance);
+        if (Type == IMR_LIGHT_SPOT)
+            Intensity *= Find_ConeIntensity(-((dX * WorldDirection.X) + 
+                                              (dY * WorldDirection.Y) + 
+                                              (dZ * WorldDirection.Z)) * InvDistance);
+        
+        // And add the light:
+        RGB[0] += Intensity * ColorR;
+        RGB[1] += Intensity * ColorG;
+        RGB[2] += Intensity * ColorB;
+         }
+     }
+ }
+
+/***************************************************************************\
+  Finds the amount of light reaching the specified point (with the specified
+  unit normal) using the same model as IlluminatePolyList().  Ray is set to
+  the vector from the point to the light (zero for ambient lights) so the
+  caller can check for shadows.
+  Note: Uses world coords.
+  Returns the intensity (0.0 if the point isn't lit).
+\***************************************************************************/
+float IMR_Light::Find_PointIntensity(float *P, float *N, float *Ray)
+{
+float LightDot, DistSquared, Distance;
+
+// No shadows from ambient lights:
+Ray[0] = Ray[1] = Ray[2] = 0.0f;
+
+// Is this an ambient light?
+if (Type == IMR_LIGHT_AMBIENT) return 1.0f;
+
+// Is this a celestial light?
+if (Type == IMR_LIGHT_CELESTIAL)
+    {
+    LightDot = (N[0] * Direction.X) + (N[1] * Direction.Y) + (N[2] * Direction.Z);
+    if (LightDot <= 0.0f) return 0.0f;
+    Ray[0] = Direction.X * IMR_LIGHT_FARDISTANCE;
+    Ray[1] = Direction.Y * IMR_LIGHT_FARDISTANCE;
+    Ray[2] = Direction.Z * IMR_LIGHT_FARDISTANCE;
+    return LightDot;
+     }
+
+// Is this a point or spot light?
+if (Type == IMR_LIGHT_POINT || Type == IMR_LIGHT_SPOT)
+    {
+    // Find the vector to the light and make sure we're in range:
+    Ray[0] = WorldPos.X - P[0];
+    Ray[1] = WorldPos.Y - P[1];
+    Ray[2] = WorldPos.Z - P[2];
+    DistSquared = (Ray[0] * Ray[0]) + (Ray[1] * Ray[1]) + (Ray[2] * Ray[2]);
+    if (DistSquared >= RangeSquared || DistSquared <= 0.0f) return 0.0f;
+
+    // Make sure the point faces the light:
+    LightDot = (N[0] * Ray[0]) + (N[1] * Ray[1]) + (N[2] * Ray[2]);
+    if (LightDot <= 0.0f) return 0.0f;
+
+    // Attenuate:
+    Distance = sqrt(DistSquared);
+    LightDot = ((Range - Distance) / Range) * (LightDot / Distance);
+    
+    // Spots also fall off towards the edge of the cone:
+    if (Type == IMR_LIGHT_SPOT)
+        LightDot *= Find_ConeIntensity(-((Ray[0] * WorldDirection.X) + 
+                                         (Ray[1] * WorldDirection.Y) + 
+                                         (Ray[2] * WorldDirection.Z)) / Distance);
+    return LightDot;
+     }
+
+// Unsupported light type:
+return 0.0f;
+ }
+
+/***************************************************************************\
+  Hashes the specified data into the key (FNV-1a).
+  Returns the new key.
+\***************************************************************************/
+unsigned long IMR_LightCache_Hash(unsigned long Key, void *Data, int Size)
+{
+unsigned char *Bytes = (unsigned char *)Data;
+
+for (int index = 0; index < Size; index ++)
+    {
+    Key ^= Bytes[index];
+    Key *= 16777619UL;
+     }
+return Key;
+ }
+
+/***************************************************************************\
+  Frees the memory used by the lighting cache.
+\***************************************************************************/
+void IMR_LightCache::Reset(void)
+{
+if (RGB) free(RGB);
+if (KeyState) free(KeyState);
+RGB = NULL;
+KeyState = NULL;
+Num_Polys = KeySize = 0;
+Valid = 0;
+ }
+
+/***************************************************************************\
+  Copies the cached lighting into the specified poly list if the cache was
+  built with the specified key (the hash and all of the state must match).
+  Returns IMR_OK if the cache was used, otherwise IMRERR_NODATA.
+\***************************************************************************/
+int IMR_LightCache::Fetch(IMR_Polygon *PList, int Num, IMR_LightCacheKey &K)
+{
+int poly, vtx;
+float *Src;
+
+// Make sure the cache is good:
+if (!Valid || Hash != K.Hash || Num != Num_Polys || !PList) return IMRERR_NODATA;
+if (K.Size < 0 || KeySize != K.Size || memcmp(KeyState, K.State, K.Size)) return IMRERR_NODATA;
+
+// Copy the lighting:
+Src = RGB;
+for (poly = 0; poly < Num; poly ++)
+    {
+    for (vtx = 0; vtx < PList[poly].Num_Verts; vtx ++, Src += 3)
+        {
+        PList[poly].UVI_Info[vtx].R = Src[0];
+        PList[poly].UVI_Info[vtx].G = Src[1];
+        PList[poly].UVI_Info[vtx].B = Src[2];
+         }
+    Src += (IMR_MAXPOLYVERTS - PList[poly].Num_Verts) * 3;
+     }
+
+// Return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Stores the lighting from the specified poly list in the cache under the
+  specified key.  Keys with too much state to keep aren't cached.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_LightCache::Store(IMR_Polygon *PList, int Num, IMR_LightCacheKey &K)
+{
+unsigned char *NewState;
+int poly, vtx;
+float *Dest;
+
+// Make sure we have a list and a key we can keep:
+Valid = 0;
+if (!PList || K.Size <= 0) return IMRERR_NODATA;
+
+// Make room (if the poly count changed):
+if (Num != Num_Polys || !RGB)
+    {
+    Reset();
+    if (!(RGB = (float *)malloc(sizeof(float) * 3 * IMR_MAXPOLYVERTS * Num)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_LightCache::Store(): Out of memory! (%d)", Num);
+        return IMRERR_OUTOFMEM;
          }
-*/
+    Num_Polys = Num;
+     }
+if (K.Size != KeySize || !KeyState)
+    {
+    if (!(NewState = (unsigned char *)realloc(KeyState, K.Size)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_LightCache::Store(): Out of memory! (%d)", K.Size);
+        return IMRERR_OUTOFMEM;
+         }
+    KeyState = NewState;
+    KeySize = K.Size;
+     }
+
+// Copy the lighting:
+Dest = RGB;
+for (poly = 0; poly < Num; poly ++)
+    {
+    for (vtx = 0; vtx < PList[poly].Num_Verts; vtx ++, Dest += 3)
+        {
+        Dest[0] = PList[poly].UVI_Info[vtx].R;
+        Dest[1] = PList[poly].UVI_Info[vtx].G;
+        Dest[2] = PList[poly].UVI_Info[vtx].B;
+         }
+    Dest += (IMR_MAXPOLYVERTS - PList[poly].Num_Verts) * 3;
+     }
+
+// The cache is now good:
+memcpy(KeyState, K.State, K.Size);
+Hash = K.Hash;
+Valid = 1;
+return IMR_OK;
+ }
+
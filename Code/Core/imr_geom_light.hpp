@@ -12,16 +12,49 @@
 #define __IMR_GEOM_LIGHT__HPP
 
 // Include headers:
-#include "IMR_Geom_Prim.hpp"
-#include "IMR_Geom_Poly.hpp"
-#include "IMR_Matrix.hpp"
-#include "IMR_Collide.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include "imr_geom_prim.hpp"
+#include "imr_geom_poly.hpp"
+#include "imr_matrix.hpp"
+#include "imr_collide.hpp"
 
 // Types, constants, and macros:
 #define IMR_LIGHT_AMBIENT     1
 #define IMR_LIGHT_CELESTIAL   2
 #define IMR_LIGHT_POINT       3
-#define IMR_LIGHT_SPOT        4    // Currently unsupported
+#define IMR_LIGHT_SPOT        4
+#define IMR_LIGHTCACHE_SEED   2166136261UL
+#define IMR_LIGHTCACHE_MAXKEY 1024          // Bytes of state a lighting cache key can keep
+#define IMR_LIGHT_FARDISTANCE 65536.0f      // Length of rays to celestial lights
+
+// Lighting cache hash function:
+unsigned long IMR_LightCache_Hash(unsigned long Key, void *Data, int Size);
+
+// Key of the static lighting of an object.  Everything the lighting depends
+// on is added to it, and kept as well as hashed, so the cache can check the
+// state itself once the hashes match:
+class IMR_LightCacheKey
+    {
+    public:
+      unsigned long Hash;
+      int Size;                                 // Bytes of state kept (-1 if too many)
+      unsigned char State[IMR_LIGHTCACHE_MAXKEY];
+
+      IMR_LightCacheKey() { Reset(); };
+      inline void Reset(void) { Hash = IMR_LIGHTCACHE_SEED; Size = 0; };
+      inline void Add(void *Data, int Bytes)
+          {
+          Hash = IMR_LightCache_Hash(Hash, Data, Bytes);
+          if (Size < 0 || Size + Bytes > IMR_LIGHTCACHE_MAXKEY)
+              {
+              Size = -1;
+              return;
+               }
+          memcpy(&State[Size], Data, Bytes);
+          Size += Bytes;
+           };
+     };
 
 // Light class:
 class IMR_Light
@@ -39,9 +72,17 @@ class IMR_Light
       float Range;
       float RangeSquared;
       int Umbra, Penumbra;              // Spotlight umbra and penumbra
+      float CosUmbra, CosPenumbra,      // Cosines of the cone angles (from the tables)
+            SinPenumbra, ConeScale;     // Used for cone rejection and falloff
+      int Dynamic;                      // Flags if light moves often (never cached)
 
     public:
-      IMR_Light() { Type = IMR_LIGHT_AMBIENT; };
+      IMR_Light() 
+          { 
+          Type = IMR_LIGHT_AMBIENT; Dynamic = 0; 
+          Umbra = Penumbra = 0; 
+          CosUmbra = CosPenumbra = 1.0; SinPenumbra = ConeScale = 0.0; 
+           };
       
       // Id methods:
       inline void Set_ID(int id) { ID = id; };
@@ -54,12 +95,15 @@ class IMR_Light
       
       // Range and color methods:
       void Set_Color(float R, float G, float B) { ColorR = R; ColorG = G; ColorB = B; };
+      void Get_Color(float &R, float &G, float &B) { R = ColorR; G = ColorG; B = ColorB; };
       void Set_Range(float R) { Range = R;  RangeSquared = R * R; };
       float Get_Range(void) { return Range; };
       
-      // Spotlight methods:
-      void Set_Umbra(int Ang) { Ang %= IMR_DEGREECOUNT; Umbra = Ang / 2; };
-      void Set_Penumbra(int Ang) { Ang %= IMR_DEGREECOUNT; Penumbra = Ang / 2; };
+      // Spotlight methods (angles are for the whole cone):
+      void Set_Umbra(int Ang) { Umbra = (Ang & IMR_DEGREEAND) / 2; Find_Cone(); };
+      void Set_Penumbra(int Ang) { Penumbra = (Ang & IMR_DEGREEAND) / 2; Find_Cone(); };
+      void Find_Cone(void);
+      inline float Find_ConeIntensity(float ViewDot);
       
       // Position and direction methods:
       IMR_3DPoint &Get_Position(void) { return Position; };
@@ -70,8 +114,17 @@ class IMR_Light
       IMR_3DPoint &Get_WorldPos(void) { return WorldPos; };
       IMR_3DPoint &Get_WorldDirection(void) { return WorldDirection; };
       
+      // Caching methods:
+      inline void Set_Dynamic(int State) { Dynamic = State ? 1 : 0; };
+      inline int Is_Dynamic(void) { return Dynamic; };
+      void Hash_State(IMR_LightCacheKey &Key);
+      
       // Miscellaneous methods:
       void IlluminatePolyList(IMR_Polygon *PList, int Num_Polys);
+      int Hits_Sphere(float *Center, float Radius);
+      int Find_Influence(float *Center, float Radius, float &Rank);
+      void IlluminateVertexList(IMR_3DPoint *VList, float *NList, float *RGB, char *Active, int Num_Verts);
+      float Find_PointIntensity(float *P, float *N, float *Ray);
       inline void operator = (IMR_Light &L);
       
      };
@@ -92,7 +145,49 @@ ColorG = L.ColorG;
 ColorB = L.ColorB;
 Umbra = L.Umbra;
 Penumbra = L.Penumbra;
+CosUmbra = L.CosUmbra;
+CosPenumbra = L.CosPenumbra;
+SinPenumbra = L.SinPenumbra;
+ConeScale = L.ConeScale;
+Dynamic = L.Dynamic;
+ }
+
+/***************************************************************************\
+  Finds how much of a spotlight reaches a point given the cosine of the 
+  angle between the spot direction and the vector from the light to the 
+  point.  Full inside the umbra, none outside the penumbra, and a linear 
+  falloff in between.
+\***************************************************************************/
+inline float IMR_Light::Find_ConeIntensity(float ViewDot)
+{
+if (ViewDot >= CosUmbra) return 1.0;
+if (ViewDot <= CosPenumbra) return 0.0;
+return (ViewDot - CosPenumbra) * ConeScale;
  }
 
+// Static lighting cache class (one per model instance):
+class IMR_LightCache
+    {
+    protected:
+      float *RGB;                       // R, G, and B for each poly vertex
+      int Num_Polys;                    // Number of polys stored
+      unsigned long Hash;               // Hash of the lights and transform used
+      unsigned char *KeyState;          // And the state itself
+      int KeySize;
+      int Valid;
+
+    public:
+      IMR_LightCache() { RGB = NULL; Num_Polys = 0; Hash = 0; KeyState = NULL; KeySize = 0; Valid = 0; };
+      ~IMR_LightCache() { Reset(); };
+      
+      // Init and de-init methods:
+      void Reset(void);
+      inline void Invalidate(void) { Valid = 0; };
+      
+      // Cache access methods:
+      int Fetch(IMR_Polygon *PList, int Num, IMR_LightCacheKey &K);
+      int Store(IMR_Polygon *PList, int Num, IMR_LightCacheKey &K);
+     };
+
 #endif
 
@@ -8,7 +8,9 @@
  Description: Model geometry module.
  
 \****************************************************************/
-#include "IMR_Geom_Model.hpp"
+#include "imr_geom_model.hpp"
+#include "imr_collidemesh.hpp"
+#include "imr_collidebvh.hpp"
 
 /***************************************************************************\
   Allocates memory for the vertex and polygon lists.
@@ -40,6 +42,14 @@ for (int poly = 0; poly < Num_Polygons; poly ++) Polygons[poly].Material.Shutdow
 Num_Vertices = Num_Polygons = 0;
 delete [] Vertices;
 delete [] Polygons;
+if (VtxNormals) free(VtxNormals);
+if (CollideMesh) delete CollideMesh;
+if (CollideBVH) delete CollideBVH;
+Vertices = NULL;
+Polygons = NULL;
+VtxNormals = NULL;
+CollideMesh = NULL;
+CollideBVH = NULL;
  }
 
 /***************************************************************************\
@@ -50,10 +60,13 @@ void IMR_Model::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
+
+// The list it's in has to index the names again:
+Name_Changed();
  }
 
 /***************************************************************************\
@@ -87,6 +100,179 @@ for (poly = 0; poly < Num_Polygons; poly ++)
     //err = Polygons[poly].Material.Init_Lightmap(DX); if (IMR_ISNOTOK(err)) return err;
      }
 
+// Find the normals used for per-vertex lighting:
+err = Find_VertexNormals(); if (IMR_ISNOTOK(err)) return err;
+
+// Find the bounding box:
+Find_Bounds();
+
+// The geometry has (probably) changed:
+++ Revision;
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Finds the normal at each vertex by averaging the normals of the polys 
+  that share it.  Hard edged polys don't contribute, so a vertex only used
+  by hard edged polys gets a zero normal.
+  Note: Called by Setup(), so the poly normals must already be found.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Model::Find_VertexNormals(void)
+{
+int poly, vtx, index;
+float nX, nY, nZ, Length;
+
+// Make room for the normals:
+if (VtxNormals) free(VtxNormals);
+if (!(VtxNormals = (float *)malloc(sizeof(float) * 3 * (Num_Vertices ? Num_Vertices : 1))))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Model::Find_VertexNormals(): Out of memory! (%d)", Num_Vertices);
+    return IMRERR_OUTOFMEM;
+     }
+memset(VtxNormals, 0, sizeof(float) * 3 * Num_Vertices);
+
+// Add the normal of each smooth poly to it's vertices:
+for (poly = 0; poly < Num_Polygons; poly ++)
+    {
+    if (Polygons[poly].Flags.HardEdge || !Polygons[poly].Normal) continue;
+    nX = Polygons[poly].Normal->lX - Polygons[poly].Vtx_List[0]->lX;
+    nY = Polygons[poly].Normal->lY - Polygons[poly].Vtx_List[0]->lY;
+    nZ = Polygons[poly].Normal->lZ - Polygons[poly].Vtx_List[0]->lZ;
+    for (vtx = 0; vtx < Polygons[poly].Num_Verts; vtx ++)
+        {
+        index = Polygons[poly].Vtx_Index[vtx] * 3;
+        VtxNormals[index] += nX;
+        VtxNormals[index + 1] += nY;
+        VtxNormals[index + 2] += nZ;
+         }
+     }
+
+// Now make them unit vectors:
+for (vtx = 0; vtx < Num_Vertices; vtx ++)
+    {
+    index = vtx * 3;
+    Length = (VtxNormals[index] * VtxNormals[index]) +
+             (VtxNormals[index + 1] * VtxNormals[index + 1]) +
+             (VtxNormals[index + 2] * VtxNormals[index + 2]);
+    if (Length <= 0.0) continue;
+    Length = 1.0 / sqrt(Length);
+    VtxNormals[index] *= Length;
+    VtxNormals[index + 1] *= Length;
+    VtxNormals[index + 2] *= Length;
+     }
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Finds the bounding box of the model in local coords.  Only the vertices
+  used by polys count (the normal vertices aren't part of the shape).
+\***************************************************************************/
+void IMR_Model::Find_Bounds(void)
+{
+int poly, vtx, c, First = 1;
+float *P;
+
+for (c = 0; c < 3; c ++) BoundMin[c] = BoundMax[c] = 0;
+for (poly = 0; poly < Num_Polygons; poly ++)
+    for (vtx = 0; vtx < Polygons[poly].Num_Verts; vtx ++)
+        {
+        P = &Vertices[Polygons[poly].Vtx_Index[vtx]].lX;
+        for (c = 0; c < 3; c ++)
+            {
+            if (First || P[c] < BoundMin[c]) BoundMin[c] = P[c];
+            if (First || P[c] > BoundMax[c]) BoundMax[c] = P[c];
+             }
+        First = 0;
+         }
+ }
+
+/***************************************************************************\
+  Returns the collision mesh for the model, building it if it hasn't been
+  built or loaded yet or the geometry has changed since.
+  Returns NULL if the mesh couldn't be built.
+\***************************************************************************/
+IMR_CollideMesh *IMR_Model::Get_CollideMesh(void)
+{
+// Make a mesh if we don't have one:
+if (!CollideMesh)
+    {
+    if (!(CollideMesh = new IMR_CollideMesh))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Model::Get_CollideMesh(): Out of memory!");
+        return NULL;
+         }
+     }
+
+// (Re)build it if it's out of date:
+if (CollideMesh->Get_Revision() != Revision)
+    if (IMR_ISNOTOK(CollideMesh->Build(*this))) return NULL;
+
+// And return it:
+return CollideMesh;
+ }
+
+/***************************************************************************\
+  Returns the collision tree for the model, building it (and the mesh) if
+  it hasn't been built yet or the geometry has changed since.
+  Returns NULL if the tree couldn't be built.
+\***************************************************************************/
+IMR_CollideBVH *IMR_Model::Get_CollideBVH(void)
+{
+IMR_CollideMesh *Mesh;
+
+// Make sure the mesh is up to date:
+if (!(Mesh = Get_CollideMesh())) return NULL;
+
+// Make a tree if we don't have one:
+if (!CollideBVH)
+    {
+    if (!(CollideBVH = new IMR_CollideBVH))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Model::Get_CollideBVH(): Out of memory!");
+        return NULL;
+         }
+     }
+
+// (Re)build it if it's out of date:
+if (CollideBVH->Get_Revision() != Mesh->Get_Revision() || !CollideBVH->Get_Num_Nodes())
+    if (IMR_ISNOTOK(CollideBVH->Build(*Mesh))) return NULL;
+
+// And return it:
+return CollideBVH;
+ }
+
+/***************************************************************************\
+  Loads a precompiled collision mesh for the model from the resources
+  instead of building it from the polys.  Should be called after the
+  model is setup; changing the geometry afterwards rebuilds the mesh.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Model::Load_CollideMesh(char *ResName)
+{
+int err;
+
+// Make a mesh if we don't have one:
+if (!CollideMesh)
+    {
+    if (!(CollideMesh = new IMR_CollideMesh))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Model::Load_CollideMesh(): Out of memory!");
+        return IMRERR_OUTOFMEM;
+         }
+     }
+
+// Load it:
+err = CollideMesh->Load(ResName, *this);
+if (IMR_ISNOTOK(err)) return err;
+
+// The old tree doesn't match anymore:
+if (CollideBVH) CollideBVH->Reset();
+
 // And return ok:
 return IMR_OK;
  }
@@ -104,6 +290,8 @@ for (int vtx = 0; vtx < Num_Vertices; vtx ++)
     Vertices[vtx].lY += Y;
     Vertices[vtx].lZ += Z;
      }
+Find_Bounds();
+++ Revision;
 
 // And return ok:
 return IMR_OK;
@@ -531,11 +719,11 @@ return IMR_OK;
 
 /***************************************************************************\
   Adds the specified model to this model's poly list in order to create
-  one combined model, with the second at the specified pos and atd relative
-  to the center of this model.
+  one combined model, with the second at the specified pos and rotation
+  relative to the center of this model.
   Returns IMR_OK if successful, otherwise an error.
 \***************************************************************************/
-int IMR_Model::CombineModel(IMR_Model *Mdl, IMR_3DPoint Pos, IMR_Attitude Atd) 
+int IMR_Model::CombineModel(IMR_Model *Mdl, IMR_3DPoint Pos, IMR_Matrix Transform) 
 {
 int index = 0, vtx = 0, poly = 0, pidx = 0;
 int OldNumV = Num_Vertices;
@@ -579,10 +767,6 @@ Num_Polygons = OldNumP + Mdl->Num_Polygons;
 for (index = 0; index < OldNumV; index ++)
     Vertices[index] = TempVerts[index];
 
-// Create our transformation matrix:
-IMR_Matrix Transform;
-Transform.Rotate(Atd.X, Atd.Y, Atd.Z);
-
 // Transform and add the verts for the new model into the list:
 for (index = OldNumV, vtx = 0; index < Num_Vertices; index ++, vtx ++)
     {
@@ -15,33 +15,48 @@
 #include <string.h>
 #include <stdlib.h>
 #include <malloc.h>
-#include "IMR_Geom_Poly.hpp"
-#include "IMR_Geom_Prim.hpp"
-#include "IMR_TexRef.hpp"
-#include "IMR_Table.hpp"
-#include "..\Foundation\IMR_List.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
-#include "..\CallStatus\IMR_RetVals.hpp"
+#include "imr_geom_poly.hpp"
+#include "imr_geom_prim.hpp"
+#include "imr_texref.hpp"
+#include "imr_table.hpp"
+#include "../Foundation/imr_list.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
+
+// Collision mesh and tree (see IMR_CollideMesh.hpp and IMR_CollideBVH.hpp):
+class IMR_CollideMesh;
+class IMR_CollideBVH;
 
 // Model class:
-class IMR_Model
+class IMR_Model : public IMR_NamedItem
     {
     protected:
       char Name[9];
       int Morph_Status,
            Morph_Progress,
            Morph_Length;
+      int Revision;                      // Bumped whenever the geometry changes
+      IMR_CollideMesh *CollideMesh;      // Collision mesh (built or loaded when first needed)
+      IMR_CollideBVH *CollideBVH;        // Collision tree (built when first needed)
     public:
       int Num_Vertices,
            Num_Polygons;
       IMR_3DPoint *Vertices;
       IMR_Polygon *Polygons;
+      float *VtxNormals;                 // Unit normal at each vertex (X, Y, Z), smoothed across polys
+      float BoundMin[3], BoundMax[3];    // Bounding box of the polys (local coords)
       IMR_Model() 
           {
           Name[8] = 0;
+          Revision = 0;
           Num_Vertices = Num_Polygons = 0;
           Vertices = (IMR_3DPoint *)NULL;
           Polygons = (IMR_Polygon *)NULL;
+          VtxNormals = (float *)NULL;
+          BoundMin[0] = BoundMin[1] = BoundMin[2] = 0;
+          BoundMax[0] = BoundMax[1] = BoundMax[2] = 0;
+          CollideMesh = (IMR_CollideMesh *)NULL;
+          CollideBVH = (IMR_CollideBVH *)NULL;
            };
       ~IMR_Model() { Reset(); };
       
@@ -56,6 +71,12 @@ class IMR_Model
       
       // Setup methods:
       int Setup(void);
+      int Find_VertexNormals(void);
+      void Find_Bounds(void);
+      inline int Get_Revision(void) { return Revision; };
+      IMR_CollideMesh *Get_CollideMesh(void);
+      IMR_CollideBVH *Get_CollideBVH(void);
+      int Load_CollideMesh(char *ResName);
       
       // Shape generation methods:
       int Shift_Pos(float X, float Y, float Z);
@@ -71,7 +92,7 @@ class IMR_Model
       int Set_PolyFlag_LightSource(int State);
 
       // CSG:
-      int CombineModel(IMR_Model *Mdl, IMR_3DPoint Pos, IMR_Attitude Atd);
+      int CombineModel(IMR_Model *Mdl, IMR_3DPoint Pos, IMR_Matrix Transform);
       
       // Skybox:
       int Make_Skybox(char *Name);
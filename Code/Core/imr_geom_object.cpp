@@ -8,39 +8,257 @@
  Description: Object geometry module
  
 \****************************************************************/
-#include "IMR_Geom_Object.hpp"
-#include "IMR_Collide.hpp"
+#include "imr_geom_object.hpp"
+#include "imr_collide.hpp"
 
 /***************************************************************************\
-  Updates the global positioning and rotation of this and each child object.
+  Updates the global positioning and rotation of this and each child object,
+  and the bounding boxes of this object and everything above it, right now.
+  The Set/Inc methods just mark the object, and everything is found again
+  at once by ResolveCoords() when it's next needed, so this is only needed
+  when changing RPos or RAtd directly.
 \***************************************************************************/
 void IMR_Object::UpdateCoords(void)
 {
-// First calculate the initial rotation matrix:
-if (Parent)
+Mark_Dirty();
+ResolveCoords();
+ }
+
+/***************************************************************************\
+  Finds the global positioning, rotation, and bounds again for each object
+  in this subtree that has moved (or that's under something that has), 
+  and the bounds of everything with a moved object under it.  Each object
+  is only done once, however many times it was moved since the last time.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::ResolveCoords_Tree(int Moved)
+{
+// Find our globals if we or something above us moved:
+if (Moved || Dirty)
     {
-    GAtd = Parent->GAtd + RAtd;
-    RotMtrx.Rotate(GAtd.X, GAtd.Y, GAtd.Z);
+    // Make the local rotation matrix again if we've turned:
+    if (RAtd != LocalAtd)
+        {
+        LocalMtrx.Rotate(RAtd.X, RAtd.Y, RAtd.Z);
+        LocalAtd = RAtd;
+         }
+
+    // Then put it on top of our parent's for the global rotation:
+    if (Parent)
+        RotMtrx.Merge_Rotations(LocalMtrx.Mtrx, Parent->RotMtrx.Mtrx);
+    else 
+        RotMtrx = LocalMtrx;
+
+    // Now rotate the relative position and find the global pos:
+    if (Parent)
+        {
+        GPos = RPos;
+        GPos.Transform(Parent->RotMtrx);
+        GPos += Parent->GPos;
+         }
+    else
+        GPos = RPos;
+
+    // We've moved, so the cached collision mesh is no good:
+    CollideCache.Invalidate();
+    Moved = 1;
      }
-else 
+
+// Now do the kiddies that need it:
+IMR_Object **Children = Get_ChildList();
+for (int index = 0; index < Num_Children; index ++)
     {
-    RotMtrx.Rotate(RAtd.X, RAtd.Y, RAtd.Z);
-    GAtd = RAtd;
+    if (!Children[index]) continue;
+    if (Moved || Children[index]->Pending) Children[index]->ResolveCoords_Tree(Moved);
      }
 
-// Now rotate the relative position and find the global pos:
-if (Parent)
+// And find our bounds (after the kiddies, since they're included):
+Find_Bounds();
+Dirty = Pending = 0;
+ }
+
+/***************************************************************************\
+  Finds the bounding box of this object and it's children again, and of 
+  everything above it.  Used when the attached model or children change.
+\***************************************************************************/
+void IMR_Object::Update_Bounds(void)
+{
+// The hierarchy finds bounds itself, so just have it do ours again:
+if (Hier)
     {
-    GPos = RPos;
-    GPos.Transform(Parent->Get_RotMatrix());
-    GPos += Parent->GPos;
+    Hier->Set_Model(HierIndex, AttachedModel);
+    Mark_Dirty();
+    return;
+     }
+for (IMR_Object *Obj = this; Obj; Obj = Obj->Parent)
+    Obj->Find_Bounds();
+ }
+
+/***************************************************************************\
+  Finds the bounding box (global coords) of the attached model and the 
+  boxes of the children.  The children must be up to date.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::Find_Bounds(void)
+{
+float Center[3], Extent[3], Min[3], Max[3];
+int c;
+
+HasBounds = 0;
+
+// Start with the model (the box is rotated, so find a box around that):
+if (AttachedModel && AttachedModel->Num_Polygons)
+    {
+    for (c = 0; c < 3; c ++)
+        {
+        Center[c] = (AttachedModel->BoundMin[c] + AttachedModel->BoundMax[c]) * 0.5f;
+        Extent[c] = (AttachedModel->BoundMax[c] - AttachedModel->BoundMin[c]) * 0.5f;
+         }
+    for (c = 0; c < 3; c ++)
+        {
+        Min[c] = (Center[0] * RotMtrx.Mtrx[0][c]) + (Center[1] * RotMtrx.Mtrx[1][c]) + (Center[2] * RotMtrx.Mtrx[2][c]) + (&GPos.X)[c];
+        Max[c] = (Extent[0] * fabs(RotMtrx.Mtrx[0][c])) + (Extent[1] * fabs(RotMtrx.Mtrx[1][c])) + (Extent[2] * fabs(RotMtrx.Mtrx[2][c]));
+        BoundMin[c] = Min[c] - Max[c];
+        BoundMax[c] = Min[c] + Max[c];
+         }
+    HasBounds = 1;
      }
-else
-    GPos = RPos;
 
-// Now loop through and update all the kiddies:
+// The scene octree only wants the model's box:
+if (Octree) Place_InOctree(HasBounds, BoundMin, BoundMax);
+
+// Add the children:
+IMR_Object **Children = Get_ChildList();
 for (int index = 0; index < Num_Children; index ++)
-    Children[index]->UpdateCoords();
+    {
+    if (!Children[index] || !Children[index]->HasBounds) continue;
+    for (c = 0; c < 3; c ++)
+        {
+        if (!HasBounds || Children[index]->BoundMin[c] < BoundMin[c]) BoundMin[c] = Children[index]->BoundMin[c];
+        if (!HasBounds || Children[index]->BoundMax[c] > BoundMax[c]) BoundMax[c] = Children[index]->BoundMax[c];
+         }
+    HasBounds = 1;
+     }
+
+// Keep our spot in the moving object hash up to date:
+if (DynHash)
+    {
+    if (HasBounds) DynHash->Move(DynEntry, BoundMin, BoundMax);
+    else DynHash->Move(DynEntry, NULL, NULL);
+     }
+ }
+
+/***************************************************************************\
+  Puts this object in the specified spatial hash of moving objects (see
+  IMR_CollideHash::Find_Pairs()).  It's kept up to date whenever the 
+  object's bounds change.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Object::Set_Dynamic(IMR_CollideHash *Hash)
+{
+// Get out of the old hash:
+Clear_Dynamic();
+if (!Hash) return IMR_OK;
+ResolveCoords();
+
+// And into the new one:
+DynEntry = Hash->Add(this, HasBounds ? BoundMin : NULL, HasBounds ? BoundMax : NULL);
+if (DynEntry < 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::Set_Dynamic(): Couldn't add object to hash!");
+    return IMRERR_TOMANY;
+     }
+DynHash = Hash;
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Takes this object out of the spatial hash it's in (if any).
+\***************************************************************************/
+void IMR_Object::Clear_Dynamic(void)
+{
+if (DynHash) DynHash->Remove(DynEntry);
+DynHash = NULL;
+DynEntry = -1;
+ }
+
+/***************************************************************************\
+  Gives this object's entry in the scene octree the specified box around
+  the attached model (global coords).  Objects that have to be drawn
+  wherever they are (ones carrying lights, or skyboxes) are always found
+  by frustum queries.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::Place_InOctree(int HasModel, float *Min, float *Max)
+{
+int Always;
+
+Always = Num_Lights > 0;
+if (HasModel && AttachedModel && AttachedModel->Polygons[0].Flags.Skybox) Always = 1;
+Octree->Move(OctEntry, HasModel ? Min : NULL, HasModel ? Max : NULL);
+Octree->Set_Always(OctEntry, Always);
+ }
+
+/***************************************************************************\
+  Puts this object in the specified scene octree (see IMR_Octree).  It's
+  kept up to date whenever the object's bounds change.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Object::Set_Octree(IMR_Octree *Tree)
+{
+// Get out of the old tree:
+Clear_Octree();
+if (!Tree) return IMR_OK;
+
+// And into the new one (it gets placed when the bounds are found again):
+OctEntry = Tree->Add(this, NULL, NULL);
+if (OctEntry < 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::Set_Octree(): Couldn't add object to tree!");
+    return IMRERR_TOMANY;
+     }
+Octree = Tree;
+Update_Bounds();
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Takes this object out of the scene octree it's in (if any).
+\***************************************************************************/
+void IMR_Object::Clear_Octree(void)
+{
+if (Octree) Octree->Remove(OctEntry);
+Octree = NULL;
+OctEntry = -1;
+ }
+
+/***************************************************************************\
+  Adds the global transform and the attached model to the specified key.
+  Used to tell when the cached static lighting is stale.
+\***************************************************************************/
+void IMR_Object::Hash_Transform(IMR_LightCacheKey &Key)
+{
+int Rev;
+
+// Add the global position and rotation:
+ResolveCoords();
+IMR_HIERARCHY_CHECKSYNC(Hier, HierIndex);
+Key.Add(&GPos.X, sizeof(float));
+Key.Add(&GPos.Y, sizeof(float));
+Key.Add(&GPos.Z, sizeof(float));
+Key.Add(RotMtrx.Mtrx, sizeof(mat));
+
+// And the model (and the revision of it's geometry):
+Key.Add(&AttachedModel, sizeof(IMR_Model *));
+if (AttachedModel)
+    {
+    Rev = AttachedModel->Get_Revision();
+    Key.Add(&Rev, sizeof(int));
+     }
  }
 
 /***************************************************************************\
@@ -52,12 +270,29 @@ void IMR_Object::Reset(void)
 {
 Name[0] = 0; ModelName[0] = 0;
 Num_Lights = Num_Children = 0;
-Animation_Time = Animation_Length = Animation_Status = 0;
 AttachedModel = NULL;
 Parent = NULL;
-for (int i = 0; i < IMR_OBJECT_MAXCHILDREN; i ++)
-    Children[i] = NULL;
+if (HeapLights) free(HeapLights);
+if (HeapChildren) free(HeapChildren);
+HeapLights = NULL;
+HeapChildren = NULL;
+Max_Lights = IMR_OBJECT_INLIGHTS;
+Max_Children = IMR_OBJECT_INCHILDREN;
+for (int i = 0; i < IMR_OBJECT_INCHILDREN; i ++)
+    InChildren[i] = NULL;
+if (Anim) delete Anim;
+Anim = NULL;
 RotMtrx.Identity();
+LocalMtrx.Identity();
+LocalAtd.X = LocalAtd.Y = LocalAtd.Z = 0;
+HasBounds = 0;
+Dirty = Pending = 1;
+if (Hier) Hier->Remove(HierIndex);
+Hier = NULL;
+Clear_Dynamic();
+Clear_Octree();
+LightCache.Reset();
+CollideCache.Reset();
 
 /// HACKHACKHACK
 Collidable = 0;
@@ -71,10 +306,14 @@ void IMR_Object::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
+
+// Anything indexing it by name has to do it again:
+if (Hier) Hier->Invalidate();
+Name_Changed();
  }
 
 /***************************************************************************\
@@ -91,6 +330,35 @@ if (LocMod)
 if (!AttachedModel && GlbMod)
     AttachedModel = GlbMod->Get_Item(ModelName, NULL);
 
+// Our bounds have (probably) changed:
+Update_Bounds();
+
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Doubles the room for lights, moving them all to the heap.
+  Returns IMR_OK if successful, otherwise an error.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Object::Grow_Lights(void)
+{
+IMR_Light **NewLights;
+
+if (HeapLights)
+    NewLights = (IMR_Light **)realloc(HeapLights, sizeof(IMR_Light *) * Max_Lights * 2);
+else
+    {
+    NewLights = (IMR_Light **)malloc(sizeof(IMR_Light *) * Max_Lights * 2);
+    if (NewLights) memcpy(NewLights, InLights, sizeof(IMR_Light *) * Num_Lights);
+     }
+if (!NewLights)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::Grow_Lights(): Out of memory in object %s! (%d)", Name, Max_Lights * 2);
+    return IMRERR_OUTOFMEM;
+     }
+HeapLights = NewLights;
+Max_Lights *= 2;
 return IMR_OK;
  }
 
@@ -99,14 +367,14 @@ return IMR_OK;
 \***************************************************************************/
 void IMR_Object::Attach_Light(IMR_Light *Lit)
 {
-// One more light:
-++ Num_Lights;
-
-// If we have too many, return:
-if (Num_Lights > IMR_OBJECT_MAXLIGHTS) { Num_Lights = IMR_OBJECT_MAXLIGHTS; return; }
+// Make room if we have to:
+if (Num_Lights >= Max_Lights && IMR_ISNOTOK(Grow_Lights())) return;
 
 // Add the pointer to the light to the end of the list:
-AttachedLights[Num_Lights - 1] = Lit;
+Get_LightList()[Num_Lights ++] = Lit;
+
+// Objects carrying lights are always drawn, so tell the scene octree:
+if (Octree) Update_Bounds();
  }
 
 /***************************************************************************\
@@ -114,6 +382,7 @@ AttachedLights[Num_Lights - 1] = Lit;
 \***************************************************************************/
 void IMR_Object::Detach_Light(int ID)
 {
+IMR_Light **AttachedLights = Get_LightList();
 int ItemIndex, Index;
 
 // Get an index to the item:
@@ -125,6 +394,7 @@ for (Index = ItemIndex; Index < Num_Lights - 1; Index ++)
 
 // One less item:
 -- Num_Lights;
+if (Octree) Update_Bounds();
  }
 
 /***************************************************************************\
@@ -133,6 +403,7 @@ for (Index = ItemIndex; Index < Num_Lights - 1; Index ++)
 IMR_Light *IMR_Object::Get_Light(int ID, int *index)
 {
 // Search each item in the list:
+IMR_Light **AttachedLights = Get_LightList();
 for (int item = 0; item < Num_Lights; item ++)
     if (AttachedLights[item]->Is(ID))
         {
@@ -164,11 +435,12 @@ Offset += RPos;
 
 // Merge this object's model with the passed model (if there is one):
 if (AttachedModel)
-    if (Mdl->CombineModel(AttachedModel, Offset, GAtd) != IMR_OK)
+    if (Mdl->CombineModel(AttachedModel, Offset, Get_RotMatrix()) != IMR_OK)
         return IMRERR_GENERIC;
 
 // Loop through each child and merge them:
 int Status = IMR_OK;
+IMR_Object **Children = Get_ChildList();
 for (int item = 0; item < Num_Children; item ++)
     if (Children[item]) Status |= Children[item]->MergeToModel(Mdl, Offset);
 
@@ -178,12 +450,40 @@ return IMRERR_GENERIC;
  }    
 
 
+/***************************************************************************\
+  Doubles the room for children, moving them all to the heap.
+  Returns IMR_OK if successful, otherwise an error.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Object::Grow_Children(void)
+{
+IMR_Object **NewChildren;
+
+if (HeapChildren)
+    NewChildren = (IMR_Object **)realloc(HeapChildren, sizeof(IMR_Object *) * Max_Children * 2);
+else
+    {
+    NewChildren = (IMR_Object **)malloc(sizeof(IMR_Object *) * Max_Children * 2);
+    if (NewChildren) memcpy(NewChildren, InChildren, sizeof(IMR_Object *) * Num_Children);
+     }
+if (!NewChildren)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::Grow_Children(): Out of memory in object %s! (%d)", Name, Max_Children * 2);
+    return IMRERR_OUTOFMEM;
+     }
+HeapChildren = NewChildren;
+Max_Children *= 2;
+return IMR_OK;
+ }
+
 /***************************************************************************\
   Attaches the specified child to the object.
   Returns IMR_OK if successful.
 \***************************************************************************/
 int IMR_Object::Attach_Child(IMR_Object *Obj)
 {
+int err;
+
 // Make sure we have an object:
 if (!Obj)
     {
@@ -191,25 +491,21 @@ if (!Obj)
     return IMRERR_NODATA;
      }
 
-// One more child:
-++ Num_Children;
-
-// If we have too many, return:
-if (Num_Children > IMR_OBJECT_MAXCHILDREN) 
+// Make room if we have to:
+if (Num_Children >= Max_Children)
     {
-    Num_Children = IMR_OBJECT_MAXCHILDREN; 
-    IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::Attach_Child(): To many children in object %s! (%d)", Name, IMR_OBJECT_MAXCHILDREN);
-    return IMRERR_TOMANY;
+    err = Grow_Children(); if (IMR_ISNOTOK(err)) return err;
      }
 
 // Add the pointer to the child to the end of the list:
-Children[Num_Children - 1] = Obj;
+Get_ChildList()[Num_Children ++] = Obj;
 
 // And add a pointer to ourselves (it's parent):
-Children[Num_Children - 1]->Parent = this;
+Obj->Parent = this;
 
-// And update our childs coords:
-Obj->UpdateCoords();
+// And have our childs coords found again:
+Obj->Mark_Dirty();
+if (Hier) Hier->Invalidate();
 
 // And return ok:
 return IMR_OK;
@@ -221,7 +517,7 @@ return IMR_OK;
 \***************************************************************************/
 IMR_Object *IMR_Object::Detach_Child(char *Name)
 {
-IMR_Object *Temp;
+IMR_Object *Temp, **Children = Get_ChildList();
 int ItemIndex;
 
 // Get an index to the child:
@@ -238,6 +534,10 @@ memmove((void *)&Children[ItemIndex],
 // One less child:
 -- Num_Children;
 
+// Our bounds have changed:
+Update_Bounds();
+if (Hier) Hier->Invalidate();
+
 // And return a pointer to the child:
 return Temp;
  }
@@ -248,8 +548,9 @@ return Temp;
 IMR_Object *IMR_Object::Get_Child(char *Name, int *index)
 {
 // Search each item in the list:
+IMR_Object **Children = Get_ChildList();
 for (int item = 0; item < Num_Children; item ++)
-    if (Children[item]->Is(Name))
+    if (Children[item] && Children[item]->Is(Name))
         {
         if (index) *index = item;
         return Children[item];
@@ -267,7 +568,7 @@ void IMR_Object::Set_ModelName(char *MName)
 if (strlen(Name) > 8)
     {
     memcpy((void *)ModelName, (void *)MName, 8);
-    ModelName[8] = '/0';
+    ModelName[8] = '\0';
      }
 else
     strcpy(ModelName, MName);
@@ -280,7 +581,7 @@ void IMR_Object::Animation_Jump(IMR_3DPoint &Pos, IMR_Attitude &Atd)
 {
 RPos = Pos;
 RAtd = Atd;
-UpdateCoords();
+Mark_Dirty();
  }
 
 /***************************************************************************\
@@ -292,26 +593,37 @@ void IMR_Object::Animation_Init(IMR_3DPoint &Pos, IMR_Attitude &Atd, int L)
 {
 float XDelta, YDelta, ZDelta;
 
+// Make room for the animation if this is the first one:
+if (!Anim)
+    {
+    if (!(Anim = new IMR_ObjectAnimation))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::Animation_Init(): Out of memory in object %s!", Name);
+        return;
+         }
+    Anim->Status = IMR_ANIMATION_DONE;
+     }
+
 // Copy current position:
-StartPos = RPos;
-StartAtd.X = (float)RAtd.X;
-StartAtd.Y = (float)RAtd.Y;
-StartAtd.Z = (float)RAtd.Z;
+Anim->StartPos = RPos;
+Anim->StartAtd.X = (float)RAtd.X;
+Anim->StartAtd.Y = (float)RAtd.Y;
+Anim->StartAtd.Z = (float)RAtd.Z;
 
 // Set destination position and attitude:
-DestPos = Pos;
-DestAtd = Atd;
+Anim->DestPos = Pos;
+Anim->DestAtd = Atd;
 if (L <= 0) return;
 
 // Set position change vector:
 if (RPos != Pos)
     {
-    PosVect.X = Pos.X - RPos.X;
-    PosVect.Y = Pos.Y - RPos.Y;
-    PosVect.Z = Pos.Z - RPos.Z;
+    Anim->PosVect.X = Pos.X - RPos.X;
+    Anim->PosVect.Y = Pos.Y - RPos.Y;
+    Anim->PosVect.Z = Pos.Z - RPos.Z;
      }
 else
-    PosVect.X = PosVect.Y = PosVect.Z = 0;
+    Anim->PosVect.X = Anim->PosVect.Y = Anim->PosVect.Z = 0;
 
 // Set attitude change vector:
 if (RAtd != Atd)
@@ -326,9 +638,9 @@ if (RAtd != Atd)
             XDelta = -((IMR_DEGREECOUNT - Atd.X) + RAtd.X);
         if (XDelta < -IMR_HALFDEGREECOUNT) 
             XDelta = (IMR_DEGREECOUNT - RAtd.X) + Atd.X;
-        AtdVect.X = (float)XDelta;
+        Anim->AtdVect.X = (float)XDelta;
          }
-    else AtdVect.X = 0;
+    else Anim->AtdVect.X = 0;
             
     if (YDelta)
         {
@@ -336,9 +648,9 @@ if (RAtd != Atd)
             YDelta = -((IMR_DEGREECOUNT - Atd.Y) + RAtd.Y);
         if (YDelta < -IMR_HALFDEGREECOUNT)
             YDelta = (IMR_DEGREECOUNT - RAtd.Y) + Atd.Y;
-        AtdVect.Y = (float)YDelta;
+        Anim->AtdVect.Y = (float)YDelta;
          }
-    else AtdVect.Y = 0;
+    else Anim->AtdVect.Y = 0;
                  
     if (ZDelta)
         {
@@ -346,77 +658,95 @@ if (RAtd != Atd)
             ZDelta = -((IMR_DEGREECOUNT - Atd.Z) + RAtd.Z);
         if (ZDelta < -IMR_HALFDEGREECOUNT)
             ZDelta = (IMR_DEGREECOUNT - RAtd.Z) + Atd.Z;
-        AtdVect.Z = (float)ZDelta;
+        Anim->AtdVect.Z = (float)ZDelta;
          }
-    else AtdVect.Z = 0;
+    else Anim->AtdVect.Z = 0;
      }
 else
-    AtdVect.X = AtdVect.Y = AtdVect.Z = 0;
+    Anim->AtdVect.X = Anim->AtdVect.Y = Anim->AtdVect.Z = 0;
  
 // Reset counters:
-Animation_Status = IMR_ANIMATION_ACTIVE;
-Animation_Time = 0;
-Animation_Length = L;
+Anim->Status = IMR_ANIMATION_ACTIVE;
+Anim->Time = 0;
+Anim->Length = L;
  }
 
 /***************************************************************************\
   Changes to the next frame in an animation.
-  --Modified 3/6/00 for nonlinear interpolation--
 \***************************************************************************/
 int IMR_Object::Animation_Step(void)
 {
+int Status;
+
+// Make sure an animation is in progress:
+if (!Anim || Anim->Status == IMR_ANIMATION_DONE) return IMR_ANIMATION_DONE;
+
+// Step it and flag that we've moved:
+Status = Animation_Advance(IMR_Time_GetFrameTime());
+Mark_Dirty();
+return Status;
+ }
+
+/***************************************************************************\
+  Moves the animation on by the specified frame time, without flagging
+  that the object has moved.  Only this object is touched, so objects can
+  be advanced at the same time on different threads, as long as each one
+  is marked dirty (see Mark_Dirty()) afterwards.
+  Returns the status of the animation.
+  --Modified 3/6/00 for nonlinear interpolation--
+\***************************************************************************/
+int IMR_Object::Animation_Advance(int FrameTime)
+{
 float q;
 
 // Make sure an animation is in progress:
-if (Animation_Status == IMR_ANIMATION_DONE) return IMR_ANIMATION_DONE;
+if (!Anim || Anim->Status == IMR_ANIMATION_DONE) return IMR_ANIMATION_DONE;
 
 // Increment counter and calculate interpolant
-Animation_Time += IMR_Time_GetFrameTime(); 
-q = (float)Animation_Time / (float)Animation_Length;
+Anim->Time += FrameTime; 
+q = (float)Anim->Time / (float)Anim->Length;
 
 // Update attitude and position:
-RPos.X = StartPos.X + (PosVect.X * q);
-RPos.Y = StartPos.Y + (PosVect.Y * q);
-RPos.Z = StartPos.Z + (PosVect.Z * q);
-if (PosVect.X != 0.0)
-    if (PosVect.X > 0.0) { if (RPos.X > DestPos.X) RPos.X = DestPos.X; } else { if (RPos.X < DestPos.X) RPos.X = DestPos.X; };
-if (PosVect.Y != 0.0)
-    if (PosVect.Y > 0.0) { if (RPos.Y > DestPos.Y) RPos.Y = DestPos.Y; } else { if (RPos.Y < DestPos.Y) RPos.Y = DestPos.Y; };
-if (PosVect.Z != 0.0)
-    if (PosVect.Z > 0.0) { if (RPos.Z > DestPos.Z) RPos.Z = DestPos.Z; } else { if (RPos.Z < DestPos.Z) RPos.Z = DestPos.Z; };
-RAtd.X = int(StartAtd.X + (AtdVect.X * q));
-RAtd.Y = int(StartAtd.Y + (AtdVect.Y * q));
-RAtd.Z = int(StartAtd.Z + (AtdVect.Z * q));
+RPos.X = Anim->StartPos.X + (Anim->PosVect.X * q);
+RPos.Y = Anim->StartPos.Y + (Anim->PosVect.Y * q);
+RPos.Z = Anim->StartPos.Z + (Anim->PosVect.Z * q);
+if (Anim->PosVect.X != 0.0)
+    if (Anim->PosVect.X > 0.0) { if (RPos.X > Anim->DestPos.X) RPos.X = Anim->DestPos.X; } else { if (RPos.X < Anim->DestPos.X) RPos.X = Anim->DestPos.X; };
+if (Anim->PosVect.Y != 0.0)
+    if (Anim->PosVect.Y > 0.0) { if (RPos.Y > Anim->DestPos.Y) RPos.Y = Anim->DestPos.Y; } else { if (RPos.Y < Anim->DestPos.Y) RPos.Y = Anim->DestPos.Y; };
+if (Anim->PosVect.Z != 0.0)
+    if (Anim->PosVect.Z > 0.0) { if (RPos.Z > Anim->DestPos.Z) RPos.Z = Anim->DestPos.Z; } else { if (RPos.Z < Anim->DestPos.Z) RPos.Z = Anim->DestPos.Z; };
+RAtd.X = int(Anim->StartAtd.X + (Anim->AtdVect.X * q));
+RAtd.Y = int(Anim->StartAtd.Y + (Anim->AtdVect.Y * q));
+RAtd.Z = int(Anim->StartAtd.Z + (Anim->AtdVect.Z * q));
 RAtd.Fix_Ang();
 /*  --removed 3.28.00, seems it caused some problems and isn't really needed ---
-if (AtdVect.X != 0.0)    
-    if (AtdVect.X > 0.0) { if (RAtd.X > DestAtd.X) RAtd.X = DestAtd.X; } else { if (RAtd.X < DestAtd.X) RAtd.X = DestAtd.X; };
-if (AtdVect.Y != 0.0)
-    if (AtdVect.Y > 0.0) { if (RAtd.Y > DestAtd.Y) RAtd.Y = DestAtd.Y; } else { if (RAtd.Y < DestAtd.Y) RAtd.Y = DestAtd.Y; };
-if (AtdVect.Z != 0.0)
-    if (AtdVect.Z > 0.0) { if (RAtd.Z > DestAtd.Z) RAtd.Z = DestAtd.Z; } else { if (RAtd.Z < DestAtd.Z) RAtd.Z = DestAtd.Z; };
+if (Anim->AtdVect.X != 0.0)    
+    if (Anim->AtdVect.X > 0.0) { if (RAtd.X > Anim->DestAtd.X) RAtd.X = Anim->DestAtd.X; } else { if (RAtd.X < Anim->DestAtd.X) RAtd.X = Anim->DestAtd.X; };
+if (Anim->AtdVect.Y != 0.0)
+    if (Anim->AtdVect.Y > 0.0) { if (RAtd.Y > Anim->DestAtd.Y) RAtd.Y = Anim->DestAtd.Y; } else { if (RAtd.Y < Anim->DestAtd.Y) RAtd.Y = Anim->DestAtd.Y; };
+if (Anim->AtdVect.Z != 0.0)
+    if (Anim->AtdVect.Z > 0.0) { if (RAtd.Z > Anim->DestAtd.Z) RAtd.Z = Anim->DestAtd.Z; } else { if (RAtd.Z < Anim->DestAtd.Z) RAtd.Z = Anim->DestAtd.Z; };
 */
-UpdateCoords();
  
 // Tell the system our status:
-if (Animation_Time >= Animation_Length) 
+if (Anim->Time >= Anim->Length) 
     {
     // Set status:
-    Animation_Status = IMR_ANIMATION_DONE;
+    Anim->Status = IMR_ANIMATION_DONE;
     
     // Set positions and attitudes exactly:
-    RPos = DestPos;
-    RAtd = DestAtd;
-    UpdateCoords();
-    PosVect.X = PosVect.Y = PosVect.Z = 0.0;
-    AtdVect.X = AtdVect.Y = AtdVect.Z = 0.0;
+    RPos = Anim->DestPos;
+    RAtd = Anim->DestAtd;
+    Anim->PosVect.X = Anim->PosVect.Y = Anim->PosVect.Z = 0.0;
+    Anim->AtdVect.X = Anim->AtdVect.Y = Anim->AtdVect.Z = 0.0;
 
     // Return status:
     return IMR_ANIMATION_DONE;
      }
 else 
     {
-    Animation_Status = IMR_ANIMATION_ACTIVE;
+    Anim->Status = IMR_ANIMATION_ACTIVE;
     return IMR_ANIMATION_ACTIVE;
      }
  }
@@ -431,7 +761,7 @@ float q = s * IMR_Time_GetNormalizedFrameTime();
 RPos.X += (Delta.X * q);
 RPos.Y += (Delta.Y * q);
 RPos.Z += (Delta.Z * q);
-UpdateCoords();
+Mark_Dirty();
  }
 
 /***************************************************************************\
@@ -442,9 +772,7 @@ UpdateCoords();
 int IMR_Object::Motion_Travel_CheckCollide(IMR_3DPoint &Delta, float s, IMR_Object *Environ, IMR_CollideInfo &CInfo)
 {
 float q = s * IMR_Time_GetNormalizedFrameTime();
-IMR_3DPoint NewPos;
-IMR_3DPoint EllipsoidSource, EllipsoidVelocity;
-int ActionFlags;
+IMR_3DPoint Pos, NewPos, Velocity;
 
 // Make sure we have an object to check:
 if (!Environ)
@@ -453,30 +781,29 @@ if (!Environ)
     return IMRERR_NODATA;
      };
 
-// Convert to ellipsoid space:
-EllipsoidSource.X = GPos.X * CInfo.invRh;
-EllipsoidSource.Y = GPos.Y * CInfo.invRv;
-EllipsoidSource.Z = GPos.Z * CInfo.invRh;
-EllipsoidVelocity.X = Delta.X * CInfo.invRh * q;
-EllipsoidVelocity.Y = Delta.Y * CInfo.invRv * q;
-EllipsoidVelocity.Z = Delta.Z * CInfo.invRh * q;
+// Make sure where we are is up to date:
+ResolveCoords();
 
-// Move and check for collisions:
-NewPos = Environ->CheckCollide(CInfo, EllipsoidSource, EllipsoidVelocity);
+// Find how far we're going this frame:
+Velocity.X = Delta.X * q;
+Velocity.Y = Delta.Y * q;
+Velocity.Z = Delta.Z * q;
 
-// Convert new position to spheroid space:
-NewPos.X *= CInfo.Rh;
-NewPos.Y *= CInfo.Rv;
-NewPos.Z *= CInfo.Rh;
+// Move and check for collisions (but not with ourselves):
+CInfo.Ignore = (void *)this;
+CInfo.Reset_Contacts();
+Pos = Get_GlobalPos();
+NewPos = Environ->CheckCollide_Move(CInfo, Pos, Velocity);
+CInfo.Ignore = NULL;
 
 // Set our new pos:
 if (Parent)
-    RPos = NewPos - Parent->GPos;
+    RPos = NewPos - Parent->Get_GlobalPos();
 else
     RPos = NewPos;
 
 // Update our coords:
-UpdateCoords();
+Mark_Dirty();
 
 // And return ok:
 return IMR_OK;
@@ -491,74 +818,346 @@ int q = (int)(r * IMR_Time_GetNormalizedFrameTime());
 RAtd.X += (Delta.X * q);
 RAtd.Y += (Delta.Y * q);
 RAtd.Z += (Delta.Z * q);
-UpdateCoords();
+RAtd.Fix_Ang();
+Mark_Dirty();
+ }
+
+/***************************************************************************\
+  Checks the models of this object and it's children for collisions with 
+  the ellipsoid moving through the specified box (global coords).  Only 
+  subtrees with bounds that overlap the box are visited.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::CheckCollide_Tree(IMR_CollideInfo &CInfo, float *Min, float *Max)
+{
+// Skip this subtree if it's not near (or it's the one moving):
+if (!HasBounds || CInfo.Ignore == (void *)this) return;
+if (!IMR_Collide_BoxesOverlap(Min, Max, BoundMin, BoundMax)) return;
+
+// Check for a collision with this model (if it exists):
+IMR_HIERARCHY_CHECKSYNC(Hier, HierIndex);
+if (AttachedModel && Collidable) 
+    IMR_Collide_CheckModCollision(AttachedModel, GPos, RotMtrx, CInfo, 
+        CInfo.Shared ? CollideCache.Peek(AttachedModel) : CollideCache.Fetch(AttachedModel, RotMtrx, GPos), (void *)this);
+
+// Now check the kiddies:
+IMR_Object **Children = Get_ChildList();
+for (int child = 0; child < Num_Children; child ++)
+    if (Children[child]) Children[child]->CheckCollide_Tree(CInfo, Min, Max);
+ }
+
+/***************************************************************************\
+  Checks just the triangles in the collision info's contact cache, for 
+  each object in this tree that has some and is near the ellipsoid moving 
+  through the specified box (global coords).
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::CheckCollide_Contacts(IMR_CollideInfo &CInfo, float *Min, float *Max)
+{
+// Skip this subtree if it's not near (or it's the one moving):
+if (!HasBounds || CInfo.Ignore == (void *)this) return;
+if (!IMR_Collide_BoxesOverlap(Min, Max, BoundMin, BoundMax)) return;
+
+// Check the cached triangles of this model (if it exists):
+IMR_HIERARCHY_CHECKSYNC(Hier, HierIndex);
+if (AttachedModel && Collidable) 
+    IMR_Collide_CheckModContacts(AttachedModel, GPos, RotMtrx, CInfo, 
+        CInfo.Shared ? CollideCache.Peek(AttachedModel) : CollideCache.Fetch(AttachedModel, RotMtrx, GPos), (void *)this);
+
+// Now check the kiddies:
+IMR_Object **Children = Get_ChildList();
+for (int child = 0; child < Num_Children; child ++)
+    if (Children[child]) Children[child]->CheckCollide_Contacts(CInfo, Min, Max);
+ }
+
+/***************************************************************************\
+  Moves an ellipsoid at the specified position by the velocity (both in
+  global coords), sliding along anything it hits in this object and it's
+  children.  The ellipsoid and the object to skip come from the collision 
+  info.
+  Returns the final position (global coords).
+\***************************************************************************/
+IMR_3DPoint IMR_Object::CheckCollide_Move(IMR_CollideInfo &CInfo, IMR_3DPoint &Pos, IMR_3DPoint &Velocity)
+{
+IMR_3DPoint EllipsoidSource, EllipsoidVelocity, NewPos;
+
+// Convert to ellipsoid space:
+EllipsoidSource.X = Pos.X * CInfo.invRh;
+EllipsoidSource.Y = Pos.Y * CInfo.invRv;
+EllipsoidSource.Z = Pos.Z * CInfo.invRh;
+EllipsoidVelocity.X = Velocity.X * CInfo.invRh;
+EllipsoidVelocity.Y = Velocity.Y * CInfo.invRv;
+EllipsoidVelocity.Z = Velocity.Z * CInfo.invRh;
+
+// Move and check for collisions:
+NewPos = CheckCollide(CInfo, EllipsoidSource, EllipsoidVelocity);
+
+// Convert new position back:
+NewPos.X *= CInfo.Rh;
+NewPos.Y *= CInfo.Rv;
+NewPos.Z *= CInfo.Rh;
+return NewPos;
+ }
+
+/***************************************************************************\
+  Makes sure the collision trees of all the collidable models in this 
+  object and it's children are built, so they can be read by several 
+  threads at once.
+\***************************************************************************/
+void IMR_Object::Build_CollideTrees(void)
+{
+if (AttachedModel && Collidable) AttachedModel->Get_CollideBVH();
+IMR_Object **Children = Get_ChildList();
+for (int child = 0; child < Num_Children; child ++)
+    if (Children[child]) Children[child]->Build_CollideTrees();
+ }
+
+// Data passed to the batch collision and ray cast jobs:
+struct IMR_CollideBatch
+    {
+    IMR_Object *Environ;
+    IMR_CollideAgent *Agents;
+    IMR_CollideRay *Rays;
+    int AnyHit;
+     };
+
+/***************************************************************************\
+  Moves one agent of a batch.  Called by the thread pool.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::CheckCollide_Job(void *Data, int Item)
+{
+IMR_CollideBatch *Batch = (IMR_CollideBatch *)Data;
+IMR_CollideAgent *Agent = &Batch->Agents[Item];
+
+Agent->Info.Shared = 1;
+Agent->Info.Reset_Contacts();
+Agent->Position = Batch->Environ->CheckCollide_Move(Agent->Info, Agent->Position, Agent->Velocity);
+Agent->Info.Shared = 0;
+ }
+
+/***************************************************************************\
+  Moves each of the specified agents through this object and it's children
+  (the environment), spreading them across the thread pool if one is 
+  specified.  The environment is only read, so each agent ends up where
+  a call to CheckCollide_Move() with it's info would put it, no matter 
+  how many threads there are or what order they run in.  Agents don't 
+  collide with each other.
+  Note: Don't move anything in the environment until this returns.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Object::CheckCollide_Batch(IMR_CollideAgent *Agents, int NumAgents, IMR_ThreadPool *Pool)
+{
+IMR_CollideBatch Batch;
+int agent;
+
+// Make sure we have something to do:
+if (!Agents || NumAgents <= 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::CheckCollide_Batch(): No agents passed!");
+    return IMRERR_NODATA;
+     }
+
+// Find the coords and build the trees now so the workers never have to:
+ResolveCoords();
+Build_CollideTrees();
+
+// Move everyone:
+Batch.Environ = this;
+Batch.Agents = Agents;
+Batch.Rays = NULL;
+Batch.AnyHit = 0;
+if (Pool)
+    return Pool->Run(CheckCollide_Job, (void *)&Batch, NumAgents);
+for (agent = 0; agent < NumAgents; agent ++)
+    CheckCollide_Job((void *)&Batch, agent);
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Casts the ray at the models of this object and it's children, skipping
+  subtrees it doesn't pass through.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::RayCast_Tree(IMR_CollideRay &Ray, int AnyHit)
+{
+// Skip this subtree if we're done, it's not in the way (or it's ignored):
+if (!HasBounds || Ray.Ignore == (void *)this || (AnyHit && Ray.Hit)) return;
+if (!IMR_Collide_RayHitsBox(Ray, BoundMin, BoundMax)) return;
+
+// Check this model (if it exists):
+IMR_HIERARCHY_CHECKSYNC(Hier, HierIndex);
+if (AttachedModel && Collidable)
+    if (IMR_Collide_RayModel(AttachedModel, GPos, RotMtrx, Ray, AnyHit)) Ray.HitObj = (void *)this;
+
+// Now check the kiddies:
+IMR_Object **Children = Get_ChildList();
+for (int child = 0; child < Num_Children; child ++)
+    if (Children[child]) Children[child]->RayCast_Tree(Ray, AnyHit);
+ }
+
+/***************************************************************************\
+  Casts the ray (global coords) at the collidable models of this object
+  and it's children and fills in the nearest hit.  If AnyHit is set it 
+  stops at the first hit found instead (for line of sight checks).
+  Returns true if anything was hit, false if not.
+\***************************************************************************/
+int IMR_Object::RayCast(IMR_CollideRay &Ray, int AnyHit)
+{
+ResolveCoords();
+Ray.Hit = 0;
+Ray.Distance = Ray.MaxDist;
+Ray.HitObj = NULL;
+RayCast_Tree(Ray, AnyHit);
+return Ray.Hit;
+ }
+
+/***************************************************************************\
+  Casts one ray of a batch.  Called by the thread pool.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Object::RayCast_Job(void *Data, int Item)
+{
+IMR_CollideBatch *Batch = (IMR_CollideBatch *)Data;
+
+Batch->Environ->RayCast(Batch->Rays[Item], Batch->AnyHit);
+ }
+
+/***************************************************************************\
+  Casts each of the specified rays at this object and it's children, 
+  spreading them across the thread pool if one is specified.
+  Note: Don't move anything in the tree until this returns.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Object::RayCast_Batch(IMR_CollideRay *Rays, int NumRays, int AnyHit, IMR_ThreadPool *Pool)
+{
+IMR_CollideBatch Batch;
+int ray;
+
+// Make sure we have something to do:
+if (!Rays || NumRays <= 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::RayCast_Batch(): No rays passed!");
+    return IMRERR_NODATA;
+     }
+
+// Find the coords and build the trees now so the workers never have to:
+ResolveCoords();
+Build_CollideTrees();
+
+// Cast everything:
+Batch.Environ = this;
+Batch.Agents = NULL;
+Batch.Rays = Rays;
+Batch.AnyHit = AnyHit;
+if (Pool)
+    return Pool->Run(RayCast_Job, (void *)&Batch, NumRays);
+for (ray = 0; ray < NumRays; ray ++)
+    RayCast_Job((void *)&Batch, ray);
+
+// And return ok:
+return IMR_OK;
  }
 
 /***************************************************************************\
   Checks for and handles a collision on this object and it's children.
   Position passed in collision info structure should be in global coords.
+  Slides along whatever it hits until the remaining motion is used up or
+  CInfo.maxIterations slides have been done, and counts the slides and
+  triangles tested in the collision info.
+  The triangles the last move hit or nearly hit are tested first, so the
+  rest of the search only has to cover the motion up to that hit.
   Returns position after collision responce.
 \***************************************************************************/
 IMR_3DPoint IMR_Object::CheckCollide(IMR_CollideInfo &CInfo, IMR_3DPoint position, IMR_3DPoint velocity)
 {
-IMR_3DPoint Pos;
- 
-// Check if we need to move at all:
-if (velocity.Mag() < IMR_COLLIDE_EPSILON) return position;
+IMR_3DPoint destinationPoint, newSourcePoint, V;
+IMR_3DPoint slidePlaneOrigin, slidePlaneNormal, newDestinationPoint;
+float Min[3], Max[3], Length, CachedDistance;
+int CachedHit;
+double l;
+
+// Make sure everything's where it should be:
+ResolveCoords();
 
-// Find destination point:
-IMR_3DPoint destinationPoint = position + velocity;
+// Reset the counters:
+CInfo.iterations = 0;
+CInfo.trianglesTested = 0;
+
+// The contacts from the last move are the ones to try first:
+IMR_Collide_BeginContacts(CInfo);
+
+// Keep sliding until we're done or out of iterations:
+while (CInfo.iterations < CInfo.maxIterations)
+    {
+    // Check if we need to move at all:
+    Length = velocity.Mag();
+    if (Length < IMR_COLLIDE_EPSILON) return position;
+    ++ CInfo.iterations;
+
+    // Find destination point:
+    destinationPoint = position + velocity;
  
-// reset the collision package we send to the mesh 
-CInfo.Velocity = velocity;
-CInfo.SourcePoint = position;
-CInfo.foundCollision = FALSE;
-CInfo.stuck = FALSE;
-CInfo.nearestDistance = -1;      
-
-/*
-// Loop through the children and check for collisions on each:
-IMR_Object *Obj;
-for (int child = 0; child < Get_Num_Children(); child ++)
-    if (Obj = Get_Child(child))
+    // reset the collision package we send to the mesh 
+    CInfo.Velocity = velocity;
+    CInfo.SourcePoint = position;
+    CInfo.foundCollision = FALSE;
+    CInfo.stuck = FALSE;
+    CInfo.nearestDistance = -1;      
+
+    // Check the cached triangles first (unless the move is so short the
+    // box can't get much smaller):
+    IMR_Collide_FindSweptBox(CInfo, Min, Max);
+    CachedHit = 0;
+    CachedDistance = 0;
+    if (CInfo.numContacts && Length > IMR_COLLIDE_CONTACTMINMOVE)
         {
-        CInfo.foundCollision = FALSE;
-        CInfo.stuck = FALSE;
-        CInfo.nearestDistance = -1;      
-        Obj->CheckCollide(CInfo, CInfo.SourcePoint, CInfo.Velocity);
+        CheckCollide_Contacts(CInfo, Min, Max);
+        CInfo.checkedContacts = 1;
+        CachedHit = CInfo.foundCollision;
+        CachedDistance = CInfo.nearestDistance;
          }
-*/
 
-// Check for a collision with this model (if it exists):
-IMR_Model *Mdl;
-if ((Mdl = Get_Model()) && Collidable) IMR_Collide_CheckModCollision(Mdl, GPos, GAtd, CInfo);
+    // Check for collisions with this object and it's children, skipping any
+    // that aren't near the path (up to the cached hit if there was one):
+    if (CachedHit) IMR_Collide_FindSweptBox(CInfo, Min, Max);
+    CheckCollide_Tree(CInfo, Min, Max);
+    CInfo.checkedContacts = 0;
+
+    // Keep track of how often the cache had the nearest triangle:
+    if (CInfo.foundCollision && Length > IMR_COLLIDE_CONTACTMINMOVE)
+        {
+        if (CachedHit && CInfo.nearestDistance == CachedDistance) ++ CInfo.cacheHits;
+        else ++ CInfo.cacheMisses;
+         }
 
-// Check return value here, and possibly call recursively:
-if (!CInfo.foundCollision)
-    { 
     // If no collision move very close to the desired destination:
-    float l = velocity.Mag();
-    IMR_3DPoint V = velocity; 
-    V.Set_Length(l - IMR_COLLIDE_EPSILON);
+    if (!CInfo.foundCollision)
+        { 
+        V = velocity; 
+        V.Set_Length(Length - IMR_COLLIDE_EPSILON);
         
-    // Update the last safe position for future error recovery:
-    CInfo.lastSafePosition = position;      
+        // Update the last safe position for future error recovery:
+        CInfo.lastSafePosition = position;      
+
+        // Return the final position:
+        return position + V;
+         }
+
+    // There was a collision, so remember the contact:
+    ++ CInfo.hitCount;
+    CInfo.lastHitPoint = CInfo.nearestPolygonIntersectionPoint;
 
-    // Return the final position:
-    return position + V;
-     }
-else // There was a collision...
-    { 
     // If we are stuck, we just back up to last safe position:
     if (CInfo.stuck) return CInfo.lastSafePosition;
       
-    // OK, first task is to move close to where we hit something:
-    IMR_3DPoint newSourcePoint;
-                   
-    // Only update if we are not already very close:
+    // OK, first task is to move close to where we hit something (only 
+    // update if we are not already very close):
     if (CInfo.nearestDistance >= IMR_COLLIDE_EPSILON)
         {
-        IMR_3DPoint V = velocity;
+        V = velocity;
         V.Set_Length(CInfo.nearestDistance - IMR_COLLIDE_EPSILON);
         newSourcePoint = CInfo.SourcePoint + V;
          }
@@ -566,26 +1165,25 @@ else // There was a collision...
         newSourcePoint = CInfo.SourcePoint;
 
     // Now we must calculate the sliding plane:
-    IMR_3DPoint slidePlaneOrigin = CInfo.nearestPolygonIntersectionPoint;
-    IMR_3DPoint slidePlaneNormal = newSourcePoint - CInfo.nearestPolygonIntersectionPoint;
+    slidePlaneOrigin = CInfo.nearestPolygonIntersectionPoint;
+    slidePlaneNormal = newSourcePoint - CInfo.nearestPolygonIntersectionPoint;
   
     // We now project the destination point onto the sliding plane:
-    double l = IMR_Collide_IntersectRayPlane(destinationPoint, slidePlaneNormal, slidePlaneOrigin, slidePlaneNormal); 
+    l = IMR_Collide_IntersectRayPlane(destinationPoint, slidePlaneNormal, slidePlaneOrigin, slidePlaneNormal); 
   
     // We can now calculate a new destination point on the sliding plane:
-    IMR_3DPoint newDestinationPoint;
     newDestinationPoint.X = destinationPoint.X + l * slidePlaneNormal.X;
     newDestinationPoint.Y = destinationPoint.Y + l * slidePlaneNormal.Y;
     newDestinationPoint.Z = destinationPoint.Z + l * slidePlaneNormal.Z;
    
-    // Generate the slide vector, which will become our new velocity vector
-    // for the next iteration:
-    IMR_3DPoint newVelocityVector = newDestinationPoint - CInfo.nearestPolygonIntersectionPoint;
-        
-    // now we recursively call the function with the new position and velocity 
+    // The slide vector becomes our new velocity vector for the next 
+    // iteration:
     CInfo.lastSafePosition = position;
-    return CheckCollide(CInfo, newSourcePoint, newVelocityVector);
+    velocity = newDestinationPoint - CInfo.nearestPolygonIntersectionPoint;
+    position = newSourcePoint;
      }
+
+// Out of iterations, so stay where we got to (just short of the last hit):
 return position;
  }
 
@@ -16,19 +16,23 @@
 #include <stdlib.h>
 #include <malloc.h>
 #include <math.h>
-#include "IMR_Geom_Light.hpp"
-#include "IMR_Geom_Model.hpp"
-#include "IMR_Geom_Poly.hpp"
-#include "IMR_Geom_Prim.hpp"
-#include "IMR_Matrix.hpp"
-#include "IMR_Collide.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
-#include "..\Foundation\IMR_List.hpp"
-#include "..\Foundation\IMR_Time.hpp"
+#include "imr_geom_light.hpp"
+#include "imr_geom_model.hpp"
+#include "imr_geom_poly.hpp"
+#include "imr_geom_prim.hpp"
+#include "imr_matrix.hpp"
+#include "imr_collide.hpp"
+#include "imr_collidehash.hpp"
+#include "imr_hierarchy.hpp"
+#include "imr_octree.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../Foundation/imr_list.hpp"
+#include "../Foundation/imr_time.hpp"
+#include "../Foundation/imr_thread.hpp"
 
 // Constants and macros:
-#define IMR_OBJECT_MAXLIGHTS    64
-#define IMR_OBJECT_MAXCHILDREN  32
+#define IMR_OBJECT_INLIGHTS     4       // Lights kept in the object before going to the heap
+#define IMR_OBJECT_INCHILDREN   4       // Children kept in the object before going to the heap
 #ifndef IMR_ANIMATION_DONE
     #define IMR_ANIMATION_DONE      0
 #endif
@@ -42,9 +46,28 @@
     #define IMR_MOTION_ACTIVE       1
 #endif
 
+// Mover for batch collisions (global coords):
+struct IMR_CollideAgent
+    {
+    IMR_CollideInfo Info;       // Ellipsoid (Setup_Ellipsoid()), object to skip, and contacts after the move
+    IMR_3DPoint Position;       // Start position (replaced by the final position)
+    IMR_3DPoint Velocity;       // Motion to make
+     };
+
+// Animation state of an object (only made for objects that are animated):
+struct IMR_ObjectAnimation
+    {
+    IMR_3DPoint  StartPos, StartAtd;
+    IMR_3DPoint  PosVect, DestPos, AtdVect;
+    IMR_Attitude DestAtd;
+    int Time, Length, Status;
+     };
+
 // Object class:
-class IMR_Object
+class IMR_Object : public IMR_NamedItem
     {
+    friend class IMR_Hierarchy;
+    friend class IMR_Octree;
     protected:
       // Miscellaneous stuff:
       char Name[9];
@@ -53,27 +76,51 @@ class IMR_Object
       // List stuff:
       int Num_Lights, Num_Children;
       
-      // Attached stuff (All local positions are relative to the object):
-      IMR_Light  *AttachedLights[IMR_OBJECT_MAXLIGHTS];
+      // Attached stuff (All local positions are relative to the object).  The
+      // first few lights and children are kept here; past that they all move
+      // to an array on the heap:
+      IMR_Light  *InLights[IMR_OBJECT_INLIGHTS], **HeapLights;
       IMR_Model  *AttachedModel;
-      IMR_Object *Children[IMR_OBJECT_MAXCHILDREN];
+      IMR_Object *InChildren[IMR_OBJECT_INCHILDREN], **HeapChildren;
+      int Max_Lights, Max_Children;
       
-      // Position and orientation (relative to parent and global):
-      IMR_3DPoint  RPos, GPos, StartPos, StartAtd;
-      IMR_Attitude RAtd, GAtd;
+      // Position and orientation (relative to parent and global).  The 
+      // global rotation is the local one put on top of the parent's (the
+      // global attitude is found from it when it's asked for):
+      IMR_3DPoint  RPos, GPos;
+      IMR_Attitude RAtd;
       IMR_Matrix   RotMtrx;
+      IMR_Matrix   LocalMtrx;           // Rotation made from RAtd
+      IMR_Attitude LocalAtd;            // RAtd when LocalMtrx was made
+
+      // Lazy update flags (the globals are only found again when needed):
+      int Dirty;                    // Relative pos or atd changed since the globals were found
+      int Pending;                  // This or something below it is dirty
 
-      // Animation control stuff:
-      IMR_3DPoint  PosVect, DestPos, AtdVect;
-      IMR_Attitude DestAtd;
-      int Animation_Time, Animation_Length, Animation_Status;
+      // Hierarchy this object's transforms are kept in (or NULL), and it's node:
+      IMR_Hierarchy *Hier;
+      int HierIndex;
+
+      // Cached static lighting for the attached model:
+      IMR_LightCache LightCache;
       
-      // Motion control stuff:
-      float Motion_TravelSpeed,
-            Motion_TurnRate;
-      IMR_3DPoint  Motion_TravelVect, Motion_TurnVect;
-      IMR_Attitude Motion_DestAtd;
-      int Motion_Time, Motion_Status;
+      // Cached world coords of the attached model (for collisions):
+      IMR_CollideCache CollideCache;
+      
+      // Bounding box of this object and it's children (global coords):
+      float BoundMin[3], BoundMax[3];
+      int HasBounds;
+
+      // Spatial hash of moving objects this one is in (or NULL), and it's entry:
+      IMR_CollideHash *DynHash;
+      int DynEntry;
+
+      // Scene octree this object is in (or NULL), and it's entry:
+      IMR_Octree *Octree;
+      int OctEntry;
+
+      // Animation control stuff (NULL until an animation is started):
+      IMR_ObjectAnimation *Anim;
       
 //// BIG HACK ZONE
 
@@ -85,13 +132,25 @@ class IMR_Object
       IMR_Object *Parent;
       
       // Protected member functions:
+      inline IMR_Light **Get_LightList(void) { return HeapLights ? HeapLights : InLights; };
+      inline IMR_Object **Get_ChildList(void) { return HeapChildren ? HeapChildren : InChildren; };
+      int Grow_Lights(void);
+      int Grow_Children(void);
       IMR_Light *Get_Light(int ID, int *index);
       IMR_Object *Get_Child(char *Name, int *index);
+      void ResolveCoords_Tree(int Moved);
+      void Find_Bounds(void);
+      void Place_InOctree(int HasModel, float *Min, float *Max);
+      void CheckCollide_Tree(IMR_CollideInfo &CInfo, float *Min, float *Max);
+      void CheckCollide_Contacts(IMR_CollideInfo &CInfo, float *Min, float *Max);
+      static void CheckCollide_Job(void *Data, int Item);
+      void RayCast_Tree(IMR_CollideRay &Ray, int AnyHit);
+      static void RayCast_Job(void *Data, int Item);
       
     public:
       
       // Constructor and destructor methods:
-      IMR_Object() { Reset(); };
+      IMR_Object() { DynHash = NULL; Octree = NULL; Hier = NULL; HeapLights = NULL; HeapChildren = NULL; Anim = NULL; Reset(); };
       ~IMR_Object() { Reset(); };
       
       // Init and de-init methods:
@@ -107,15 +166,63 @@ class IMR_Object
       
       // Position and orientation methods:
       void UpdateCoords(void);
-      void Set_RelativePos(IMR_3DPoint &Pos) { RPos = Pos; UpdateCoords(); };
-      void Inc_RelativePos(IMR_3DPoint &Pos) { RPos += Pos; UpdateCoords(); };
-      void Set_RelativeAtd(IMR_Attitude &Atd) { RAtd = Atd; UpdateCoords(); };
-      void Inc_RelativeAtd(IMR_Attitude &Atd) { RAtd += Atd; UpdateCoords(); };
+      void Update_Bounds(void);
+      inline void Mark_Dirty(void)
+          {
+          if (Hier)
+              {
+              Hier->Mark_Dirty(HierIndex, RPos, RAtd);
+              return;
+               }
+          Dirty = Pending = 1;
+          for (IMR_Object *Obj = Parent; Obj && !Obj->Pending; Obj = Obj->Parent)
+              Obj->Pending = 1;
+           };
+      inline void ResolveCoords(void)
+          {
+          IMR_Object *Top = this;
+          if (Hier)
+              {
+              Hier->Update();
+              return;
+               }
+          while (Top->Parent) Top = Top->Parent;
+          if (Top->Hier) Top->Hier->Update();
+          else if (Top->Pending) Top->ResolveCoords_Tree(0);
+           };
+      inline IMR_Hierarchy *Get_Hierarchy(void) { return Hier; };
+      void Set_RelativePos(IMR_3DPoint &Pos) { RPos = Pos; Mark_Dirty(); };
+      void Inc_RelativePos(IMR_3DPoint &Pos) { RPos += Pos; Mark_Dirty(); };
+      void Set_RelativeAtd(IMR_Attitude &Atd) { RAtd = Atd; Mark_Dirty(); };
+      void Inc_RelativeAtd(IMR_Attitude &Atd) { RAtd += Atd; Mark_Dirty(); };
       inline IMR_3DPoint Get_RelativePos(void) { return RPos; };
       inline IMR_Attitude Get_RelativeAtd(void) { return RAtd; };
-      inline IMR_3DPoint Get_GlobalPos(void) { return GPos; };
-      inline IMR_Attitude Get_GlobalAtd(void) { return GAtd; };
-      inline IMR_Matrix Get_RotMatrix(void) { return RotMtrx; };
+      inline IMR_3DPoint Get_GlobalPos(void)
+          {
+          ResolveCoords();
+          if (Hier)
+              {
+              IMR_3DPoint Pos;
+              float *NodePos = Hier->Get_GlobalPos(HierIndex);
+              Pos.X = NodePos[0]; Pos.Y = NodePos[1]; Pos.Z = NodePos[2];
+              return Pos;
+               }
+          return GPos;
+           };
+      inline IMR_Attitude Get_GlobalAtd(void)
+          {
+          IMR_Attitude Atd;
+          ResolveCoords();
+          if (Hier) return Hier->Get_GlobalAtd(HierIndex);
+          RotMtrx.Find_Angles(&Atd.X, &Atd.Y, &Atd.Z);
+          return Atd;
+           };
+      inline IMR_Matrix Get_RotMatrix(void)
+          {
+          ResolveCoords();
+          if (Hier) return Hier->Get_RotMatrix(HierIndex);
+          return RotMtrx;
+           };
       
       // Methods accessing parent:
       inline IMR_Object *Get_Parent(void) { return Parent; };
@@ -127,10 +234,14 @@ class IMR_Object
       inline IMR_Light *Get_Light(int index) 
           { 
           if (index >= 0 && index < Num_Lights) 
-              return AttachedLights[index]; 
+              return Get_LightList()[index]; 
           return NULL; 
            };
       
+      // Lighting cache methods:
+      inline IMR_LightCache *Get_LightCache(void) { return &LightCache; };
+      void Hash_Transform(IMR_LightCacheKey &Key);
+      
       // Attached model methods:
       void Set_ModelName(char *MName);
       char *Get_ModelName(void) { return ModelName; };
@@ -139,32 +250,44 @@ class IMR_Object
           if (Mdl) 
               {
               AttachedModel = Mdl; 
+              LightCache.Invalidate();
+              CollideCache.Invalidate();
+              Update_Bounds();
               return IMR_OK;
                }
           IMR_LogMsg(__LINE__, __FILE__, "IMR_Object::Attach_Model(): NULL Model specified!");
           return IMRERR_NODATA;
            };
-      inline void Detach_Model(void) { AttachedModel = NULL; };
+      inline void Detach_Model(void) { AttachedModel = NULL; LightCache.Reset(); CollideCache.Reset(); Update_Bounds(); };
       inline IMR_Model *Get_Model(void) { return AttachedModel; };
       int MergeToModel(IMR_Model *Mdl, IMR_3DPoint Offset);
             
       // Child object methods:
       int Attach_Child(IMR_Object *Child);
       IMR_Object *Detach_Child(char *Name);
-      inline void Clear_Children(void) { for (int index = 0; index < Num_Children; index ++) Children[index] = NULL; };
+      inline void Clear_Children(void) 
+          { 
+          IMR_Object **Children = Get_ChildList();
+          for (int index = 0; index < Num_Children; index ++) Children[index] = NULL; 
+          if (Hier) Hier->Invalidate();
+           };
       int Get_Num_Children(void) { return Num_Children; };
       inline IMR_Object *Get_Child(int index)  
           {
           if (index >= 0 && index < Num_Children) 
-              return Children[index];
+              return Get_ChildList()[index];
           return NULL;
            };
       inline IMR_Object *Get_Child(char *Name)  
           {
-          IMR_Object *Temp;
+          IMR_Object *Temp, **Children = Get_ChildList();
+          // Use the hierarchy's index if we're in one (updating it may let go of us):
+          if (Hier) Hier->Update();
+          if (Hier) return Hier->Find_Object(Name, HierIndex);
           if (Is(Name)) return this;
           for (int index = 0; index < Num_Children; index ++)
               {
+              if (!Children[index]) continue;
               Temp = Children[index]->Get_Child(Name);
               if (Temp != NULL) return Temp;
                }
@@ -172,6 +295,7 @@ class IMR_Object
            };
       inline IMR_Object *Get_Local_Child(char *Name)  
           {
+          IMR_Object **Children = Get_ChildList();
           for (int index = 0; index < Num_Children; index ++)
               if (Children[index] != NULL && Children[index]->Is(Name)) 
                   return Children[index];
@@ -182,7 +306,8 @@ class IMR_Object
       void Animation_Jump(IMR_3DPoint &Pos, IMR_Attitude &Ang);
       void Animation_Init(IMR_3DPoint &Pos, IMR_Attitude &Ang, int L);
       int Animation_Step(void);
-      int Animation_Get_Status(void) const { return Animation_Status; };
+      int Animation_Advance(int FrameTime);
+      int Animation_Get_Status(void) const { return Anim ? Anim->Status : IMR_ANIMATION_DONE; };
       
       // Motion control methods:
       void Motion_Travel(IMR_3DPoint &Delta, float s);
@@ -191,11 +316,31 @@ class IMR_Object
       
       // Collision detection methods:
       IMR_3DPoint CheckCollide(IMR_CollideInfo &CInfo, IMR_3DPoint position, IMR_3DPoint velocity);
+      IMR_3DPoint CheckCollide_Move(IMR_CollideInfo &CInfo, IMR_3DPoint &Pos, IMR_3DPoint &Velocity);
+      int CheckCollide_Batch(IMR_CollideAgent *Agents, int NumAgents, IMR_ThreadPool *Pool);
+      void Build_CollideTrees(void);
+      int Set_Dynamic(IMR_CollideHash *Hash);
+      void Clear_Dynamic(void);
+      inline int Is_Dynamic(void) { return DynHash != NULL; };
+      int Set_Octree(IMR_Octree *Tree);
+      void Clear_Octree(void);
+      inline IMR_Octree *Get_Octree(void) { return Octree; };
+      int RayCast(IMR_CollideRay &Ray, int AnyHit);
+      int RayCast_Batch(IMR_CollideRay *Rays, int NumRays, int AnyHit, IMR_ThreadPool *Pool);
+      inline int Get_Bounds(float *Min, float *Max)
+          {
+          ResolveCoords();
+          if (!HasBounds) return 0;
+          Min[0] = BoundMin[0]; Min[1] = BoundMin[1]; Min[2] = BoundMin[2];
+          Max[0] = BoundMax[0]; Max[1] = BoundMax[1]; Max[2] = BoundMax[2];
+          return 1;
+           };
 
 //// ANOTHER BIG HACK ZONE
 
       void inline Set_Collidable(void) { Collidable = 1; };
       void inline Set_NonCollidable(void) { Collidable = 0; };
+      int inline Is_Collidable(void) { return Collidable; };
 
 //// END ANOTHER BIG HACK ZONE
 
@@ -8,7 +8,7 @@
  Description: Polygon geometry module.
  
 \****************************************************************/
-#include "IMR_Geom_Poly.hpp"
+#include "imr_geom_poly.hpp"
 
 /***************************************************************************\
   Calculates the centroid of the poly and stores it in the specified point.
@@ -126,9 +126,7 @@ for (vtx = 0; vtx < Num_Verts; vtx ++)
 RadiusSquared = Distance[0];
 for (vtx = 0; vtx < Num_Verts; vtx ++)
     if (Distance[vtx] > RadiusSquared) 
-        {
         RadiusSquared = Distance[vtx];
-        Radius = sqrt(Distance[vtx]);
-         }
+Radius = sqrt(RadiusSquared);
  }
 
@@ -13,8 +13,8 @@
 
 #include <math.h>
 #include <string.h>
-#include "IMR_Geom_Prim.hpp"
-#include "IMR_Material.hpp"
+#include "imr_geom_prim.hpp"
+#include "imr_material.hpp"
 
 // Defines:
 #define IMR_MAXPOLYVERTS 6
@@ -48,6 +48,9 @@ class IMR_Polygon
           unsigned int MaxZ:1;         // Flags if poly should be rendered with max Z (i.e. skybox)
           unsigned int MinZ:1;         // Flags if poly should be rendered with min Z (i.e. overlay)
           unsigned int Skybox:1;       // Flags if poly shouldn't be translated (but will be transformed)
+          unsigned int Baked:1;        // Flags if static lighting is baked into UVI_Info
+          unsigned int HardEdge:1;     // Flags if poly is lit per-corner (not smoothed with it's neighbours)
+          unsigned int VertexLit:1;    // Flags if poly gathers it's lighting from shared vertices (set by the pipeline)
            } Flags;
       
       // Collision detection stuff:
@@ -63,6 +66,9 @@ class IMR_Polygon
           Flags.TwoSided = 0;
           Flags.Transparent = 0;
           Flags.LightSource = 0;
+          Flags.Baked = 0;
+          Flags.HardEdge = 0;
+          Flags.VertexLit = 0;
            };
       ~IMR_Polygon() { Material.Shutdown(); };
       inline void operator = (IMR_Polygon &P);
@@ -77,10 +83,12 @@ class IMR_Polygon
       inline void Set_Pegged(int Val) { Flags.Pegged = Val ? 1 : 0; };
       inline void Set_LightSource(int Val) { Flags.LightSource = Val ? 1 : 0; };
       inline void Set_Transparent(int Val) { Flags.Transparent = Val ? 1 : 0; };
+      inline void Set_HardEdge(int Val) { Flags.HardEdge = Val ? 1 : 0; };
       inline int Get_TwoSided(void) { return Flags.TwoSided; };
       inline int Get_Pegged(void) { return Flags.Pegged; };
       inline int Get_LightSource(void) { return Flags.LightSource; };
       inline int Get_Transparent(void) { return Flags.Transparent; };
+      inline int Get_HardEdge(void) { return Flags.HardEdge; };
      };
 
 inline void IMR_Polygon::operator = (IMR_Polygon &P)
@@ -102,6 +110,8 @@ Flags.LightSource = P.Flags.LightSource;
 Flags.MaxZ = P.Flags.MaxZ;
 Flags.MinZ = P.Flags.MinZ;
 Flags.Skybox = P.Flags.Skybox;
+Flags.Baked = P.Flags.Baked;
+Flags.HardEdge = P.Flags.HardEdge;
 Radius = P.Radius;
 RadiusSquared = P.RadiusSquared;
  }    
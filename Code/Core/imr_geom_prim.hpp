@@ -13,9 +13,9 @@
 #define __IMR_GEOM_PRIM__HPP
 
 // Include all the headers for the various primitives:
-#include "IMR_Geom_Prim_Point.hpp"
-#include "IMR_Geom_Prim_UVI.hpp"
-#include "IMR_Geom_Prim_Ang.hpp"
+#include "imr_geom_prim_point.hpp"
+#include "imr_geom_prim_uvi.hpp"
+#include "imr_geom_prim_ang.hpp"
 
 #endif
 
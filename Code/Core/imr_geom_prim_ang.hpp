@@ -11,7 +11,7 @@
 #ifndef __IMR_GEOM_PRIM_ANG__HPP
 #define __IMR_GEOM_PRIM_ANG__HPP
 
-#include "IMR_Table.hpp"
+#include "imr_table.hpp"
 
 // Attitude class:
 class IMR_Attitude
@@ -20,13 +20,13 @@ class IMR_Attitude
       int X, Y, Z;
       IMR_Attitude() { X = Y = Z = 0; };
       inline void Fix_Ang(void);
-      inline int operator == (IMR_Attitude &A);
-      inline int operator != (IMR_Attitude &A);
-      inline void operator = (IMR_Attitude &A);
-      inline IMR_Attitude operator + (IMR_Attitude &A);
-      inline IMR_Attitude operator - (IMR_Attitude &A);
-      inline IMR_Attitude &operator += (IMR_Attitude &A);
-      inline IMR_Attitude &operator -= (IMR_Attitude &A);
+      inline int operator == (const IMR_Attitude &A);
+      inline int operator != (const IMR_Attitude &A);
+      inline void operator = (const IMR_Attitude &A);
+      inline IMR_Attitude operator + (const IMR_Attitude &A);
+      inline IMR_Attitude operator - (const IMR_Attitude &A);
+      inline IMR_Attitude &operator += (const IMR_Attitude &A);
+      inline IMR_Attitude &operator -= (const IMR_Attitude &A);
      };
 
 /***************************************************************************\
@@ -42,29 +42,29 @@ Z &= IMR_DEGREEAND;
 /***************************************************************************\
   Overloaded operators.
 \***************************************************************************/
-inline int IMR_Attitude::operator == (IMR_Attitude &A)
+inline int IMR_Attitude::operator == (const IMR_Attitude &A)
 {
 int RValue = 0;
 if (A.X == X && A.Y == Y && A.Z == Z) RValue = 1;
 return RValue;
  }
 
-inline int IMR_Attitude::operator != (IMR_Attitude &A)
+inline int IMR_Attitude::operator != (const IMR_Attitude &A)
 {
 int RValue = 0;
 if ((A.X != X) || (A.Y != Y) || (A.Z != Z)) RValue = 1;
 return RValue;
  }
 
-inline void IMR_Attitude::operator = (IMR_Attitude &A)
+inline void IMR_Attitude::operator = (const IMR_Attitude &A)
 {
-A.Fix_Ang();
 X = A.X;
 Y = A.Y;
 Z = A.Z;
+Fix_Ang();
  }
 
-inline IMR_Attitude IMR_Attitude::operator + (IMR_Attitude &A)
+inline IMR_Attitude IMR_Attitude::operator + (const IMR_Attitude &A)
 {
 IMR_Attitude Temp;
 Temp.X = X + A.X;
@@ -74,7 +74,7 @@ Temp.Fix_Ang();
 return Temp;
  }
 
-inline IMR_Attitude IMR_Attitude::operator - (IMR_Attitude &A)
+inline IMR_Attitude IMR_Attitude::operator - (const IMR_Attitude &A)
 {
 IMR_Attitude Temp;
 Temp.X = X - A.X;
@@ -84,7 +84,7 @@ Temp.Fix_Ang();
 return Temp;
  }
 
-inline IMR_Attitude &IMR_Attitude::operator += (IMR_Attitude &A)
+inline IMR_Attitude &IMR_Attitude::operator += (const IMR_Attitude &A)
 {
 X += A.X;
 Y += A.Y;
@@ -93,7 +93,7 @@ Fix_Ang();
 return *this;
  }
 
-inline IMR_Attitude &IMR_Attitude::operator -= (IMR_Attitude &A)
+inline IMR_Attitude &IMR_Attitude::operator -= (const IMR_Attitude &A)
 {
 X -= A.X;
 Y -= A.Y;
@@ -8,7 +8,7 @@
  Description: Point primitive geometry module
  
 \****************************************************************/
-#include "IMR_Geom_Prim_Point.hpp"
+#include "imr_geom_prim_point.hpp"
 
 /***************************************************************************\
   Transforms a point using the specified matrix.
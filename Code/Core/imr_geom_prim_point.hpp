@@ -13,8 +13,8 @@
 #define __IMR_GEOM_PRIM_POINT__HPP
 
 #include <math.h>
-#include "IMR_Geom_Prim_UVI.hpp"
-#include "IMR_Matrix.hpp"
+#include "imr_geom_prim_uvi.hpp"
+#include "imr_matrix.hpp"
 
 // 3D point class:
 class IMR_3DPoint
@@ -35,6 +35,7 @@ class IMR_3DPoint
           {
           aX = aY = aZ = 0; 
           tX = tY = tZ = 0;
+          lX = lY = lZ = 0;
           wX = wY = wZ = 0;
           cX = cY = cZ = 0;
           iX = iY = iZ = 0;
@@ -66,14 +67,14 @@ class IMR_3DPoint
       inline void Set_Length(float L);
       inline int IsZero(void) { return (!X && !Y && !Z); };
       
-      inline int operator == (IMR_3DPoint &P);
-      inline int operator != (IMR_3DPoint &P);
-      inline void operator = (IMR_3DPoint &P);
-      inline IMR_3DPoint operator * (IMR_3DPoint &P);
-      inline IMR_3DPoint operator + (IMR_3DPoint &P);
-      inline IMR_3DPoint operator - (IMR_3DPoint &P);
-      inline IMR_3DPoint &operator += (IMR_3DPoint &P);
-      inline IMR_3DPoint &operator -= (IMR_3DPoint &P);
+      inline int operator == (const IMR_3DPoint &P);
+      inline int operator != (const IMR_3DPoint &P);
+      inline void operator = (const IMR_3DPoint &P);
+      inline IMR_3DPoint operator * (const IMR_3DPoint &P);
+      inline IMR_3DPoint operator + (const IMR_3DPoint &P);
+      inline IMR_3DPoint operator - (const IMR_3DPoint &P);
+      inline IMR_3DPoint &operator += (const IMR_3DPoint &P);
+      inline IMR_3DPoint &operator -= (const IMR_3DPoint &P);
       
       void Transform(IMR_Matrix &mtrx);
      };
@@ -83,7 +84,7 @@ class IMR_3DPoint
 \***************************************************************************/
 float inline IMR_3DPoint::Mag(void)
 {
-return sqrt((aX * aX) + (aY * aY) + (aZ * aZ));
+return IMR_Sqrt((aX * aX) + (aY * aY) + (aZ * aZ));
  }
 
 /***************************************************************************\
@@ -140,12 +141,12 @@ void inline IMR_3DPoint::Make_Unit(void)
 {
 float Length, InvLength = 0;
 
-// Find length of vector:
-Length = Mag();
+// Find squared length of vector:
+Length = (aX * aX) + (aY * aY) + (aZ * aZ);
 
 // Avoid a devide-by-zero:
-if (Length) 
-    InvLength = 1 / Length;
+if (Length > 0) 
+    InvLength = IMR_RSqrt(Length);
 
 // Devide everything by the length of the vector:
 if (InvLength)
@@ -163,12 +164,12 @@ void inline IMR_3DPoint::Set_Length(float L)
 {
 float Length, InvLength = 0;
 
-// Find length of vector:
-Length = Mag();
+// Find squared length of vector:
+Length = (aX * aX) + (aY * aY) + (aZ * aZ);
 
 // Avoid a devide-by-zero:
-if (Length) 
-    InvLength = (1 / Length) * L;
+if (Length > 0) 
+    InvLength = IMR_RSqrt(Length) * L;
 
 // Devide everything by the length of the vector and mult by new length:
 if (InvLength)
@@ -182,21 +183,21 @@ if (InvLength)
 /***************************************************************************\
   Overloaded operators.
 \***************************************************************************/
-inline int IMR_3DPoint::operator == (IMR_3DPoint &P)
+inline int IMR_3DPoint::operator == (const IMR_3DPoint &P)
 {
 int RValue = 0;
 if (P.aX == aX && P.aY == aY && P.aZ == aZ) RValue = 1;
 return RValue;
  }
 
-inline int IMR_3DPoint::operator != (IMR_3DPoint &P)
+inline int IMR_3DPoint::operator != (const IMR_3DPoint &P)
 {
 int RValue = 0;
 if ((P.aX != aX) || (P.aY != aY) || (P.aZ != aZ)) RValue = 1;
 return RValue;
  }
 
-inline void IMR_3DPoint::operator = (IMR_3DPoint &P)
+inline void IMR_3DPoint::operator = (const IMR_3DPoint &P)
 {
 aX = P.aX;
 aY = P.aY;
@@ -220,7 +221,7 @@ IsNormal = P.IsNormal;
 IsSkybox = P.IsSkybox;
  }
 
-inline IMR_3DPoint IMR_3DPoint::operator * (IMR_3DPoint &P)
+inline IMR_3DPoint IMR_3DPoint::operator * (const IMR_3DPoint &P)
 {
 IMR_3DPoint Temp;
 Temp.X = aX * P.aX;
@@ -229,7 +230,7 @@ Temp.Z = aZ * P.aZ;
 return Temp;
  }
 
-inline IMR_3DPoint IMR_3DPoint::operator + (IMR_3DPoint &P)
+inline IMR_3DPoint IMR_3DPoint::operator + (const IMR_3DPoint &P)
 {
 IMR_3DPoint Temp;
 Temp.X = aX + P.aX;
@@ -238,7 +239,7 @@ Temp.Z = aZ + P.aZ;
 return Temp;
  }
 
-inline IMR_3DPoint IMR_3DPoint::operator - (IMR_3DPoint &P)
+inline IMR_3DPoint IMR_3DPoint::operator - (const IMR_3DPoint &P)
 {
 IMR_3DPoint Temp;
 Temp.X = aX - P.aX;
@@ -247,7 +248,7 @@ Temp.Z = aZ - P.aZ;
 return Temp;
  }
 
-inline IMR_3DPoint &IMR_3DPoint::operator += (IMR_3DPoint &P)
+inline IMR_3DPoint &IMR_3DPoint::operator += (const IMR_3DPoint &P)
 {
 aX += P.aX;
 aY += P.aY;
@@ -255,7 +256,7 @@ aZ += P.aZ;
 return *this;
  }
 
-inline IMR_3DPoint &IMR_3DPoint::operator -= (IMR_3DPoint &P)
+inline IMR_3DPoint &IMR_3DPoint::operator -= (const IMR_3DPoint &P)
 {
 aX -= P.aX;
 aY -= P.aY;
@@ -274,7 +275,7 @@ class IMR_PrjPoint
       int pR, pG, pB;               // Projected color
       IMR_PrjPoint() { pX = pY = pZ = pU = pV = 0.0; pR = pG = pB = 0; };
       inline void Project(float Zoom, int XC, int YC);
-      inline void operator = (IMR_3DPoint &P);
+      inline void operator = (const IMR_3DPoint &P);
       inline void operator = (IMR_UVIInfo &U);
       inline void operator = (IMR_PrjPoint &P);
     };
@@ -291,7 +292,7 @@ pZ = Z;
  }
 
 // Overloaded assignment operator:
-inline void IMR_PrjPoint::operator = (IMR_3DPoint &P)
+inline void IMR_PrjPoint::operator = (const IMR_3DPoint &P)
 {
 X = P.cX;
 Y = P.cY;
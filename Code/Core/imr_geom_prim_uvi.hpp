@@ -17,7 +17,8 @@ class IMR_UVIInfo
     public:
       float U, V;
       float I, R, G, B;
-      IMR_UVIInfo() { U = V = I = R = G = B = 0; };
+      float LU, LV;                 // Lightmap coords (set when baked lighting is loaded)
+      IMR_UVIInfo() { U = V = I = R = G = B = LU = LV = 0; };
      };
 
 #endif
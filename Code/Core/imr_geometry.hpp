@@ -12,11 +12,11 @@
 #define __IMR_GEOMETRY__HPP
 
 // Include all the headers for the various geometries:
-#include "IMR_Geom_Object.hpp"
-#include "IMR_Geom_Model.hpp"
-#include "IMR_Geom_Light.hpp"
-#include "IMR_Geom_Poly.hpp"
-#include "IMR_Geom_Prim.hpp"
+#include "imr_geom_object.hpp"
+#include "imr_geom_model.hpp"
+#include "imr_geom_light.hpp"
+#include "imr_geom_poly.hpp"
+#include "imr_geom_prim.hpp"
 
 #endif
 
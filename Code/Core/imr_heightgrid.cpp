@@ -0,0 +1,321 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_HeightGrid.cpp
+ Description: Height grid module.  Answers "where's the floor
+              under this point" without running the collision
+              code, by keeping the floor triangles of the static
+              geometry in a grid over X and Z.  The grid is a
+              snapshot, so it has to be built again if the
+              geometry moves.
+
+\****************************************************************/
+#include "imr_heightgrid.hpp"
+
+/***************************************************************************\
+  Frees all memory used by the grid.
+\***************************************************************************/
+void IMR_HeightGrid::Reset(void)
+{
+if (CellStart) free(CellStart);
+if (CellTris) free(CellTris);
+if (Tris) free(Tris);
+CellStart = CellTris = NULL;
+Tris = NULL;
+Num_Tris = Max_Tris = Num_X = Num_Z = 0;
+ }
+
+/***************************************************************************\
+  Counts the triangles in the collidable models of the specified object
+  and it's children.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_HeightGrid::Count_Tris(IMR_Object *Obj)
+{
+IMR_CollideMesh *Mesh;
+int Count = 0;
+
+if (Obj->Get_Model() && Obj->Is_Collidable() && (Mesh = Obj->Get_Model()->Get_CollideMesh()))
+    Count += Mesh->Get_Num_Tris();
+for (int child = 0; child < Obj->Get_Num_Children(); child ++)
+    if (Obj->Get_Child(child)) Count += Count_Tris(Obj->Get_Child(child));
+return Count;
+ }
+
+/***************************************************************************\
+  Adds the upward facing triangles in the collidable models of the
+  specified object and it's children (in global coords).
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_HeightGrid::Add_Tris(IMR_Object *Obj)
+{
+IMR_CollideMesh *Mesh;
+IMR_HeightTri *Tri;
+IMR_Matrix Rot;
+IMR_3DPoint Pos;
+float Corner[3][3], Local[3], N[3], Det;
+int tri, vtx, c;
+
+if (Obj->Get_Model() && Obj->Is_Collidable() && (Mesh = Obj->Get_Model()->Get_CollideMesh()))
+    {
+    Rot = Obj->Get_RotMatrix();
+    Pos = Obj->Get_GlobalPos();
+    for (tri = 0; tri < Mesh->Get_Num_Tris() && Num_Tris < Max_Tris; tri ++)
+        {
+        // Turn the normal, and skip the triangle if it doesn't face up:
+        for (c = 0; c < 3; c ++)
+            N[c] = (Mesh->Nx[tri] * Rot.Mtrx[0][c]) + (Mesh->Ny[tri] * Rot.Mtrx[1][c]) + (Mesh->Nz[tri] * Rot.Mtrx[2][c]);
+        if (N[1] < IMR_HEIGHTGRID_MINUP) continue;
+
+        // Find the corners in global coords:
+        for (vtx = 0; vtx < 3; vtx ++)
+            {
+            Local[0] = Mesh->Ax[tri];
+            Local[1] = Mesh->Ay[tri];
+            Local[2] = Mesh->Az[tri];
+            if (vtx == 1) { Local[0] += Mesh->E1x[tri]; Local[1] += Mesh->E1y[tri]; Local[2] += Mesh->E1z[tri]; }
+            if (vtx == 2) { Local[0] += Mesh->E2x[tri]; Local[1] += Mesh->E2y[tri]; Local[2] += Mesh->E2z[tri]; }
+            for (c = 0; c < 3; c ++)
+                Corner[vtx][c] = (Local[0] * Rot.Mtrx[0][c]) + (Local[1] * Rot.Mtrx[1][c]) + (Local[2] * Rot.Mtrx[2][c]) + (&Pos.X)[c];
+             }
+
+        // Skip it if it has no area from above:
+        Tri = &Tris[Num_Tris];
+        Tri->Ax = Corner[0][0];
+        Tri->Az = Corner[0][2];
+        Tri->E1x = Corner[1][0] - Corner[0][0];
+        Tri->E1z = Corner[1][2] - Corner[0][2];
+        Tri->E2x = Corner[2][0] - Corner[0][0];
+        Tri->E2z = Corner[2][2] - Corner[0][2];
+        Det = (Tri->E1x * Tri->E2z) - (Tri->E1z * Tri->E2x);
+        if (Det > -1e-12f && Det < 1e-12f) continue;
+        Tri->InvDet = 1.0f / Det;
+
+        // Find the plane as a height over X and Z:
+        Tri->Nx = N[0]; Tri->Ny = N[1]; Tri->Nz = N[2];
+        Tri->Hx = -N[0] / N[1];
+        Tri->Hz = -N[2] / N[1];
+        Tri->H0 = Corner[0][1] - (Tri->Hx * Corner[0][0]) - (Tri->Hz * Corner[0][2]);
+        Tri->MaxY = Corner[0][1];
+        if (Corner[1][1] > Tri->MaxY) Tri->MaxY = Corner[1][1];
+        if (Corner[2][1] > Tri->MaxY) Tri->MaxY = Corner[2][1];
+        ++ Num_Tris;
+         }
+     }
+
+// Now add the kiddies:
+for (int child = 0; child < Obj->Get_Num_Children(); child ++)
+    if (Obj->Get_Child(child)) Add_Tris(Obj->Get_Child(child));
+ }
+
+/***************************************************************************\
+  Finds the cells covered by the specified triangle's box.
+  Notes: Protected member function.
+  Returns the number of cells.
+\***************************************************************************/
+inline int IMR_HeightGrid::Get_CellRange(IMR_HeightTri &Tri, int *CMin, int *CMax)
+{
+float Lo[2], Hi[2], V;
+int c;
+
+Lo[0] = Hi[0] = Tri.Ax;
+Lo[1] = Hi[1] = Tri.Az;
+V = Tri.Ax + Tri.E1x; if (V < Lo[0]) Lo[0] = V; if (V > Hi[0]) Hi[0] = V;
+V = Tri.Ax + Tri.E2x; if (V < Lo[0]) Lo[0] = V; if (V > Hi[0]) Hi[0] = V;
+V = Tri.Az + Tri.E1z; if (V < Lo[1]) Lo[1] = V; if (V > Hi[1]) Hi[1] = V;
+V = Tri.Az + Tri.E2z; if (V < Lo[1]) Lo[1] = V; if (V > Hi[1]) Hi[1] = V;
+for (c = 0; c < 2; c ++)
+    {
+    CMin[c] = (int)((Lo[c] - (c ? MinZ : MinX)) * Inv_CellSize);
+    CMax[c] = (int)((Hi[c] - (c ? MinZ : MinX)) * Inv_CellSize);
+    if (CMin[c] < 0) CMin[c] = 0;
+    if (CMax[c] > (c ? Num_Z : Num_X) - 1) CMax[c] = (c ? Num_Z : Num_X) - 1;
+     }
+return (CMax[0] - CMin[0] + 1) * (CMax[1] - CMin[1] + 1);
+ }
+
+/***************************************************************************\
+  Builds the grid from the upward facing triangles of the collidable
+  models in the specified object and it's children, as they are now.
+  Cells should be about as big as a typical floor triangle.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_HeightGrid::Build(IMR_Object *Environ, float NewCellSize)
+{
+float MaxX, MaxZ, V;
+int CMin[2], CMax[2], tri, X, Z, Cells, Total, Cell;
+
+// Get rid of the old grid:
+Reset();
+
+// Check the params:
+if (!Environ || NewCellSize <= 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_HeightGrid::Build(): Invalid params! (%f)", NewCellSize);
+    return IMRERR_GENERIC;
+     }
+CellSize = NewCellSize;
+Inv_CellSize = 1.0f / NewCellSize;
+
+// Gather the floor triangles:
+Max_Tris = Count_Tris(Environ);
+if (!Max_Tris)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_HeightGrid::Build(): No collidable geometry!");
+    return IMRERR_NODATA;
+     }
+if (!(Tris = (IMR_HeightTri *)malloc(sizeof(IMR_HeightTri) * Max_Tris)))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_HeightGrid::Build(): Out of memory! (%d)", Max_Tris);
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+Add_Tris(Environ);
+if (!Num_Tris)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_HeightGrid::Build(): No floor triangles!");
+    Reset();
+    return IMRERR_NODATA;
+     }
+
+// Find the area they cover:
+MinX = MaxX = Tris[0].Ax;
+MinZ = MaxZ = Tris[0].Az;
+for (tri = 0; tri < Num_Tris; tri ++)
+    {
+    V = Tris[tri].Ax;                   if (V < MinX) MinX = V; if (V > MaxX) MaxX = V;
+    V = Tris[tri].Ax + Tris[tri].E1x;   if (V < MinX) MinX = V; if (V > MaxX) MaxX = V;
+    V = Tris[tri].Ax + Tris[tri].E2x;   if (V < MinX) MinX = V; if (V > MaxX) MaxX = V;
+    V = Tris[tri].Az;                   if (V < MinZ) MinZ = V; if (V > MaxZ) MaxZ = V;
+    V = Tris[tri].Az + Tris[tri].E1z;   if (V < MinZ) MinZ = V; if (V > MaxZ) MaxZ = V;
+    V = Tris[tri].Az + Tris[tri].E2z;   if (V < MinZ) MinZ = V; if (V > MaxZ) MaxZ = V;
+     }
+Num_X = (int)((MaxX - MinX) * Inv_CellSize) + 1;
+Num_Z = (int)((MaxZ - MinZ) * Inv_CellSize) + 1;
+if ((float)Num_X * (float)Num_Z > (float)IMR_HEIGHTGRID_MAXCELLS)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_HeightGrid::Build(): Too many cells! (%d x %d)", Num_X, Num_Z);
+    Reset();
+    return IMRERR_TOMANY;
+     }
+Cells = Num_X * Num_Z;
+
+// Count the triangles in each cell:
+if (!(CellStart = (int *)malloc(sizeof(int) * (Cells + 1))))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_HeightGrid::Build(): Out of memory! (%d)", Cells);
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+memset(CellStart, 0, sizeof(int) * (Cells + 1));
+Total = 0;
+for (tri = 0; tri < Num_Tris; tri ++)
+    {
+    Total += Get_CellRange(Tris[tri], CMin, CMax);
+    for (Z = CMin[1]; Z <= CMax[1]; Z ++)
+        for (X = CMin[0]; X <= CMax[0]; X ++)
+            ++ CellStart[(Z * Num_X) + X + 1];
+     }
+
+// Turn the counts into starting points and fill in the cells:
+for (Cell = 0; Cell < Cells; Cell ++)
+    CellStart[Cell + 1] += CellStart[Cell];
+if (!(CellTris = (int *)malloc(sizeof(int) * Total)))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_HeightGrid::Build(): Out of memory! (%d)", Total);
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+for (tri = 0; tri < Num_Tris; tri ++)
+    {
+    Get_CellRange(Tris[tri], CMin, CMax);
+    for (Z = CMin[1]; Z <= CMax[1]; Z ++)
+        for (X = CMin[0]; X <= CMax[0]; X ++)
+            CellTris[CellStart[(Z * Num_X) + X] ++] = tri;
+     }
+
+// Filling them moved each start to the next cell's, so move them back:
+for (Cell = Cells; Cell > 0; Cell --)
+    CellStart[Cell] = CellStart[Cell - 1];
+CellStart[0] = 0;
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Finds the highest floor at or below the specified point (global coords),
+  and it's unit normal (if Normal isn't NULL).
+  Returns true if there's a floor, false if not.
+\***************************************************************************/
+int IMR_HeightGrid::Get_Floor(float X, float Y, float Z, float *Height, IMR_3DPoint *Normal)
+{
+IMR_HeightTri *Tri, *Best;
+float dX, dZ, u, v, Tol, H, BestH;
+int CX, CZ, Cell, index;
+
+// Find the cell:
+if (!CellStart) return 0;
+dX = (X - MinX) * Inv_CellSize;
+dZ = (Z - MinZ) * Inv_CellSize;
+if (dX < 0 || dZ < 0) return 0;
+CX = (int)dX;
+CZ = (int)dZ;
+if (CX >= Num_X || CZ >= Num_Z) return 0;
+Cell = (CZ * Num_X) + CX;
+
+// Check each triangle in it:
+Best = NULL;
+BestH = 0;
+for (index = CellStart[Cell]; index < CellStart[Cell + 1]; index ++)
+    {
+    Tri = &Tris[CellTris[index]];
+
+    // Skip it if it can't be below the point or higher than the best:
+    if (Best && Tri->MaxY <= BestH) continue;
+
+    // Make sure the point is over the triangle:
+    dX = X - Tri->Ax;
+    dZ = Z - Tri->Az;
+    u = ((dX * Tri->E2z) - (dZ * Tri->E2x)) * Tri->InvDet;
+    v = ((dZ * Tri->E1x) - (dX * Tri->E1z)) * Tri->InvDet;
+    Tol = IMR_HEIGHTGRID_EDGETOL;
+    if (u < -Tol || v < -Tol || u + v > 1.0f + Tol) continue;
+
+    // Keep the highest one at or below the point:
+    H = Tri->H0 + (Tri->Hx * X) + (Tri->Hz * Z);
+    if (H > Y || (Best && H <= BestH)) continue;
+    Best = Tri;
+    BestH = H;
+     }
+
+// Return what we found:
+if (!Best) return 0;
+if (Height) *Height = BestH;
+if (Normal)
+    {
+    Normal->X = Best->Nx;
+    Normal->Y = Best->Ny;
+    Normal->Z = Best->Nz;
+     }
+return 1;
+ }
+
+/***************************************************************************\
+  Finds how steep the floor under the specified point is: how much it
+  rises for each unit moved along X and along Z.
+  Returns true if there's a floor, false if not.
+\***************************************************************************/
+int IMR_HeightGrid::Get_Slope(float X, float Y, float Z, float *SlopeX, float *SlopeZ)
+{
+IMR_3DPoint Normal;
+float Height;
+
+if (!Get_Floor(X, Y, Z, &Height, &Normal)) return 0;
+if (SlopeX) *SlopeX = -Normal.X / Normal.Y;
+if (SlopeZ) *SlopeZ = -Normal.Z / Normal.Y;
+return 1;
+ }
@@ -0,0 +1,80 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_HeightGrid.hpp
+ Description: Header
+
+\****************************************************************/
+#ifndef __IMR_HEIGHTGRID__HPP
+#define __IMR_HEIGHTGRID__HPP
+
+// Include headers:
+#include <stdlib.h>
+#include <math.h>
+#include "imr_geom_object.hpp"
+#include "imr_collidemesh.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
+
+// Constants:
+#define IMR_HEIGHTGRID_MINUP        0.1f        // Smallest Y of a triangle's normal for it to count as floor
+#define IMR_HEIGHTGRID_EDGETOL      0.0001f     // Tolerance of the point in triangle test (barycentric)
+#define IMR_HEIGHTGRID_MAXCELLS     (1 << 22)   // Largest grid that will be built
+
+// Floor triangle (global coords):
+struct IMR_HeightTri
+    {
+    float Ax, Az;               // First corner (X and Z)
+    float E1x, E1z, E2x, E2z;   // Edges from the first corner (X and Z)
+    float InvDet;               // 1 / the cross product of the edges
+    float H0, Hx, Hz;           // Height at X, Z is H0 + Hx * X + Hz * Z
+    float Nx, Ny, Nz;           // Unit normal
+    float MaxY;                 // Highest corner
+     };
+
+// Height grid class.  Keeps the upward facing triangles of the collidable
+// models in an object tree in a 2D grid over X and Z, so the floor under a
+// point can be found by checking the few triangles in one cell:
+class IMR_HeightGrid
+    {
+    protected:
+      float MinX, MinZ, CellSize, Inv_CellSize;
+      int Num_X, Num_Z;
+      int *CellStart;               // First entry of each cell in CellTris (Num_X * Num_Z + 1)
+      int *CellTris;                // Triangles in each cell
+      IMR_HeightTri *Tris;
+      int Num_Tris, Max_Tris;
+
+      // Protected member functions:
+      int Count_Tris(IMR_Object *Obj);
+      void Add_Tris(IMR_Object *Obj);
+      inline int Get_CellRange(IMR_HeightTri &Tri, int *CMin, int *CMax);
+
+    public:
+      IMR_HeightGrid()
+          {
+          CellStart = CellTris = NULL;
+          Tris = NULL;
+          Num_Tris = Max_Tris = Num_X = Num_Z = 0;
+          MinX = MinZ = CellSize = Inv_CellSize = 0;
+           };
+      ~IMR_HeightGrid() { Reset(); };
+
+      // Init and de-init methods:
+      int Build(IMR_Object *Environ, float NewCellSize);
+      void Reset(void);
+
+      // Query methods:
+      int Get_Floor(float X, float Y, float Z, float *Height, IMR_3DPoint *Normal);
+      int Get_Slope(float X, float Y, float Z, float *SlopeX, float *SlopeZ);
+      inline int Get_Height(float X, float Y, float Z, float *Height) { return Get_Floor(X, Y, Z, Height, NULL); };
+
+      // Info methods:
+      inline int Get_Num_Tris(void) { return Num_Tris; };
+      inline float Get_CellSize(void) { return CellSize; };
+     };
+
+#endif
@@ -0,0 +1,439 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_Hierarchy.cpp
+ Description: Hierarchy module.  Keeps the transforms of an
+              object tree in one array, in parent before child
+              order, so updating them is a pass down the array
+              rather than a walk through the objects.
+
+\****************************************************************/
+#include "imr_hierarchy.hpp"
+#include "imr_geom_object.hpp"
+
+/***************************************************************************\
+  Frees all memory used by the hierarchy and lets go of the objects in it
+  (they go back to updating themselves).
+\***************************************************************************/
+void IMR_Hierarchy::Reset(void)
+{
+int node;
+
+for (node = 0; node < Num_Nodes; node ++)
+    if (Objects[node])
+        {
+        Objects[node]->Hier = NULL;
+        Objects[node]->Dirty = Objects[node]->Pending = 1;
+         }
+if (Objects) free(Objects);
+if (Nodes) free(Nodes);
+if (Rots) free(Rots);
+if (LocalRots) free(LocalRots);
+if (Boxes) free(Boxes);
+if (NextNamed) free(NextNamed);
+Names.Reset();
+Objects = NULL;
+Nodes = NULL;
+Rots = NULL;
+LocalRots = NULL;
+Boxes = NULL;
+NextNamed = NULL;
+Names_Build = -1;
+Root = NULL;
+Num_Nodes = Max_Nodes = 0;
+Pending = Invalid = 0;
+ }
+
+/***************************************************************************\
+  Counts the specified object and it's children.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Hierarchy::Count_Nodes(IMR_Object *Obj)
+{
+IMR_Object **Children = Obj->Get_ChildList();
+int Count = 1;
+
+for (int child = 0; child < Obj->Num_Children; child ++)
+    if (Children[child]) Count += Count_Nodes(Children[child]);
+return Count;
+ }
+
+/***************************************************************************\
+  Adds nodes for the specified object and it's children (parents first).
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Hierarchy::Add_Nodes(IMR_Object *Obj, int ParentIndex)
+{
+int Index = Num_Nodes ++;
+
+// Add the object:
+Objects[Index] = Obj;
+Nodes[Index].RPos[0] = Obj->RPos.X;
+Nodes[Index].RPos[1] = Obj->RPos.Y;
+Nodes[Index].RPos[2] = Obj->RPos.Z;
+Nodes[Index].RAtd[0] = Obj->RAtd.X & IMR_DEGREEAND;
+Nodes[Index].RAtd[1] = Obj->RAtd.Y & IMR_DEGREEAND;
+Nodes[Index].RAtd[2] = Obj->RAtd.Z & IMR_DEGREEAND;
+Nodes[Index].Parent = ParentIndex;
+Nodes[Index].Flags = IMR_HIERARCHY_DIRTY | IMR_HIERARCHY_TURNED;
+Obj->Hier = this;
+Obj->HierIndex = Index;
+Set_Model(Index, Obj->AttachedModel);
+
+// And it's kiddies:
+IMR_Object **Children = Obj->Get_ChildList();
+for (int child = 0; child < Obj->Num_Children; child ++)
+    if (Children[child]) Add_Nodes(Children[child], Index);
+Nodes[Index].End = Num_Nodes;
+ }
+
+/***************************************************************************\
+  Makes the nodes again from the tree under the root.  Every node is
+  marked dirty, so they're all updated next time.
+  Notes: Protected member function.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Hierarchy::Flatten(void)
+{
+IMR_HierarchyNode *NewNodes;
+IMR_Matrix *NewRots;
+IMR_HierarchyBox *NewBoxes;
+IMR_Object **NewObjects;
+int *NewNamed;
+int node, Count;
+
+// Let go of the old objects (some may not be in the tree anymore):
+for (node = 0; node < Num_Nodes; node ++)
+    if (Objects[node])
+        {
+        Objects[node]->Hier = NULL;
+        Objects[node]->Dirty = Objects[node]->Pending = 1;
+         }
+Num_Nodes = 0;
+Invalid = 0;
+if (!Root) return IMR_OK;
+
+// Make room:
+Count = Count_Nodes(Root);
+if (Count > Max_Nodes)
+    {
+    if (!(NewNodes = (IMR_HierarchyNode *)realloc(Nodes, sizeof(IMR_HierarchyNode) * Count)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Flatten(): Out of memory! (%d)", Count);
+        return IMRERR_OUTOFMEM;
+         }
+    Nodes = NewNodes;
+    if (!(NewRots = (IMR_Matrix *)realloc(Rots, sizeof(IMR_Matrix) * Count)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Flatten(): Out of memory! (%d)", Count);
+        return IMRERR_OUTOFMEM;
+         }
+    Rots = NewRots;
+    if (!(NewRots = (IMR_Matrix *)realloc(LocalRots, sizeof(IMR_Matrix) * Count)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Flatten(): Out of memory! (%d)", Count);
+        return IMRERR_OUTOFMEM;
+         }
+    LocalRots = NewRots;
+    if (!(NewBoxes = (IMR_HierarchyBox *)realloc(Boxes, sizeof(IMR_HierarchyBox) * Count)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Flatten(): Out of memory! (%d)", Count);
+        return IMRERR_OUTOFMEM;
+         }
+    Boxes = NewBoxes;
+    if (!(NewObjects = (IMR_Object **)realloc(Objects, sizeof(IMR_Object *) * Count)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Flatten(): Out of memory! (%d)", Count);
+        return IMRERR_OUTOFMEM;
+         }
+    Objects = NewObjects;
+    if (!(NewNamed = (int *)realloc(NextNamed, sizeof(int) * Count)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Flatten(): Out of memory! (%d)", Count);
+        return IMRERR_OUTOFMEM;
+         }
+    NextNamed = NewNamed;
+    Max_Nodes = Count;
+     }
+
+// And add everything:
+Add_Nodes(Root, -1);
+Pending = 1;
+++ Num_Builds;
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Builds the hierarchy for the tree under the specified object (which
+  must be the top of it's tree) and finds everything's globals.  The
+  objects in the tree send their changes here from then on, and adding or
+  removing objects just makes the nodes get made again on the next update.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Hierarchy::Build(IMR_Object *NewRoot)
+{
+int err;
+
+// Get rid of the old one:
+Reset();
+
+// Make sure we have a root:
+if (!NewRoot || NewRoot->Parent)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Build(): Root must be the top of a tree!");
+    return IMRERR_NODATA;
+     }
+Root = NewRoot;
+
+// Make the nodes and update them:
+err = Flatten(); if (IMR_ISNOTOK(err)) return err;
+Update_Nodes();
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Takes the object at the specified node out (when it's reset).  The
+  nodes are made again on the next update.
+\***************************************************************************/
+void IMR_Hierarchy::Remove(int Index)
+{
+if (Index < 0 || Index >= Num_Nodes) return;
+if (Objects[Index] == Root) Root = NULL;
+Objects[Index] = NULL;
+Invalid = 1;
+ }
+
+/***************************************************************************\
+  Keeps the box of the specified model (or none if it's NULL) for the
+  specified node.  Called when the object's model changes.
+\***************************************************************************/
+void IMR_Hierarchy::Set_Model(int Index, IMR_Model *Mdl)
+{
+IMR_HierarchyBox *Box = &Boxes[Index];
+
+Box->HasModel = 0;
+if (!Mdl || !Mdl->Num_Polygons) return;
+for (int c = 0; c < 3; c ++)
+    {
+    Box->Center[c] = (Mdl->BoundMin[c] + Mdl->BoundMax[c]) * 0.5f;
+    Box->Extent[c] = (Mdl->BoundMax[c] - Mdl->BoundMin[c]) * 0.5f;
+     }
+Box->HasModel = 1;
+ }
+
+/***************************************************************************\
+  Finds the box around the model of the specified node (which has just
+  moved), the same way IMR_Object::Find_Bounds() does.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Hierarchy::Find_ModelBox(int Index)
+{
+IMR_HierarchyBox *Box = &Boxes[Index];
+IMR_Matrix *Rot = &Rots[Index];
+float Mid, Half;
+int c;
+
+if (!Box->HasModel) return;
+for (c = 0; c < 3; c ++)
+    {
+    Mid = (Box->Center[0] * Rot->Mtrx[0][c]) + (Box->Center[1] * Rot->Mtrx[1][c]) + (Box->Center[2] * Rot->Mtrx[2][c]) + Nodes[Index].GPos[c];
+    Half = (Box->Extent[0] * fabs(Rot->Mtrx[0][c])) + (Box->Extent[1] * fabs(Rot->Mtrx[1][c])) + (Box->Extent[2] * fabs(Rot->Mtrx[2][c]));
+    Box->ModelMin[c] = Mid - Half;
+    Box->ModelMax[c] = Mid + Half;
+     }
+ }
+
+/***************************************************************************\
+  Finds the globals of each dirty node and each node under one in a
+  single pass down the array (parents are always done before their
+  children), then finds the bounds and hands everything back to the
+  objects in a pass back up it (each child adds it's box to it's parent's
+  before the parent is done).
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Hierarchy::Update_Nodes(void)
+{
+IMR_HierarchyNode *Node, *Parent;
+IMR_HierarchyBox *Box, *ParentBox;
+IMR_Matrix *Rot;
+IMR_Object *Obj;
+int node, c;
+
+// Make the nodes again if the tree changed:
+if (Invalid) Flatten();
+Pending = 0;
+
+// Find the globals, and start the boxes that need finding with the models:
+for (node = 0; node < Num_Nodes; node ++)
+    {
+    Node = &Nodes[node];
+    Parent = Node->Parent >= 0 ? &Nodes[Node->Parent] : NULL;
+    if ((Node->Flags & IMR_HIERARCHY_DIRTY) || (Parent && (Parent->Flags & IMR_HIERARCHY_MOVED)))
+        {
+        if (Node->Flags & IMR_HIERARCHY_TURNED)
+            LocalRots[node].Rotate(Node->RAtd[0], Node->RAtd[1], Node->RAtd[2]);
+        if (Parent)
+            {
+            Rot = &Rots[Node->Parent];
+            Rots[node].Merge_Rotations(LocalRots[node].Mtrx, Rot->Mtrx);
+            for (c = 0; c < 3; c ++)
+                Node->GPos[c] = ((Node->RPos[0] * Rot->Mtrx[0][c]) + (Node->RPos[1] * Rot->Mtrx[1][c]) + 
+                                 (Node->RPos[2] * Rot->Mtrx[2][c]) + Rot->Mtrx[3][c]) + Parent->GPos[c];
+             }
+        else
+            {
+            Rots[node] = LocalRots[node];
+            Node->GPos[0] = Node->RPos[0]; Node->GPos[1] = Node->RPos[1]; Node->GPos[2] = Node->RPos[2];
+             }
+        Node->Flags |= IMR_HIERARCHY_MOVED;
+        Find_ModelBox(node);
+         }
+    if (!(Node->Flags & IMR_HIERARCHY_UPDATE)) continue;
+    Box = &Boxes[node];
+    for (c = 0; c < 3; c ++)
+        {
+        Box->Min[c] = Box->ModelMin[c];
+        Box->Max[c] = Box->ModelMax[c];
+         }
+    Box->Has = Box->HasModel;
+     }
+
+// Finish the boxes and hand everything back (children before parents):
+for (node = Num_Nodes - 1; node >= 0; node --)
+    {
+    Node = &Nodes[node];
+    Box = &Boxes[node];
+
+    // Add our box to our parent's (if it's being found again):
+    if (Node->Parent >= 0 && Box->Has && (Nodes[Node->Parent].Flags & IMR_HIERARCHY_UPDATE))
+        {
+        ParentBox = &Boxes[Node->Parent];
+        for (c = 0; c < 3; c ++)
+            {
+            if (!ParentBox->Has || Box->Min[c] < ParentBox->Min[c]) ParentBox->Min[c] = Box->Min[c];
+            if (!ParentBox->Has || Box->Max[c] > ParentBox->Max[c]) ParentBox->Max[c] = Box->Max[c];
+             }
+        ParentBox->Has = 1;
+         }
+    if (!(Node->Flags & IMR_HIERARCHY_UPDATE)) continue;
+
+    // Hand back the globals (if we moved) and the bounds:
+    Obj = Objects[node];
+    if (Node->Flags & IMR_HIERARCHY_MOVED)
+        {
+        Obj->GPos.X = Node->GPos[0]; Obj->GPos.Y = Node->GPos[1]; Obj->GPos.Z = Node->GPos[2];
+        Obj->RotMtrx = Rots[node];
+        Obj->CollideCache.Invalidate();
+         }
+    for (c = 0; c < 3; c ++)
+        {
+        Obj->BoundMin[c] = Box->Min[c];
+        Obj->BoundMax[c] = Box->Max[c];
+         }
+    Obj->HasBounds = Box->Has;
+    Obj->Dirty = Obj->Pending = 0;
+    if (Obj->DynHash)
+        {
+        if (Box->Has) Obj->DynHash->Move(Obj->DynEntry, Box->Min, Box->Max);
+        else Obj->DynHash->Move(Obj->DynEntry, NULL, NULL);
+         }
+    if (Obj->Octree) Obj->Place_InOctree(Box->HasModel, Box->ModelMin, Box->ModelMax);
+    Node->Flags = 0;
+     }
+ }
+
+/***************************************************************************\
+  Indexes the names of the objects in the nodes.  Objects with the same
+  name are linked in node order, so a search can skip the ones outside of
+  the subtree it wants.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Hierarchy::Index_Names(void)
+{
+int node, named;
+
+Names.Clear();
+Names.Init(Num_Nodes);
+for (node = 0; node < Num_Nodes; node ++)
+    {
+    NextNamed[node] = -1;
+    if (Names.Add(Objects[node]->Get_Name(), node)) continue;
+
+    // The name's already there, so link this node after the last one with it:
+    if (!Names.Get(Objects[node]->Get_Name(), &named)) continue;
+    while (NextNamed[named] >= 0) named = NextNamed[named];
+    NextNamed[named] = node;
+     }
+Names_Build = Num_Builds;
+ }
+
+/***************************************************************************\
+  Returns a pointer to the first object with the specified name at or under
+  the specified node (going down the tree the way IMR_Object::Get_Child()
+  does), or NULL if there isn't one.  The names are indexed again after
+  the nodes are made again (which renaming an object causes), so call
+  Update() first.
+\***************************************************************************/
+IMR_Object *IMR_Hierarchy::Find_Object(char *Name, int Index)
+{
+int node;
+
+// Make sure the names are current:
+if (Index < 0 || Index >= Num_Nodes) return NULL;
+if (Names_Build != Num_Builds) Index_Names();
+
+// Look the name up, and skip the objects with it that come before the node:
+if (!Names.Get(Name, &node)) return NULL;
+while (node >= 0 && node < Index) node = NextNamed[node];
+if (node < 0 || node >= Nodes[Index].End) return NULL;
+return Objects[node];
+ }
+
+#ifdef IMR_DEBUG
+/***************************************************************************\
+  Checks that the copies the object at the specified node keeps (globals,
+  rotation and bounds) match the node.  Only Update_Nodes() should ever
+  write them, so a mismatch means something else did.
+  Returns IMR_OK if they match, otherwise an error.
+\***************************************************************************/
+int IMR_Hierarchy::Check_Sync(int Index)
+{
+IMR_HierarchyNode *Node;
+IMR_HierarchyBox *Box;
+IMR_Object *Obj;
+int c;
+
+if (Pending || Invalid || Index < 0 || Index >= Num_Nodes || !Objects[Index]) return IMR_OK;
+Node = &Nodes[Index];
+Box = &Boxes[Index];
+Obj = Objects[Index];
+
+// Check the globals and the rotation:
+if (Obj->GPos.X != Node->GPos[0] || Obj->GPos.Y != Node->GPos[1] || Obj->GPos.Z != Node->GPos[2] ||
+    memcmp(Obj->RotMtrx.Mtrx, Rots[Index].Mtrx, sizeof(Rots[Index].Mtrx)))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Check_Sync(): Globals of node %d out of sync!", Index);
+    return IMRERR_GENERIC;
+     }
+
+// And the bounds:
+if (Obj->HasBounds != Box->Has)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Check_Sync(): Bounds of node %d out of sync!", Index);
+    return IMRERR_GENERIC;
+     }
+if (Box->Has)
+    for (c = 0; c < 3; c ++)
+        if (Obj->BoundMin[c] != Box->Min[c] || Obj->BoundMax[c] != Box->Max[c])
+            {
+            IMR_LogMsg(__LINE__, __FILE__, "IMR_Hierarchy::Check_Sync(): Bounds of node %d out of sync!", Index);
+            return IMRERR_GENERIC;
+             }
+return IMR_OK;
+ }
+#endif
@@ -0,0 +1,149 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_Hierarchy.hpp
+ Description: Header
+
+\****************************************************************/
+#ifndef __IMR_HIERARCHY__HPP
+#define __IMR_HIERARCHY__HPP
+
+// Include headers:
+#include <stdlib.h>
+#include <math.h>
+#include "imr_geom_prim.hpp"
+#include "imr_matrix.hpp"
+#include "../Foundation/imr_namehash.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
+
+// Checks that an object's copies of it's node are current (debug builds):
+#ifdef IMR_DEBUG
+#include <assert.h>
+#define IMR_HIERARCHY_CHECKSYNC(Hier, Index) assert(!(Hier) || IMR_ISOK((Hier)->Check_Sync(Index)))
+#else
+#define IMR_HIERARCHY_CHECKSYNC(Hier, Index)
+#endif
+
+// Node flags:
+#define IMR_HIERARCHY_DIRTY         0x01    // Relative pos or atd changed
+#define IMR_HIERARCHY_MOVED         0x02    // Globals were found again this update
+#define IMR_HIERARCHY_CHILDMOVED    0x04    // Something under it moved (bounds need finding)
+#define IMR_HIERARCHY_TURNED        0x08    // Relative atd changed (local rotation needs making)
+#define IMR_HIERARCHY_UPDATE        (IMR_HIERARCHY_MOVED | IMR_HIERARCHY_CHILDMOVED)
+
+// Defined elsewhere:
+class IMR_Object;
+class IMR_Model;
+
+// Transforms of one object in the hierarchy (the rotation matrices are
+// kept in their own array, since most passes don't need them):
+struct IMR_HierarchyNode
+    {
+    float RPos[3], GPos[3];
+    int RAtd[3];                // Relative atd (wrapped)
+    int Parent;                 // Index of the parent (-1 for the root)
+    int End;                    // Index after the last node under it
+    int Flags;
+     };
+
+// Bounding boxes of one object in the hierarchy (global coords):
+struct IMR_HierarchyBox
+    {
+    float Center[3], Extent[3];         // Box of the attached model (local coords)
+    float ModelMin[3], ModelMax[3];     // Box around the attached model
+    float Min[3], Max[3];               // Box around the model and the children
+    int HasModel, Has;
+     };
+
+// Hierarchy class.  Keeps the transforms of an object tree in one array
+// with parents before their children, so the globals can be found in a
+// single pass down the array instead of by walking the tree.  The objects
+// in it send their position and attitude changes here, and their global
+// getters read from the nodes.  The objects still keep copies of the
+// globals, rotation and bounds for the collision tree walks (which pass
+// them by reference for every model they visit); only Update_Nodes()
+// writes them:
+class IMR_Hierarchy
+    {
+    protected:
+      IMR_Object *Root;
+      IMR_Object **Objects;         // Object at each node
+      IMR_HierarchyNode *Nodes;
+      IMR_Matrix *Rots;             // Global rotation of each node
+      IMR_Matrix *LocalRots;        // Rotation made from each node's relative atd
+      IMR_HierarchyBox *Boxes;
+      IMR_NameHash<int> Names;      // First node with each name
+      int *NextNamed;               // Next node with the same name (-1 for none)
+      int Names_Build;              // Build the names were indexed for
+      int Num_Nodes, Max_Nodes;
+      int Pending;                  // Some node is dirty
+      int Invalid;                  // The tree changed, so the nodes must be made again
+      int Num_Builds;               // Times the nodes have been made
+
+      // Protected member functions:
+      int Count_Nodes(IMR_Object *Obj);
+      void Add_Nodes(IMR_Object *Obj, int ParentIndex);
+      int Flatten(void);
+      void Find_ModelBox(int Index);
+      void Update_Nodes(void);
+      void Index_Names(void);
+
+    public:
+      IMR_Hierarchy()
+          {
+          Root = NULL; Objects = NULL; Nodes = NULL; Rots = NULL; LocalRots = NULL; Boxes = NULL;
+          NextNamed = NULL; Names_Build = -1;
+          Num_Nodes = Max_Nodes = 0;
+          Pending = Invalid = Num_Builds = 0;
+           };
+      ~IMR_Hierarchy() { Reset(); };
+
+      // Init and de-init methods:
+      int Build(IMR_Object *NewRoot);
+      void Reset(void);
+
+      // Update methods:
+      inline void Update(void) { if (Pending || Invalid) Update_Nodes(); };
+      inline void Invalidate(void) { Invalid = 1; };
+      inline void Mark_Dirty(int Index, IMR_3DPoint &Pos, IMR_Attitude &Atd)
+          {
+          int X = Atd.X & IMR_DEGREEAND, Y = Atd.Y & IMR_DEGREEAND, Z = Atd.Z & IMR_DEGREEAND;
+          Nodes[Index].RPos[0] = Pos.X; Nodes[Index].RPos[1] = Pos.Y; Nodes[Index].RPos[2] = Pos.Z;
+          if (Nodes[Index].RAtd[0] != X || Nodes[Index].RAtd[1] != Y || Nodes[Index].RAtd[2] != Z)
+              {
+              Nodes[Index].RAtd[0] = X; Nodes[Index].RAtd[1] = Y; Nodes[Index].RAtd[2] = Z;
+              Nodes[Index].Flags |= IMR_HIERARCHY_TURNED;
+               }
+          Nodes[Index].Flags |= IMR_HIERARCHY_DIRTY;
+          for (int node = Nodes[Index].Parent; node >= 0 && !(Nodes[node].Flags & IMR_HIERARCHY_CHILDMOVED); node = Nodes[node].Parent)
+              Nodes[node].Flags |= IMR_HIERARCHY_CHILDMOVED;
+          Pending = 1;
+           };
+      void Remove(int Index);
+      void Set_Model(int Index, IMR_Model *Mdl);
+
+      // Node access methods (valid after Update()):
+      inline IMR_Object *Get_Root(void) { return Root; };
+      inline int Get_Num_Nodes(void) { return Num_Nodes; };
+      inline int Get_Num_Builds(void) { return Num_Builds; };
+      inline IMR_Object *Get_Object(int Index) { return Objects[Index]; };
+      inline int Get_Parent(int Index) { return Nodes[Index].Parent; };
+      inline float *Get_GlobalPos(int Index) { return Nodes[Index].GPos; };
+      inline IMR_Attitude Get_GlobalAtd(int Index)
+          {
+          IMR_Attitude Atd;
+          Rots[Index].Find_Angles(&Atd.X, &Atd.Y, &Atd.Z);
+          return Atd;
+           };
+      inline IMR_Matrix &Get_RotMatrix(int Index) { return Rots[Index]; };
+      IMR_Object *Find_Object(char *Name, int Index);
+      #ifdef IMR_DEBUG
+      int Check_Sync(int Index);
+      #endif
+     };
+
+#endif
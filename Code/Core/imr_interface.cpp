@@ -8,7 +8,7 @@
  Description: Immerse engine main interface module
  
 \****************************************************************/
-#include "IMR_Interface.hpp"
+#include "imr_interface.hpp"
 
 /***************************************************************************\
   Initializes the interface using the specified init structure.
@@ -134,10 +134,40 @@ if (!Flags.InFrame)
     return IMRERR_NONFATAL_NOTINFRAME;
      }
 
+// Find the coords of anything that's moved (once for the whole frame):
+Obj.ResolveCoords();
+
 // Add the object to the pipeline:
 return Pipeline.Add_Object(Obj);
  }
 
+/***************************************************************************\
+  Adds the objects in the specified scene octree that the camera might see.
+  The coords of everything in it must already be resolved.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Interface::Add_Scene(IMR_Octree &Scene)
+{
+// If we are in asynchronous mode, make sure we are done drawing:
+if (Flags.DrawAsynchronous && Pipeline.Async_IsDrawing())
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Interface::Add_Scene(): Still drawing!");
+    return IMRERR_NOTREADY;
+     }
+
+// Make sure we are in a frame:
+if (!Flags.InFrame)
+    {
+    #ifdef IMR_DEBUG
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Interface::Add_Scene(): Not in frame!");
+    #endif
+    return IMRERR_NONFATAL_NOTINFRAME;
+     }
+
+// Add what's in view to the pipeline:
+return Pipeline.Add_Scene(Scene);
+ }
+
 /***************************************************************************\
   Adds the specified model to the list.
   Returns IMR_OK if successful, otherwise an error.
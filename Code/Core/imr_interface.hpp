@@ -12,17 +12,17 @@
 
 // Include all the headers:
 #include <windows.h>
-#include "IMR_Table.hpp"
-#include "IMR_Geometry.hpp"
-#include "IMR_Camera.hpp"
-#include "IMR_Palette.hpp"
-#include "IMR_TexRef.hpp"
-#include "IMR_Pipeline.hpp"
-#include "IMR_Resource.hpp"
-#include "..\RendCore\DirectX6\IMR_Renderer.hpp"
-#include "..\Foundation\IMR_List.hpp"
-#include "..\Foundation\IMR_Time.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
+#include "imr_table.hpp"
+#include "imr_geometry.hpp"
+#include "imr_camera.hpp"
+#include "imr_palette.hpp"
+#include "imr_texref.hpp"
+#include "imr_pipeline.hpp"
+#include "imr_resource.hpp"
+#include "../RendCore/DirectX6/imr_renderer.hpp"
+#include "../Foundation/imr_list.hpp"
+#include "../Foundation/imr_time.hpp"
+#include "../CallStatus/imr_log.hpp"
 
 // Constants and macros:
 #define IMR_MAX_GLBTEX        64
@@ -97,6 +97,7 @@ class IMR_Interface
       int Begin_Frame(IMR_Camera &Cam);
       int Add_Model(IMR_Model &Mod, IMR_3DPoint &Pos, IMR_Attitude &Atd);
       int Add_Object(IMR_Object &Obj);
+      int Add_Scene(IMR_Octree &Scene);
       int Draw_Frame(void);
       int End_Frame(void);
       int Blit_Frame(void);
@@ -0,0 +1,801 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_LightBake.cpp
+ Description: Offline lightmap baker.  Finds the direct light
+              from every static light falling on each poly,
+              tracing shadow rays against the collidable
+              geometry, and saves the result in an RDF.  Baked
+              polys are skipped by the static lights at runtime.
+
+ RDF layout (after the usual type and resource name):
+   short  Version (IMR_LIGHTBAKE_VERSION)
+   short  Number of objects
+   For each object:
+     char[9] Object name
+     short   Number of polys
+     int     Number of vertices in it's model
+     For each poly:
+       short Width, Height
+       char  Number of vertices
+       float Lightmap origin, U axis and V axis (model coords)
+       RGB   Lighting at each vertex
+       RGB   Width * Height lumels
+
+\****************************************************************/
+#include "imr_lightbake.hpp"
+
+/***************************************************************************\
+  Transforms the local coords of the specified point into world coords.
+\***************************************************************************/
+static void IMR_LightBake_ToWorld(IMR_3DPoint &Src, IMR_Matrix &Rot, IMR_3DPoint &Pos, float *Dest)
+{
+for (int c = 0; c < 3; c ++)
+    Dest[c] = (Src.lX * Rot.Mtrx[0][c]) +
+              (Src.lY * Rot.Mtrx[1][c]) +
+              (Src.lZ * Rot.Mtrx[2][c]) + Rot.Mtrx[3][c];
+Dest[0] += Pos.X;
+Dest[1] += Pos.Y;
+Dest[2] += Pos.Z;
+ }
+
+/***************************************************************************\
+  Transforms the specified world coords into the local coords of an object
+  with the specified transform.  If Pos is NULL, only the rotation is
+  undone (for directions).
+\***************************************************************************/
+static void IMR_LightBake_ToLocal(float *Src, IMR_Matrix &Rot, IMR_3DPoint *Pos, float *Dest)
+{
+float P[3];
+
+P[0] = Src[0]; P[1] = Src[1]; P[2] = Src[2];
+if (Pos)
+    {
+    P[0] -= Pos->X + Rot.Mtrx[3][0];
+    P[1] -= Pos->Y + Rot.Mtrx[3][1];
+    P[2] -= Pos->Z + Rot.Mtrx[3][2];
+     }
+for (int r = 0; r < 3; r ++)
+    Dest[r] = (P[0] * Rot.Mtrx[r][0]) + (P[1] * Rot.Mtrx[r][1]) + (P[2] * Rot.Mtrx[r][2]);
+ }
+
+/***************************************************************************\
+  Writes the specified data to the file, unless an earlier write failed.
+  Ok is cleared if this write fails.
+\***************************************************************************/
+static void IMR_LightBake_Write(int fd, void *Data, int Size, int &Ok)
+{
+if (Ok && write(fd, Data, Size) != Size) Ok = 0;
+ }
+
+/***************************************************************************\
+  Reads the specified amount of data from the file, unless an earlier read
+  failed.  Ok is cleared if this read comes up short.
+\***************************************************************************/
+static void IMR_LightBake_Read(int fd, void *Data, int Size, int &Ok)
+{
+if (Ok && read(fd, Data, Size) != Size) Ok = 0;
+ }
+
+/***************************************************************************\
+  Frees all memory used by the baker.
+\***************************************************************************/
+void IMR_LightBaker::Reset(void)
+{
+// Free the lumels:
+if (Polys)
+    {
+    for (int index = 0; index < Num_Polys; index ++)
+        if (Polys[index].Lumels) free(Polys[index].Lumels);
+    free(Polys);
+     }
+
+// Free the lists:
+if (Entries) free(Entries);
+if (Occluders) free(Occluders);
+Occluder_BVH.Reset();
+Occluder_Mesh.Reset();
+Entries = NULL;
+Polys = NULL;
+Occluders = NULL;
+Num_Entries = Max_Entries = Num_Polys = Num_Occluders = Max_Occluders = Num_Lights = 0;
+ }
+
+/***************************************************************************\
+  Counts the objects, polys, and shadow casting triangles in the tree.
+\***************************************************************************/
+void IMR_LightBaker::Count(IMR_Object *Obj)
+{
+IMR_Model *Mdl;
+int poly;
+
+if ((Mdl = Obj->Get_Model()) && Mdl->Num_Polygons && !Mdl->Polygons[0].Flags.Skybox)
+    {
+    ++ Max_Entries;
+    Num_Polys += Mdl->Num_Polygons;
+    if (Obj->Is_Collidable())
+        for (poly = 0; poly < Mdl->Num_Polygons; poly ++)
+            Max_Occluders += Mdl->Polygons[poly].Num_Verts - 2;
+     }
+for (int index = 0; index < Obj->Get_Num_Children(); index ++)
+    if (Obj->Get_Child(index)) Count(Obj->Get_Child(index));
+ }
+
+/***************************************************************************\
+  Adds the specified triangle to the list of shadow casters.
+\***************************************************************************/
+void IMR_LightBaker::Add_Occluder(float *A, float *B, float *C)
+{
+float *Tri;
+int c;
+
+if (Num_Occluders >= Max_Occluders) return;
+Tri = &Occluders[(Num_Occluders ++) * 9];
+for (c = 0; c < 3; c ++)
+    {
+    Tri[c] = A[c];
+    Tri[3 + c] = B[c];
+    Tri[6 + c] = C[c];
+     }
+ }
+
+/***************************************************************************\
+  Collects the objects, lights, and shadow casters in the tree.
+  Note: Lights get their world pos and direction the same way the
+        pipeline finds them.
+\***************************************************************************/
+void IMR_LightBaker::Gather(IMR_Object *Obj)
+{
+IMR_Model *Mdl;
+IMR_Light *Lit;
+IMR_3DPoint Pos;
+IMR_Matrix Rot;
+float W[IMR_MAXPOLYVERTS][3];
+int index, poly, vtx;
+
+// Get the transform:
+Pos = Obj->Get_GlobalPos();
+Rot = Obj->Get_RotMatrix();
+
+// Add the static lights:
+for (index = 0; index < Obj->Get_Num_Lights(); index ++)
+    {
+    if (!(Lit = Obj->Get_Light(index)) || Lit->Is_Dynamic()) continue;
+    if (Num_Lights >= IMR_LIGHTBAKE_MAXLIGHTS)
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_LightBaker::Gather(): (NONFATAL) Too many lights!");
+        break;
+         }
+    Lights[Num_Lights ++] = Lit;
+    if (Lit->Get_Type() == IMR_LIGHT_POINT || Lit->Get_Type() == IMR_LIGHT_SPOT)
+        Lit->Get_WorldPos() = Lit->Get_Position() + Pos;
+    if (Lit->Get_Type() == IMR_LIGHT_CELESTIAL || Lit->Get_Type() == IMR_LIGHT_SPOT)
+        {
+        Lit->Get_WorldDirection() = Lit->Get_Direction();
+        Lit->Get_WorldDirection().Transform(Rot);
+         }
+     }
+
+// Add the model:
+if ((Mdl = Obj->Get_Model()) && Mdl->Num_Polygons && !Mdl->Polygons[0].Flags.Skybox)
+    {
+    // Add an entry (and point it's polys back at it):
+    Entries[Num_Entries].Obj = Obj;
+    Entries[Num_Entries].FirstPoly = (Num_Entries ? Entries[Num_Entries - 1].FirstPoly + Entries[Num_Entries - 1].Num_Polys : 0);
+    Entries[Num_Entries].Num_Polys = Mdl->Num_Polygons;
+    for (poly = 0; poly < Mdl->Num_Polygons; poly ++)
+        Polys[Entries[Num_Entries].FirstPoly + poly].Entry = Num_Entries;
+    ++ Num_Entries;
+
+    // Add the shadow casters (fanned into triangles):
+    if (Obj->Is_Collidable())
+        for (poly = 0; poly < Mdl->Num_Polygons; poly ++)
+            {
+            for (vtx = 0; vtx < Mdl->Polygons[poly].Num_Verts; vtx ++)
+                IMR_LightBake_ToWorld(Mdl->Vertices[Mdl->Polygons[poly].Vtx_Index[vtx]], Rot, Pos, W[vtx]);
+            for (vtx = 1; vtx < Mdl->Polygons[poly].Num_Verts - 1; vtx ++)
+                Add_Occluder(W[0], W[vtx], W[vtx + 1]);
+             }
+     }
+
+// Now do the kiddies:
+for (index = 0; index < Obj->Get_Num_Children(); index ++)
+    if (Obj->Get_Child(index)) Gather(Obj->Get_Child(index));
+ }
+
+// Shadow ray passed from IMR_LightBaker::Is_Occluded() to the tree query:
+struct IMR_LightBakeRay
+    {
+    IMR_CollideMesh *Mesh;
+    float *P, *Ray;
+    int Hit;
+     };
+
+/***************************************************************************\
+  Intersects the shadow ray with a triangle of the occluder mesh
+  (Moller-Trumbore).  Called by IMR_CollideBVH::Query_Ray().
+  Returns nonzero to stop the query (at the first hit).
+\***************************************************************************/
+static int IMR_LightBake_RayTriangle(void *Data, int Tri, float *MaxT)
+{
+IMR_LightBakeRay &Q = *(IMR_LightBakeRay *)Data;
+IMR_CollideMesh &M = *Q.Mesh;
+float h[3], s[3], q[3], a, f, u, v, t;
+
+// Find the determinant (zero if the ray is in the plane):
+h[0] = (Q.Ray[1] * M.E2z[Tri]) - (Q.Ray[2] * M.E2y[Tri]);
+h[1] = (Q.Ray[2] * M.E2x[Tri]) - (Q.Ray[0] * M.E2z[Tri]);
+h[2] = (Q.Ray[0] * M.E2y[Tri]) - (Q.Ray[1] * M.E2x[Tri]);
+a = (M.E1x[Tri] * h[0]) + (M.E1y[Tri] * h[1]) + (M.E1z[Tri] * h[2]);
+if (a > -1e-8f && a < 1e-8f) return 0;
+f = 1.0f / a;
+
+// Find the barycentric coords:
+s[0] = Q.P[0] - M.Ax[Tri];
+s[1] = Q.P[1] - M.Ay[Tri];
+s[2] = Q.P[2] - M.Az[Tri];
+u = f * ((s[0] * h[0]) + (s[1] * h[1]) + (s[2] * h[2]));
+if (u < 0.0f || u > 1.0f) return 0;
+q[0] = (s[1] * M.E1z[Tri]) - (s[2] * M.E1y[Tri]);
+q[1] = (s[2] * M.E1x[Tri]) - (s[0] * M.E1z[Tri]);
+q[2] = (s[0] * M.E1y[Tri]) - (s[1] * M.E1x[Tri]);
+v = f * ((Q.Ray[0] * q[0]) + (Q.Ray[1] * q[1]) + (Q.Ray[2] * q[2]));
+if (v < 0.0f || u + v > 1.0f) return 0;
+
+// And see if it's along the segment:
+t = f * ((M.E2x[Tri] * q[0]) + (M.E2y[Tri] * q[1]) + (M.E2z[Tri] * q[2]));
+if (t <= 0.0f || t >= *MaxT) return 0;
+Q.Hit = 1;
+return 1;
+ }
+
+/***************************************************************************\
+  Checks if anything blocks the segment from P to P + Ray.  Any hit will
+  do, so the trace stops at the first one found.
+  Returns true if the segment is blocked.
+\***************************************************************************/
+int IMR_LightBaker::Is_Occluded(float *P, float *Ray)
+{
+IMR_LightBakeRay Q;
+
+// Rays of zero length can't be blocked:
+if ((Ray[0] * Ray[0]) + (Ray[1] * Ray[1]) + (Ray[2] * Ray[2]) <= 0.0f) return 0;
+
+// Trace it through the tree:
+Q.Mesh = &Occluder_Mesh;
+Q.P = P;
+Q.Ray = Ray;
+Q.Hit = 0;
+Occluder_BVH.Query_Ray(P, Ray, 1.0f, IMR_LightBake_RayTriangle, &Q);
+return Q.Hit;
+ }
+
+/***************************************************************************\
+  Finds the light reaching the specified point from all the static lights.
+\***************************************************************************/
+void IMR_LightBaker::Light_Point(float *P, float *N, unsigned char *RGB)
+{
+float Start[3], Ray[3], Intensity, R, G, B, Cr, Cg, Cb;
+int index;
+
+// Start shadow rays just off the surface:
+Start[0] = P[0] + (N[0] * IMR_LIGHTBAKE_EPSILON);
+Start[1] = P[1] + (N[1] * IMR_LIGHTBAKE_EPSILON);
+Start[2] = P[2] + (N[2] * IMR_LIGHTBAKE_EPSILON);
+
+// Add up the light:
+R = G = B = 0.0f;
+for (index = 0; index < Num_Lights; index ++)
+    {
+    Intensity = Lights[index]->Find_PointIntensity(P, N, Ray);
+    if (Intensity <= 0.0f) continue;
+    if (Is_Occluded(Start, Ray)) continue;
+    Lights[index]->Get_Color(Cr, Cg, Cb);
+    R += Cr * Intensity;
+    G += Cg * Intensity;
+    B += Cb * Intensity;
+     }
+
+// Keep in range of 0-1 and save:
+if (R > 1.0f) R = 1.0f;
+if (G > 1.0f) G = 1.0f;
+if (B > 1.0f) B = 1.0f;
+RGB[0] = (unsigned char)(R * 255.0f);
+RGB[1] = (unsigned char)(G * 255.0f);
+RGB[2] = (unsigned char)(B * 255.0f);
+ }
+
+/***************************************************************************\
+  Bakes the lighting for the specified poly.  Only touches the baked poly,
+  so it's safe to call from several threads at once.
+\***************************************************************************/
+void IMR_LightBaker::Bake_Poly(int Index)
+{
+IMR_BakeEntry *Entry;
+IMR_BakedPoly *Baked;
+IMR_Polygon *Poly;
+IMR_Model *Mdl;
+IMR_3DPoint Pos;
+IMR_Matrix Rot;
+float W[IMR_MAXPOLYVERTS][3], N[3], U[3], V[3], P[3], AxisU[3], AxisV[3],
+      Len, MinU, MaxU, MinV, MaxV, Du, Dv, StepU, StepV, Cu, Cv;
+unsigned char *Lumel;
+int vtx, c, x, y;
+
+// Find the entry this poly belongs to:
+Baked = &Polys[Index];
+Entry = &Entries[Baked->Entry];
+Mdl = Entry->Obj->Get_Model();
+Poly = &Mdl->Polygons[Index - Entry->FirstPoly];
+Pos = Entry->Obj->Get_GlobalPos();
+Rot = Entry->Obj->Get_RotMatrix();
+
+// Find the world coords of the vertices and the normal:
+Baked->Num_Verts = Poly->Num_Verts;
+for (vtx = 0; vtx < Poly->Num_Verts; vtx ++)
+    IMR_LightBake_ToWorld(Mdl->Vertices[Poly->Vtx_Index[vtx]], Rot, Pos, W[vtx]);
+IMR_LightBake_ToWorld(Mdl->Vertices[Poly->Normal_Index], Rot, Pos, N);
+for (c = 0; c < 3; c ++) N[c] -= W[0][c];
+
+// Light sources are always at full intensity:
+if (Poly->Flags.LightSource)
+    {
+    Baked->Width = Baked->Height = IMR_LIGHTBAKE_MINSIZE;
+    memset(Baked->Lumels, 255, Baked->Width * Baked->Height * 3);
+    memset(Baked->Corners, 255, sizeof(Baked->Corners));
+    for (c = 0; c < 3; c ++) Baked->Origin[c] = Baked->AxisU[c] = Baked->AxisV[c] = 0.0f;
+    return;
+     }
+
+// Find the axes of the lightmap (U along the first edge):
+for (c = 0; c < 3; c ++) U[c] = W[1][c] - W[0][c];
+Len = sqrt((U[0] * U[0]) + (U[1] * U[1]) + (U[2] * U[2]));
+if (Len > 0.0f) { U[0] /= Len; U[1] /= Len; U[2] /= Len; }
+V[0] = (N[1] * U[2]) - (N[2] * U[1]);
+V[1] = (N[2] * U[0]) - (N[0] * U[2]);
+V[2] = (N[0] * U[1]) - (N[1] * U[0]);
+
+// Find the extents of the poly along the axes:
+MinU = MinV = MaxU = MaxV = 0.0f;
+for (vtx = 1; vtx < Poly->Num_Verts; vtx ++)
+    {
+    Cu = ((W[vtx][0] - W[0][0]) * U[0]) + ((W[vtx][1] - W[0][1]) * U[1]) + ((W[vtx][2] - W[0][2]) * U[2]);
+    Cv = ((W[vtx][0] - W[0][0]) * V[0]) + ((W[vtx][1] - W[0][1]) * V[1]) + ((W[vtx][2] - W[0][2]) * V[2]);
+    if (Cu < MinU) MinU = Cu;
+    if (Cu > MaxU) MaxU = Cu;
+    if (Cv < MinV) MinV = Cv;
+    if (Cv > MaxV) MaxV = Cv;
+     }
+
+// Size the lightmap:
+Du = MaxU - MinU;
+Dv = MaxV - MinV;
+Baked->Width = (int)(Du / LumelSize) + 1;
+Baked->Height = (int)(Dv / LumelSize) + 1;
+if (Baked->Width < IMR_LIGHTBAKE_MINSIZE) Baked->Width = IMR_LIGHTBAKE_MINSIZE;
+if (Baked->Width > IMR_LIGHTBAKE_MAXSIZE) Baked->Width = IMR_LIGHTBAKE_MAXSIZE;
+if (Baked->Height < IMR_LIGHTBAKE_MINSIZE) Baked->Height = IMR_LIGHTBAKE_MINSIZE;
+if (Baked->Height > IMR_LIGHTBAKE_MAXSIZE) Baked->Height = IMR_LIGHTBAKE_MAXSIZE;
+StepU = Du / (float)(Baked->Width - 1);
+StepV = Dv / (float)(Baked->Height - 1);
+
+// Save the mapping in model coords, so it still holds when the object
+// moves or the model is shared.  The origin is half a lumel before the
+// first lumel, and the axes are scaled so a point's distance along them is
+// it's lightmap coord (0-1 across the lightmap):
+for (c = 0; c < 3; c ++)
+    {
+    P[c] = W[0][c] + (U[c] * (MinU - (StepU * 0.5f))) + (V[c] * (MinV - (StepV * 0.5f)));
+    AxisU[c] = StepU > 0.0f ? U[c] / (StepU * (float)Baked->Width) : 0.0f;
+    AxisV[c] = StepV > 0.0f ? V[c] / (StepV * (float)Baked->Height) : 0.0f;
+     }
+IMR_LightBake_ToLocal(P, Rot, &Pos, Baked->Origin);
+IMR_LightBake_ToLocal(AxisU, Rot, NULL, Baked->AxisU);
+IMR_LightBake_ToLocal(AxisV, Rot, NULL, Baked->AxisV);
+
+// Light each lumel:
+Lumel = Baked->Lumels;
+for (y = 0; y < Baked->Height; y ++)
+    {
+    Cv = MinV + (StepV * (float)y);
+    for (x = 0; x < Baked->Width; x ++, Lumel += 3)
+        {
+        Cu = MinU + (StepU * (float)x);
+        for (c = 0; c < 3; c ++) P[c] = W[0][c] + (U[c] * Cu) + (V[c] * Cv);
+        Light_Point(P, N, Lumel);
+         }
+     }
+
+// And light each vertex:
+for (vtx = 0; vtx < Poly->Num_Verts; vtx ++)
+    Light_Point(W[vtx], N, Baked->Corners[vtx]);
+ }
+
+/***************************************************************************\
+  Thread pool job.  Bakes a single poly.
+\***************************************************************************/
+void IMR_LightBaker::Bake_Job(void *Data, int Item)
+{
+((IMR_LightBaker *)Data)->Bake_Poly(Item);
+ }
+
+/***************************************************************************\
+  Bakes the lighting for every model in the tree using the static lights
+  in the tree.  Collidable objects cast shadows.  If a thread pool is
+  specified, the polys are spread across it's workers.
+  Note: Call UpdateCoords() on the root first.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_LightBaker::Bake(IMR_Object &Root, float Lumel, IMR_ThreadPool *Pool)
+{
+int index, err;
+
+// Get rid of the old bake:
+Reset();
+if (Lumel > 0.0f) LumelSize = Lumel;
+
+// Count everything and allocate space:
+Count(&Root);
+if (!Max_Entries)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_LightBaker::Bake(): Nothing to bake!");
+    return IMRERR_NODATA;
+     }
+Entries = (IMR_BakeEntry *)malloc(sizeof(IMR_BakeEntry) * Max_Entries);
+Polys = (IMR_BakedPoly *)malloc(sizeof(IMR_BakedPoly) * Num_Polys);
+if (Max_Occluders) Occluders = (float *)malloc(sizeof(float) * 9 * Max_Occluders);
+if (!Entries || !Polys || (Max_Occluders && !Occluders))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_LightBaker::Bake(): Out of memory! (%d, %d)", Num_Polys, Max_Occluders);
+    Num_Polys = 0;
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+for (index = 0; index < Num_Polys; index ++)
+    {
+    if (!(Polys[index].Lumels = (unsigned char *)malloc(IMR_LIGHTBAKE_MAXSIZE * IMR_LIGHTBAKE_MAXSIZE * 3)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_LightBaker::Bake(): Out of memory! (%d)", Num_Polys);
+        Num_Polys = index;
+        Reset();
+        return IMRERR_OUTOFMEM;
+         }
+     }
+
+// Collect the objects, lights, and shadow casters:
+Gather(&Root);
+
+// Put the shadow casters in a tree (the list isn't needed after that):
+if (Num_Occluders)
+    {
+    err = Occluder_Mesh.Build(Occluders, Num_Occluders);
+    if (IMR_ISOK(err)) err = Occluder_BVH.Build(Occluder_Mesh);
+    if (IMR_ISNOTOK(err) && err != IMRERR_NODATA)
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_LightBaker::Bake(): Can't build the shadow casters! (%d)", Num_Occluders);
+        Reset();
+        return err;
+         }
+     }
+if (Occluders) free(Occluders);
+Occluders = NULL;
+Num_Occluders = Max_Occluders = 0;
+
+// Now bake everything:
+if (Pool)
+    return Pool->Run(Bake_Job, (void *)this, Num_Polys);
+for (index = 0; index < Num_Polys; index ++)
+    Bake_Poly(index);
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Saves the baked lighting to the specified RDF.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_LightBaker::Save(char *FileName, char *ResName)
+{
+char Buffer[33];
+short Temp;
+int fd, entry, poly, Ok;
+IMR_BakedPoly *Baked;
+
+// Make sure we have something to save:
+if (!Num_Entries)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_LightBaker::Save(): Nothing to save!");
+    return IMRERR_NODATA;
+     }
+
+// Open the file:
+fd = open(FileName, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, S_IREAD | S_IWRITE);
+if (fd == -1)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Can not create file %s!", FileName);
+    return IMRERR_BADFILE;
+     }
+
+// Write the type and resource name:
+Ok = 1;
+IMR_LightBake_Write(fd, (void *)IMR_LIGHTBAKE_RDFTYPE, 3, Ok);
+memset(Buffer, 0, 33);
+strncpy(Buffer, ResName, 32);
+IMR_LightBake_Write(fd, Buffer, 32, Ok);
+
+// Write the version:
+Temp = IMR_LIGHTBAKE_VERSION; IMR_LightBake_Write(fd, &Temp, 2, Ok);
+
+// Write each object:
+Temp = Num_Entries; IMR_LightBake_Write(fd, &Temp, 2, Ok);
+for (entry = 0; entry < Num_Entries && Ok; entry ++)
+    {
+    memset(Buffer, 0, 9);
+    strncpy(Buffer, Entries[entry].Obj->Get_Name(), 8);
+    IMR_LightBake_Write(fd, Buffer, 9, Ok);
+    Temp = Entries[entry].Num_Polys; IMR_LightBake_Write(fd, &Temp, 2, Ok);
+    IMR_LightBake_Write(fd, &Entries[entry].Obj->Get_Model()->Num_Vertices, 4, Ok);
+
+    // Write each poly:
+    for (poly = 0; poly < Entries[entry].Num_Polys; poly ++)
+        {
+        Baked = &Polys[Entries[entry].FirstPoly + poly];
+        Temp = Baked->Width; IMR_LightBake_Write(fd, &Temp, 2, Ok);
+        Temp = Baked->Height; IMR_LightBake_Write(fd, &Temp, 2, Ok);
+        Buffer[0] = Baked->Num_Verts; IMR_LightBake_Write(fd, Buffer, 1, Ok);
+        IMR_LightBake_Write(fd, Baked->Origin, sizeof(float) * 3, Ok);
+        IMR_LightBake_Write(fd, Baked->AxisU, sizeof(float) * 3, Ok);
+        IMR_LightBake_Write(fd, Baked->AxisV, sizeof(float) * 3, Ok);
+        IMR_LightBake_Write(fd, Baked->Corners, Baked->Num_Verts * 3, Ok);
+        IMR_LightBake_Write(fd, Baked->Lumels, Baked->Width * Baked->Height * 3, Ok);
+         }
+     }
+
+// Close the file:
+if (close(fd)) Ok = 0;
+if (!Ok)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Can not write file %s!", FileName);
+    return IMRERR_BADFILE;
+     }
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Lists the objects in the tree that get baked, in the order they're baked
+  in.  If List is NULL, they're only counted.
+\***************************************************************************/
+static void IMR_LightBake_List(IMR_Object *Obj, IMR_Object **List, int &Num)
+{
+IMR_Model *Mdl;
+
+if ((Mdl = Obj->Get_Model()) && Mdl->Num_Polygons && !Mdl->Polygons[0].Flags.Skybox)
+    {
+    if (List) List[Num] = Obj;
+    ++ Num;
+     }
+for (int index = 0; index < Obj->Get_Num_Children(); index ++)
+    if (Obj->Get_Child(index)) IMR_LightBake_List(Obj->Get_Child(index), List, Num);
+ }
+
+/***************************************************************************\
+  Compares two model pointers (for sorting them with qsort()).
+\***************************************************************************/
+static int IMR_LightBake_CompareModels(const void *A, const void *B)
+{
+char *a = *(char **)A, *b = *(char **)B;
+
+if (a < b) return -1;
+if (a > b) return 1;
+return 0;
+ }
+
+/***************************************************************************\
+  Checks if more than one object uses the specified model, given the
+  sorted models of the objects.
+  Returns true if the model is shared.
+\***************************************************************************/
+static int IMR_LightBake_IsShared(IMR_Model **Models, int Num, IMR_Model *Mdl)
+{
+IMR_Model **Found;
+int index;
+
+if (!(Found = (IMR_Model **)bsearch(&Mdl, Models, Num, sizeof(IMR_Model *), IMR_LightBake_CompareModels)))
+    return 0;
+index = Found - Models;
+return (index > 0 && Models[index - 1] == Mdl) || (index < Num - 1 && Models[index + 1] == Mdl);
+ }
+
+/***************************************************************************\
+  Loads the baked lighting with the specified resource name and applies it
+  to the objects in the tree.  The vertex lighting is stored in the models
+  and the polys are flagged as baked.  If a renderer is specified, the
+  lightmaps are also created (with IDs starting at FirstID) and attached to
+  each poly's material.  Each object is matched by it's place in the tree
+  (or by name if the tree has changed), and skipped unless it's model has
+  the same number of polys and vertices it was baked with.
+  Note: The lighting is kept in the model, so objects whose model is used
+        by another object in the tree are skipped (each would overwrite
+        the others' lighting).
+  Returns the number of lightmaps created if successful, otherwise an error.
+\***************************************************************************/
+int IMR_LightBaker::Load(char *ResName, IMR_Object &Root, IMR_Renderer *Rend, int FirstID)
+{
+IMR_RDFResourceDesc ResourceDesc;
+IMR_Object *Obj, **Objects;
+IMR_Model *Mdl, **Models;
+IMR_Polygon *Poly;
+IMR_3DPoint *Vtx;
+IMR_TexRef Ref;
+unsigned char Buffer[35], Corners[IMR_MAXPOLYVERTS][3],
+              Lumels[IMR_LIGHTBAKE_MAXSIZE * IMR_LIGHTBAKE_MAXSIZE * 3], *Data;
+float Origin[3], AxisU[3], AxisV[3], d[3];
+int fd, err, entry, Num_Entries, poly, Num_Polys, Num_Vertices, Num_Objects,
+    Width, Height, Num_Verts, vtx, index, ID, Version, Ok;
+
+// Look for the file in our resources:
+ResourceDesc = IMR_Resources.Get_RDFManager()->FindRDF(IMR_LIGHTBAKE_RDFTYPE, NULL, ResName);
+if (ResourceDesc == -1)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Lightmaps %s not found in resource directory!", ResName);
+    return IMRERR_BADFILE;
+     }
+
+// List the objects in the order they were baked, and sort their models so
+// shared ones can be found:
+Num_Objects = 0;
+IMR_LightBake_List(&Root, NULL, Num_Objects);
+Objects = (IMR_Object **)malloc(sizeof(IMR_Object *) * (Num_Objects + 1));
+Models = (IMR_Model **)malloc(sizeof(IMR_Model *) * (Num_Objects + 1));
+if (!Objects || !Models)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_LightBaker::Load(): Out of memory! (%d)", Num_Objects);
+    free(Objects);
+    free(Models);
+    return IMRERR_OUTOFMEM;
+     }
+Num_Objects = 0;
+IMR_LightBake_List(&Root, Objects, Num_Objects);
+for (index = 0; index < Num_Objects; index ++)
+    Models[index] = Objects[index]->Get_Model();
+qsort(Models, Num_Objects, sizeof(IMR_Model *), IMR_LightBake_CompareModels);
+
+// Open the file:
+err = IMR_Resources.Get_RDFManager()->OpenRDF(ResourceDesc, fd);
+if (IMR_ISNOTOK(err))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Can't load lightmaps %s!", ResName);
+    free(Objects);
+    free(Models);
+    return IMRERR_BADFILE;
+     }
+
+// Eat ID and name:
+Ok = 1;
+IMR_LightBake_Read(fd, Buffer, 35, Ok);
+
+// Make sure it's a layout we know:
+Version = 0; IMR_LightBake_Read(fd, &Version, 2, Ok);
+err = IMR_OK;
+if (Ok && Version != IMR_LIGHTBAKE_VERSION)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Lightmaps %s are version %d (expected %d)!", ResName, Version, IMR_LIGHTBAKE_VERSION);
+    err = IMRERR_BADFILE;
+     }
+
+// Read each object:
+ID = FirstID;
+Num_Entries = 0; IMR_LightBake_Read(fd, &Num_Entries, 2, Ok);
+for (entry = 0; entry < Num_Entries && Ok && IMR_ISOK(err); entry ++)
+    {
+    // Find the object:
+    IMR_LightBake_Read(fd, Buffer, 9, Ok);
+    Buffer[8] = 0;
+    Num_Polys = 0; IMR_LightBake_Read(fd, &Num_Polys, 2, Ok);
+    Num_Vertices = 0; IMR_LightBake_Read(fd, &Num_Vertices, 4, Ok);
+    if (!Ok) break;
+    Obj = entry < Num_Objects ? Objects[entry] : NULL;
+    if (!Obj || !Obj->Is((char *)Buffer)) Obj = Root.Get_Child((char *)Buffer);
+    Mdl = Obj ? Obj->Get_Model() : NULL;
+    if (!Mdl || Mdl->Num_Polygons != Num_Polys || Mdl->Num_Vertices != Num_Vertices)
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "(NONFATAL) Object %s doesn't match lightmaps %s!", Buffer, ResName);
+        Mdl = NULL;
+         }
+    else if (IMR_LightBake_IsShared(Models, Num_Objects, Mdl))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "(NONFATAL) Object %s shares it's model, so lightmaps %s can't be used for it!", Buffer, ResName);
+        Mdl = NULL;
+         }
+
+    // Read each poly:
+    for (poly = 0; poly < Num_Polys; poly ++)
+        {
+        Width = 0; IMR_LightBake_Read(fd, &Width, 2, Ok);
+        Height = 0; IMR_LightBake_Read(fd, &Height, 2, Ok);
+        Num_Verts = 0; IMR_LightBake_Read(fd, &Num_Verts, 1, Ok);
+        if (!Ok) break;
+        if (Width <= 0 || Height <= 0 || Width > IMR_LIGHTBAKE_MAXSIZE || Height > IMR_LIGHTBAKE_MAXSIZE ||
+            Num_Verts > IMR_MAXPOLYVERTS)
+            {
+            IMR_LogMsg(__LINE__, __FILE__, "Bad lightmap in %s! (%d, %d, %d)", ResName, Width, Height, Num_Verts);
+            err = IMRERR_BADFILE;
+            break;
+             }
+        IMR_LightBake_Read(fd, Origin, sizeof(float) * 3, Ok);
+        IMR_LightBake_Read(fd, AxisU, sizeof(float) * 3, Ok);
+        IMR_LightBake_Read(fd, AxisV, sizeof(float) * 3, Ok);
+        IMR_LightBake_Read(fd, Corners, Num_Verts * 3, Ok);
+        IMR_LightBake_Read(fd, Lumels, Width * Height * 3, Ok);
+        if (!Ok) break;
+
+        // Skip it if there's no poly to put it in:
+        if (!Mdl) continue;
+        Poly = &Mdl->Polygons[poly];
+        if (Poly->Num_Verts != Num_Verts) continue;
+
+        // Save the vertex lighting and the lightmap coords:
+        for (vtx = 0; vtx < Num_Verts; vtx ++)
+            {
+            Poly->UVI_Info[vtx].R = (float)Corners[vtx][0] * (1.0f / 255.0f);
+            Poly->UVI_Info[vtx].G = (float)Corners[vtx][1] * (1.0f / 255.0f);
+            Poly->UVI_Info[vtx].B = (float)Corners[vtx][2] * (1.0f / 255.0f);
+            Vtx = &Mdl->Vertices[Poly->Vtx_Index[vtx]];
+            d[0] = Vtx->lX - Origin[0];
+            d[1] = Vtx->lY - Origin[1];
+            d[2] = Vtx->lZ - Origin[2];
+            Poly->UVI_Info[vtx].LU = (d[0] * AxisU[0]) + (d[1] * AxisU[1]) + (d[2] * AxisU[2]);
+            Poly->UVI_Info[vtx].LV = (d[0] * AxisV[0]) + (d[1] * AxisV[1]) + (d[2] * AxisV[2]);
+             }
+        Poly->Flags.Baked = 1;
+
+        // Create the lightmap:
+        if (!Rend) continue;
+        Ref = Rend->Lightmap_Add(ID);
+        if (!Ref.HasHost()) continue;
+        Ref.Width = Width;
+        Ref.Height = Height;
+        Ref.Type = IMR_REFTYPE_LIGHTMAP;
+        if (IMR_ISNOTOK(Rend->Lightmap_Gen(Ref))) continue;
+
+        // Copy the lumels (converted to 3:3:2):
+        Ref = Rend->Lightmap_GetData(ID);
+        Data = (unsigned char *)Ref.Get_Data();
+        if (Data)
+            {
+            for (index = 0; index < Width * Height; index ++)
+                Data[index] = (Lumels[index * 3] & 0xE0) |
+                              ((Lumels[index * 3 + 1] >> 3) & 0x1C) |
+                              (Lumels[index * 3 + 2] >> 6);
+            Rend->Lightmap_ReturnData(Ref);
+             }
+
+        // And attach it to the material:
+        Poly->Material.Set_LightmapID(ID);
+        Poly->Material.Set_LightMap(Rend->Lightmap_GetRef(ID));
+        ++ ID;
+         }
+     }
+
+// Close the file:
+IMR_Resources.Get_RDFManager()->CloseRDF(fd);
+free(Objects);
+free(Models);
+
+// Make sure we read the whole thing:
+if (!Ok)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "Lightmaps %s are cut short!", ResName);
+    return IMRERR_BADFILE;
+     }
+if (IMR_ISNOTOK(err)) return err;
+
+// Return the number of lightmaps we made:
+return ID - FirstID;
+ }
@@ -0,0 +1,108 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_LightBake.hpp
+ Description: Header
+
+\****************************************************************/
+#ifndef __IMR_LIGHTBAKE__HPP
+#define __IMR_LIGHTBAKE__HPP
+
+// Include stuff:
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "imr_geom_object.hpp"
+#include "imr_geom_light.hpp"
+#include "imr_geom_model.hpp"
+#include "imr_geom_poly.hpp"
+#include "imr_collidebvh.hpp"
+#include "imr_rdfmngr.hpp"
+#include "imr_resource.hpp"
+#include "../RendCore/DirectX6/imr_renderer.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../Foundation/imr_thread.hpp"
+
+// Constants and macros:
+#define IMR_LIGHTBAKE_MINSIZE     2         // Min lightmap width/height
+#define IMR_LIGHTBAKE_MAXSIZE     16        // Max lightmap width/height
+#define IMR_LIGHTBAKE_MAXLIGHTS   256
+#define IMR_LIGHTBAKE_EPSILON     0.25f     // Offset from the surface for shadow rays
+#define IMR_LIGHTBAKE_RDFTYPE     "Lmp"
+#define IMR_LIGHTBAKE_VERSION     2         // Version of the RDF layout
+
+// Baked lighting for a single poly:
+struct IMR_BakedPoly
+    {
+    int Entry;                                    // Entry of the object it's from
+    int Width, Height, Num_Verts;
+    unsigned char Corners[IMR_MAXPOLYVERTS][3];   // RGB at each vertex
+    unsigned char *Lumels;                        // RGB for each lumel (Width * Height)
+    float Origin[3], AxisU[3], AxisV[3];          // Lightmap mapping (model coords, see Load())
+     };
+
+// Object being baked:
+struct IMR_BakeEntry
+    {
+    IMR_Object *Obj;
+    int FirstPoly, Num_Polys;
+     };
+
+// Lightmap baker class:
+class IMR_LightBaker
+    {
+    protected:
+      // Settings:
+      float LumelSize;
+
+      // Objects and their baked polys:
+      IMR_BakeEntry *Entries;
+      int Num_Entries, Max_Entries;
+      IMR_BakedPoly *Polys;
+      int Num_Polys;
+
+      // Shadow casters (world coords, 9 floats per triangle) and the tree
+      // the shadow rays are traced through:
+      float *Occluders;
+      int Num_Occluders, Max_Occluders;
+      IMR_CollideMesh Occluder_Mesh;
+      IMR_CollideBVH Occluder_BVH;
+
+      // Lights:
+      IMR_Light *Lights[IMR_LIGHTBAKE_MAXLIGHTS];
+      int Num_Lights;
+
+      // Protected member functions:
+      void Count(IMR_Object *Obj);
+      void Gather(IMR_Object *Obj);
+      void Add_Occluder(float *A, float *B, float *C);
+      int Is_Occluded(float *P, float *Ray);
+      void Light_Point(float *P, float *N, unsigned char *RGB);
+      void Bake_Poly(int Index);
+      static void Bake_Job(void *Data, int Item);
+
+    public:
+      IMR_LightBaker()
+          {
+          Entries = NULL; Polys = NULL; Occluders = NULL;
+          Num_Entries = Max_Entries = Num_Polys = Num_Occluders = Max_Occluders = Num_Lights = 0;
+          LumelSize = 16.0f;
+           };
+      ~IMR_LightBaker() { Reset(); };
+
+      // Init and de-init methods:
+      void Reset(void);
+
+      // Bake methods:
+      int Bake(IMR_Object &Root, float Lumel, IMR_ThreadPool *Pool);
+      int Save(char *FileName, char *ResName);
+      inline int Get_Num_Polys(void) { return Num_Polys; };
+
+      // Load method (used at runtime):
+      static int Load(char *ResName, IMR_Object &Root, IMR_Renderer *Rend, int FirstID);
+     };
+
+#endif
@@ -8,7 +8,7 @@
  Description: Material class code module
  
 \****************************************************************/
-#include "IMR_Material.hpp"
+#include "imr_material.hpp"
 
 /***************************************************************************\
   Sets the name of the material.
@@ -18,7 +18,7 @@ void IMR_Material::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)TextureName, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
@@ -32,7 +32,7 @@ void IMR_Material::Set_TextureName(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)TextureName, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(TextureName, NewName);
@@ -14,8 +14,8 @@
 // Include stuff:
 #include <stdlib.h>
 #include <string.h>
-#include "IMR_TexRef.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
+#include "imr_texref.hpp"
+#include "../CallStatus/imr_log.hpp"
 
 // Constants and macros:
 #ifndef IMR_ON
@@ -56,6 +56,7 @@ class IMR_Material
           Flags.Shiny = IMR_OFF;
           Flags.Reflective = IMR_OFF;
           Flags.Transparent = IMR_OFF;
+          LightmapID = -1;
            };
       ~IMR_Material() { Shutdown(); };
       void Shutdown(void)
@@ -72,6 +73,12 @@ class IMR_Material
       // Texture methods:
       int Set_Texture(IMR_TexRef Tex) { Texture = Tex; return IMR_OK; };
       IMR_TexRef Get_Texture(void) { return Texture; };
+      
+      // Lightmap methods:
+      inline void Set_LightmapID(int ID) { LightmapID = ID; };
+      inline int Get_LightmapID(void) { return LightmapID; };
+      int Set_LightMap(IMR_TexRef Map) { LightMap = Map; return IMR_OK; };
+      IMR_TexRef Get_LightMap(void) { return LightMap; };
 
       // Appearance methods:
       inline void Set_Shiny(int Val) { Flags.Shiny = Val ? IMR_ON:IMR_OFF; };
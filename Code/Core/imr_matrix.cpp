@@ -8,7 +8,7 @@
  Description: Matrix math module
  
 \****************************************************************/
-#include "IMR_Matrix.hpp"
+#include "imr_matrix.hpp"
 
 /***************************************************************************\
   Makes Matrix a rotation matrix
@@ -166,4 +166,37 @@ if (product == 7)                   // X, Y, and Z rotation
      }
  }
 
+/***************************************************************************\
+  Finds the angles that Rotate() would make this matrix's rotation from.
+  Any rotation can be made from two sets of angles; the one with the X
+  angle within a quarter turn of zero is picked, so the Y angle comes back
+  as a whole heading.
+\***************************************************************************/
+void IMR_Matrix::Find_Angles(int *Ang_X, int *Ang_Y, int *Ang_Z)
+{
+float Sign, CosY, X, Y, Z;
+float Scale = IMR_DEGREECOUNT / 6.2831853f;
 
+// Rotate() makes [cy cz, cy sz, -sy], [.., .., sx cy], [.., .., cx cy]
+// in the first and last columns, so keeping cx positive gives cy's sign:
+Sign = Mtrx[2][2] < 0 ? -1.0f : 1.0f;
+CosY = (float)sqrt((Mtrx[0][0] * Mtrx[0][0]) + (Mtrx[0][1] * Mtrx[0][1])) * Sign;
+if (fabs(CosY) > 0.00001f)
+    {
+    X = (float)atan2(Mtrx[1][2] * Sign, Mtrx[2][2] * Sign);
+    Y = (float)atan2(-Mtrx[0][2], CosY);
+    Z = (float)atan2(Mtrx[0][1] * Sign, Mtrx[0][0] * Sign);
+     }
+else
+    {
+    // Turned a quarter turn about Y, so X and Z turn about the same axis:
+    X = (float)atan2(-Mtrx[2][1], Mtrx[1][1]);
+    Y = (float)atan2(-Mtrx[0][2], 0.0f);
+    Z = 0;
+     }
+
+// And put them in table units:
+*Ang_X = (int)floor((X * Scale) + 0.5f) & IMR_DEGREEAND;
+*Ang_Y = (int)floor((Y * Scale) + 0.5f) & IMR_DEGREEAND;
+*Ang_Z = (int)floor((Z * Scale) + 0.5f) & IMR_DEGREEAND;
+ }
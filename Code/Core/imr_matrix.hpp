@@ -11,7 +11,7 @@
 #ifndef __IMR_MATRIX__HPP
 #define __IMR_MATRIX__HPP
 
-#include "IMR_Table.hpp"
+#include "imr_table.hpp"
 
 // Data type used in matrix
 typedef float mat[4][4];
@@ -21,13 +21,15 @@ class IMR_Matrix
     {
     public:
       mat Mtrx;
-      Matrix() { };
+      IMR_Matrix() { };
       void Init(mat Mtrx);
       void inline Identity(void);
       void inline Merge_Matrix(mat Mtrx);
       void inline Merge_Matrices(mat a, mat b);
+      void inline Merge_Rotations(mat a, mat b);
       void Rotate(int Ang_X, int Ang_Y, int Ang_Z);
       void ZYXRotate(int Ang_X, int Ang_Y, int Ang_Z);
+      void Find_Angles(int *Ang_X, int *Ang_Y, int *Ang_Z);
       void Translate(float Pos_X, float Pos_Y, float Pos_Z);
      };
 
@@ -84,4 +86,22 @@ for (i = 0; i < 4; i++ )
                      (MtrxA[i][3] * MtrxB[3][j]);
  }
 
+/***************************************************************************\
+  Merges rotation matrices MtrxA and MtrxB (so points are turned by A, 
+  then by B) and stores the result in Matrix.  Only the 3x3 rotation part
+  is multiplied; the rest is left as identity.
+\***************************************************************************/
+void inline IMR_Matrix::Merge_Rotations(mat MtrxA, mat MtrxB)
+{
+for (int i = 0; i < 3; i++)
+    {
+    Mtrx[i][0] = (MtrxA[i][0] * MtrxB[0][0]) + (MtrxA[i][1] * MtrxB[1][0]) + (MtrxA[i][2] * MtrxB[2][0]);
+    Mtrx[i][1] = (MtrxA[i][0] * MtrxB[0][1]) + (MtrxA[i][1] * MtrxB[1][1]) + (MtrxA[i][2] * MtrxB[2][1]);
+    Mtrx[i][2] = (MtrxA[i][0] * MtrxB[0][2]) + (MtrxA[i][1] * MtrxB[1][2]) + (MtrxA[i][2] * MtrxB[2][2]);
+    Mtrx[i][3] = 0;
+     }
+Mtrx[3][0] = Mtrx[3][1] = Mtrx[3][2] = 0;
+Mtrx[3][3] = 1.0f;
+ }
+
 #endif
@@ -0,0 +1,636 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_Octree.cpp
+ Description: Loose octree of object bounds.  Each object is kept
+              in the smallest node whose cell is as big as it is,
+              and only relinked when it leaves that node, so
+              moving objects is cheap and a query only visits the
+              nodes near what it's looking for.
+
+\****************************************************************/
+#include "imr_octree.hpp"
+#include "imr_geom_object.hpp"
+
+/***************************************************************************\
+  Sets up an empty tree around the specified cube (center and half the
+  size, global coords) with the specified number of levels below the root,
+  and allocates space for the specified number of objects.  Objects outside
+  the cube are kept in the root.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Octree::Setup(float *Center, float Half, int NewDepth, int MaxObjects)
+{
+int index;
+
+// Get rid of the old tree:
+Reset();
+
+// Check the params:
+if (Half <= 0 || MaxObjects <= 0 || NewDepth < 0 || NewDepth > IMR_OCTREE_MAXDEPTH)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Octree::Setup(): Invalid size! (%f, %d, %d)", Half, NewDepth, MaxObjects);
+    return IMRERR_GENERIC;
+     }
+Depth = NewDepth;
+
+// Allocate space (the nodes grow as they're needed):
+Max_Entries = Max_Found = MaxObjects;
+Max_Nodes = 64;
+Entries = (IMR_OctreeEntry *)malloc(sizeof(IMR_OctreeEntry) * Max_Entries);
+Found = (IMR_Object **)malloc(sizeof(IMR_Object *) * Max_Found);
+Nodes = (IMR_OctreeNode *)malloc(sizeof(IMR_OctreeNode) * Max_Nodes);
+if (!Entries || !Found || !Nodes)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Octree::Setup(): Out of memory! (%d)", MaxObjects);
+    Reset();
+    return IMRERR_OUTOFMEM;
+     }
+
+// Everything starts out empty:
+for (index = 0; index < Max_Entries; index ++)
+    {
+    Entries[index].Obj = NULL;
+    Entries[index].State = IMR_OCTREE_FREE;
+    Entries[index].Always = 0;
+    Entries[index].Node = -1;
+    Entries[index].Next = index + 1 < Max_Entries ? index + 1 : -1;
+     }
+Free_Entry = 0;
+Always_Entry = -1;
+
+// Make the root:
+Num_Nodes = 1;
+Free_Node = -1;
+Nodes[0].Center[0] = Center[0]; Nodes[0].Center[1] = Center[1]; Nodes[0].Center[2] = Center[2];
+Nodes[0].Half = Half;
+for (index = 0; index < 8; index ++) Nodes[0].Child[index] = -1;
+Nodes[0].Parent = -1;
+Nodes[0].Level = 0;
+Nodes[0].First = -1;
+Nodes[0].Count = 0;
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Frees all memory used by the tree.  The objects still in it are let go.
+\***************************************************************************/
+void IMR_Octree::Reset(void)
+{
+for (int index = 0; index < Max_Entries; index ++)
+    if (Entries[index].State != IMR_OCTREE_FREE)
+        Entries[index].Obj->Octree = NULL;
+if (Nodes) free(Nodes);
+if (Entries) free(Entries);
+if (Found) free(Found);
+Nodes = NULL;
+Entries = NULL;
+Found = NULL;
+Num_Nodes = Max_Nodes = Depth = 0;
+Free_Node = -1;
+Max_Entries = Num_Found = Max_Found = 0;
+Free_Entry = Always_Entry = -1;
+ }
+
+/***************************************************************************\
+  Makes the child of the specified node at the specified octant.
+  Returns the new node, or -1 if out of memory.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Octree::New_Node(int Parent, int Octant)
+{
+IMR_OctreeNode *NewList, *N;
+int Node, c;
+
+// Use a free node if there is one, otherwise make the list bigger if it's
+// full:
+if (Free_Node >= 0)
+    {
+    Node = Free_Node;
+    Free_Node = Nodes[Node].First;
+     }
+else if (Num_Nodes >= Max_Nodes)
+    {
+    if (!(NewList = (IMR_OctreeNode *)realloc(Nodes, sizeof(IMR_OctreeNode) * Max_Nodes * 2)))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_Octree::New_Node(): (NONFATAL) Out of memory for nodes! (%d)", Num_Nodes);
+        return -1;
+         }
+    Nodes = NewList;
+    Max_Nodes *= 2;
+    Node = Num_Nodes ++;
+     }
+else
+    Node = Num_Nodes ++;
+
+// Fill it in (the octant's bits pick the high side of each axis):
+N = &Nodes[Node];
+N->Half = Nodes[Parent].Half * 0.5f;
+for (c = 0; c < 3; c ++)
+    N->Center[c] = Nodes[Parent].Center[c] + ((Octant & (1 << c)) ? N->Half : -N->Half);
+for (c = 0; c < 8; c ++) N->Child[c] = -1;
+N->Parent = Parent;
+N->Level = Nodes[Parent].Level + 1;
+N->First = -1;
+N->Count = 0;
+Nodes[Parent].Child[Octant] = Node;
+
+// Return the node:
+return Node;
+ }
+
+/***************************************************************************\
+  Finds the node the specified box belongs in (the deepest one whose cell
+  holds the box's center and is at least as big as the box), making nodes
+  as needed.
+  Returns the node.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Octree::Find_Node(float *Min, float *Max)
+{
+float Center[3], Extent = 0, e;
+int Node = 0, Child, Octant, c;
+
+// Find the center and biggest half size of the box:
+for (c = 0; c < 3; c ++)
+    {
+    Center[c] = (Min[c] + Max[c]) * 0.5f;
+    e = (Max[c] - Min[c]) * 0.5f;
+    if (e > Extent) Extent = e;
+     }
+
+// Anything too big or outside the root stays in the root:
+if (Extent > Nodes[0].Half) return 0;
+for (c = 0; c < 3; c ++)
+    if (fabs(Center[c] - Nodes[0].Center[c]) > Nodes[0].Half) return 0;
+
+// Go down while the box fits the children:
+while (Nodes[Node].Level < Depth && Extent <= Nodes[Node].Half * 0.5f)
+    {
+    Octant = 0;
+    for (c = 0; c < 3; c ++)
+        if (Center[c] >= Nodes[Node].Center[c]) Octant |= 1 << c;
+    Child = Nodes[Node].Child[Octant];
+    if (Child < 0 && (Child = New_Node(Node, Octant)) < 0) break;
+    Node = Child;
+     }
+
+// Return the node:
+return Node;
+ }
+
+/***************************************************************************\
+  Links the specified entry into the specified node.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Octree::Link_Node(int Entry, int Node)
+{
+IMR_OctreeEntry *E = &Entries[Entry];
+
+E->Node = Node;
+E->Prev = -1;
+E->Next = Nodes[Node].First;
+if (E->Next >= 0) Entries[E->Next].Prev = Entry;
+Nodes[Node].First = Entry;
+for (; Node >= 0; Node = Nodes[Node].Parent)
+    ++ Nodes[Node].Count;
+ }
+
+/***************************************************************************\
+  Unlinks the specified entry from it's node (if it's in one).  The node is
+  left in the tree even if it's empty (see Prune_Node()).
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Octree::Unlink_Node(int Entry)
+{
+IMR_OctreeEntry *E = &Entries[Entry];
+int Node = E->Node;
+
+if (Node < 0) return;
+if (E->Prev >= 0) Entries[E->Prev].Next = E->Next;
+else Nodes[Node].First = E->Next;
+if (E->Next >= 0) Entries[E->Next].Prev = E->Prev;
+for (; Node >= 0; Node = Nodes[Node].Parent)
+    -- Nodes[Node].Count;
+E->Node = -1;
+E->Prev = E->Next = -1;
+ }
+
+/***************************************************************************\
+  Frees the specified node and the ones above it, for as long as they're
+  empty (the root is always kept).  A node's children are always freed
+  before it, so an empty node never has any.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Octree::Prune_Node(int Node)
+{
+int Parent, Octant, c;
+
+while (Node > 0 && !Nodes[Node].Count)
+    {
+    // Take it away from it's parent:
+    Parent = Nodes[Node].Parent;
+    Octant = 0;
+    for (c = 0; c < 3; c ++)
+        if (Nodes[Node].Center[c] > Nodes[Parent].Center[c]) Octant |= 1 << c;
+    Nodes[Parent].Child[Octant] = -1;
+
+    // And free it:
+    Nodes[Node].First = Free_Node;
+    Free_Node = Node;
+    Node = Parent;
+     }
+ }
+
+/***************************************************************************\
+  Adds the specified object to the tree, with the specified bounding box
+  (global coords, or NULL if it has none).
+  Returns the entry of the object, or -1 if the tree is full.
+\***************************************************************************/
+int IMR_Octree::Add(IMR_Object *Obj, float *Min, float *Max)
+{
+int Entry;
+
+// Get a free entry:
+if (Free_Entry < 0)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Octree::Add(): Tree is full! (%d)", Max_Entries);
+    return -1;
+     }
+Entry = Free_Entry;
+Free_Entry = Entries[Entry].Next;
+
+// Fill it in and put it in it's node:
+Entries[Entry].Obj = Obj;
+Entries[Entry].State = IMR_OCTREE_NOBOUNDS;
+Entries[Entry].Always = 0;
+Entries[Entry].Node = -1;
+Entries[Entry].Prev = Entries[Entry].Next = -1;
+Move(Entry, Min, Max);
+
+// Return the entry:
+return Entry;
+ }
+
+/***************************************************************************\
+  Gives the specified entry a new bounding box (global coords, or NULL if
+  it has none).  The entry is only relinked if it belongs in a different
+  node.
+\***************************************************************************/
+void IMR_Octree::Move(int Entry, float *Min, float *Max)
+{
+IMR_OctreeEntry *E;
+int Node, Old, c;
+
+// Make sure the entry is in use:
+if (Entry < 0 || Entry >= Max_Entries) return;
+E = &Entries[Entry];
+if (E->State == IMR_OCTREE_FREE) return;
+
+// Without bounds it can't be in a node:
+if (!Min || !Max)
+    {
+    Old = E->Node;
+    Unlink_Node(Entry);
+    Prune_Node(Old);
+    E->State = IMR_OCTREE_NOBOUNDS;
+    return;
+     }
+
+// Save the box and find where it goes:
+for (c = 0; c < 3; c ++)
+    {
+    E->Min[c] = Min[c];
+    E->Max[c] = Max[c];
+     }
+Node = Find_Node(Min, Max);
+
+// And move it there if it isn't already (the old node is only pruned once
+// the new one has it, since the new one might be under it):
+if (E->Node == Node) return;
+Old = E->Node;
+Unlink_Node(Entry);
+Link_Node(Entry, Node);
+Prune_Node(Old);
+E->State = IMR_OCTREE_INNODE;
+ }
+
+/***************************************************************************\
+  Sets whether the specified entry is always found by frustum queries,
+  whether it's in the frustum or not.  Used for objects that have to be
+  drawn no matter where they are (ones carrying lights, or skyboxes).
+\***************************************************************************/
+void IMR_Octree::Set_Always(int Entry, int State)
+{
+IMR_OctreeEntry *E;
+
+// Make sure the entry is in use and changing:
+if (Entry < 0 || Entry >= Max_Entries) return;
+E = &Entries[Entry];
+if (E->State == IMR_OCTREE_FREE || (E->Always != 0) == (State != 0)) return;
+
+// Link it into (or out of) the list:
+if (State)
+    {
+    E->Prev_Always = -1;
+    E->Next_Always = Always_Entry;
+    if (Always_Entry >= 0) Entries[Always_Entry].Prev_Always = Entry;
+    Always_Entry = Entry;
+     }
+else
+    {
+    if (E->Prev_Always >= 0) Entries[E->Prev_Always].Next_Always = E->Next_Always;
+    else Always_Entry = E->Next_Always;
+    if (E->Next_Always >= 0) Entries[E->Next_Always].Prev_Always = E->Prev_Always;
+     }
+E->Always = State ? 1 : 0;
+ }
+
+/***************************************************************************\
+  Takes the specified entry out of the tree.
+\***************************************************************************/
+void IMR_Octree::Remove(int Entry)
+{
+int Old;
+
+// Make sure the entry is in use:
+if (Entry < 0 || Entry >= Max_Entries || Entries[Entry].State == IMR_OCTREE_FREE) return;
+
+// Take it out of it's node and the always list:
+Old = Entries[Entry].Node;
+Unlink_Node(Entry);
+Prune_Node(Old);
+Set_Always(Entry, 0);
+
+// And free it:
+Entries[Entry].Obj = NULL;
+Entries[Entry].State = IMR_OCTREE_FREE;
+Entries[Entry].Next = Free_Entry;
+Free_Entry = Entry;
+ }
+
+/***************************************************************************\
+  Adds the specified object to the found list.
+  Returns 1 if successful, otherwise 0.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Octree::Add_Found(IMR_Object *Obj)
+{
+// The list holds every entry, so this only fails if something's wrong:
+if (Num_Found >= Max_Found) return 0;
+Found[Num_Found ++] = Obj;
+return 1;
+ }
+
+/***************************************************************************\
+  Checks a box (center and half sizes) against the planes in the mask.
+  Returns -1 if it's outside any of them, otherwise the mask of the planes
+  it isn't completely inside of.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Octree::Box_Planes(float *Center, float *Extent, float (*Planes)[4], int Mask)
+{
+float Dist, Radius;
+int plane;
+
+for (plane = 0; plane < 6; plane ++)
+    {
+    if (!(Mask & (1 << plane))) continue;
+    Dist = (Center[0] * Planes[plane][0]) + (Center[1] * Planes[plane][1]) + (Center[2] * Planes[plane][2]) + Planes[plane][3];
+    Radius = (Extent[0] * fabs(Planes[plane][0])) + (Extent[1] * fabs(Planes[plane][1])) + (Extent[2] * fabs(Planes[plane][2]));
+    if (Dist < -Radius) return -1;
+    if (Dist >= Radius) Mask &= ~(1 << plane);
+     }
+return Mask;
+ }
+
+/***************************************************************************\
+  Adds everything under the specified node that's inside the planes in the
+  mask to the found list.  Once a node is inside all the planes, nothing
+  under it is checked.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Octree::Walk_Planes(int Node, float (*Planes)[4], int Mask)
+{
+IMR_OctreeNode *N = &Nodes[Node];
+IMR_OctreeEntry *E;
+float Center[3], Extent[3];
+int Entry, child, c;
+
+if (!N->Count) return;
+
+// Check the loose box (the root also holds what's outside of it):
+if (Node && Mask)
+    {
+    Extent[0] = Extent[1] = Extent[2] = N->Half * 2;
+    if ((Mask = Box_Planes(N->Center, Extent, Planes, Mask)) < 0) return;
+     }
+
+// Check the entries:
+for (Entry = N->First; Entry >= 0; Entry = E->Next)
+    {
+    E = &Entries[Entry];
+    if (E->Always) continue;        // Already found
+    if (Mask)
+        {
+        for (c = 0; c < 3; c ++)
+            {
+            Center[c] = (E->Min[c] + E->Max[c]) * 0.5f;
+            Extent[c] = (E->Max[c] - E->Min[c]) * 0.5f;
+             }
+        if (Box_Planes(Center, Extent, Planes, Mask) < 0) continue;
+         }
+    Add_Found(E->Obj);
+     }
+
+// And the children:
+for (child = 0; child < 8; child ++)
+    if (N->Child[child] >= 0) Walk_Planes(N->Child[child], Planes, Mask);
+ }
+
+/***************************************************************************\
+  Finds the objects that might be seen by a camera at the specified
+  position and attitude, with the specified near and far planes and field
+  of view (as the pipeline culls: |X| < Z * FOV_Width in camera coords).
+  Objects set to always be found are included.
+  Returns the number of objects found (see Get_Found()).
+\***************************************************************************/
+int IMR_Octree::Find_Frustum(IMR_3DPoint &Pos, IMR_Attitude &Atd, float Near, float Far, float FOV_Width)
+{
+float Cam[6][4] = { {  0,  0,  1, 0 },     // Near
+                    {  0,  0, -1, 0 },     // Far
+                    {  1,  0,  0, 0 },     // Left
+                    { -1,  0,  0, 0 },     // Right
+                    {  0,  1,  0, 0 },     // Bottom
+                    {  0, -1,  0, 0 } };   // Top
+float Planes[6][4];
+IMR_Matrix Rot;
+IMR_Attitude CamAtd = Atd;
+int Entry, plane, c;
+
+Num_Found = 0;
+if (!Nodes) return 0;
+
+// Make the camera's rotation, the same way the pipeline does:
+CamAtd.X = -CamAtd.X;
+CamAtd.Y = -CamAtd.Y;
+CamAtd.Z = -CamAtd.Z;
+CamAtd.Fix_Ang();
+Rot.ZYXRotate(CamAtd.X, CamAtd.Y, CamAtd.Z);
+
+// Fill in the camera coord planes:
+Cam[0][3] = -Near;
+Cam[1][3] = Far;
+for (plane = 2; plane < 6; plane ++) Cam[plane][2] = FOV_Width;
+
+// And turn them into global coords (a camera point is the global point
+// less the position, times the rotation):
+for (plane = 0; plane < 6; plane ++)
+    {
+    for (c = 0; c < 3; c ++)
+        Planes[plane][c] = (Rot.Mtrx[c][0] * Cam[plane][0]) + (Rot.Mtrx[c][1] * Cam[plane][1]) + (Rot.Mtrx[c][2] * Cam[plane][2]);
+    Planes[plane][3] = Cam[plane][3] - ((Pos.X * Planes[plane][0]) + (Pos.Y * Planes[plane][1]) + (Pos.Z * Planes[plane][2]));
+     }
+
+// Add the entries that are always found, then walk the tree:
+for (Entry = Always_Entry; Entry >= 0; Entry = Entries[Entry].Next_Always)
+    Add_Found(Entries[Entry].Obj);
+Walk_Planes(0, Planes, 0x3F);
+
+// Return the number found:
+return Num_Found;
+ }
+
+/***************************************************************************\
+  Adds everything under the specified node that touches the specified
+  sphere to the found list.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Octree::Walk_Sphere(int Node, float *Center, float Radius)
+{
+IMR_OctreeNode *N = &Nodes[Node];
+float Min[3], Max[3];
+int Entry, child, c;
+
+if (!N->Count) return;
+
+// Check the loose box (the root also holds what's outside of it):
+if (Node)
+    {
+    for (c = 0; c < 3; c ++)
+        {
+        Min[c] = N->Center[c] - N->Half * 2;
+        Max[c] = N->Center[c] + N->Half * 2;
+         }
+    if (Box_DistSquared(Min, Max, Center) > Radius * Radius) return;
+     }
+
+// Check the entries:
+for (Entry = N->First; Entry >= 0; Entry = Entries[Entry].Next)
+    if (Box_DistSquared(Entries[Entry].Min, Entries[Entry].Max, Center) <= Radius * Radius)
+        Add_Found(Entries[Entry].Obj);
+
+// And the children:
+for (child = 0; child < 8; child ++)
+    if (N->Child[child] >= 0) Walk_Sphere(N->Child[child], Center, Radius);
+ }
+
+/***************************************************************************\
+  Finds the objects whose boxes touch the specified sphere (global coords).
+  Used to find what a light reaches.
+  Returns the number of objects found (see Get_Found()).
+\***************************************************************************/
+int IMR_Octree::Find_Sphere(float *Center, float Radius)
+{
+Num_Found = 0;
+if (!Nodes) return 0;
+Walk_Sphere(0, Center, Radius);
+return Num_Found;
+ }
+
+/***************************************************************************\
+  Checks if the specified box is hit by a ray (start, one over each part
+  of the direction, and length in terms of the direction).
+  Returns 1 if it's hit, otherwise 0.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_Octree::Box_Ray(float *Min, float *Max, float *Start, float *Inv_Dir, float Length)
+{
+float TMin = 0, TMax = Length, T1, T2, tmp;
+int c;
+
+for (c = 0; c < 3; c ++)
+    {
+    // Parallel to the slab, so it has to start in it:
+    if (Inv_Dir[c] == 0)
+        {
+        if (Start[c] < Min[c] || Start[c] > Max[c]) return 0;
+        continue;
+         }
+    T1 = (Min[c] - Start[c]) * Inv_Dir[c];
+    T2 = (Max[c] - Start[c]) * Inv_Dir[c];
+    if (T1 > T2) { tmp = T1; T1 = T2; T2 = tmp; }
+    if (T1 > TMin) TMin = T1;
+    if (T2 < TMax) TMax = T2;
+    if (TMin > TMax) return 0;
+     }
+return 1;
+ }
+
+/***************************************************************************\
+  Adds everything under the specified node whose box is hit by the
+  specified ray to the found list.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Octree::Walk_Ray(int Node, float *Start, float *Inv_Dir, float Length)
+{
+IMR_OctreeNode *N = &Nodes[Node];
+float Min[3], Max[3];
+int Entry, child, c;
+
+if (!N->Count) return;
+
+// Check the loose box (the root also holds what's outside of it):
+if (Node)
+    {
+    for (c = 0; c < 3; c ++)
+        {
+        Min[c] = N->Center[c] - N->Half * 2;
+        Max[c] = N->Center[c] + N->Half * 2;
+         }
+    if (!Box_Ray(Min, Max, Start, Inv_Dir, Length)) return;
+     }
+
+// Check the entries:
+for (Entry = N->First; Entry >= 0; Entry = Entries[Entry].Next)
+    if (Box_Ray(Entries[Entry].Min, Entries[Entry].Max, Start, Inv_Dir, Length))
+        Add_Found(Entries[Entry].Obj);
+
+// And the children:
+for (child = 0; child < 8; child ++)
+    if (N->Child[child] >= 0) Walk_Ray(N->Child[child], Start, Inv_Dir, Length);
+ }
+
+/***************************************************************************\
+  Finds the objects whose boxes are hit by the specified ray (global
+  coords), out to the specified length along the direction.  The objects
+  aren't in any order; use them to pick what to cast against.
+  Returns the number of objects found (see Get_Found()).
+\***************************************************************************/
+int IMR_Octree::Find_Ray(float *Start, float *Dir, float Length)
+{
+float Inv_Dir[3];
+int c;
+
+Num_Found = 0;
+if (!Nodes) return 0;
+for (c = 0; c < 3; c ++)
+    Inv_Dir[c] = Dir[c] != 0 ? 1.0f / Dir[c] : 0;
+Walk_Ray(0, Start, Inv_Dir, Length);
+return Num_Found;
+ }
@@ -0,0 +1,125 @@
+/****************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_Octree.hpp
+ Description: Header
+
+\****************************************************************/
+#ifndef __IMR_OCTREE__HPP
+#define __IMR_OCTREE__HPP
+
+// Include headers:
+#include <stdlib.h>
+#include <math.h>
+#include "imr_geom_prim.hpp"
+#include "imr_matrix.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
+
+// Constants:
+#define IMR_OCTREE_DEPTH            6       // Default levels below the root
+#define IMR_OCTREE_MAXDEPTH         10
+
+// Entry states:
+#define IMR_OCTREE_FREE             0       // Not in use
+#define IMR_OCTREE_NOBOUNDS         1       // In use, but has no bounds (so never found by bounds)
+#define IMR_OCTREE_INNODE           2       // Linked into the node that fits it
+
+// Defined elsewhere:
+class IMR_Object;
+
+// Object in the tree (global coords):
+struct IMR_OctreeEntry
+    {
+    IMR_Object *Obj;
+    float Min[3], Max[3];       // Bounding box
+    int State;
+    int Always;                 // Always found by frustum queries (lights, skyboxes)
+    int Node;                   // Node it's linked into (-1 if none)
+    int Prev, Next;             // Entries in the same node (or next free entry)
+    int Prev_Always, Next_Always;
+     };
+
+// Node of the tree.  Each node's box is twice the size of it's cell, so an
+// object only has to fit the cell by it's center and size:
+struct IMR_OctreeNode
+    {
+    float Center[3], Half;      // Cell (the loose box is Center +/- Half * 2)
+    int Child[8];               // Child at each octant (-1 if none)
+    int Parent, Level;
+    int First;                  // First entry in the node (-1 if none), or next free node
+    int Count;                  // Entries in the node and everything under it
+     };
+
+// Loose octree class.  Keeps the bounds of the objects in a scene so the
+// ones in a frustum, sphere or along a ray can be found without walking the
+// whole object tree.  Objects move through it as their bounds change:
+class IMR_Octree
+    {
+    protected:
+      IMR_OctreeNode *Nodes;
+      int Num_Nodes, Max_Nodes, Free_Node, Depth;
+      IMR_OctreeEntry *Entries;
+      int Max_Entries, Free_Entry, Always_Entry;
+      IMR_Object **Found;           // Objects found by the last query
+      int Num_Found, Max_Found;
+
+      // Protected member functions:
+      int New_Node(int Parent, int Octant);
+      int Find_Node(float *Min, float *Max);
+      void Link_Node(int Entry, int Node);
+      void Unlink_Node(int Entry);
+      void Prune_Node(int Node);
+      int Add_Found(IMR_Object *Obj);
+      void Walk_Planes(int Node, float (*Planes)[4], int Mask);
+      void Walk_Sphere(int Node, float *Center, float Radius);
+      void Walk_Ray(int Node, float *Start, float *Inv_Dir, float Length);
+      int Box_Planes(float *Center, float *Extent, float (*Planes)[4], int Mask);
+      int Box_Ray(float *Min, float *Max, float *Start, float *Inv_Dir, float Length);
+      inline float Box_DistSquared(float *Min, float *Max, float *P)
+          {
+          float Dist = 0, d;
+          for (int c = 0; c < 3; c ++)
+              {
+              if (P[c] < Min[c]) { d = Min[c] - P[c]; Dist += d * d; }
+              else if (P[c] > Max[c]) { d = P[c] - Max[c]; Dist += d * d; }
+               }
+          return Dist;
+           };
+
+    public:
+      IMR_Octree()
+          {
+          Nodes = NULL; Entries = NULL; Found = NULL;
+          Num_Nodes = Max_Nodes = Depth = 0;
+          Free_Node = -1;
+          Max_Entries = 0; Free_Entry = Always_Entry = -1;
+          Num_Found = Max_Found = 0;
+           };
+      ~IMR_Octree() { Reset(); };
+
+      // Init and de-init methods:
+      int Setup(float *Center, float Half, int NewDepth, int MaxObjects);
+      void Reset(void);
+
+      // Object methods:
+      int Add(IMR_Object *Obj, float *Min, float *Max);
+      void Move(int Entry, float *Min, float *Max);
+      void Set_Always(int Entry, int State);
+      void Remove(int Entry);
+
+      // Query methods (each returns the number of objects found):
+      int Find_Frustum(IMR_3DPoint &Pos, IMR_Attitude &Atd, float Near, float Far, float FOV_Width);
+      int Find_Sphere(float *Center, float Radius);
+      int Find_Ray(float *Start, float *Dir, float Length);
+      inline IMR_Object **Get_Found(void) { return Found; };
+      inline int Get_Num_Found(void) { return Num_Found; };
+
+      // Info methods:
+      inline int Get_Num_Nodes(void) { return Num_Nodes; };
+     };
+
+#endif
@@ -8,7 +8,7 @@
  Description: Palette module
  
 \****************************************************************/
-#include "IMR_Palette.hpp"
+#include "imr_palette.hpp"
 
 /***************************************************************************\
   Sets the palette and builds the colormapping tables.
@@ -14,8 +14,8 @@
 // Include headers:
 #include <stdlib.h>
 #include <math.h>
-#include "..\CallStatus\IMR_Log.hpp"
-#include "..\CallStatus\IMR_RetVals.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../CallStatus/imr_retvals.hpp"
 
 // Types:
 typedef struct { char R, G, B; } IMR_PaletteEntry;
@@ -8,7 +8,7 @@
  Description: Graphics pipeline.
  
 \****************************************************************/
-#include "IMR_Pipeline.hpp"
+#include "imr_pipeline.hpp"
 
 /***************************************************************************\
   Initializes memory for the pipeline.
@@ -20,21 +20,26 @@ int IMR_Pipeline::Init(int MaxVerts, int MaxPolys, int MaxLights)
 Vertices = new IMR_3DPoint[MaxVerts];
 Polygons = new IMR_Polygon[MaxPolys];
 DrawPolyList =(IMR_Polygon **)malloc(sizeof(IMR_Polygon *) * MaxPolys);
+Batches = (IMR_PipeBatch *)malloc(sizeof(IMR_PipeBatch) * MaxPolys);
+VtxNormals = (float *)malloc(sizeof(float) * 3 * MaxVerts);
+VtxRGB = (float *)malloc(sizeof(float) * 3 * MaxVerts);
+VtxActive = (char *)malloc(sizeof(char) * MaxVerts);
 
-// Set maximum number of lights:
-if (MaxLights > IMR_PIPE_MAX_LIGHTS)
-    Max_Lights = IMR_PIPE_MAX_LIGHTS;
-else
-    Max_Lights = MaxLights;
+// Make room for the lights (the list grows if more are added):
+if (MaxLights < 1) MaxLights = 1;
+Lights = (IMR_Light **)malloc(sizeof(IMR_Light *) * MaxLights);
+Max_Lights = Lights ? MaxLights : 0;
 
 // Check if we couldn't allocate the memory:
-if (!Vertices) Max_Vertices = 0;
+if (!Vertices || !VtxNormals || !VtxRGB || !VtxActive) Max_Vertices = 0;
 else Max_Vertices = MaxVerts;
 if (!Polygons || !DrawPolyList) Max_Polygons = 0;
 else Max_Polygons = MaxPolys;
+if (!Batches) Max_Batches = 0;
+else Max_Batches = MaxPolys;
 
 // Return an error if we couldn't allocate memory:
-if (!Vertices || !Polygons || !DrawPolyList)
+if (!Vertices || !Polygons || !DrawPolyList || !Batches || !VtxNormals || !VtxRGB || !VtxActive || !Lights)
     {
     IMR_LogMsg(__LINE__, __FILE__, "IMR_Pipeline::Init(): Out of memory! (%d,%d,%d)", MaxVerts, MaxPolys, MaxLights);
     return IMRERR_OUTOFMEM;
@@ -66,9 +71,18 @@ while (Flags.IsDrawing)
 delete [] Vertices;
 delete [] Polygons;
 delete [] DrawPolyList;
+if (Batches) free(Batches);
+if (Lights) free(Lights);
+if (VtxNormals) free(VtxNormals);
+if (VtxRGB) free(VtxRGB);
+if (VtxActive) free(VtxActive);
+Batches = NULL;
+Lights = NULL;
+VtxNormals = VtxRGB = NULL;
+VtxActive = NULL;
 
 // Reset stuff:
-Max_Vertices = Max_Polygons = 0;
+Max_Vertices = Max_Polygons = Max_Batches = Max_Lights = 0;
 Flags.ShouldQuit = 0;
 Flags.IsDrawing = 0;
  }
@@ -98,8 +112,23 @@ return Add_Model(Mdl, Pos, Transform);
 \***************************************************************************/
 int IMR_Pipeline::Add_Model(IMR_Model &Mdl, IMR_3DPoint &Pos, IMR_Matrix &Transform)
 {
-int FirstVtx, polyindx;
+return Add_Model(Mdl, Pos, Transform, NULL);
+ }
+
+/***************************************************************************\
+  Adds the specified model to the list and transforms the vertices using
+  the specified matrix.  The polys are recorded as a batch belonging to
+  the specified object (if any) so it's cached lighting can be used.  If 
+  per-vertex lighting is on, smooth polys are flagged to gather their 
+  lighting from the shared vertices.
+  Notes: Protected member function.
+  Returns: IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Pipeline::Add_Model(IMR_Model &Mdl, IMR_3DPoint &Pos, IMR_Matrix &Transform, IMR_Object *Obj)
+{
+int FirstVtx, FirstPoly, polyindx, VertexLit;
 int vtx, poly, index, tmp;
+float *Src, *Dest, Min[3], Max[3], dX, dY, dZ, RadiusSquared, DistSquared;
 
 // Save an index to the first vertex from this model in the list:
 FirstVtx = Num_Vertices;
@@ -116,6 +145,9 @@ if (tmp > Max_Vertices)
 else 
     Num_Vertices = tmp;
 
+// Save an index to the first poly from this model in the list:
+FirstPoly = Num_Polygons;
+
 // Do a quick hack to see if the model is a skybox...
 int isSkybox = Mdl.Polygons[0].Flags.Skybox;
 
@@ -129,6 +161,21 @@ for (vtx = 0, index = FirstVtx; vtx < Mdl.Num_Vertices; vtx ++, index ++)
     Vertices[index].ActiveToWorld();
      }
 
+// Rotate the vertex normals (if we're lighting per-vertex):
+VertexLit = Flags.VertexLighting && Mdl.VtxNormals && !isSkybox;
+memset(&VtxActive[FirstVtx], 0, Mdl.Num_Vertices);
+if (VertexLit)
+    {
+    Src = Mdl.VtxNormals;
+    Dest = &VtxNormals[FirstVtx * 3];
+    for (vtx = 0; vtx < Mdl.Num_Vertices; vtx ++, Src += 3, Dest += 3)
+        {
+        Dest[0] = (Src[0] * Transform.Mtrx[0][0]) + (Src[1] * Transform.Mtrx[1][0]) + (Src[2] * Transform.Mtrx[2][0]);
+        Dest[1] = (Src[0] * Transform.Mtrx[0][1]) + (Src[1] * Transform.Mtrx[1][1]) + (Src[2] * Transform.Mtrx[2][1]);
+        Dest[2] = (Src[0] * Transform.Mtrx[0][2]) + (Src[1] * Transform.Mtrx[1][2]) + (Src[2] * Transform.Mtrx[2][2]);
+         }
+     }
+
 // Now add all the polys to our list:
 for (poly = 0; poly < Mdl.Num_Polygons; poly ++)
     {
@@ -139,17 +186,18 @@ for (poly = 0; poly < Mdl.Num_Polygons; poly ++)
     if (Num_Polygons > Max_Polygons)
         {
         Num_Polygons = Max_Polygons;
-        return IMR_OK; // IMRERR_NONFATAL_SPACEOVERFLOW
+        break;
          }
     
     // Copy the poly:
     polyindx = Num_Polygons - 1;
     Polygons[polyindx] = Mdl.Polygons[poly];
     
-    // Setup lighting and vertices:
+    // Setup lighting and vertices (baked polys keep their lighting):
     for (vtx = 0; vtx < Polygons[polyindx].Num_Verts; vtx ++)
         {
         Polygons[polyindx].Vtx_List[vtx] = &Vertices[Mdl.Polygons[poly].Vtx_Index[vtx] + FirstVtx];
+        if (Polygons[polyindx].Flags.Baked) continue;
         Polygons[polyindx].UVI_Info[vtx].R = 0.0;
         Polygons[polyindx].UVI_Info[vtx].G = 0.0;
         Polygons[polyindx].UVI_Info[vtx].B = 0.0;
@@ -160,6 +208,63 @@ for (poly = 0; poly < Mdl.Num_Polygons; poly ++)
     Polygons[polyindx].Normal =  &Vertices[Polygons[polyindx].Normal_Index];
     Polygons[polyindx].Flags.Visible = 1;
     Polygons[polyindx].Flags.Culled = 0;
+    
+    // Smooth polys are lit from their vertices:
+    Polygons[polyindx].Flags.VertexLit = 0;
+    if (VertexLit && !Polygons[polyindx].Flags.HardEdge && 
+        !Polygons[polyindx].Flags.Baked && !Polygons[polyindx].Flags.LightSource)
+        {
+        Polygons[polyindx].Flags.VertexLit = 1;
+        for (vtx = 0; vtx < Polygons[polyindx].Num_Verts; vtx ++)
+            VtxActive[Mdl.Polygons[poly].Vtx_Index[vtx] + FirstVtx] = 1;
+         }
+     }
+
+// Record the batch:
+if (Num_Polygons > FirstPoly && Num_Batches < Max_Batches)
+    {
+    Batches[Num_Batches].Obj = Obj;
+    Batches[Num_Batches].FirstPoly = FirstPoly;
+    Batches[Num_Batches].Num_Polys = Num_Polygons - FirstPoly;
+    Batches[Num_Batches].FirstVtx = FirstVtx;
+    Batches[Num_Batches].Num_Verts = Mdl.Num_Vertices;
+    Batches[Num_Batches].VertexLit = VertexLit;
+    
+    // Find the bounding sphere (skyboxes are lit by everything):
+    if (isSkybox)
+        {
+        Batches[Num_Batches].Center[0] = Batches[Num_Batches].Center[1] = Batches[Num_Batches].Center[2] = 0.0;
+        Batches[Num_Batches].Radius = IMR_LIGHT_FARDISTANCE;
+         }
+    else
+        {
+        Min[0] = Max[0] = Vertices[FirstVtx].wX;
+        Min[1] = Max[1] = Vertices[FirstVtx].wY;
+        Min[2] = Max[2] = Vertices[FirstVtx].wZ;
+        for (index = FirstVtx + 1; index < FirstVtx + Mdl.Num_Vertices; index ++)
+            {
+            if (Vertices[index].wX < Min[0]) Min[0] = Vertices[index].wX;
+            if (Vertices[index].wX > Max[0]) Max[0] = Vertices[index].wX;
+            if (Vertices[index].wY < Min[1]) Min[1] = Vertices[index].wY;
+            if (Vertices[index].wY > Max[1]) Max[1] = Vertices[index].wY;
+            if (Vertices[index].wZ < Min[2]) Min[2] = Vertices[index].wZ;
+            if (Vertices[index].wZ > Max[2]) Max[2] = Vertices[index].wZ;
+             }
+        Batches[Num_Batches].Center[0] = (Min[0] + Max[0]) * 0.5;
+        Batches[Num_Batches].Center[1] = (Min[1] + Max[1]) * 0.5;
+        Batches[Num_Batches].Center[2] = (Min[2] + Max[2]) * 0.5;
+        RadiusSquared = 0.0;
+        for (index = FirstVtx; index < FirstVtx + Mdl.Num_Vertices; index ++)
+            {
+            dX = Vertices[index].wX - Batches[Num_Batches].Center[0];
+            dY = Vertices[index].wY - Batches[Num_Batches].Center[1];
+            dZ = Vertices[index].wZ - Batches[Num_Batches].Center[2];
+            DistSquared = (dX * dX) + (dY * dY) + (dZ * dZ);
+            if (DistSquared > RadiusSquared) RadiusSquared = DistSquared;
+             }
+        Batches[Num_Batches].Radius = sqrt(RadiusSquared);
+         }
+    ++ Num_Batches;
      }
 
 // And return ok:
@@ -167,16 +272,15 @@ return IMR_OK;
  }
 
 /***************************************************************************\
-  Adds the specified object to the list.
+  Adds the lights and model of the specified object (but not it's children)
+  to the list, at the specified global position and rotation.
   Notes: Protected member function.
-  Returns: True if successful, false otherwise.
 \***************************************************************************/
-int IMR_Pipeline::Add_Object(IMR_Object &Obj)
+void IMR_Pipeline::Add_Node(IMR_Object &Obj, IMR_3DPoint &Pos, IMR_Matrix &Rot)
 {
 int index;
-IMR_Light *TmpLight;
+IMR_Light *TmpLight, **NewList;
 IMR_Model *TmpModel;
-IMR_Object *TmpChild;
 
 // Add the lights to the list:
 for (index = 0; index < Obj.Get_Num_Lights(); index ++)
@@ -184,36 +288,61 @@ for (index = 0; index < Obj.Get_Num_Lights(); index ++)
     // Get a pointer to the light and make sure it exists:
     if (!(TmpLight = Obj.Get_Light(index))) break;
     
-    // One more light in the list:
-    ++ Num_Lights;
-    
-    // If we have too many, stop adding lights:
-    if (Num_Lights > Max_Lights)
+    // Make the list bigger if it's full:
+    if (Num_Lights >= Max_Lights)
         {
-        Num_Lights = Max_Lights;
-        break;
+        if (!(NewList = (IMR_Light **)realloc(Lights, sizeof(IMR_Light *) * (Max_Lights ? Max_Lights * 2 : 8))))
+            {
+            IMR_LogMsg(__LINE__, __FILE__, "IMR_Pipeline::Add_Node(): (NONFATAL) Out of memory for lights! (%d)", Num_Lights);
+            break;
+             }
+        Lights = NewList;
+        Max_Lights = Max_Lights ? Max_Lights * 2 : 8;
          }
     
     // Add the light to the list:
-    Lights[Num_Lights - 1] = TmpLight;
+    Lights[Num_Lights ++] = TmpLight;
     
     // Now find the world pos and direction of the light:
     if (TmpLight->Get_Type() == IMR_LIGHT_POINT || 
         TmpLight->Get_Type() == IMR_LIGHT_SPOT)
         {       
-        TmpLight->Get_WorldPos() = TmpLight->Get_Position() + Obj.Get_GlobalPos();
+        TmpLight->Get_WorldPos() = TmpLight->Get_Position() + Pos;
          }
     if (TmpLight->Get_Type() == IMR_LIGHT_CELESTIAL ||
         TmpLight->Get_Type() == IMR_LIGHT_SPOT)
         {
         TmpLight->Get_WorldDirection() = TmpLight->Get_Direction();
-        TmpLight->Get_WorldDirection().Transform(Obj.Get_RotMatrix());
+        TmpLight->Get_WorldDirection().Transform(Rot);
          }
      }
 
 // Now add the model to the list (if there is one):
 if (TmpModel = Obj.Get_Model())
-    Add_Model(*TmpModel, Obj.Get_GlobalPos(), Obj.Get_RotMatrix());
+    Add_Model(*TmpModel, Pos, Rot, &Obj);
+ }
+
+/***************************************************************************\
+  Adds the specified object and it's children to the list.  If the object
+  is the root of a hierarchy, the hierarchy's nodes are added in order
+  instead of walking the tree.
+  Returns: True if successful, false otherwise.
+\***************************************************************************/
+int IMR_Pipeline::Add_Object(IMR_Object &Obj)
+{
+IMR_Object *TmpChild;
+IMR_3DPoint Pos;
+IMR_Matrix Rot;
+int index;
+
+// Use the hierarchy if there is one:
+if (Obj.Get_Hierarchy() && Obj.Get_Hierarchy()->Get_Root() == &Obj)
+    return Add_Hierarchy(*Obj.Get_Hierarchy());
+
+// Add this object:
+Pos = Obj.Get_GlobalPos();
+Rot = Obj.Get_RotMatrix();
+Add_Node(Obj, Pos, Rot);
 
 // Now add all the children objects to the list:
 for (index = 0; index < Obj.Get_Num_Children(); index ++)
@@ -225,6 +354,73 @@ for (index = 0; index < Obj.Get_Num_Children(); index ++)
 return IMR_OK;
  }
 
+/***************************************************************************\
+  Adds each object in the specified hierarchy to the list, in one pass 
+  over it's nodes.
+  Returns: True if successful, false otherwise.
+\***************************************************************************/
+int IMR_Pipeline::Add_Hierarchy(IMR_Hierarchy &Hier)
+{
+IMR_3DPoint Pos;
+float *GPos;
+int node;
+
+// Make sure the transforms are up to date:
+Hier.Update();
+
+// Add each node:
+for (node = 0; node < Hier.Get_Num_Nodes(); node ++)
+    {
+    GPos = Hier.Get_GlobalPos(node);
+    Pos.X = GPos[0]; Pos.Y = GPos[1]; Pos.Z = GPos[2];
+    Add_Node(*Hier.Get_Object(node), Pos, Hier.Get_RotMatrix(node));
+     }
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Adds each object in the specified scene octree that the camera might see
+  (and the ones that are always drawn).  Their coords must be resolved.
+  Returns: IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_Pipeline::Add_Scene(IMR_Octree &Scene)
+{
+IMR_Object **Found, *Obj;
+IMR_3DPoint Pos;
+IMR_Attitude Atd;
+IMR_Matrix Rot;
+float FOV_Width;
+int Num_Found, index;
+
+// Make sure we have a camera:
+if (!CurrCamera || !CurrRenderer)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_Pipeline::Add_Scene(): Frame not setup!");
+    return IMRERR_NOTREADY;
+     }
+
+// Find what's in the view (as wide as Cull() keeps polys):
+Pos = CurrCamera->Get_Pos();
+Atd = CurrCamera->Get_Atd();
+FOV_Width = CurrRenderer->Get_WindowWidth() / CurrCamera->Lens_Get_Zoom();
+Num_Found = Scene.Find_Frustum(Pos, Atd, CurrCamera->Lens_Get_Near(), CurrCamera->Lens_Get_Far(), FOV_Width);
+Found = Scene.Get_Found();
+
+// Add each object (but not it's children, they're found on their own):
+for (index = 0; index < Num_Found; index ++)
+    {
+    Obj = Found[index];
+    Pos = Obj->Get_GlobalPos();
+    Rot = Obj->Get_RotMatrix();
+    Add_Node(*Obj, Pos, Rot);
+     }
+
+// And return ok:
+return IMR_OK;
+ }
+
 /***************************************************************************\
   Sets up the pipeline for the next frame.
   Returns IMR_OK.
@@ -236,7 +432,7 @@ CurrCamera = &Cam;
 CurrRenderer = &Rend;
 
 // Reset the lists:
-Num_Vertices = Num_Polygons = Num_Lights = 0;
+Num_Vertices = Num_Polygons = Num_Lights = Num_Batches = 0;
 
 // Reset debug info:
 #ifdef IMR_DEBUG
@@ -257,19 +453,156 @@ return Add_Object(Obj);
  }
 
 /***************************************************************************\
-  Cycles through each polygon in the list and lights it.
+  Adds the light at each shared vertex to the vertex lit polys in the 
+  specified range and keeps the result in range of 0-1.
+  Notes: Protected member function.
 \***************************************************************************/
-int IMR_Pipeline::Illuminate(void)
+void IMR_Pipeline::Gather_VertexLighting(int FirstPoly, int NumPolys)
+{
+int poly, vtx;
+float *Src;
+IMR_Polygon *Poly;
+
+for (poly = FirstPoly, Poly = &Polygons[FirstPoly]; poly < FirstPoly + NumPolys; poly ++, Poly ++)
+    {
+    if (!Poly->Flags.VertexLit) continue;
+    for (vtx = 0; vtx < Poly->Num_Verts; vtx ++)
+        {
+        Src = &VtxRGB[(Poly->Vtx_List[vtx] - Vertices) * 3];
+        Poly->UVI_Info[vtx].R += Src[0];
+        Poly->UVI_Info[vtx].G += Src[1];
+        Poly->UVI_Info[vtx].B += Src[2];
+        if (Poly->UVI_Info[vtx].R > 1.0) Poly->UVI_Info[vtx].R = 1.0;
+        if (Poly->UVI_Info[vtx].G > 1.0) Poly->UVI_Info[vtx].G = 1.0;
+        if (Poly->UVI_Info[vtx].B > 1.0) Poly->UVI_Info[vtx].B = 1.0;
+         }
+     }
+ }
+
+/***************************************************************************\
+  Finds the lights that reach the specified batch's bounding sphere.  If 
+  there are more than IMR_PIPE_MAX_OBJLIGHTS, only the ones that add the 
+  most light are kept.
+  Notes: Protected member function.  Each light in the frame is checked;
+         the scene octree only has the boxes of the models, not how far
+         the lights reach, so it can't find them.
+  Returns the number of lights in the list.
+\***************************************************************************/
+int IMR_Pipeline::Find_BatchLights(IMR_PipeBatch *Batch, IMR_Light **List)
+{
+float Rank, Ranks[IMR_PIPE_MAX_OBJLIGHTS];
+int index, slot, Num;
+
+// Loop through the lights and keep the list sorted by rank:
+Num = 0;
+for (index = 0; index < Num_Lights; index ++)
+    {
+    // Skip the light if it doesn't reach the batch:
+    if (!Lights[index]->Find_Influence(Batch->Center, Batch->Radius, Rank)) continue;
+    
+    // If the list is full, make sure this one beats the weakest:
+    if (Num == IMR_PIPE_MAX_OBJLIGHTS)
+        {
+        if (Rank <= Ranks[Num - 1]) continue;
+        -- Num;
+         }
+    
+    // Insert the light:
+    for (slot = Num; slot > 0 && Ranks[slot - 1] < Rank; slot --)
+        {
+        List[slot] = List[slot - 1];
+        Ranks[slot] = Ranks[slot - 1];
+         }
+    List[slot] = Lights[index];
+    Ranks[slot] = Rank;
+    ++ Num;
+     }
+
+// Return the number of lights found:
+return Num;
+ }
+
+/***************************************************************************\
+  Applies either the static or the dynamic lights in the specified list to
+  the batch.  Vertex lit polys are lit through their shared vertices and 
+  the rest are lit per-corner.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Pipeline::Light_Batch(IMR_PipeBatch *Batch, IMR_Light **List, int Num, int Dynamic)
 {
 int index;
 
+// Light the shared vertices:
+if (Batch->VertexLit)
+    {
+    memset(&VtxRGB[Batch->FirstVtx * 3], 0, sizeof(float) * 3 * Batch->Num_Verts);
+    for (index = 0; index < Num; index ++)
+        if (List[index]->Is_Dynamic() == Dynamic) 
+            List[index]->IlluminateVertexList(&Vertices[Batch->FirstVtx], &VtxNormals[Batch->FirstVtx * 3],
+                                              &VtxRGB[Batch->FirstVtx * 3], &VtxActive[Batch->FirstVtx],
+                                              Batch->Num_Verts);
+    Gather_VertexLighting(Batch->FirstPoly, Batch->Num_Polys);
+     }
+
+// Then light the rest of the polys:
+for (index = 0; index < Num; index ++)
+    if (List[index]->Is_Dynamic() == Dynamic) 
+        List[index]->IlluminatePolyList(&Polygons[Batch->FirstPoly], Batch->Num_Polys);
+ }
+
+/***************************************************************************\
+  Cycles through each batch of polygons in the list and lights it using
+  only the lights that reach it.  Static lights are only applied when an 
+  object's cached lighting is stale; dynamic lights are added on top every
+  frame.  With per-vertex lighting on, smooth polys are lit once per shared
+  vertex and gather the result.
+\***************************************************************************/
+int IMR_Pipeline::Illuminate(void)
+{
+int index, batch, Num, HasDynamic, Cached;
+IMR_LightCacheKey Key;
+IMR_Polygon *PList;
+IMR_LightCache *Cache;
+IMR_PipeBatch *Batch;
+IMR_Light *List[IMR_PIPE_MAX_OBJLIGHTS];
+
 // Calculate the centroids for each poly:
 for (index = 0; index < Num_Polygons; index ++)
     Polygons[index].Find_Centroid();
 
-// Loop through each light and illuminate the polygon list:
-for (index = 0; index < Num_Lights; index ++)
-    Lights[index]->IlluminatePolyList(Polygons, Num_Polygons);
+// Loop through each batch:
+for (batch = 0, Batch = Batches; batch < Num_Batches; batch ++, Batch ++)
+    {
+    PList = &Polygons[Batch->FirstPoly];
+    
+    // Find the lights for this batch and the key for the static ones:
+    Num = Find_BatchLights(Batch, List);
+    Key.Reset();
+    HasDynamic = 0;
+    for (index = 0; index < Num; index ++)
+        {
+        if (!List[index]->Is_Dynamic()) List[index]->Hash_State(Key);
+        else HasDynamic = 1;
+         }
+    
+    // Apply the static lights (unless the object's cache is still good):
+    Cache = NULL;
+    Cached = 0;
+    if (Batch->Obj)
+        {
+        Cache = Batch->Obj->Get_LightCache();
+        Batch->Obj->Hash_Transform(Key);
+        Cached = IMR_ISOK(Cache->Fetch(PList, Batch->Num_Polys, Key));
+         }
+    if (!Cached)
+        {
+        Light_Batch(Batch, List, Num, 0);
+        if (Cache) Cache->Store(PList, Batch->Num_Polys, Key);
+         }
+    
+    // And add the dynamic lights on top:
+    if (HasDynamic) Light_Batch(Batch, List, Num, 1);
+     }
 
 // Return ok:
 return IMR_OK;
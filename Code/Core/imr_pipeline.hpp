@@ -13,14 +13,24 @@
 
 #include <stdlib.h>
 #include <windows.h>
-#include "IMR_Geometry.hpp"
-#include "IMR_Matrix.hpp"
-#include "IMR_Camera.hpp"
-#include "..\RendCore\DirectX6\IMR_Renderer.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
-#include "..\Foundation\IMR_List.hpp"
+#include "imr_geometry.hpp"
+#include "imr_matrix.hpp"
+#include "imr_camera.hpp"
+#include "../RendCore/DirectX6/imr_renderer.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../Foundation/imr_list.hpp"
 
-#define IMR_PIPE_MAX_LIGHTS 64
+#define IMR_PIPE_MAX_OBJLIGHTS 8      // Max lights applied to a single object
+
+// Batch of polys added from a single model:
+struct IMR_PipeBatch
+    {
+    IMR_Object *Obj;                // Object the polys belong to (NULL if none)
+    int FirstPoly, Num_Polys;
+    int FirstVtx, Num_Verts;
+    int VertexLit;                  // Flags if any polys are lit from shared vertices
+    float Center[3], Radius;        // Bounding sphere (world coords)
+     };
 
 // Pipeline class:
 class IMR_Pipeline
@@ -29,7 +39,8 @@ class IMR_Pipeline
       // Counters:
       int Num_Vertices, Max_Vertices,
            Num_Polygons, Max_Polygons,
-           Num_Lights, Max_Lights;
+           Num_Lights, Max_Lights,
+           Num_Batches, Max_Batches;
       int PolysCulled;
       
       // Interfaces used for the current frame:
@@ -41,15 +52,27 @@ class IMR_Pipeline
           {
           unsigned int IsDrawing:1;
           unsigned int ShouldQuit:1;
+          unsigned int VertexLighting:1;
            } Flags;
       
       // Lists:
       IMR_3DPoint                *Vertices;
       IMR_Polygon                *Polygons;
-      IMR_Light                  *Lights[IMR_PIPE_MAX_LIGHTS];
+      IMR_Light                  **Lights;
+      IMR_PipeBatch              *Batches;
+      float                      *VtxNormals;     // World normal at each vertex (X, Y, Z)
+      float                      *VtxRGB;         // Light at each vertex (R, G, B)
+      char                       *VtxActive;      // Flags if a vertex is used by a vertex lit poly
     
       // Temporary storage:
       IMR_Polygon **DrawPolyList;
+      
+      // Protected member functions:
+      int Add_Model(IMR_Model &Mdl, IMR_3DPoint &Pos, IMR_Matrix &Transform, IMR_Object *Obj);
+      void Add_Node(IMR_Object &Obj, IMR_3DPoint &Pos, IMR_Matrix &Rot);
+      void Gather_VertexLighting(int FirstPoly, int NumPolys);
+      int Find_BatchLights(IMR_PipeBatch *Batch, IMR_Light **List);
+      void Light_Batch(IMR_PipeBatch *Batch, IMR_Light **List, int Num, int Dynamic);
     
     public:
       IMR_Pipeline() 
@@ -57,12 +80,17 @@ class IMR_Pipeline
           CurrCamera = NULL;
           CurrRenderer = NULL;
           DrawPolyList = NULL;
-          Num_Vertices = Num_Polygons = Num_Lights = 0; 
-          Max_Vertices = Max_Polygons = Max_Lights = 0;
+          Num_Vertices = Num_Polygons = Num_Lights = Num_Batches = 0; 
+          Max_Vertices = Max_Polygons = Max_Lights = Max_Batches = 0;
           Vertices = NULL;
           Polygons = NULL;
+          Batches = NULL;
+          Lights = NULL;
+          VtxNormals = VtxRGB = NULL;
+          VtxActive = NULL;
           Flags.IsDrawing = 0;
           Flags.ShouldQuit = 0;
+          Flags.VertexLighting = 0;
            };
       
       // Our asynchronous draw thread:
@@ -78,12 +106,18 @@ class IMR_Pipeline
       int Add_Model(IMR_Model &Mdl, IMR_3DPoint &Pos, IMR_Attitude &Rot);
       int Add_Model(IMR_Model &Mdl, IMR_3DPoint &Pos, IMR_Matrix &Transform);
       int Add_Object(IMR_Object &Obj);
+      int Add_Hierarchy(IMR_Hierarchy &Hier);
+      int Add_Scene(IMR_Octree &Scene);
       int Illuminate(void);
       int Transform(void);
       int Cull(void);
       int ClipAndProject(void);
       int DrawFrame(void);
       
+      // Lighting mode methods:
+      void Set_VertexLighting(int State) { Flags.VertexLighting = State ? 1 : 0; };
+      int Get_VertexLighting(void) { return Flags.VertexLighting; };
+      
       // Asynchroneous draw methods:
       int Async_IsDrawing(void) { return Flags.IsDrawing; };
             
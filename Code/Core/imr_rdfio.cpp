@@ -8,7 +8,7 @@
  Description: RDF i/o encapsulation class
  
 \****************************************************************/
-#include "IMR_RDFIo.hpp"
+#include "imr_rdfio.hpp"
 
 /***************************************************************************\
   Returns an index to the specified file in the directory.
@@ -9,8 +9,8 @@
 #define __IMR_RDFIO__HPP
 
 // Include headers:
-#include <sys\types.h>
-#include <sys\stat.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <io.h>
 #include <stdio.h>
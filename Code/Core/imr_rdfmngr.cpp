@@ -8,7 +8,7 @@
  Description: RDF manager
  
 \****************************************************************/
-#include "IMR_RDFMngr.hpp"
+#include "imr_rdfmngr.hpp"
 
 /****************************************************************\
   Returns true if the passed filename (without path) is the same 
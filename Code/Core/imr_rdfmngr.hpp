@@ -11,21 +11,21 @@
 #ifndef IMR_RDFMNGR_HPP_INCLUDED
 #define IMR_RDFMNGR_HPP_INCLUDED
 
-#include <sys\types.h>
-#include <sys\stat.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
-#include <io.h>
 #include <malloc.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
-#include "..\CallStatus\IMR_Log.hpp"
+#include "../Foundation/imr_compat.hpp"
+#include "../CallStatus/imr_log.hpp"
 
 // RDF resource type:
 typedef int IMR_RDFResourceDesc;
 
 // Constants:
-const IMR_MaxRDFListEntries = 1024;
+const int IMR_MaxRDFListEntries = 1024;
 
 // RDF list entry class:
 class IMR_RDFListEnt
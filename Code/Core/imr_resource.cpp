@@ -8,7 +8,7 @@
  Description: RDFManager wrapper class.
  
 \****************************************************************/
-#include "IMR_Resource.hpp"
+#include "imr_resource.hpp"
 
 // Globals:
 IMR_ResourceManager IMR_Resources;
@@ -11,16 +11,16 @@
 #ifndef IMR_RESOURCE_HPP_INCLUDED
 #define IMR_RESOURCE_HPP_INCLUDED
 
-#include <sys\types.h>
-#include <sys\stat.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
-#include <io.h>
 #include <malloc.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
-#include "..\CallStatus\IMR_Log.hpp"
-#include "..\Core\IMR_RDFMngr.hpp"
+#include "../Foundation/imr_compat.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../Core/imr_rdfmngr.hpp"
 
 // Resource manager class:
 class IMR_ResourceManager
@@ -8,11 +8,12 @@
  Description: Lookup tables
  
 \****************************************************************/
-#include "IMR_Table.hpp"
+#include "imr_table.hpp"
 
 // Globals:
 int TablesBuilt = 0;
 float SinTable[IMR_DEGREECOUNT + 1], CosTable[IMR_DEGREECOUNT + 1];
+float AttenTable[IMR_ATTENCOUNT + 2];
 
 /***************************************************************************\
   Generates all the lookup tables if needed.
@@ -30,6 +31,11 @@ for (int Angle = 0; Angle <= IMR_DEGREECOUNT; ++ Angle)
     SinTable[Angle] = sin(AngToRad * Degree);
      }
 
+// Build the attenuation table (1 - sqrt of the squared distance ratio):
+for (int Entry = 0; Entry <= IMR_ATTENCOUNT; ++ Entry)
+    AttenTable[Entry] = 1.0 - sqrt((float)Entry / IMR_ATTENCOUNT);
+AttenTable[IMR_ATTENCOUNT + 1] = 0.0;
+
 // Flag that the tables have been initialized:
 TablesBuilt = 1;
  }
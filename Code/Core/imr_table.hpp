@@ -7,6 +7,8 @@
  Filename: IMR_Table.hpp
  Description: Header for all tables
  Notes: DegreeCount must be a power of 2!
+        Define IMR_FASTMATH to use the table and bit trick
+        versions of sqrt() in the lighting and vector code.
  
 \****************************************************************/
 #ifndef __IMR_TABLE__HPP
@@ -20,11 +22,67 @@
 #define IMR_DEGREEMOD       1024
 #define IMR_DEGREEAND       1023
 #define IMR_HALFDEGREECOUNT 512
+#define IMR_ATTENCOUNT      1024      // Entries in the attenuation table
 
 // Globals:
 extern float SinTable[IMR_DEGREECOUNT + 1], CosTable[IMR_DEGREECOUNT + 1];
+extern float AttenTable[IMR_ATTENCOUNT + 2];
 
 // Prototypes:
 void IMR_BuildTables(void);
 
+/***************************************************************************\
+  Returns 1 / sqrt(X).  With IMR_FASTMATH, uses the integer bit trick for a
+  first guess and one Newton-Raphson step (about 0.2% max error).
+  Note: X must be positive.
+\***************************************************************************/
+inline float IMR_RSqrt(float X)
+{
+#ifdef IMR_FASTMATH
+    union { float f; int i; } Guess;
+    float HalfX = X * 0.5f;
+    
+    // Make a first guess from the exponent and mantissa bits:
+    Guess.f = X;
+    Guess.i = 0x5F3759DF - (Guess.i >> 1);
+    
+    // And refine it:
+    return Guess.f * (1.5f - (HalfX * Guess.f * Guess.f));
+#else
+    return 1.0f / (float)sqrt(X);
+#endif
+ }
+
+/***************************************************************************\
+  Returns sqrt(X).  With IMR_FASTMATH, finds it as X * IMR_RSqrt(X).
+\***************************************************************************/
+inline float IMR_Sqrt(float X)
+{
+#ifdef IMR_FASTMATH
+    if (X <= 0.0f) return 0.0f;
+    return X * IMR_RSqrt(X);
+#else
+    return (float)sqrt(X);
+#endif
+ }
+
+/***************************************************************************\
+  Returns the linear light falloff (1 - Distance / Range) given the ratio
+  of the squared distance to the squared range, so no sqrt is needed.  With
+  IMR_FASTMATH, reads the attenuation table (interpolated).
+  Returns 0 if the ratio is out of range.
+\***************************************************************************/
+inline float IMR_Attenuate(float DistSquaredRatio)
+{
+if (DistSquaredRatio >= 1.0f) return 0.0f;
+if (DistSquaredRatio <= 0.0f) return 1.0f;
+#ifdef IMR_FASTMATH
+    float Pos = DistSquaredRatio * IMR_ATTENCOUNT;
+    int Index = (int)Pos;
+    return AttenTable[Index] + ((AttenTable[Index + 1] - AttenTable[Index]) * (Pos - Index));
+#else
+    return 1.0f - (float)sqrt(DistSquaredRatio);
+#endif
+ }
+
 #endif
@@ -0,0 +1,58 @@
+/***************************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_Compat.hpp
+ Description: Header.  Covers the few compiler and system calls the
+              engine uses that only Win32 compilers have, so the parts
+              that don't draw anything (collision, objects, the benches)
+              also build with gcc on other systems.
+
+\***************************************************************************/
+#ifndef __IMR_COMPAT__HPP
+#define __IMR_COMPAT__HPP
+
+// Pick the system:
+#if defined(__WATCOMC__) || defined(_WIN32)
+#define IMR_WIN32
+#else
+#define IMR_POSIX
+#endif
+
+#ifdef IMR_WIN32
+
+// Include stuff:
+#include <io.h>
+#include <windows.h>
+
+#else
+
+// Include stuff:
+#include <unistd.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Case insensitive string compares:
+#define stricmp strcasecmp
+#define strnicmp strncasecmp
+
+// Win32 flags (there's no text mode to ask for or not):
+#ifndef TRUE
+#define TRUE        1
+#define FALSE       0
+#endif
+#ifndef O_BINARY
+#define O_BINARY    0
+#define O_TEXT      0
+#endif
+#ifndef S_IREAD
+#define S_IREAD     S_IRUSR
+#define S_IWRITE    S_IWUSR
+#endif
+
+#endif
+
+#endif
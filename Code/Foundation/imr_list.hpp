@@ -11,15 +11,34 @@
 // Include stuff:
 #include <stdlib.h>
 #include <string.h>
+#include "imr_namehash.hpp"
+
+// Base class for items in a named list ---
+// The list gives each item it adds a flag to set when it's renamed, so
+// the item's Set_Name() must call Name_Changed():
+class IMR_NamedItem
+    {
+    protected:
+      int *Renamed;                 // Flag of the list it's in (or NULL)
+      inline void Name_Changed(void) { if (Renamed) *Renamed = 1; };
+
+    public:
+      IMR_NamedItem() { Renamed = NULL; };
+      inline void Set_RenamedFlag(int *Flag) { Renamed = Flag; };
+     };
 
 // List class with named items ---
-// For use with classes with the Is(), SetName(), and GetName() member functions:
+// For use with classes derived from IMR_NamedItem, with the Is(), SetName(),
+// and GetName() member functions.  The names are hashed, and indexed again
+// on the next look up after an item is renamed:
 template <class IMR_NLT>
 class IMR_NamedList
     {
     private:
       int Num_Items, Max_Items;
       IMR_NLT *Items;
+      IMR_NameHash<int> Index;      // Index of each item by name
+      int Renamed;                  // An item was renamed since they were indexed
 
     public:
       IMR_NamedList();
@@ -30,10 +49,12 @@ class IMR_NamedList
           {
           delete [] Items;
           Max_Items = Num_Items = 0;
+          Index.Reset();
            };
 
       IMR_NLT *Add_Item(char *Name);
       void Delete_Item(char *Name);
+      void Reindex(void);
 
       IMR_NLT *Get_Item(char *Name, int *Index);
       inline int Get_Item_Index(char *Name) { int tmp; Get_Item(Name, &tmp); return tmp; };
@@ -47,7 +68,7 @@ class IMR_NamedList
   Default constructor.
 \***************************************************************************/
 template <class IMR_NLT>
-IMR_NamedList<IMR_NLT>::IMR_NamedList(): Num_Items(0), Items(0), Max_Items(0)
+IMR_NamedList<IMR_NLT>::IMR_NamedList(): Num_Items(0), Items(0), Max_Items(0), Renamed(0)
 {
  }
 
@@ -55,8 +76,9 @@ IMR_NamedList<IMR_NLT>::IMR_NamedList(): Num_Items(0), Items(0), Max_Items(0)
   Constructor with size argument.
 \***************************************************************************/
 template <class IMR_NLT>
-IMR_NamedList<IMR_NLT>::IMR_NamedList(int max): Max_Items(max), Items(new IMR_NLT[max])
+IMR_NamedList<IMR_NLT>::IMR_NamedList(int max): Max_Items(max), Items(new IMR_NLT[max]), Renamed(0)
 {
+Index.Init(max);
  }
 
 /***************************************************************************\
@@ -68,6 +90,7 @@ void IMR_NamedList<IMR_NLT>::Init(int max)
 Max_Items = max;
 Items = new IMR_NLT[max];
 if (!Items) Max_Items = 0;
+Index.Init(Max_Items);
  }
 
 /***************************************************************************\
@@ -86,8 +109,10 @@ if (Num_Items > Max_Items)
     return NULL;
      }
 
-// Set the name of the new item:
+// Set the name of the new item (and have it tell us if it's renamed):
 Items[Num_Items - 1].Set_Name(Name);
+Items[Num_Items - 1].Set_RenamedFlag(&Renamed);
+Index.Add(Items[Num_Items - 1].Get_Name(), Num_Items - 1);
 
 // And return a pointer to it:
 return &Items[Num_Items - 1];
@@ -111,6 +136,21 @@ memmove((void *)&Items[ItemIndex],
 
 // One less item:
 -- Num_Items;
+
+// The items after it have moved, so index them all again:
+Reindex();
+ }
+
+/***************************************************************************\
+  Indexes the names of all the items again.
+\***************************************************************************/
+template <class IMR_NLT>
+void IMR_NamedList<IMR_NLT>::Reindex(void)
+{
+Renamed = 0;
+Index.Clear();
+for (int item = 0; item < Num_Items; item ++)
+    Index.Add(Items[item].Get_Name(), item);
  }
 
 /***************************************************************************\
@@ -119,16 +159,16 @@ memmove((void *)&Items[ItemIndex],
 template <class IMR_NLT>
 IMR_NLT *IMR_NamedList<IMR_NLT>::Get_Item(char *Name, int *index)
 {
-// Search each item in the list:
-for (int item = 0; item < Num_Items; item ++)
-    if (Items[item].Is(Name)) 
-        {
-        if (index) *index = item;
-        return &Items[item];
-         }
+int item;
 
-// No match was found, so return null:
-return NULL;
+// Index the names again if an item was renamed:
+if (Renamed) Reindex();
+
+// Look the name up:
+if (!Index.Get(Name, &item)) return NULL;
+
+if (index) *index = item;
+return &Items[item];
  }
 
 // List class with id'd items ---
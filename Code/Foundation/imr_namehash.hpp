@@ -0,0 +1,175 @@
+/***************************************************************************\
+  File: IMR_NameHash.hpp
+  Description: Templated hash table for looking up items by name (case
+               insensitive, like the Is() member functions).  No cpp module!
+  Author: Daniel Hawthorn
+  Modified:
+
+\***************************************************************************/
+#ifndef __IMR_NAMEHASH__HPP
+#define __IMR_NAMEHASH__HPP
+
+// Include stuff:
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "imr_compat.hpp"
+
+// Constants:
+#define IMR_NAMEHASH_MINSIZE    16
+
+/***************************************************************************\
+  Returns the hash key of the specified name, ignoring case.
+\***************************************************************************/
+inline unsigned int IMR_NameHash_Key(char *Name)
+{
+unsigned int Key = 2166136261u;
+
+for (; *Name; Name ++)
+    Key = (Key ^ (unsigned int)tolower((unsigned char)*Name)) * 16777619u;
+return Key;
+ }
+
+// Hash table of names ---
+// The names aren't copied, so each name must stay put (and keep the same
+// value) while it's in the table.  There's no removal; clear the table and
+// add everything again instead:
+template <class IMR_NHT>
+class IMR_NameHash
+    {
+    private:
+      struct Entry
+          {
+          unsigned int Key;
+          char *Name;                   // NULL if the entry is empty
+          IMR_NHT Item;
+           };
+      Entry *Table;
+      int Size, Num_Entries;            // Size is always a power of two
+
+      int Grow(int NewSize);
+
+    public:
+      IMR_NameHash() { Table = NULL; Size = Num_Entries = 0; };
+      ~IMR_NameHash() { Reset(); };
+      int Init(int Max);
+      inline void Reset(void)
+          {
+          free(Table);
+          Table = NULL;
+          Size = Num_Entries = 0;
+           };
+      inline void Clear(void)
+          {
+          for (int entry = 0; entry < Size; entry ++) Table[entry].Name = NULL;
+          Num_Entries = 0;
+           };
+
+      int Add(char *Name, IMR_NHT Item);
+      int Get(char *Name, IMR_NHT *Item);
+      inline int Get_Num_Entries(void) { return Num_Entries; };
+     };
+
+/***************************************************************************\
+  Makes the table big enough to hold the specified number of names without
+  growing.  Returns 1 if successful, otherwise 0.
+\***************************************************************************/
+template <class IMR_NHT>
+int IMR_NameHash<IMR_NHT>::Init(int Max)
+{
+int NewSize = IMR_NAMEHASH_MINSIZE;
+
+// Keep the table at most half full:
+while (NewSize < Max * 2) NewSize <<= 1;
+if (NewSize <= Size) return 1;
+return Grow(NewSize);
+ }
+
+/***************************************************************************\
+  Moves the table into one of the specified size.
+  Returns 1 if successful, otherwise 0.
+\***************************************************************************/
+template <class IMR_NHT>
+int IMR_NameHash<IMR_NHT>::Grow(int NewSize)
+{
+Entry *Old = Table;
+int OldSize = Size, entry, slot;
+
+// Make the new table:
+Table = (Entry *)malloc(sizeof(Entry) * NewSize);
+if (!Table)
+    {
+    Table = Old;
+    return 0;
+     }
+Size = NewSize;
+for (entry = 0; entry < Size; entry ++) Table[entry].Name = NULL;
+
+// And move the old entries over:
+for (entry = 0; entry < OldSize; entry ++)
+    if (Old[entry].Name)
+        {
+        for (slot = Old[entry].Key & (Size - 1); Table[slot].Name; slot = (slot + 1) & (Size - 1));
+        Table[slot] = Old[entry];
+         }
+free(Old);
+return 1;
+ }
+
+/***************************************************************************\
+  Adds the specified name to the table.  If the name is already in the
+  table, the item it had is kept.
+  Returns 1 if the name was added, otherwise 0.
+\***************************************************************************/
+template <class IMR_NHT>
+int IMR_NameHash<IMR_NHT>::Add(char *Name, IMR_NHT Item)
+{
+unsigned int Key;
+int slot;
+
+if (!Name) return 0;
+
+// Keep the table at most half full:
+if ((Num_Entries + 1) * 2 > Size)
+    if (!Grow(Size ? Size * 2 : IMR_NAMEHASH_MINSIZE)) return 0;
+
+// Find the end of the run of entries for the key, making sure the name
+// isn't already there:
+Key = IMR_NameHash_Key(Name);
+for (slot = Key & (Size - 1); Table[slot].Name; slot = (slot + 1) & (Size - 1))
+    if (Table[slot].Key == Key && !stricmp(Table[slot].Name, Name)) return 0;
+
+// And fill it in:
+Table[slot].Key = Key;
+Table[slot].Name = Name;
+Table[slot].Item = Item;
+++ Num_Entries;
+return 1;
+ }
+
+/***************************************************************************\
+  Looks up the specified name, and gets its item if it's there.
+  Returns 1 if the name was found, otherwise 0.
+\***************************************************************************/
+template <class IMR_NHT>
+int IMR_NameHash<IMR_NHT>::Get(char *Name, IMR_NHT *Item)
+{
+unsigned int Key;
+int slot;
+
+if (!Name || !Table) return 0;
+
+// Check each entry in the run for the key:
+Key = IMR_NameHash_Key(Name);
+for (slot = Key & (Size - 1); Table[slot].Name; slot = (slot + 1) & (Size - 1))
+    if (Table[slot].Key == Key && !stricmp(Table[slot].Name, Name))
+        {
+        if (Item) *Item = Table[slot].Item;
+        return 1;
+         }
+
+// No match was found:
+return 0;
+ }
+
+#endif
@@ -0,0 +1,309 @@
+/***************************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_Thread.cpp
+ Description: Worker thread pool.  Items in a job are handed out one at
+              a time, so the workers stay busy even when some items
+              take much longer than others.  Uses Win32 threads and
+              events, or pthreads on other systems.
+
+\***************************************************************************/
+#include "imr_thread.hpp"
+
+#ifdef IMR_WIN32
+
+/***************************************************************************\
+  Starts the specified number of worker threads.  If NumThreads is 0, one
+  thread is started for each processor.  The thread calling Run() also
+  does work, so a pool with no workers simply runs jobs serially.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_ThreadPool::Init(int NumThreads)
+{
+SYSTEM_INFO SysInfo;
+DWORD ThreadID;
+
+// Get rid of any old threads:
+Shutdown();
+
+// Find the number of threads to use:
+if (NumThreads <= 0)
+    {
+    GetSystemInfo(&SysInfo);
+    NumThreads = SysInfo.dwNumberOfProcessors - 1;     // The caller is a worker, too
+     }
+if (NumThreads > IMR_THREAD_MAXTHREADS) NumThreads = IMR_THREAD_MAXTHREADS;
+
+// Start the workers:
+ShouldQuit = 0;
+for (Num_Threads = 0; Num_Threads < NumThreads; Num_Threads ++)
+    {
+    StartEvents[Num_Threads] = CreateEvent(NULL, FALSE, FALSE, NULL);
+    DoneEvents[Num_Threads] = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!StartEvents[Num_Threads] || !DoneEvents[Num_Threads])
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_ThreadPool::Init(): Could not create events!");
+        if (StartEvents[Num_Threads]) CloseHandle(StartEvents[Num_Threads]);
+        if (DoneEvents[Num_Threads]) CloseHandle(DoneEvents[Num_Threads]);
+        break;
+         }
+    Workers[Num_Threads].Pool = this;
+    Workers[Num_Threads].Index = Num_Threads;
+    Threads[Num_Threads] = CreateThread(NULL, 0, Worker, (LPVOID)&Workers[Num_Threads], 0, &ThreadID);
+    if (!Threads[Num_Threads])
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_ThreadPool::Init(): Could not create thread %d!", Num_Threads);
+        CloseHandle(StartEvents[Num_Threads]);
+        CloseHandle(DoneEvents[Num_Threads]);
+        break;
+         }
+     }
+
+// And return ok (we can always run jobs, even without workers):
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Stops all the worker threads.
+\***************************************************************************/
+void IMR_ThreadPool::Shutdown(void)
+{
+int index;
+
+// Nothing to do?
+if (!Num_Threads) return;
+
+// Tell the workers to quit and wait for them:
+ShouldQuit = 1;
+for (index = 0; index < Num_Threads; index ++)
+    SetEvent(StartEvents[index]);
+WaitForMultipleObjects(Num_Threads, Threads, TRUE, INFINITE);
+
+// Free handles:
+for (index = 0; index < Num_Threads; index ++)
+    {
+    CloseHandle(Threads[index]);
+    CloseHandle(StartEvents[index]);
+    CloseHandle(DoneEvents[index]);
+     }
+Num_Threads = 0;
+ShouldQuit = 0;
+ }
+
+#else
+
+/***************************************************************************\
+  Starts the specified number of worker threads.  If NumThreads is 0, one
+  thread is started for each processor.  The thread calling Run() also
+  does work, so a pool with no workers simply runs jobs serially.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_ThreadPool::Init(int NumThreads)
+{
+// Get rid of any old threads:
+Shutdown();
+
+// Find the number of threads to use:
+if (NumThreads <= 0)
+    NumThreads = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;  // The caller is a worker, too
+if (NumThreads > IMR_THREAD_MAXTHREADS) NumThreads = IMR_THREAD_MAXTHREADS;
+if (NumThreads <= 0) return IMR_OK;
+
+// Setup the job signals:
+pthread_mutex_init(&Lock, NULL);
+pthread_cond_init(&Start, NULL);
+pthread_cond_init(&Done, NULL);
+Job_Number = Num_Woken = Num_Busy = 0;
+
+// Start the workers:
+ShouldQuit = 0;
+for (Num_Threads = 0; Num_Threads < NumThreads; Num_Threads ++)
+    {
+    Workers[Num_Threads].Pool = this;
+    Workers[Num_Threads].Index = Num_Threads;
+    if (pthread_create(&Threads[Num_Threads], NULL, Worker, (void *)&Workers[Num_Threads]))
+        {
+        IMR_LogMsg(__LINE__, __FILE__, "IMR_ThreadPool::Init(): Could not create thread %d!", Num_Threads);
+        break;
+         }
+     }
+
+// Don't need the signals if nothing started:
+if (!Num_Threads)
+    {
+    pthread_mutex_destroy(&Lock);
+    pthread_cond_destroy(&Start);
+    pthread_cond_destroy(&Done);
+     }
+
+// And return ok (we can always run jobs, even without workers):
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Stops all the worker threads.
+\***************************************************************************/
+void IMR_ThreadPool::Shutdown(void)
+{
+int index;
+
+// Nothing to do?
+if (!Num_Threads) return;
+
+// Tell the workers to quit and wait for them:
+pthread_mutex_lock(&Lock);
+ShouldQuit = 1;
+pthread_cond_broadcast(&Start);
+pthread_mutex_unlock(&Lock);
+for (index = 0; index < Num_Threads; index ++)
+    pthread_join(Threads[index], NULL);
+
+// Free the signals:
+pthread_mutex_destroy(&Lock);
+pthread_cond_destroy(&Start);
+pthread_cond_destroy(&Done);
+Num_Threads = 0;
+ShouldQuit = 0;
+ }
+
+#endif
+
+/***************************************************************************\
+  Calls the specified function once for each item, spreading the items
+  across the workers.  Doesn't return until every item is done.  The
+  function must not touch data used by other items.
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_ThreadPool::Run(IMR_ThreadJob Func, void *Data, int NumItems)
+{
+int index;
+
+// Make sure we have a job:
+if (!Func)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_ThreadPool::Run(): NULL job passed!");
+    return IMRERR_NODATA;
+     }
+if (NumItems <= 0) return IMR_OK;
+
+// Setup the job:
+Job = Func;
+JobData = Data;
+Num_Items = NumItems;
+NextItem = -1;
+
+// Wake up the workers (no point waking more than there are items):
+#ifdef IMR_WIN32
+for (index = 0; index < Num_Threads && index < NumItems - 1; index ++)
+    SetEvent(StartEvents[index]);
+#else
+index = (Num_Threads < NumItems - 1) ? Num_Threads : NumItems - 1;
+if (index)
+    {
+    pthread_mutex_lock(&Lock);
+    Num_Woken = Num_Busy = index;
+    ++ Job_Number;
+    pthread_cond_broadcast(&Start);
+    pthread_mutex_unlock(&Lock);
+     }
+#endif
+
+// Do our share of the work:
+DoItems();
+
+// Now wait for the workers:
+#ifdef IMR_WIN32
+if (index) WaitForMultipleObjects(index, DoneEvents, TRUE, INFINITE);
+#else
+if (index)
+    {
+    pthread_mutex_lock(&Lock);
+    while (Num_Busy) pthread_cond_wait(&Done, &Lock);
+    pthread_mutex_unlock(&Lock);
+     }
+#endif
+
+// And return ok:
+Job = NULL;
+JobData = NULL;
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Takes items from the current job until there are none left.
+\***************************************************************************/
+void IMR_ThreadPool::DoItems(void)
+{
+long Item;
+
+#ifdef IMR_WIN32
+while ((Item = InterlockedIncrement((LONG *)&NextItem)) < Num_Items)
+#else
+while ((Item = __sync_add_and_fetch(&NextItem, 1)) < Num_Items)
+#endif
+    Job(JobData, Item);
+ }
+
+#ifdef IMR_WIN32
+
+/***************************************************************************\
+  Worker thread.  Waits for a job, does items until the job is finished,
+  then signals that it's done.
+\***************************************************************************/
+DWORD WINAPI IMR_ThreadPool::Worker(LPVOID Param)
+{
+IMR_ThreadPool *Pool = ((IMR_ThreadWorker *)Param)->Pool;
+int Me = ((IMR_ThreadWorker *)Param)->Index;
+
+// Main loop:
+for (;;)
+    {
+    WaitForSingleObject(Pool->StartEvents[Me], INFINITE);
+    if (Pool->ShouldQuit) break;
+    Pool->DoItems();
+    SetEvent(Pool->DoneEvents[Me]);
+     }
+
+return 0;
+ }
+
+#else
+
+/***************************************************************************\
+  Worker thread.  Waits for a job, does items until the job is finished,
+  then signals when it's the last worker done.
+\***************************************************************************/
+void *IMR_ThreadPool::Worker(void *Param)
+{
+IMR_ThreadPool *Pool = ((IMR_ThreadWorker *)Param)->Pool;
+int Me = ((IMR_ThreadWorker *)Param)->Index;
+int Seen = 0, Quit, Help;
+
+// Main loop:
+for (;;)
+    {
+    // Wait for a new job:
+    pthread_mutex_lock(&Pool->Lock);
+    while (Pool->Job_Number == Seen && !Pool->ShouldQuit)
+        pthread_cond_wait(&Pool->Start, &Pool->Lock);
+    Seen = Pool->Job_Number;
+    Quit = Pool->ShouldQuit;
+    Help = Me < Pool->Num_Woken;
+    pthread_mutex_unlock(&Pool->Lock);
+    if (Quit) break;
+    if (!Help) continue;
+
+    // Do items, and tell Run() if we're the last one done:
+    Pool->DoItems();
+    pthread_mutex_lock(&Pool->Lock);
+    if (!(-- Pool->Num_Busy)) pthread_cond_signal(&Pool->Done);
+    pthread_mutex_unlock(&Pool->Lock);
+     }
+
+return NULL;
+ }
+
+#endif
@@ -0,0 +1,82 @@
+/***************************************************************************\
+
+ iMMERSE Engine
+ (C) 1999 No Tears Shed Software
+ All rights reserved
+
+ Filename: IMR_Thread.hpp
+ Description: Header
+
+\***************************************************************************/
+#ifndef __IMR_THREAD__HPP
+#define __IMR_THREAD__HPP
+
+// Include stuff:
+#include "imr_compat.hpp"
+#include "../CallStatus/imr_log.hpp"
+#ifdef IMR_POSIX
+#include <pthread.h>
+#endif
+
+// Constants and macros:
+#define IMR_THREAD_MAXTHREADS   32
+
+// Job function type (called once for each item in the job):
+typedef void (*IMR_ThreadJob)(void *Data, int Item);
+
+// Worker info (passed to each worker thread):
+class IMR_ThreadPool;
+struct IMR_ThreadWorker
+    {
+    IMR_ThreadPool *Pool;
+    int Index;
+     };
+
+// Thread pool class:
+class IMR_ThreadPool
+    {
+    protected:
+      // Worker threads:
+      int Num_Threads;
+      IMR_ThreadWorker Workers[IMR_THREAD_MAXTHREADS];
+#ifdef IMR_WIN32
+      HANDLE Threads[IMR_THREAD_MAXTHREADS],
+             StartEvents[IMR_THREAD_MAXTHREADS],
+             DoneEvents[IMR_THREAD_MAXTHREADS];
+#else
+      pthread_t Threads[IMR_THREAD_MAXTHREADS];
+      pthread_mutex_t Lock;         // Guards the job number and busy count
+      pthread_cond_t Start, Done;
+      int Job_Number;               // Bumped for each job (workers wait for it to change)
+      int Num_Woken, Num_Busy;      // Workers asked to help with the job, and still working on it
+#endif
+
+      // Current job:
+      IMR_ThreadJob Job;
+      void *JobData;
+      int Num_Items;
+      volatile long NextItem;
+      volatile int ShouldQuit;
+
+      // Protected member functions:
+#ifdef IMR_WIN32
+      static DWORD WINAPI Worker(LPVOID);
+#else
+      static void *Worker(void *);
+#endif
+      void DoItems(void);
+
+    public:
+      IMR_ThreadPool() { Num_Threads = 0; Job = NULL; JobData = NULL; Num_Items = 0; NextItem = 0; ShouldQuit = 0; };
+      ~IMR_ThreadPool() { Shutdown(); };
+
+      // Init and shutdown methods:
+      int Init(int NumThreads);
+      void Shutdown(void);
+
+      // Job methods:
+      int Run(IMR_ThreadJob Func, void *Data, int NumItems);
+      inline int Get_Num_Threads(void) { return Num_Threads; };
+     };
+
+#endif
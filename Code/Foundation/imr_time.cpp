@@ -8,7 +8,7 @@
  Description: Timebase for all animation control.
  
 \****************************************************************/
-#include "IMR_Time.hpp"
+#include "imr_time.hpp"
 
 // File globals:
 float IMR_Time_ClockToMs = 1000 / CLOCKS_PER_SEC;
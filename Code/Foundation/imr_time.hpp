@@ -13,7 +13,7 @@
 
 // Include stuff:
 #include <time.h>
-#include <windows.h>
+#include "imr_compat.hpp"
 
 // Globals:
 extern float IMR_Time_ClockToMs;
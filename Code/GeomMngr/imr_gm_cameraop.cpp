@@ -8,7 +8,7 @@
  Description: CameraOperator code module.
  
 \****************************************************************/
-#include "IMR_GM_CameraOp.hpp"
+#include "imr_gm_cameraop.hpp"
 
 /****************************************************************\
   Resets the cameraop.
@@ -18,6 +18,7 @@ void IMR_CameraOp::Reset(void)
 // Reset all pointers:
 Camera = NULL;
 TargetObj = NULL;
+Floor = NULL;
 
 // Reset animation:
 Pnt1.X = Pnt1.Y = Pnt1.Z = Pnt2.X = Pnt2.Y = Pnt2.Z = 0.0f;
@@ -43,6 +44,53 @@ IMR_LogMsg(__LINE__, __FILE__, "Unknown viewcontrol parameter specified! (%d)",
 return IMRERR_GENERIC;
  }
 
+/****************************************************************\
+  Pulls the camera position (Pnt2) in towards the target if 
+  anything in the geometry is between them.
+  Notes: Protected member function.
+\****************************************************************/
+void IMR_CameraOp::Vcn_ClearView(IMR_Object *Geom)
+{
+IMR_CollideRay Ray;
+float Length, t;
+
+// Cast a ray from the target to the camera:
+Ray.Origin = TargetObj->Get_GlobalPos();
+Ray.Dir = Pnt2 - Ray.Origin;
+Length = Ray.Dir.Mag();
+if (Length <= IMR_CAMERAOP_VCN_BLOCKGAP) return;
+Ray.MaxDist = 1.0f;
+Ray.Ignore = (void *)TargetObj;
+if (!Geom->RayCast(Ray, 0)) return;
+
+// Move the camera to just short of whatever's in the way:
+t = Ray.Distance - (IMR_CAMERAOP_VCN_BLOCKGAP / Length);
+if (t < 0) t = 0;
+Pnt2.X = Ray.Origin.X + (Ray.Dir.X * t);
+Pnt2.Y = Ray.Origin.Y + (Ray.Dir.Y * t);
+Pnt2.Z = Ray.Origin.Z + (Ray.Dir.Z * t);
+ }
+
+/****************************************************************\
+  Raises the camera position (Pnt2) if it's too close to the 
+  floor under it.  Floors above the target don't count, so the
+  camera isn't pushed up onto a ceiling.
+  Notes: Protected member function.
+\****************************************************************/
+void IMR_CameraOp::Vcn_ClearFloor(void)
+{
+float Height, Top;
+
+// Find the floor under the camera:
+Top = TargetObj->Get_GlobalPos().Y;
+if (Pnt2.Y > Top) Top = Pnt2.Y;
+if (!Floor->Get_Height(Pnt2.X, Top, Pnt2.Z, &Height)) return;
+
+// And keep above it:
+if (Pnt2.Y < Height + IMR_CAMERAOP_VCN_FLOORGAP)
+    Pnt2.Y = Height + IMR_CAMERAOP_VCN_FLOORGAP;
+ }
+
 /****************************************************************\
   Updates the camera position based on viewcontrol parameters
   and geometry info.
@@ -61,15 +109,22 @@ if (VcnFlags.Mode == IMR_CAMERAOP_VCN_MODE_FIXED)
 if (VcnFlags.Mode == IMR_CAMERAOP_VCN_MODE_CHASE)
     {
     if (!Camera || !Camera->Obj_GetAttached() || !TargetObj) return IMR_OK;
-    IMR_Matrix Mat;
-
-    // Check for obstructions here...
+    IMR_Matrix Mat, Offset;
 
-    Atd2 = Atd1 + TargetObj->Get_GlobalAtd();
-    Mat.Rotate(Atd2.X, Atd2.Y, Atd2.Z);
+    // Put our offset rotation on top of the target's:
+    Offset.Rotate(Atd1.X, Atd1.Y, Atd1.Z);
+    Mat.Merge_Rotations(Offset.Mtrx, TargetObj->Get_RotMatrix().Mtrx);
+    Mat.Find_Angles(&Atd2.X, &Atd2.Y, &Atd2.Z);
     Pnt2 = Pnt1;
     Pnt2.Transform(Mat);
     Pnt2 += TargetObj->Get_GlobalPos();
+
+    // Check for obstructions:
+    if ((VcnFlags.Constraints & IMR_CAMERAOP_VCN_CONSTRAINT_NOBLOCK) && Geom)
+        Vcn_ClearView(Geom);
+    if ((VcnFlags.Constraints & IMR_CAMERAOP_VCN_CONSTRAINT_ABOVEFLOOR) && Floor)
+        Vcn_ClearFloor();
+
     Camera->Obj_GetAttached()->Animation_Init(Pnt2, Atd2, VcnFlags.FollowTime);
     Camera->Obj_GetAttached()->Animation_Step();
     //Camera->Obj_GetAttached()->Set_RelativePos(Pnt2);
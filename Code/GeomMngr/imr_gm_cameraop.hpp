@@ -12,11 +12,12 @@
 #define __IMR_GM_CAMERAOP__HPP
 
 // Include all the headers:
-#include "..\Foundation\IMR_List.hpp"
-#include "..\Foundation\IMR_Time.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
-#include "..\Core\IMR_Geometry.hpp"
-#include "..\Core\IMR_Camera.hpp"
+#include "../Foundation/imr_list.hpp"
+#include "../Foundation/imr_time.hpp"
+#include "../CallStatus/imr_log.hpp"
+#include "../Core/imr_geometry.hpp"
+#include "../Core/imr_camera.hpp"
+#include "../Core/imr_heightgrid.hpp"
 
 #define IMR_CAMERAOP_VCN_MODE                   0x01
     #define IMR_CAMERAOP_VCN_MODE_FIXED             0x00
@@ -30,6 +31,9 @@
     #define IMR_CAMERAOP_VCN_CONSTRAINT_NOPAN       0x01
     #define IMR_CAMERAOP_VCN_CONSTRAINT_RELATION    0x02
     #define IMR_CAMERAOP_VCN_CONSTRAINT_NOBLOCK     0x04
+    #define IMR_CAMERAOP_VCN_CONSTRAINT_ABOVEFLOOR  0x08
+#define IMR_CAMERAOP_VCN_BLOCKGAP               1.0f    // Room left between the camera and what blocks it
+#define IMR_CAMERAOP_VCN_FLOORGAP               1.0f    // Lowest the camera can get to the floor
 
 // CameraOperator class:
 class IMR_CameraOp
@@ -40,6 +44,7 @@ class IMR_CameraOp
      
      *Camera is the camera for which this CameraOp operates
      *TargetObj is the object for which this camera follows or is attached to
+     *Floor is the height grid used to keep the camera above the ground
      Pnt1,2 and Atd1,2 are the end positions for a track camera.
      When the camera is in chase mode these are positioning offsets.
    
@@ -49,6 +54,7 @@ class IMR_CameraOp
       // Various pointers:
       IMR_Camera *Camera;
       IMR_Object *TargetObj;
+      IMR_HeightGrid *Floor;
       
       // Animation control:
       IMR_3DPoint  Pnt1, Pnt2;
@@ -62,6 +68,10 @@ class IMR_CameraOp
               FollowTime,
               Constraints;
            } VcnFlags;
+
+      // Protected member functions:
+      void Vcn_ClearView(IMR_Object *Geom);
+      void Vcn_ClearFloor(void);
       
     public:
     
@@ -74,6 +84,7 @@ class IMR_CameraOp
           {
           Camera = Op.Camera;
           TargetObj = Op.TargetObj;
+          Floor = Op.Floor;
           Pnt1 = Op.Pnt1;
           Pnt2 = Op.Pnt2;
           Atd1 = Op.Atd1;
@@ -91,6 +102,8 @@ class IMR_CameraOp
       // Viewcontrol methods (ViewCoNtrol):
       inline void Vcn_SetTargetObj(IMR_Object *Obj) { TargetObj = Obj; };
       inline IMR_Object *Vcn_GetTargetObj(void) { return TargetObj; };
+      inline void Vcn_SetFloor(IMR_HeightGrid *Grid) { Floor = Grid; };
+      inline IMR_HeightGrid *Vcn_GetFloor(void) { return Floor; };
       inline void Vcn_SetPnt1(IMR_3DPoint &P) { Pnt1 = P; };
       inline void Vcn_SetPnt2(IMR_3DPoint &P) { Pnt2 = P; };
       inline void Vcn_SetAtd1(IMR_Attitude &A) { Atd1 = A; };
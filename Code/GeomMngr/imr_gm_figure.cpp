@@ -8,7 +8,7 @@
  Description: Figure module
  
 \****************************************************************/
-#include "IMR_GM_Figure.hpp"
+#include "imr_gm_figure.hpp"
 
 /***************************************************************************\
 **
@@ -24,7 +24,7 @@ void IMR_SkelSegment::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
@@ -38,7 +38,7 @@ void IMR_SkelSegment::Set_ObjectName(char *Name)
 if (strlen(Name) > 8)
     {
     memcpy((void *)ObjName, (void *)Name, 8);
-    ObjName[8] = '/0';
+    ObjName[8] = '\0';
      }
 else
     strcpy(ObjName, Name);
@@ -59,7 +59,7 @@ void IMR_Skeleton::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
@@ -122,8 +122,13 @@ if (!NewSeg)
 NewSeg->Set_Next(Segs);
 Segs = NewSeg;
 
-// And give it a name:
+// And give it a name.  The newest segment with a name is the one that's
+// found, so if the name's already taken the index has to be made again:
 NewSeg->Set_Name(Name);
+if (SegIndex.Get(NewSeg->Get_Name(), NULL))
+    Index_Segments();
+else
+    SegIndex.Add(NewSeg->Get_Name(), NewSeg);
 
 // One more segment:
 ++ Num_Segs;
@@ -137,18 +142,22 @@ return IMR_OK;
 \***************************************************************************/
 IMR_SkelSegment *IMR_Skeleton::Get_Segment(char *Name)
 {
-IMR_SkelSegment *Curr = Segs;
+IMR_SkelSegment *Seg;
 
-// Loop while we have a segment:
-while (Curr)
-    {
-    if (Curr->Is(Name))
-        return Curr;
-    Curr = Curr->Get_Next();
-     }
+// Look the name up:
+if (!SegIndex.Get(Name, &Seg)) return NULL;
+return Seg;
+ }
 
-// No segment by that name, so return null:
-return NULL;
+/***************************************************************************\
+  Indexes the names of all the segments again.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_Skeleton::Index_Segments(void)
+{
+SegIndex.Clear();
+for (IMR_SkelSegment *Curr = Segs; Curr; Curr = Curr->Get_Next())
+    SegIndex.Add(Curr->Get_Name(), Curr);
  }
 
 /***************************************************************************\
@@ -179,7 +188,10 @@ else
 delete Curr;
 
 // One less seg:
-++ Num_Segs;
+-- Num_Segs;
+
+// An older segment with the same name may be the one found now:
+Index_Segments();
  }
 
 /***************************************************************************\
@@ -200,6 +212,7 @@ while (Curr)
 // And set segs to null:
 Segs = NULL;
 Num_Segs = 0;
+SegIndex.Clear();
  }
 
 /***************************************************************************\
@@ -216,10 +229,13 @@ void IMR_Figure::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
+
+// The list it's in has to index the names again:
+Name_Changed();
  }
 
 /***************************************************************************\
@@ -422,6 +438,38 @@ Animation_Key = Key;
 \***************************************************************************/
 int IMR_Figure::Animation_Step(void)
 {
+int Status;
+
+// Make sure an animation is in progress:
+if (Animation_Status == IMR_ANIMATION_DONE) return IMR_ANIMATION_DONE;
+
+// Step it and flag that the objects have moved:
+Status = Animation_Advance(IMR_Time_GetFrameTime());
+Mark_Dirty();
+return Status;
+ }
+
+/***************************************************************************\
+  Flags that the objects in the current key have moved.
+\***************************************************************************/
+void IMR_Figure::Mark_Dirty(void)
+{
+IMR_SkelSegment *Seg;
+
+if (!Animation_Key) return;
+for (Seg = Animation_Key->GetFirstSegment(); Seg; Seg = Seg->Get_Next())
+    if (Seg->Get_Object()) Seg->Get_Object()->Mark_Dirty();
+ }
+
+/***************************************************************************\
+  Moves the animation on by the specified frame time, without flagging
+  that the objects have moved.  Only the figure's own objects are touched,
+  so figures that don't share objects can be advanced at the same time on
+  different threads, as long as Mark_Dirty() is called afterwards.
+  Returns the status of the animation.
+\***************************************************************************/
+int IMR_Figure::Animation_Advance(int FrameTime)
+{
 IMR_Skeleton *Key;
 IMR_SkelSegment *Seg;
 IMR_Object *Obj;
@@ -440,14 +488,14 @@ while (Seg)
     Obj = Seg->Get_Object();
     
     // Make sure there is an object:
-    if (Obj) Obj->Animation_Step();
+    if (Obj) Obj->Animation_Advance(FrameTime);
     
     // Get the next segment:
     Seg = Seg->Get_Next();
      }
 
 // Increment counter:
-Animation_Time += IMR_Time_GetFrameTime(); 
+Animation_Time += FrameTime; 
 
 // Tell the user our status:
 if (Animation_Time >= Animation_Length) 
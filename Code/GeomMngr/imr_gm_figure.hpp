@@ -12,10 +12,10 @@
 #define __IMR_GM_FIGURE__HPP
 
 // Include all the headers:
-#include "..\Foundation\IMR_List.hpp"
-#include "..\Foundation\IMR_Time.hpp"
-#include "..\Core\IMR_Geometry.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
+#include "../Foundation/imr_list.hpp"
+#include "../Foundation/imr_time.hpp"
+#include "../Core/imr_geometry.hpp"
+#include "../CallStatus/imr_log.hpp"
 
 // Constants and macros:
 #define IMR_SKELETON_MAXKEYS 32
@@ -72,10 +72,14 @@ class IMR_Skeleton
       // Segment stuff:
       int Num_Segs;
       IMR_SkelSegment *Segs;            // Pointer to first segment in linked list
+      IMR_NameHash<IMR_SkelSegment *> SegIndex;     // Segments by name
             
       // Pointer to next skeleton in list:
       IMR_Skeleton *Next;
       
+      // Protected member functions:
+      void Index_Segments(void);
+      
     public:
       IMR_Skeleton() { Next = NULL; Segs = NULL; Name[0] = 0; };
       ~IMR_Skeleton() { Wipe_Segments(); };
@@ -105,7 +109,7 @@ class IMR_Skeleton
      };
 
 // Figure:
-class IMR_Figure
+class IMR_Figure : public IMR_NamedItem
     {
     protected:
       // Name stuff:
@@ -125,10 +129,11 @@ class IMR_Figure
     public:
       IMR_Figure()
           {
-          Name[0] = '/0';
-          RootObjName[0] = '/0';
+          Name[0] = '\0';
+          RootObjName[0] = '\0';
           Num_Keys = 0; Keys = NULL;
           Animation_Time = Animation_Length = 0; Animation_Status = IMR_ANIMATION_DONE;
+          Animation_Key = NULL;
            };
       ~IMR_Figure() { Wipe_Keys(); };
 
@@ -151,6 +156,8 @@ class IMR_Figure
       void Animation_Jump(char *KeyName);
       void Animation_Init(char *KeyName, int Length);
       int Animation_Step(void);
+      int Animation_Advance(int FrameTime);
+      void Mark_Dirty(void);
       int Animation_Get_Status(void) { return Animation_Status; };
       
       // File IO methods:
@@ -161,7 +168,7 @@ class IMR_Figure
       void Set_RootObj(char *NewName)
           {
           if (strlen(NewName) > 8)
-              { memcpy((void *)RootObjName, (void *)NewName, 8); RootObjName[8] = '/0'; } 
+              { memcpy((void *)RootObjName, (void *)NewName, 8); RootObjName[8] = '\0'; } 
           else
               strcpy(RootObjName, NewName); 
            };
@@ -9,7 +9,7 @@
               IMR_Interface class.
  
 \****************************************************************/
-#include "IMR_GM_Interface.hpp"
+#include "imr_gm_interface.hpp"
 
 /***************************************************************************\
   Initializes the interface.
@@ -52,6 +52,9 @@ int err;
 err = IMR_Interface::Shutdown(); if (IMR_ISNOTOK(err)) return err;
 
 // Reset everything:
+Scene.Reset();
+WorldHier.Reset();
+SceneBuild = 0;
 Flags.ClassInitialized = 0;
 
 // And return ok:
@@ -115,8 +118,8 @@ for (fig = 0; fig < GlobalFigures.Get_Num_Items(); fig ++)
     if (IMR_ISNOTOK(err)) return err;
      }
 
-// Now go through all the objects and update their coordinates:
-World.UpdateCoords();
+// Now flatten the world and update all the coordinates:
+err = WorldHier.Build(&World); if (IMR_ISNOTOK(err)) return err;
 
 // And return ok:
 return IMR_OK;
@@ -173,6 +176,22 @@ int err = ParentObj->Attach_Child(ChildObj); if (IMR_ISNOTOK(err)) return err;
 return IMR_OK;
  }
 
+/***************************************************************************\
+  Returns a pointer to the object with the specified name in the world
+  (the first one found going down the tree).  A NULL name means the root
+  object.  Once the geometries are prepped, the names are looked up in the
+  world hierarchy's index (see IMR_Object::Get_Child()).
+  If the object isn't in the world, returns null.
+\***************************************************************************/
+IMR_Object *IMR_GM_Interface::Seek_Object(char *Name)
+{
+// Do we want the root object?  Return a pointer to it:
+if (!Name) return &World;
+
+// Otherwise look for it:
+return World.Get_Child(Name);
+ }
+
 /***************************************************************************\
   Lops the specified object and all it's children off from the geometry.
   Returns a pointer to the lopped object if successful, otherwise NULL.
@@ -459,11 +478,165 @@ return IMR_Interface::Begin_Frame(*ExternalCamera);
  }
 
 /***************************************************************************\
-  Adds the geometries to the polygon list.
+  Puts everything in the world into the scene octree again, with the root
+  fit around the world.  Called when the world's nodes are made again.
+  Returns IMR_OK if successful, otherwise an error.
+  Notes: Protected member function.
+\***************************************************************************/
+int IMR_GM_Interface::Index_Scene(void)
+{
+float Min[3], Max[3], Center[3], Half = 1;
+int err, node, c;
+
+// Fit the root around the world (anything that wanders out of it is kept
+// in the root):
+if (!World.Get_Bounds(Min, Max))
+    Min[0] = Min[1] = Min[2] = Max[0] = Max[1] = Max[2] = 0;
+for (c = 0; c < 3; c ++)
+    {
+    Center[c] = (Min[c] + Max[c]) * 0.5f;
+    if ((Max[c] - Min[c]) * 0.5f > Half) Half = (Max[c] - Min[c]) * 0.5f;
+     }
+err = Scene.Setup(Center, Half, IMR_OCTREE_DEPTH, WorldHier.Get_Num_Nodes());
+if (IMR_ISNOTOK(err)) return err;
+
+// Add each node, then update so they all get placed:
+for (node = 0; node < WorldHier.Get_Num_Nodes(); node ++)
+    {
+    err = WorldHier.Get_Object(node)->Set_Octree(&Scene);
+    if (IMR_ISNOTOK(err)) return err;
+     }
+WorldHier.Update();
+SceneBuild = WorldHier.Get_Num_Builds();
+
+// And return ok:
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Adds the geometries to the polygon list.  Once the world has been 
+  flattened, only what the camera might see (and what's always drawn) is
+  added, found with the scene octree.
   Returns IMR_OK if successful, otherwise an error.
 \***************************************************************************/
 int IMR_GM_Interface::Add_Geometries(void)
 {
+int err;
+
+// If the world hasn't been flattened yet, add the whole tree:
+if (WorldHier.Get_Root() != &World) return IMR_Interface::Add_Object(World);
+
+// Find the coords of anything that's moved, and fill the scene again if 
+// the world's nodes were made again:
+WorldHier.Update();
+if (SceneBuild != WorldHier.Get_Num_Builds())
+    {
+    err = Index_Scene(); if (IMR_ISNOTOK(err)) return err;
+     }
+
 // Return what we get from our engine add:
-return IMR_Interface::Add_Object(World);
+return IMR_Interface::Add_Scene(Scene);
+ }
+
+// Animations being stepped by Step_Animations():
+struct IMR_GM_AnimBatch
+    {
+    IMR_Object **Objects;
+    IMR_Figure **Figures;
+    char *Moved;                // Flags if each object (then each figure) was animating
+    int Num_Objects;
+    int FrameTime;
+     };
+
+/***************************************************************************\
+  Steps one object of an animation batch.  Called by the thread pool.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_GM_Interface::Animate_ObjectJob(void *Data, int Item)
+{
+IMR_GM_AnimBatch *Batch = (IMR_GM_AnimBatch *)Data;
+IMR_Object *Obj = Batch->Objects[Item];
+
+Batch->Moved[Item] = Obj && Obj->Animation_Get_Status() != IMR_ANIMATION_DONE;
+if (Batch->Moved[Item]) Obj->Animation_Advance(Batch->FrameTime);
+ }
+
+/***************************************************************************\
+  Steps one figure of an animation batch.  Called by the thread pool.
+  Notes: Protected member function.
+\***************************************************************************/
+void IMR_GM_Interface::Animate_FigureJob(void *Data, int Item)
+{
+IMR_GM_AnimBatch *Batch = (IMR_GM_AnimBatch *)Data;
+IMR_Figure *Fig = Batch->Figures[Item];
+char *Moved = &Batch->Moved[Batch->Num_Objects + Item];
+
+*Moved = Fig && Fig->Animation_Get_Status() != IMR_ANIMATION_DONE;
+if (*Moved) Fig->Animation_Advance(Batch->FrameTime);
+ }
+
+/***************************************************************************\
+  Steps the animations of the specified objects and figures, spreading 
+  them across the thread pool if one is specified, then finds the globals
+  of everything in the world once they've all moved.  The objects are all
+  stepped before the figures, so everything ends up where calling 
+  Animation_Step() on each object, then each figure, in order would put 
+  it, no matter how many threads there are.
+  Note: An object can only be in the object list once, and figures can't
+        share objects (a figure's objects can be in the object list).
+  Returns IMR_OK if successful, otherwise an error.
+\***************************************************************************/
+int IMR_GM_Interface::Step_Animations(IMR_Object **Objects, int NumObjects, IMR_Figure **Figures, int NumFigures, IMR_ThreadPool *Pool)
+{
+IMR_GM_AnimBatch Batch;
+int err = IMR_OK, item;
+
+// Make sure we have something to do:
+if (!Objects || NumObjects < 0) NumObjects = 0;
+if (!Figures || NumFigures < 0) NumFigures = 0;
+if (!NumObjects && !NumFigures)
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_GM_Interface::Step_Animations(): No animations passed!");
+    return IMRERR_NODATA;
+     }
+Batch.Objects = Objects;
+Batch.Figures = Figures;
+Batch.Num_Objects = NumObjects;
+Batch.FrameTime = IMR_Time_GetFrameTime();
+if (!(Batch.Moved = (char *)malloc(NumObjects + NumFigures)))
+    {
+    IMR_LogMsg(__LINE__, __FILE__, "IMR_GM_Interface::Step_Animations(): Out of memory! (%d)", NumObjects + NumFigures);
+    return IMRERR_OUTOFMEM;
+     }
+
+// Step the objects, then the figures (each one only touches it's own 
+// objects, and nothing's marked as moved until they're all done):
+if (Pool)
+    {
+    err = Pool->Run(Animate_ObjectJob, (void *)&Batch, NumObjects);
+    if (IMR_ISOK(err)) err = Pool->Run(Animate_FigureJob, (void *)&Batch, NumFigures);
+     }
+else
+    {
+    for (item = 0; item < NumObjects; item ++) Animate_ObjectJob((void *)&Batch, item);
+    for (item = 0; item < NumFigures; item ++) Animate_FigureJob((void *)&Batch, item);
+     }
+if (IMR_ISNOTOK(err))
+    {
+    free(Batch.Moved);
+    return err;
+     }
+
+// Now flag what moved, in order:
+for (item = 0; item < NumObjects; item ++)
+    if (Batch.Moved[item]) Objects[item]->Mark_Dirty();
+for (item = 0; item < NumFigures; item ++)
+    if (Batch.Moved[NumObjects + item]) Figures[item]->Mark_Dirty();
+free(Batch.Moved);
+
+// And find the globals of everything that moved:
+World.ResolveCoords();
+
+// And return ok:
+return IMR_OK;
  }
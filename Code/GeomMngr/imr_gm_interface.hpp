@@ -12,14 +12,15 @@
 #define __IMR_GM_INTERFACE__HPP
 
 // Include all the headers:
-#include "IMR_GM_Figure.hpp"
-#include "IMR_GM_CameraOp.hpp"
-#include "..\Core\IMR_Interface.hpp"
-#include "..\Core\IMR_Geometry.hpp"
-#include "..\Core\IMR_Camera.hpp"
-#include "..\Core\IMR_Geom_Light.hpp"
-#include "..\Core\IMR_Resource.hpp"
-#include "..\Foundation\IMR_List.hpp"
+#include "imr_gm_figure.hpp"
+#include "imr_gm_cameraop.hpp"
+#include "../Core/imr_interface.hpp"
+#include "../Core/imr_geometry.hpp"
+#include "../Core/imr_camera.hpp"
+#include "../Core/imr_geom_light.hpp"
+#include "../Core/imr_resource.hpp"
+#include "../Foundation/imr_list.hpp"
+#include "../Foundation/imr_thread.hpp"
 
 // Constants and macros:
 #define IMR_MAX_GLBTEX        64
@@ -48,6 +49,9 @@ class IMR_GM_Interface : public IMR_Interface
       
       // The parent geometry:
       IMR_Object                  World;
+      IMR_Hierarchy               WorldHier;      // Transforms of everything under it
+      IMR_Octree                  Scene;          // Bounds of everything under it
+      int SceneBuild;                             // Build of WorldHier that's in the scene
       
       // Geometry scale, expressed in terms of units per meter:
       int WorldScale;
@@ -58,6 +62,11 @@ class IMR_GM_Interface : public IMR_Interface
           unsigned int ClassInitialized:1;
            } Flags;
       
+      // Protected member functions:
+      int Index_Scene(void);
+      static void Animate_ObjectJob(void *Data, int Item);
+      static void Animate_FigureJob(void *Data, int Item);
+      
     public:
       IMR_GM_Interface()
           {
@@ -72,6 +81,7 @@ class IMR_GM_Interface : public IMR_Interface
           Lights.Init(0);
           Cameras.Init(0);
           WorldScale = 100;     // Default to 100 units per meter
+          SceneBuild = 0;
            };
       ~IMR_GM_Interface() { Shutdown(); };
       
@@ -92,10 +102,13 @@ class IMR_GM_Interface : public IMR_Interface
       // Prep methods:
       int Prep_Geometries(void);
 
+      // Animation methods:
+      int Step_Animations(IMR_Object **Objects, int NumObjects, IMR_Figure **Figures, int NumFigures, IMR_ThreadPool *Pool);
+
       // Geometry methods:
       int Attach_Object(char *Child, char *Parent);
       IMR_Object *Lop_Object(char *Name);
-      inline IMR_Object *Seek_Object(char *Name) { if (!Name) return &World; else return World.Get_Child(Name); };
+      IMR_Object *Seek_Object(char *Name);
       inline IMR_Object *Detach_Object(char *Name) { return Lop_Object(Name); };
       
       // List access methods:
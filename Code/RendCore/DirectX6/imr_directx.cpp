@@ -12,7 +12,7 @@
 #include <windows.h>
 #include <ddraw.h>
 #include <d3d.h>
-#include "IMR_DirectX.HPP"
+#include "imr_directx.hpp"
 
 // Globals:
 static struct
@@ -19,8 +19,8 @@
 #include <windows.h>
 #include <ddraw.h>
 #include <d3d.h>
-#include "IMR_DirectX_Err.hpp"
-#include "..\..\CallStatus\IMR_Log.hpp"
+#include "imr_directx_err.hpp"
+#include "../../CallStatus/imr_log.hpp"
 
 // DirectX interface init structure:
 typedef struct
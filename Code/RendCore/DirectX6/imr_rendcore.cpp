@@ -9,7 +9,7 @@
               rasterization and blits.
  
 \****************************************************************/
-#include "IMR_RendCore.hpp"
+#include "imr_rendcore.hpp"
 
 /***************************************************************************\
   Initializes the renderer.  
@@ -16,16 +16,16 @@
 #include <malloc.h>
 #include <math.h>
 #include <stdlib.h>
-#include "..\..\Core\IMR_Table.hpp"
-#include "..\..\Core\IMR_Geometry.hpp"
-#include "..\..\Core\IMR_Camera.hpp"
-#include "..\..\Core\IMR_TexRef.hpp"
-#include "..\..\Core\IMR_Resource.hpp"
-#include "..\..\Foundation\IMR_List.hpp"
-#include "..\..\CallStatus\IMR_Log.hpp"
-#include "..\..\CallStatus\IMR_RetVals.hpp"
-#include "IMR_Texture.hpp"
-#include "IMR_DirectX.hpp"
+#include "../../Core/imr_table.hpp"
+#include "../../Core/imr_geometry.hpp"
+#include "../../Core/imr_camera.hpp"
+#include "../../Core/imr_texref.hpp"
+#include "../../Core/imr_resource.hpp"
+#include "../../Foundation/imr_list.hpp"
+#include "../../CallStatus/imr_log.hpp"
+#include "../../CallStatus/imr_retvals.hpp"
+#include "imr_texture.hpp"
+#include "imr_directx.hpp"
 
 // Macros:
 #define IMR_RENDERER_MODE_INIT          0
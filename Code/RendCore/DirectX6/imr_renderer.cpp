@@ -9,8 +9,8 @@
  
 \****************************************************************/
 
-#include "IMR_DirectX.cpp"
-#include "IMR_DirectX_Err.cpp"
-#include "IMR_RendCore.cpp"
-#include "IMR_Texture.cpp"
+#include "imr_directx.cpp"
+#include "imr_directx_err.cpp"
+#include "imr_rendcore.cpp"
+#include "imr_texture.cpp"
 
@@ -9,5 +9,5 @@
  
 \****************************************************************/
 
-#include "IMR_RendCore.hpp"
+#include "imr_rendcore.hpp"
 
@@ -8,7 +8,7 @@
  Description: Texture primitive methods
  
 \****************************************************************/
-#include "IMR_Texture.hpp"
+#include "imr_texture.hpp"
 
 /***************************************************************************\
   Sets the name of the texture.
@@ -18,10 +18,13 @@ void IMR_Texture::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
+
+// The list it's in has to index the names again:
+Name_Changed();
  }
 
 /***************************************************************************\
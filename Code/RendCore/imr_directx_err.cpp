@@ -5,7 +5,7 @@
   Modified:
   
 \***************************************************************************/
-#include "IMR_DirectX_Err.hpp"
+#include "imr_directx_err.hpp"
 
 /***************************************************************************\
   Returns an error message from the specified DirectX error code.
@@ -8,7 +8,7 @@
  Description: Texture primitive methods
  
 \****************************************************************/
-#include "IMR_Texture.hpp"
+#include "imr_texture.hpp"
 
 /***************************************************************************\
   Sets the name of the texture.
@@ -18,7 +18,7 @@ void IMR_Texture::Set_Name(char *NewName)
 if (strlen(NewName) > 8)
     {
     memcpy((void *)Name, (void *)NewName, 8);
-    Name[8] = '/0';
+    Name[8] = '\0';
      }
 else
     strcpy(Name, NewName);
@@ -17,12 +17,12 @@
 #include <stdio.h>
 #include <conio.h>
 #include <io.h>
-#include <sys\types.h>
-#include <sys\stat.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include "IMR_Palette.hpp"
-#include "IMR_DirectX.hpp"
-#include "..\CallStatus\IMR_Log.hpp"
+#include "imr_directx.hpp"
+#include "../CallStatus/imr_log.hpp"
 
 // Texture class:
 class IMR_Texture
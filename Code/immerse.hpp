@@ -8,20 +8,20 @@
  
 \****************************************************************/
 
-#include "CallStatus\IMR_Log.hpp"
-#include "Core\IMR_Camera.hpp"
-#include "Core\IMR_Collide.hpp"
-#include "Core\IMR_DirectX.hpp"
-#include "Core\IMR_DirectX_Err.hpp"
-#include "Core\IMR_Geometry.hpp"
-#include "Core\IMR_Interface.hpp"
-#include "Core\IMR_Material.hpp"
-#include "Core\IMR_Matrix.hpp"
-#include "Core\IMR_Palette.hpp"
-#include "Core\IMR_Pipeline.hpp"
-#include "Core\IMR_RendBuffer.hpp"
-#include "Core\IMR_Renderer.hpp"
-#include "Core\IMR_Table.hpp"
-#include "Core\IMR_Texture.hpp"
-#include "GeomMngr\IMR_GM_Figure.hpp"
-#include "GeomMngr\IMR_GM_Interface.hpp"
+#include "CallStatus/imr_log.hpp"
+#include "Core/imr_camera.hpp"
+#include "Core/imr_collide.hpp"
+#include "Core/IMR_DirectX.hpp"
+#include "Core/IMR_DirectX_Err.hpp"
+#include "Core/imr_geometry.hpp"
+#include "Core/imr_interface.hpp"
+#include "Core/imr_material.hpp"
+#include "Core/imr_matrix.hpp"
+#include "Core/imr_palette.hpp"
+#include "Core/imr_pipeline.hpp"
+#include "Core/IMR_RendBuffer.hpp"
+#include "Core/IMR_Renderer.hpp"
+#include "Core/imr_table.hpp"
+#include "Core/IMR_Texture.hpp"
+#include "GeomMngr/imr_gm_figure.hpp"
+#include "GeomMngr/imr_gm_interface.hpp"
@@ -0,0 +1,277 @@
+/***************************************************************************\
+   Collision benchmark.  Builds the panels from collidetest.cpp (and grids
+   of copies of them, and of finer versions of them), then replays scripted walks through them with
+   Motion_Travel_CheckCollide(), the same way collidetest.cpp moves the
+   person around.  Reports queries per second, triangles tested and slide
+   iterations per query, and a checksum of where the movers ended up (so
+   a change that speeds things up but moves things differently shows).
+   The frame time is fixed and the walks come from a fixed seed, so runs
+   can be compared.  No window or display needed, so it can be run from a
+   script on any platform.
+   Console app, build with (add -dIMR_SSE for the SSE packet code):
+     wcl386 -bt=nt -ox collidebench.cpp ..\Code\Core\IMR_Collide.cpp
+       ..\Code\Core\IMR_CollideBVH.cpp ..\Code\Core\IMR_CollideMesh.cpp
+       ..\Code\Core\IMR_CollideHash.cpp ..\Code\Core\IMR_Geom_Object.cpp
+       ..\Code\Core\IMR_Geom_Light.cpp ..\Code\Core\IMR_Geom_Model.cpp
+       ..\Code\Core\IMR_Hierarchy.cpp ..\Code\Core\IMR_Octree.cpp
+       ..\Code\Core\IMR_Geom_Poly.cpp ..\Code\Core\IMR_Geom_Prim_Point.cpp
+       ..\Code\Core\IMR_Material.cpp ..\Code\Core\IMR_Matrix.cpp
+       ..\Code\Core\IMR_Resource.cpp ..\Code\Core\IMR_RDFMngr.cpp
+       ..\Code\Core\IMR_Table.cpp ..\Code\Foundation\IMR_Time.cpp
+       ..\Code\Foundation\IMR_Thread.cpp ..\Code\CallStatus\IMR_Log.cpp
+   Or with gcc on any system with the Makefile ("make bench").
+\***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../Code/Core/imr_geom_object.hpp"
+#include "../Code/Foundation/imr_time.hpp"
+
+// Constants:
+#define BENCH_SCENES      4         // Number of scenes
+#define BENCH_MAXGRID     16        // Cells along each side of the biggest scene
+#define BENCH_CELLSIZE    400.0f    // Distance between the cells
+#define BENCH_MOVERS      16        // Walks replayed in each scene
+#define BENCH_FRAMES      10000     // Frames in each walk
+#define BENCH_FRAMETIME   33        // Fixed frame time (ms)
+#define BENCH_SPEED       300.0f    // Walking rate (as in collidetest.cpp)
+#define BENCH_TURNRATE    300.0f    // Turning rate (as in collidetest.cpp)
+#define BENCH_TURNEVERY   30        // Frames between changes of direction in the walks
+
+// Scenes (cells along each side, and whether to use the fine panels):
+int Grids[BENCH_SCENES] = {1, 4, 16, 16};
+int Fine[BENCH_SCENES] = {0, 0, 0, 1};
+
+// Test data:
+IMR_Model Panel, FinePanel, Head;
+IMR_Object Level, Movers;
+IMR_Object Rows[BENCH_MAXGRID];
+IMR_Object Cells[BENCH_MAXGRID * BENCH_MAXGRID];
+IMR_Object Panels[BENCH_MAXGRID * BENCH_MAXGRID * 2];
+IMR_Object People[BENCH_MOVERS];
+IMR_CollideInfo CInfo[BENCH_MOVERS];
+unsigned int Seed;
+
+/***************************************************************************\
+  Returns the number of seconds taken by the specified number of clock ticks.
+\***************************************************************************/
+double Seconds(clock_t Start, clock_t End)
+{
+return (double)(End - Start) / CLOCKS_PER_SEC;
+ }
+
+/***************************************************************************\
+  Returns a random number from 0 to Max - 1.  Uses it's own generator
+  rather than rand(), so the walks (and checksums) are the same with any
+  compiler's library.
+\***************************************************************************/
+int Random(int Max)
+{
+Seed = Seed * 1103515245 + 12345;
+return (int)((Seed >> 16) & 0x7fff) % Max;
+ }
+
+/***************************************************************************\
+  Builds the models used in the scenes.
+\***************************************************************************/
+int Setup_Models(void)
+{
+int err;
+
+// Same models as collidetest.cpp:
+err = Panel.Make_Wall(100, 100, 100, "Panel"); if (IMR_ISNOTOK(err)) return err;
+err = Panel.Setup(); if (IMR_ISNOTOK(err)) return err;
+err = FinePanel.Make_Wall(100, 100, 10, "FinePanel"); if (IMR_ISNOTOK(err)) return err;
+err = FinePanel.Setup(); if (IMR_ISNOTOK(err)) return err;
+err = Head.Make_Pyramid(23, 23, 23, "Head"); if (IMR_ISNOTOK(err)) return err;
+err = Head.Setup(); if (IMR_ISNOTOK(err)) return err;
+return IMR_OK;
+ }
+
+/***************************************************************************\
+  Builds a scene with a grid of Size by Size cells, each with the two
+  panels from collidetest.cpp (made of the specified model), and puts the movers in it.  The cells are
+  grouped into rows, the way a level's sectors would be.
+\***************************************************************************/
+void Setup_Scene(int Size, IMR_Model *Mdl)
+{
+IMR_3DPoint Pos;
+IMR_Attitude Atd;
+int row, cell, mover;
+float Offset = (Size - 1) * BENCH_CELLSIZE * 0.5f;
+
+// Start from nothing:
+Level.Reset();
+Movers.Reset();
+
+// Make the rows:
+for (row = 0; row < Size; row ++)
+    {
+    Rows[row].Reset();
+    Level.Attach_Child(&Rows[row]);
+    Pos.X = 0; Pos.Y = 0; Pos.Z = row * BENCH_CELLSIZE - Offset;
+    Rows[row].Set_RelativePos(Pos);
+     }
+
+// Make the cells (each is an object with the two panels as children):
+for (cell = 0; cell < Size * Size; cell ++)
+    {
+    Cells[cell].Reset();
+    Rows[cell / Size].Attach_Child(&Cells[cell]);
+    Pos.X = (cell % Size) * BENCH_CELLSIZE - Offset; Pos.Y = 0; Pos.Z = 0;
+    Cells[cell].Set_RelativePos(Pos);
+
+    // Panel 1 (centered on the cell):
+    Panels[cell * 2].Reset();
+    Panels[cell * 2].Attach_Model(Mdl);
+    Panels[cell * 2].Set_Collidable();
+    Cells[cell].Attach_Child(&Panels[cell * 2]);
+    Pos.X = 0; Pos.Y = 0; Pos.Z = 50;
+    Atd.X = 128; Atd.Y = 0; Atd.Z = 0;
+    Panels[cell * 2].Set_RelativePos(Pos);
+    Panels[cell * 2].Set_RelativeAtd(Atd);
+
+    // Panel 2 (same spot relative to panel 1 as in collidetest.cpp):
+    Panels[cell * 2 + 1].Reset();
+    Panels[cell * 2 + 1].Attach_Model(Mdl);
+    Panels[cell * 2 + 1].Set_Collidable();
+    Cells[cell].Attach_Child(&Panels[cell * 2 + 1]);
+    Pos.X = 50; Pos.Y = 0; Pos.Z = 0;
+    Atd.X = 128; Atd.Y = 256; Atd.Z = 0;
+    Panels[cell * 2 + 1].Set_RelativePos(Pos);
+    Panels[cell * 2 + 1].Set_RelativeAtd(Atd);
+     }
+
+// Put the movers in random spots (kept apart from the level, so moving
+// them doesn't touch the level's bounds):
+for (mover = 0; mover < BENCH_MOVERS; mover ++)
+    {
+    People[mover].Reset();
+    People[mover].Attach_Model(&Head);
+    Movers.Attach_Child(&People[mover]);
+    Pos.X = Random(Size * (int)BENCH_CELLSIZE) - Offset - BENCH_CELLSIZE * 0.5f;
+    Pos.Y = 0;
+    Pos.Z = Random(Size * (int)BENCH_CELLSIZE) - Offset - BENCH_CELLSIZE * 0.5f;
+    Atd.X = 0; Atd.Y = Random(1024); Atd.Z = 0;
+    People[mover].Set_RelativePos(Pos);
+    People[mover].Set_RelativeAtd(Atd);
+    CInfo[mover].Setup_Ellipsoid(50, 50);
+    CInfo[mover].Clear_ContactCache();
+    CInfo[mover].Reset_CacheStats();
+     }
+ }
+
+/***************************************************************************\
+  Replays the walks through the scene made by Setup_Scene() and prints the
+  results.
+\***************************************************************************/
+void Test_Scene(int Size, IMR_Model *Mdl)
+{
+IMR_3DPoint MotionVect, Pos;
+IMR_Attitude Heading, Turns[BENCH_MOVERS];
+IMR_Matrix Mat;
+clock_t Start;
+double Time, Tris = 0, Iterations = 0, Checksum = 0;
+float Limit = Size * BENCH_CELLSIZE * 0.5f;
+int frame, mover, Hits = 0, Queries = BENCH_MOVERS * BENCH_FRAMES;
+
+for (mover = 0; mover < BENCH_MOVERS; mover ++)
+    Turns[mover].X = Turns[mover].Y = Turns[mover].Z = 0;
+
+// Walk everyone around:
+Start = clock();
+for (frame = 0; frame < BENCH_FRAMES; frame ++)
+    for (mover = 0; mover < BENCH_MOVERS; mover ++)
+        {
+        // Change direction every so often (left, right, or straight):
+        if (!((frame + mover) % BENCH_TURNEVERY)) Turns[mover].Y = Random(3) - 1;
+        if (Turns[mover].Y) People[mover].Motion_Turn(Turns[mover], BENCH_TURNRATE);
+
+        // Turn around at the edge of the scene:
+        Pos = People[mover].Get_GlobalPos();
+        if (Pos.X < -Limit || Pos.X > Limit || Pos.Z < -Limit || Pos.Z > Limit)
+            {
+            Heading = People[mover].Get_RelativeAtd();
+            MotionVect.X = 0; MotionVect.Y = 0; MotionVect.Z = 1.0f;
+            Mat.Rotate(Heading.X, Heading.Y, Heading.Z);
+            MotionVect.Transform(Mat);
+            if (MotionVect.X * Pos.X + MotionVect.Z * Pos.Z > 0)
+                {
+                Heading.Y += 512;
+                Heading.Fix_Ang();
+                People[mover].Set_RelativeAtd(Heading);
+                 }
+             }
+
+        // Walk forward (as in collidetest.cpp):
+        MotionVect.X = 0; MotionVect.Y = 0; MotionVect.Z = 1.0f;
+        Mat = People[mover].Get_RotMatrix();
+        MotionVect.Transform(Mat);
+        People[mover].Motion_Travel_CheckCollide(MotionVect, BENCH_SPEED, &Level, CInfo[mover]);
+
+        // Stay on the ground (there's no gravity, so sliding up the panels
+        // would otherwise lift the movers over them for good):
+        Pos = People[mover].Get_RelativePos();
+        if (Pos.Y != 0)
+            {
+            Pos.Y = 0;
+            People[mover].Set_RelativePos(Pos);
+             }
+
+        // Keep count:
+        Tris += CInfo[mover].trianglesTested;
+        Iterations += CInfo[mover].iterations;
+        Hits += CInfo[mover].hitCount;
+         }
+Time = Seconds(Start, clock());
+
+// Find the checksum:
+for (mover = 0; mover < BENCH_MOVERS; mover ++)
+    {
+    Pos = People[mover].Get_GlobalPos();
+    Checksum += Pos.X + Pos.Z * 7;
+     }
+
+printf("%dx%d cells (%d panels, %d polys):\n", Size, Size, Size * Size * 2, Size * Size * 2 * Mdl->Num_Polygons);
+if (Time > 0.0)
+    printf("  %.0f queries/s (%.2f us/query)\n", Queries / Time, (Time * 1e6) / Queries);
+else
+    printf("  too fast to time\n");
+printf("  %.2f triangles tested/query\n", Tris / Queries);
+printf("  %.2f slide iterations/query, %.3f hits/query\n", Iterations / Queries, (double)Hits / Queries);
+printf("  checksum %.3f\n", Checksum);
+ }
+
+/***************************************************************************\
+  Main.
+\***************************************************************************/
+int main(void)
+{
+int scene;
+
+// Setup the tables, the models, and the timer (fixed frame time):
+IMR_BuildTables();
+if (IMR_ISNOTOK(Setup_Models()))
+    {
+    printf("Couldn't make the models!\n");
+    return 1;
+     }
+IMR_Time_FrameTime = BENCH_FRAMETIME;
+
+// Run the tests:
+#ifdef IMR_SSE
+printf("iMMERSE collision benchmark (SSE)\n\n");
+#else
+printf("iMMERSE collision benchmark\n\n");
+#endif
+printf("%d movers, %d frames each, %d ms frames\n\n", BENCH_MOVERS, BENCH_FRAMES, BENCH_FRAMETIME);
+for (scene = 0; scene < BENCH_SCENES; scene ++)
+    {
+    Seed = 1999;
+    Setup_Scene(Grids[scene], Fine[scene] ? &FinePanel : &Panel);
+    Test_Scene(Grids[scene], Fine[scene] ? &FinePanel : &Panel);
+    if (scene < BENCH_SCENES - 1) printf("\n");
+     }
+return 0;
+ }
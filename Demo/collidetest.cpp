@@ -7,7 +7,7 @@
 // Setup iMMERSE debugging:
 #define IMR_DEBUG
 
-#include "Demo.HPP"
+#include "DEMO.HPP"
 
 // Miscellaneous:
 HANDLE ThisInstance;
@@ -284,8 +284,7 @@ while (Running)
             MotionVect.X = 0;
             MotionVect.Y = 0;
             MotionVect.Z = 1.0f;
-            Heading = Immerse.Get_Object("Person")->Get_GlobalAtd();
-            Mat.Rotate(Heading.X, Heading.Y, Heading.Z);
+            Mat = Immerse.Get_Object("Person")->Get_RotMatrix();
             MotionVect.Transform(Mat);
             Immerse.Get_Object("Person")->Motion_Travel_CheckCollide(MotionVect, 300, Immerse.Get_Object("TestPnl1"), CInfo);
              }
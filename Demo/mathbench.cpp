@@ -0,0 +1,134 @@
+/***************************************************************************\
+   Fast math benchmark.  Compares the accuracy and speed of the IMR_FASTMATH
+   versions of IMR_RSqrt() and IMR_Attenuate() against the plain sqrt()
+   math used without it.
+   Console app, build with: wcl386 -bt=nt -ox mathbench.cpp ..\Code\Core\IMR_Table.cpp
+\***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// Benchmark the fast versions:
+#define IMR_FASTMATH
+
+#include "../Code/Core/imr_table.hpp"
+
+// Constants:
+#define BENCH_SAMPLES     100000    // Samples for the accuracy tests
+#define BENCH_VALUES      4096      // Values cycled through in the speed tests
+#define BENCH_PASSES      2000      // Passes over the values in the speed tests
+
+// Test data:
+float Values[BENCH_VALUES], Ratios[BENCH_VALUES];
+volatile float Sink;
+
+/***************************************************************************\
+  Returns the number of seconds taken by the specified number of clock ticks.
+\***************************************************************************/
+double Seconds(clock_t Start, clock_t End)
+{
+return (double)(End - Start) / CLOCKS_PER_SEC;
+ }
+
+/***************************************************************************\
+  Checks the accuracy of IMR_RSqrt() over a wide range of squared distances.
+\***************************************************************************/
+void Test_RSqrtAccuracy(void)
+{
+double X, Exact, Error, MaxError = 0.0, TotalError = 0.0;
+
+for (int index = 0; index < BENCH_SAMPLES; index ++)
+    {
+    // Sweep from 0.0001 to 1000000 (log spaced):
+    X = pow(10.0, -4.0 + (10.0 * index / BENCH_SAMPLES));
+    Exact = 1.0 / sqrt(X);
+    Error = fabs(IMR_RSqrt((float)X) - Exact) / Exact;
+    if (Error > MaxError) MaxError = Error;
+    TotalError += Error;
+     }
+
+printf("IMR_RSqrt()     max rel error %.6f%%, avg %.6f%%\n",
+       MaxError * 100.0, (TotalError / BENCH_SAMPLES) * 100.0);
+ }
+
+/***************************************************************************\
+  Checks the accuracy of IMR_Attenuate() over the whole range of a light.
+\***************************************************************************/
+void Test_AttenAccuracy(void)
+{
+double Ratio, Exact, Error, MaxError = 0.0, TotalError = 0.0;
+
+for (int index = 0; index < BENCH_SAMPLES; index ++)
+    {
+    Ratio = (double)index / BENCH_SAMPLES;
+    Exact = 1.0 - sqrt(Ratio);
+    Error = fabs(IMR_Attenuate((float)Ratio) - Exact);
+    if (Error > MaxError) MaxError = Error;
+    TotalError += Error;
+     }
+
+printf("IMR_Attenuate() max abs error %.6f (%.2f of 255), avg %.6f\n",
+       MaxError, MaxError * 255.0, TotalError / BENCH_SAMPLES);
+ }
+
+/***************************************************************************\
+  Times the point light math for one vertex both ways: attenuation and
+  normalization from the squared distance.
+\***************************************************************************/
+void Test_Speed(void)
+{
+clock_t Start;
+double Plain, Fast;
+float Sum, Distance;
+int pass, index;
+
+// Plain math (what the lighting code did before):
+Sum = 0.0f;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_VALUES; index ++)
+        {
+        Distance = (float)sqrt(Values[index]);
+        Sum += ((100.0f - Distance) / 100.0f) * (1.0f / Distance);
+         }
+Plain = Seconds(Start, clock());
+Sink = Sum;
+
+// Fast math:
+Sum = 0.0f;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_VALUES; index ++)
+        Sum += IMR_Attenuate(Ratios[index]) * IMR_RSqrt(Values[index]);
+Fast = Seconds(Start, clock());
+Sink = Sum;
+
+// Show the results:
+printf("Plain: %.2f ns/vertex\n", (Plain * 1e9) / ((double)BENCH_PASSES * BENCH_VALUES));
+printf("Fast:  %.2f ns/vertex\n", (Fast * 1e9) / ((double)BENCH_PASSES * BENCH_VALUES));
+if (Fast > 0.0) printf("Speedup: %.2fx\n", Plain / Fast);
+ }
+
+/***************************************************************************\
+  Main.
+\***************************************************************************/
+int main(void)
+{
+// Setup the tables and the test data (squared distances within a range of 100):
+IMR_BuildTables();
+srand(1);
+for (int index = 0; index < BENCH_VALUES; index ++)
+    {
+    Values[index] = 0.01f + ((float)rand() / RAND_MAX) * 9999.0f;
+    Ratios[index] = Values[index] / 10000.0f;
+     }
+
+// Run the tests:
+printf("iMMERSE fast math benchmark\n\n");
+Test_RSqrtAccuracy();
+Test_AttenAccuracy();
+printf("\n");
+Test_Speed();
+return 0;
+ }
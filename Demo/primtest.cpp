@@ -0,0 +1,158 @@
+/***************************************************************************\
+   Primitive operator test.  Checks the IMR_3DPoint, IMR_PrjPoint and
+   IMR_Attitude operators: that they take const and temporary operands,
+   that attitudes wrap, and that assignment leaves the source alone.
+   Prints each check that fails, and returns non-zero if any did.
+   Console app, build with: wcl386 -bt=nt primtest.cpp
+\***************************************************************************/
+#include <stdio.h>
+#include "../Code/Core/imr_geom_prim.hpp"
+
+// Number of checks that failed:
+int Failed = 0;
+
+/***************************************************************************\
+  Counts and prints a failed check.
+\***************************************************************************/
+void Check(int Passed, char *What)
+{
+if (!Passed)
+    {
+    printf("FAILED: %s\n", What);
+    Failed ++;
+     }
+ }
+
+/***************************************************************************\
+  Checks that an attitude has the specified angles.
+\***************************************************************************/
+int Is_Atd(const IMR_Attitude &A, int X, int Y, int Z)
+{
+return (A.X == X && A.Y == Y && A.Z == Z);
+ }
+
+/***************************************************************************\
+  Checks that a point has the specified active coords.
+\***************************************************************************/
+int Is_Point(const IMR_3DPoint &P, float X, float Y, float Z)
+{
+return (P.aX == X && P.aY == Y && P.aZ == Z);
+ }
+
+/***************************************************************************\
+  Tests the attitude operators.
+\***************************************************************************/
+void Test_Attitude(void)
+{
+IMR_Attitude A, B, C;
+A.X = 10;  A.Y = 1000; A.Z = 512;
+B.X = 20;  B.Y = 30;   B.Z = 512;
+
+// Assignment wraps the copy and leaves the source alone:
+IMR_Attitude Big;
+Big.X = 1030; Big.Y = -4; Big.Z = 2048;
+const IMR_Attitude &Src = Big;
+C = Src;
+Check(Is_Atd(C, 6, 1020, 0), "attitude = wraps the copy");
+Check(Is_Atd(Big, 1030, -4, 2048), "attitude = leaves the source alone");
+
+// Sums and differences wrap:
+C = A + B;
+Check(Is_Atd(C, 30, 6, 0), "attitude +");
+C = A - B;
+Check(Is_Atd(C, 1014, 970, 0), "attitude -");
+C = A;
+C += B;
+Check(Is_Atd(C, 30, 6, 0), "attitude +=");
+C = A;
+C -= B;
+Check(Is_Atd(C, 1014, 970, 0), "attitude -=");
+
+// Temporaries on the right:
+C = A;
+C += A - B;
+Check(Is_Atd(C, 0, 946, 512), "attitude += temporary");
+C = (A + B) - (A - B);
+Check(Is_Atd(C, 40, 60, 0), "attitude - of temporaries");
+
+// Comparisons:
+C = A;
+Check(C == A, "attitude == equal");
+Check(!(C != A), "attitude != equal");
+Check(!(C == B), "attitude == different");
+Check(C != B, "attitude != different");
+Check(A + B == B + A, "attitude == temporaries");
+ }
+
+/***************************************************************************\
+  Tests the point operators.
+\***************************************************************************/
+void Test_Point(void)
+{
+IMR_3DPoint A, B, C;
+A.X = 1.0f; A.Y = 2.0f; A.Z = 3.0f;
+B.X = 4.0f; B.Y = 5.0f; B.Z = 6.0f;
+
+// Arithmetic:
+C = A + B;
+Check(Is_Point(C, 5.0f, 7.0f, 9.0f), "point +");
+C = B - A;
+Check(Is_Point(C, 3.0f, 3.0f, 3.0f), "point -");
+C = A * B;
+Check(Is_Point(C, 4.0f, 10.0f, 18.0f), "point *");
+C = A;
+C += B;
+Check(Is_Point(C, 5.0f, 7.0f, 9.0f), "point +=");
+C -= A;
+Check(Is_Point(C, 4.0f, 5.0f, 6.0f), "point -=");
+
+// Temporaries on the right:
+C = A + B - A * B;
+Check(Is_Point(C, 1.0f, -3.0f, -9.0f), "point chain of temporaries");
+C = A;
+C += B - A;
+Check(Is_Point(C, 4.0f, 5.0f, 6.0f), "point += temporary");
+
+// Assignment copies every set of coords and leaves the source alone:
+IMR_3DPoint Full;
+Full.X = 1.0f;  Full.Y = 2.0f;  Full.Z = 3.0f;
+Full.tX = 4.0f; Full.lY = 5.0f; Full.wZ = 6.0f;
+Full.cX = 7.0f; Full.iY = 8.0f;
+Full.IsNormal = 1;
+const IMR_3DPoint &Src = Full;
+C = Src;
+Check(Is_Point(C, 1.0f, 2.0f, 3.0f) && C.tX == 4.0f && C.lY == 5.0f &&
+      C.wZ == 6.0f && C.cX == 7.0f && C.iY == 8.0f && C.IsNormal == 1,
+      "point = copies all coords");
+Check(Is_Point(Full, 1.0f, 2.0f, 3.0f) && Full.tX == 4.0f, "point = leaves the source alone");
+
+// Comparisons:
+C = A;
+Check(C == A, "point == equal");
+Check(!(C != A), "point != equal");
+Check(!(C == B), "point == different");
+Check(C != B, "point != different");
+Check(A + B == B + A, "point == temporaries");
+
+// Projected points take the camera coords:
+IMR_PrjPoint Prj;
+Full.cY = 9.0f; Full.cZ = 10.0f;
+Prj = Src;
+Check(Prj.X == 7.0f && Prj.Y == 9.0f && Prj.Z == 10.0f, "projected point = const point");
+ }
+
+/***************************************************************************\
+  Main.
+\***************************************************************************/
+int main(void)
+{
+Test_Attitude();
+Test_Point();
+if (Failed)
+    {
+    printf("%d checks failed\n", Failed);
+    return 1;
+     }
+printf("All checks passed\n");
+return 0;
+ }
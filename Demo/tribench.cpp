@@ -0,0 +1,383 @@
+/***************************************************************************\
+   Collision triangle test benchmark.  Compares the old angle sum point in
+   triangle test and edge distance closest point with the barycentric
+   versions, and sweeping triangles one at a time against sweeping them
+   in packets.  Uses the panels and ellipsoid from collidetest.cpp.
+   Console app, build with (add -dIMR_SSE for the SSE packet code):
+     wcl386 -bt=nt -ox tribench.cpp ..\Code\Core\IMR_Collide.cpp
+       ..\Code\Core\IMR_CollideBVH.cpp ..\Code\Core\IMR_CollideMesh.cpp
+       ..\Code\Core\IMR_Geom_Model.cpp ..\Code\Core\IMR_Geom_Poly.cpp
+       ..\Code\Core\IMR_Geom_Prim_Point.cpp ..\Code\Core\IMR_Material.cpp
+       ..\Code\Core\IMR_Matrix.cpp
+       ..\Code\Core\IMR_Resource.cpp ..\Code\Core\IMR_RDFMngr.cpp
+       ..\Code\Core\IMR_Table.cpp ..\Code\CallStatus\IMR_Log.cpp
+\***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../Code/Core/imr_collide.hpp"
+
+// Constants:
+#define BENCH_SAMPLES     4096      // Points/sweeps generated
+#define BENCH_PASSES      500       // Passes over the samples in the speed tests
+#define BENCH_MAXTRIS     8         // Triangles in the scene
+
+// Test data:
+IMR_3DPoint TriA[BENCH_MAXTRIS], TriB[BENCH_MAXTRIS], TriC[BENCH_MAXTRIS], TriN[BENCH_MAXTRIS];
+IMR_3DPoint Points[BENCH_SAMPLES], Sources[BENCH_SAMPLES], Dirs[BENCH_SAMPLES];
+int PointTri[BENCH_SAMPLES];
+int Num_Tris = 0;
+volatile float Sink;
+
+/***************************************************************************\
+  Returns the number of seconds taken by the specified number of clock ticks.
+\***************************************************************************/
+double Seconds(clock_t Start, clock_t End)
+{
+return (double)(End - Start) / CLOCKS_PER_SEC;
+ }
+
+/***************************************************************************\
+  Returns a random number from Min to Max.
+\***************************************************************************/
+float Random(float Min, float Max)
+{
+return Min + ((float)rand() / RAND_MAX) * (Max - Min);
+ }
+
+/***************************************************************************\
+  The point in triangle test as it was (angle sum).
+\***************************************************************************/
+int Old_CheckPointInTriangle(IMR_3DPoint point, IMR_3DPoint a, IMR_3DPoint b, IMR_3DPoint c)
+{
+double total_angles = 0.0f;
+IMR_3DPoint v1 = point - a;
+IMR_3DPoint v2 = point - b;
+IMR_3DPoint v3 = point - c;
+
+v1.Make_Unit();
+v2.Make_Unit();
+v3.Make_Unit();
+total_angles += acos(v1.Dot_Product(v2));
+total_angles += acos(v2.Dot_Product(v3));
+total_angles += acos(v3.Dot_Product(v1));
+if (fabs((6.2848f) - total_angles) <= 0.005) return 1;
+return 0;
+ }
+
+/***************************************************************************\
+  The closest point on a segment as it was (normalizes the segment).
+\***************************************************************************/
+IMR_3DPoint Old_ClosestPointOnLine(IMR_3DPoint &a, IMR_3DPoint &b, IMR_3DPoint &p)
+{
+IMR_3DPoint c = p - a;
+IMR_3DPoint V = b - a;
+float d = V.Mag();
+V.Make_Unit();
+float t = V.Dot_Product(c);
+if (t < 0.0f) return (a);
+if (t > d) return (b);
+V.X = V.X * t;
+V.Y = V.Y * t;
+V.Z = V.Z * t;
+return (a + V);
+ }
+
+/***************************************************************************\
+  The closest point on a triangle as it was (closest of the three edges).
+\***************************************************************************/
+IMR_3DPoint Old_ClosestPointOnTriangle(IMR_3DPoint a, IMR_3DPoint b, IMR_3DPoint c, IMR_3DPoint p)
+{
+IMR_3DPoint Rab = Old_ClosestPointOnLine(a, b, p);
+IMR_3DPoint Rbc = Old_ClosestPointOnLine(b, c, p);
+IMR_3DPoint Rca = Old_ClosestPointOnLine(c, a, p);
+float dAB = (p - Rab).Mag();
+float dBC = (p - Rbc).Mag();
+float dCA = (p - Rca).Mag();
+float min = dAB;
+IMR_3DPoint result = Rab;
+if (dBC < min) { min = dBC; result = Rbc; }
+if (dCA < min) result = Rca;
+return result;
+ }
+
+/***************************************************************************\
+  Adds the triangles of a panel from collidetest.cpp at the specified
+  position and attitude (in ellipsoid space).
+\***************************************************************************/
+void Add_Panel(IMR_Model &Mdl, IMR_CollideInfo &CInfo, float X, float Y, float Z, int AtdX, int AtdY)
+{
+IMR_Matrix Mtrx;
+IMR_3DPoint V[4], N, Scale;
+int poly, vtx, Corner[6] = { 0, 1, 3, 1, 2, 3 };
+
+Scale.X = Scale.Z = CInfo.invRh; Scale.Y = CInfo.invRv;
+Mtrx.Rotate(AtdX, AtdY, 0);
+for (poly = 0; poly < Mdl.Num_Polygons; poly ++)
+    {
+    // Transform the corners and the normal:
+    for (vtx = 0; vtx < 4; vtx ++)
+        {
+        V[vtx] = *Mdl.Polygons[poly].Vtx_List[vtx];
+        V[vtx].LocalToActive();
+        V[vtx].Transform(Mtrx);
+         }
+    N = *Mdl.Polygons[poly].Normal;
+    N.LocalToActive();
+    N.Transform(Mtrx);
+    N -= V[0];
+    N.Make_Unit();
+
+    // Split into triangles:
+    for (vtx = 0; vtx < 6 && Num_Tris < BENCH_MAXTRIS; vtx += 3, Num_Tris ++)
+        {
+        TriA[Num_Tris] = V[Corner[vtx]];
+        TriB[Num_Tris] = V[Corner[vtx + 1]];
+        TriC[Num_Tris] = V[Corner[vtx + 2]];
+        TriA[Num_Tris].X += X; TriA[Num_Tris].Y += Y; TriA[Num_Tris].Z += Z;
+        TriB[Num_Tris].X += X; TriB[Num_Tris].Y += Y; TriB[Num_Tris].Z += Z;
+        TriC[Num_Tris].X += X; TriC[Num_Tris].Y += Y; TriC[Num_Tris].Z += Z;
+        TriA[Num_Tris] = TriA[Num_Tris] * Scale;
+        TriB[Num_Tris] = TriB[Num_Tris] * Scale;
+        TriC[Num_Tris] = TriC[Num_Tris] * Scale;
+        TriN[Num_Tris] = N;
+         }
+     }
+ }
+
+/***************************************************************************\
+  Makes the scene and the sample points and sweeps.
+\***************************************************************************/
+void Setup_Data(void)
+{
+IMR_Model Panel;
+IMR_CollideInfo CInfo;
+IMR_3DPoint Center;
+float u, v;
+int index, tri;
+
+// Same panels and ellipsoid as collidetest.cpp:
+CInfo.Setup_Ellipsoid(50, 50);
+Panel.Make_Wall(100, 100, 100, "Panel");
+Panel.Setup();
+Add_Panel(Panel, CInfo, 0, 0, 300, 128, 0);
+Add_Panel(Panel, CInfo, 50, 0, 250, 128, 256);
+
+// Points on the planes of the triangles (about half inside):
+srand(1);
+for (index = 0; index < BENCH_SAMPLES; index ++)
+    {
+    tri = index % Num_Tris;
+    u = Random(-0.5f, 1.5f);
+    v = Random(-0.5f, 1.5f - u);
+    Points[index].X = TriA[tri].X + ((TriB[tri].X - TriA[tri].X) * u) + ((TriC[tri].X - TriA[tri].X) * v);
+    Points[index].Y = TriA[tri].Y + ((TriB[tri].Y - TriA[tri].Y) * u) + ((TriC[tri].Y - TriA[tri].Y) * v);
+    Points[index].Z = TriA[tri].Z + ((TriB[tri].Z - TriA[tri].Z) * u) + ((TriC[tri].Z - TriA[tri].Z) * v);
+    PointTri[index] = tri;
+     }
+
+// Sweeps from around the panels toward them:
+for (index = 0; index < BENCH_SAMPLES; index ++)
+    {
+    tri = index % Num_Tris;
+    Center.X = (TriA[tri].X + TriB[tri].X + TriC[tri].X) * (1.0f / 3.0f);
+    Center.Y = (TriA[tri].Y + TriB[tri].Y + TriC[tri].Y) * (1.0f / 3.0f);
+    Center.Z = (TriA[tri].Z + TriB[tri].Z + TriC[tri].Z) * (1.0f / 3.0f);
+    Sources[index].X = Center.X + Random(-2.5f, 2.5f);
+    Sources[index].Y = Center.Y + Random(-2.5f, 2.5f);
+    Sources[index].Z = Center.Z + Random(-2.5f, 2.5f);
+    Dirs[index] = Center - Sources[index];
+    Dirs[index].X += Random(-1.0f, 1.0f);
+    Dirs[index].Make_Unit();
+     }
+ }
+
+/***************************************************************************\
+  Compares the point in triangle tests.
+\***************************************************************************/
+void Test_PointInTriangle(void)
+{
+clock_t Start;
+double Old, New;
+int pass, index, tri, Agree = 0, Inside = 0, Count;
+
+// Check they agree:
+for (index = 0; index < BENCH_SAMPLES; index ++)
+    {
+    tri = PointTri[index];
+    Inside += IMR_Collide_CheckPointInTriangle(Points[index], TriA[tri], TriB[tri], TriC[tri]);
+    if (Old_CheckPointInTriangle(Points[index], TriA[tri], TriB[tri], TriC[tri]) ==
+        (int)IMR_Collide_CheckPointInTriangle(Points[index], TriA[tri], TriB[tri], TriC[tri])) ++ Agree;
+     }
+printf("Point in triangle: %d of %d agree (%d inside)\n", Agree, BENCH_SAMPLES, Inside);
+
+// Time them:
+Count = 0;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_SAMPLES; index ++)
+        Count += Old_CheckPointInTriangle(Points[index], TriA[PointTri[index]], TriB[PointTri[index]], TriC[PointTri[index]]);
+Old = Seconds(Start, clock());
+Sink = (float)Count;
+Count = 0;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_SAMPLES; index ++)
+        Count += IMR_Collide_CheckPointInTriangle(Points[index], TriA[PointTri[index]], TriB[PointTri[index]], TriC[PointTri[index]]);
+New = Seconds(Start, clock());
+Sink = (float)Count;
+
+printf("  Angle sum:   %.2f ns/test\n", (Old * 1e9) / ((double)BENCH_PASSES * BENCH_SAMPLES));
+printf("  Barycentric: %.2f ns/test\n", (New * 1e9) / ((double)BENCH_PASSES * BENCH_SAMPLES));
+if (New > 0.0) printf("  Speedup: %.2fx\n", Old / New);
+ }
+
+/***************************************************************************\
+  Compares the closest point on triangle functions.
+\***************************************************************************/
+void Test_ClosestPoint(void)
+{
+IMR_3DPoint P1, P2, D;
+clock_t Start;
+double Old, New, MaxError = 0.0, Error;
+float Sum;
+int pass, index, tri;
+
+// Check they agree (the points are on the plane, so both should find the
+// same point for the ones outside, which is all the collision code asks for):
+for (index = 0; index < BENCH_SAMPLES; index ++)
+    {
+    tri = PointTri[index];
+    if (IMR_Collide_CheckPointInTriangle(Points[index], TriA[tri], TriB[tri], TriC[tri])) continue;
+    P1 = Old_ClosestPointOnTriangle(TriA[tri], TriB[tri], TriC[tri], Points[index]);
+    P2 = IMR_Collide_ClosestPointOnTriangle(TriA[tri], TriB[tri], TriC[tri], Points[index]);
+    D = P1 - P2;
+    Error = sqrt(D.Dot_Product(D));
+    if (Error > MaxError) MaxError = Error;
+     }
+printf("Closest point on triangle: max difference %.6f (outside points)\n", MaxError);
+
+// Time them:
+Sum = 0;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_SAMPLES; index ++)
+        Sum += Old_ClosestPointOnTriangle(TriA[PointTri[index]], TriB[PointTri[index]], TriC[PointTri[index]], Points[index]).X;
+Old = Seconds(Start, clock());
+Sink = Sum;
+Sum = 0;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_SAMPLES; index ++)
+        Sum += IMR_Collide_ClosestPointOnTriangle(TriA[PointTri[index]], TriB[PointTri[index]], TriC[PointTri[index]], Points[index]).X;
+New = Seconds(Start, clock());
+Sink = Sum;
+
+printf("  Edges:   %.2f ns/test\n", (Old * 1e9) / ((double)BENCH_PASSES * BENCH_SAMPLES));
+printf("  Regions: %.2f ns/test\n", (New * 1e9) / ((double)BENCH_PASSES * BENCH_SAMPLES));
+if (New > 0.0) printf("  Speedup: %.2fx\n", Old / New);
+ }
+
+/***************************************************************************\
+  Fills a packet with the triangles starting at the specified one.
+\***************************************************************************/
+void Fill_Packet(IMR_CollidePacket &Pkt, int First, int Num)
+{
+int slot, tri;
+
+for (slot = 0; slot < IMR_COLLIDE_PACKETSIZE; slot ++)
+    {
+    tri = (First + (slot < Num ? slot : 0)) % Num_Tris;
+    Pkt.Ax[slot] = TriA[tri].X; Pkt.Ay[slot] = TriA[tri].Y; Pkt.Az[slot] = TriA[tri].Z;
+    Pkt.Bx[slot] = TriB[tri].X; Pkt.By[slot] = TriB[tri].Y; Pkt.Bz[slot] = TriB[tri].Z;
+    Pkt.Cx[slot] = TriC[tri].X; Pkt.Cy[slot] = TriC[tri].Y; Pkt.Cz[slot] = TriC[tri].Z;
+    Pkt.Nx[slot] = TriN[tri].X; Pkt.Ny[slot] = TriN[tri].Y; Pkt.Nz[slot] = TriN[tri].Z;
+     }
+Pkt.Num = Num;
+ }
+
+/***************************************************************************\
+  Compares sweeping one triangle at a time with sweeping packets.
+\***************************************************************************/
+void Test_Sweep(void)
+{
+IMR_CollidePacket Single[BENCH_MAXTRIS], Packet[BENCH_MAXTRIS];
+IMR_CollideHit Hits[IMR_COLLIDE_PACKETSIZE], Hit;
+clock_t Start;
+double Old, New, MaxError = 0.0, Error;
+float Sum;
+int pass, index, tri, Num_Packets, Hit_Count = 0;
+
+// Make the packets (the same triangles either way):
+for (tri = 0; tri < Num_Tris; tri ++) Fill_Packet(Single[tri], tri, 1);
+Num_Packets = (Num_Tris + IMR_COLLIDE_PACKETSIZE - 1) / IMR_COLLIDE_PACKETSIZE;
+for (index = 0; index < Num_Packets; index ++)
+    Fill_Packet(Packet[index], index * IMR_COLLIDE_PACKETSIZE,
+                Num_Tris - (index * IMR_COLLIDE_PACKETSIZE) < IMR_COLLIDE_PACKETSIZE ?
+                Num_Tris - (index * IMR_COLLIDE_PACKETSIZE) : IMR_COLLIDE_PACKETSIZE);
+
+// Check they agree:
+for (index = 0; index < BENCH_SAMPLES; index ++)
+    for (tri = 0; tri < Num_Tris; tri ++)
+        {
+        IMR_Collide_SweepPacket(Single[tri], Sources[index], Dirs[index], &Hit);
+        IMR_Collide_SweepPacket(Packet[tri / IMR_COLLIDE_PACKETSIZE], Sources[index], Dirs[index], Hits);
+        Error = fabs(Hit.Distance - Hits[tri % IMR_COLLIDE_PACKETSIZE].Distance);
+        if (Error > MaxError) MaxError = Error;
+        if (Hit.Distance > 0) ++ Hit_Count;
+         }
+printf("Sweep: max difference %.6f (%d hits in %d sweeps)\n", MaxError, Hit_Count, BENCH_SAMPLES * Num_Tris);
+
+// Time them:
+Sum = 0;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_SAMPLES; index ++)
+        for (tri = 0; tri < Num_Tris; tri ++)
+            {
+            IMR_Collide_SweepPacket(Single[tri], Sources[index], Dirs[index], &Hit);
+            Sum += Hit.Distance;
+             }
+Old = Seconds(Start, clock());
+Sink = Sum;
+Sum = 0;
+Start = clock();
+for (pass = 0; pass < BENCH_PASSES; pass ++)
+    for (index = 0; index < BENCH_SAMPLES; index ++)
+        for (tri = 0; tri < Num_Packets; tri ++)
+            {
+            IMR_Collide_SweepPacket(Packet[tri], Sources[index], Dirs[index], Hits);
+            Sum += Hits[0].Distance;
+             }
+New = Seconds(Start, clock());
+Sink = Sum;
+
+printf("  One at a time: %.2f ns/triangle\n", (Old * 1e9) / ((double)BENCH_PASSES * BENCH_SAMPLES * Num_Tris));
+printf("  Packets of %d:  %.2f ns/triangle\n", IMR_COLLIDE_PACKETSIZE, (New * 1e9) / ((double)BENCH_PASSES * BENCH_SAMPLES * Num_Tris));
+if (New > 0.0) printf("  Speedup: %.2fx\n", Old / New);
+ }
+
+/***************************************************************************\
+  Main.
+\***************************************************************************/
+int main(void)
+{
+// Setup the tables and the test data:
+IMR_BuildTables();
+Setup_Data();
+
+// Run the tests:
+#ifdef IMR_SSE
+printf("iMMERSE collision triangle benchmark (SSE)\n\n");
+#else
+printf("iMMERSE collision triangle benchmark\n\n");
+#endif
+printf("%d triangles, %d samples\n\n", Num_Tris, BENCH_SAMPLES);
+Test_PointInTriangle();
+printf("\n");
+Test_ClosestPoint();
+printf("\n");
+Test_Sweep();
+return 0;
+ }